@@ -0,0 +1,136 @@
+#pragma once
+
+#include <faabric/redis/Redis.h>
+#include <faabric/util/queue.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct pollfd;
+struct redisAsyncContext;
+
+namespace faabric::redis {
+
+// Arguments of a single Redis command, e.g. { "SADD", key, value }
+using RedisCommand = std::vector<std::string>;
+
+/**
+ * A small pool of asynchronous connections to a Redis instance, shared by any
+ * number of threads.
+ *
+ * Hiredis async contexts aren't thread-safe, so all connections are driven by
+ * a single event loop thread. Callers submit commands on a lock-free queue and
+ * wake the loop, which writes everything submitted since it last woke up in
+ * one go, so independent commands are pipelined rather than each waiting on a
+ * round-trip.
+ *
+ * The commands in a single submission go over the same connection, so are
+ * executed in order, as are submissions sharing an ordering key. Other
+ * submissions may go over different connections, so callers that need to read
+ * their own writes must flush first.
+ *
+ * Stopping sends everything already submitted and waits for the replies, up
+ * to the timeout, before closing the connections.
+ *
+ * Blocking commands (e.g. BLPOP) must not be sent through the pool, as they
+ * would hold up everything queued behind them on the same connection.
+ */
+class AsyncRedis
+{
+  public:
+    AsyncRedis(const RedisInstance& instanceIn,
+               int nConnectionsIn,
+               int timeoutMsIn = DEFAULT_TIMEOUT);
+
+    ~AsyncRedis();
+
+    AsyncRedis(const AsyncRedis&) = delete;
+
+    AsyncRedis& operator=(const AsyncRedis&) = delete;
+
+    static AsyncRedis& getQueue();
+
+    std::future<void> command(RedisCommand command);
+
+    // Sends the commands back-to-back on the same connection. The future is
+    // only complete once all of them have replied, and fails if any of them
+    // fail. Submissions with the same ordering key execute in the order they
+    // were made.
+    std::future<void> pipeline(
+      std::vector<RedisCommand> commands,
+      std::optional<uint32_t> orderingKey = std::nullopt);
+
+    std::future<void> publishSchedulerResult(
+      const std::string& key,
+      const std::string& statusKey,
+      const std::vector<uint8_t>& result,
+      std::optional<uint32_t> orderingKey = std::nullopt);
+
+    // Waits for every command submitted before the call to complete
+    void flush();
+
+    int getConnectionCount() const;
+
+    void stop();
+
+  private:
+    struct PendingRequest
+    {
+        std::vector<RedisCommand> commands;
+        std::promise<void> result;
+        size_t remaining = 0;
+        std::string error;
+
+        // Only set for requests that must go over a given connection
+        int connectionIdx = -1;
+    };
+
+    struct Connection
+    {
+        redisAsyncContext* ctx = nullptr;
+        bool reading = false;
+        bool writing = false;
+    };
+
+    const RedisInstance& instance;
+    const int nConnections;
+    const int timeoutMs;
+
+    faabric::util::MultiProducerQueue<std::shared_ptr<PendingRequest>>
+      submissions;
+
+    // Submissions that flushes need to wait for
+    std::atomic<uint64_t> nSubmitted = 0;
+    std::atomic<uint64_t> nFlushed = 0;
+
+    int wakeFd = -1;
+    std::atomic<bool> wakePending = false;
+    std::atomic<bool> stopped = false;
+
+    std::jthread loopThread;
+
+    std::future<void> submit(std::shared_ptr<PendingRequest> request);
+
+    void run();
+
+    // Waits for I/O on the connections and handles it. The other vectors are
+    // scratch space kept between calls.
+    void pollOnce(std::vector<Connection>& connections,
+                  std::vector<pollfd>& pollFds,
+                  std::vector<int>& pollConnections);
+
+    void connect(Connection& conn);
+
+    void send(Connection& conn, std::shared_ptr<PendingRequest> request);
+
+    static void onReply(redisAsyncContext* ctx, void* reply, void* privdata);
+
+    static void finishCommand(PendingRequest& request,
+                              const std::string& error);
+};
+}
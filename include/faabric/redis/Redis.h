@@ -65,6 +65,18 @@ return 0
 )---";
 };
 
+// Instances are shared by all clients with the same role
+RedisInstance& getRedisInstance(RedisRole role);
+
+// A range of a value to be read into the given buffer
+struct RedisReadRange
+{
+    std::string key;
+    long offset = 0;
+    size_t length = 0;
+    uint8_t* buffer = nullptr;
+};
+
 using UniqueRedisReply =
   std::unique_ptr<redisReply, decltype(&freeReplyObject)>;
 
@@ -127,6 +139,8 @@ class Redis
                   long start,
                   long end);
 
+    void getRangesPipeline(const std::vector<RedisReadRange>& ranges);
+
     void sadd(const std::string& key, const std::string& value);
 
     void srem(const std::string& key, const std::string& value);
@@ -201,7 +215,8 @@ class Redis
     void dequeueMultiple(const std::string& queueName,
                          uint8_t* buff,
                          long buffLen,
-                         long nElems);
+                         long nElems,
+                         long startIdx = 0);
 
     // Scheduler result publish
     void publishSchedulerResult(const std::string& key,
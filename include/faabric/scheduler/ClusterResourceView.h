@@ -0,0 +1,48 @@
+#pragma once
+
+#include <faabric/proto/faabric.pb.h>
+
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace faabric::scheduler {
+
+/**
+ * Locally cached view of the resources on other hosts in the cluster, so that
+ * scheduling decisions don't need a round-trip to every candidate host.
+ *
+ * The view is refreshed periodically in the background (or before every
+ * decision that needs other hosts, if gossip is off), and whenever a host
+ * replies to a reservation. In between, slots handed out by scheduling
+ * decisions are reserved optimistically in the view, and confirmed with the
+ * hosts themselves once the decision has been made.
+ */
+class ClusterResourceView
+{
+  public:
+    void update(const std::string& host, const faabric::HostResources& res);
+
+    bool hasHost(const std::string& host);
+
+    faabric::HostResources getResources(const std::string& host);
+
+    // Claims up to the requested number of free slots on the host, returning
+    // the number claimed
+    int reserve(const std::string& host, int slotsRequested);
+
+    void release(const std::string& host, int slots);
+
+    std::set<std::string> getHosts();
+
+    void removeHost(const std::string& host);
+
+    void clear();
+
+  private:
+    std::shared_mutex mx;
+
+    std::unordered_map<std::string, faabric::HostResources> hosts;
+};
+}
@@ -9,6 +9,7 @@ enum FunctionCalls
     Unregister = 3,
     GetResources = 4,
     PendingMigrations = 5,
-    Reservation = 6
+    Reservation = 6,
+    SetFunctionResult = 7
 };
 }
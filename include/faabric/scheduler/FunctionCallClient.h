@@ -22,6 +22,9 @@ getBatchRequests();
 std::vector<std::pair<std::string, faabric::EmptyRequest>>
 getResourceRequests();
 
+std::vector<std::pair<std::string, faabric::ReservationRequest>>
+getReservationRequests();
+
 std::vector<std::pair<std::string, std::shared_ptr<faabric::PendingMigrations>>>
 getPendingMigrationsRequests();
 
@@ -31,6 +34,25 @@ getUnregisterRequests();
 void queueResourceResponse(const std::string& host,
                            faabric::HostResources& res);
 
+// Stands in for a remote host when mocking, e.g. to simulate a whole cluster.
+// Requests to the host are handled here rather than recorded.
+class MockHost
+{
+  public:
+    virtual ~MockHost() = default;
+
+    virtual faabric::HostResources getResources() = 0;
+
+    // Returns the number of slots actually reserved. Forced reservations take
+    // the slots even if they're not free.
+    virtual int tryReserve(int slots, bool force) = 0;
+
+    virtual void executeFunctions(
+      std::shared_ptr<faabric::BatchExecuteRequest> req) = 0;
+};
+
+void setMockHost(const std::string& host, std::shared_ptr<MockHost> mockHost);
+
 void clearMockRequests();
 
 // -----------------------------------
@@ -39,7 +61,8 @@ void clearMockRequests();
 class FunctionCallClient : public faabric::transport::MessageEndpointClient
 {
   public:
-    explicit FunctionCallClient(const std::string& hostIn);
+    explicit FunctionCallClient(const std::string& hostIn,
+                                bool pooled = false);
 
     void sendFlush();
 
@@ -49,8 +72,31 @@ class FunctionCallClient : public faabric::transport::MessageEndpointClient
 
     void executeFunctions(std::shared_ptr<faabric::BatchExecuteRequest> req);
 
-    int tryReserve(int requestedSlots);
+    // Sends the given messages from the request under the header's batch
+    // details, serialising them straight from the request rather than copying
+    // them into one of their own. See faabric::util::serialiseBatchSubset.
+    void executeFunctions(const faabric::BatchExecuteRequest& header,
+                          const faabric::BatchExecuteRequest& req,
+                          const std::vector<int>& msgIdxs,
+                          const std::vector<bool>& directResults);
+
+    faabric::ReservationResponse tryReserve(int requestedSlots,
+                                            bool force = false);
 
     void unregister(faabric::UnregisterRequest& req);
+
+    void setFunctionResult(faabric::Message& msg);
 };
+
+// Fetches the resources of several hosts at once. Hosts that can't be reached
+// are left out of the results.
+std::vector<std::pair<std::string, faabric::HostResources>> getResourcesOnHosts(
+  const std::vector<std::string>& hosts);
+
+// Sends reservations for the given number of slots to several hosts at once,
+// returning the responses in the same order. Hosts that can't be reached are
+// treated as having reserved nothing.
+std::vector<faabric::ReservationResponse> tryReserveOnHosts(
+  const std::vector<std::pair<std::string, int>>& reservations,
+  bool force = false);
 }
@@ -20,6 +20,8 @@ class FunctionCallServer final
     std::unique_ptr<google::protobuf::Message> doSyncRecv(
       transport::Message& message) override;
 
+    bool isHighPriority(uint8_t header, bool async) override;
+
     std::unique_ptr<google::protobuf::Message> recvFlush(const uint8_t* buffer,
                                                          size_t bufferSize);
 
@@ -38,5 +40,7 @@ class FunctionCallServer final
     void recvExecuteFunctions(const uint8_t* buffer, size_t bufferSize);
 
     void recvUnregister(const uint8_t* buffer, size_t bufferSize);
+
+    void recvSetFunctionResult(const uint8_t* buffer, size_t bufferSize);
 };
 }
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace faabric::scheduler {
+
+// A host that calls could be sent to, along with what we know about it
+struct PlacementCandidate
+{
+    std::string host;
+
+    // Free slots, or zero if we don't know
+    int freeSlots = 0;
+
+    // Whether the host already holds the function's snapshot, so only needs
+    // diffs rather than the whole thing
+    bool hasSnapshot = false;
+};
+
+/**
+ * Estimates how long it'll take calls to start on a given host, so that
+ * scheduling can prefer hosts that won't have to wait for a snapshot.
+ *
+ * A host without the snapshot has to receive it in full before it can start,
+ * but that cost is shared between all the calls it takes, so hosts with more
+ * free slots are penalised less.
+ */
+class PlacementCostModel
+{
+  public:
+    explicit PlacementCostModel(int transferMbpsIn);
+
+    // Expected time to transfer the given number of bytes
+    double getTransferMillis(size_t nBytes) const;
+
+    // Expected time per call before calls sent to the host can start
+    double getStartMillis(const PlacementCandidate& candidate,
+                          size_t snapshotBytes,
+                          int nCalls) const;
+
+    // Orders the hosts from cheapest to most expensive to send the calls to.
+    // Hosts that cost the same keep their original order.
+    std::vector<std::string> rankHosts(
+      const std::vector<PlacementCandidate>& candidates,
+      size_t snapshotBytes,
+      int nCalls) const;
+
+  private:
+    const int transferMbps;
+};
+}
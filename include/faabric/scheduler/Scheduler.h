@@ -1,9 +1,12 @@
 #pragma once
 
 #include <faabric/proto/faabric.pb.h>
+#include <faabric/scheduler/ClusterResourceView.h>
 #include <faabric/scheduler/ExecGraph.h>
 #include <faabric/scheduler/FunctionCallClient.h>
 #include <faabric/scheduler/InMemoryMessageQueue.h>
+#include <faabric/scheduler/PlacementCostModel.h>
+#include <faabric/scheduler/WeightedFairQueue.h>
 #include <faabric/snapshot/SnapshotClient.h>
 #include <faabric/snapshot/SnapshotRegistry.h>
 #include <faabric/transport/PointToPointBroker.h>
@@ -18,11 +21,12 @@
 #include <faabric/util/snapshot.h>
 #include <faabric/util/timing.h>
 
+#include <deque>
 #include <future>
 #include <shared_mutex>
 
-#define AVAILABLE_HOST_SET "available_hosts"
 #define MIGRATED_FUNCTION_RETURN_VALUE -99
+#define REJECTED_FUNCTION_RETURN_VALUE -98
 
 namespace faabric::scheduler {
 
@@ -101,6 +105,8 @@ class Executor
 
     bool isExecuting();
 
+    bool isClaimed() { return claimed; }
+
     bool isShutdown() { return _isShutdown; }
 
   protected:
@@ -163,6 +169,62 @@ class SchedulerReaperThread : public faabric::util::PeriodicBackgroundThread
     void doWork() override;
 };
 
+/**
+ * Background thread that periodically refreshes this host's view of the
+ * resources on the other hosts in the cluster.
+ */
+class ResourceGossipThread : public faabric::util::PeriodicBackgroundThread
+{
+  public:
+    void doWork() override;
+};
+
+/**
+ * Background thread that periodically tops up each function's pool of idle
+ * executors, based on how often the function has been called recently.
+ */
+class ExecutorPoolThread : public faabric::util::PeriodicBackgroundThread
+{
+  public:
+    void doWork() override;
+};
+
+/**
+ * Scheduler state that only concerns a single function. Each function has its
+ * own lock, so calls to different functions don't contend with each other.
+ */
+struct FunctionShard
+{
+    std::mutex mx;
+
+    std::vector<std::shared_ptr<Executor>> executors;
+
+    std::set<std::string> registeredHosts;
+
+    // Hosts each snapshot has already been pushed to
+    std::unordered_map<std::string, std::set<std::string>> pushedSnapshots;
+
+    // ---- Warm pool ----
+    // Message to create pre-warmed executors from. Not set for functions that
+    // haven't been executed here, or that run as threads
+    std::unique_ptr<faabric::Message> prewarmMsg = nullptr;
+
+    // Local calls since the pool was last topped up, and a moving average of
+    // them across top-ups
+    int nRecentCalls = 0;
+    double callRate = 0;
+};
+
+// Calls waiting for this host to have capacity to execute them
+struct AdmissionMetrics
+{
+    int queueDepth = 0;
+    long nQueued = 0;
+    long nRejected = 0;
+    long totalWaitMillis = 0;
+    long maxWaitMillis = 0;
+};
+
 class Scheduler
 {
   public:
@@ -197,14 +259,17 @@ class Scheduler
 
     int reapStaleExecutors();
 
+    // Creates idle executors so bursts of calls don't hit cold starts.
+    // Returns the number created.
+    int prewarmExecutors();
+
     long getFunctionExecutorCount(const faabric::Message& msg);
 
     int getFunctionRegisteredHostCount(const faabric::Message& msg);
 
-    const std::set<std::string>& getFunctionRegisteredHosts(
+    std::set<std::string> getFunctionRegisteredHosts(
       const std::string& user,
-      const std::string& function,
-      bool acquireLock = true);
+      const std::string& function);
 
     void broadcastFlush();
 
@@ -212,8 +277,16 @@ class Scheduler
 
     void setFunctionResult(faabric::Message& msg);
 
+    // Sets a result pushed straight back to this host by the host that
+    // executed the function
+    void setFunctionResultLocally(const faabric::Message& msg);
+
     faabric::Message getFunctionResult(unsigned int messageId, int timeout);
 
+    // Results and chained calls are written to Redis in the background. This
+    // waits until everything written from this host so far has landed.
+    void flushFunctionResults();
+
     void setThreadResult(const faabric::Message& msg,
                          int32_t returnValue,
                          const std::string& key,
@@ -245,9 +318,14 @@ class Scheduler
 
     size_t getCachedMessageCount();
 
+    // Called when a task finishes executing on this host, which also starts
+    // any calls queued waiting for its slot
     void vacateSlot();
 
-    int tryReserveSlots(int slotsRequested);
+    AdmissionMetrics getAdmissionMetrics();
+
+    // Forced reservations take the slots even if they're not free
+    int tryReserveSlots(int slotsRequested, bool force = false);
 
     std::string getThisHost();
 
@@ -271,6 +349,10 @@ class Scheduler
 
     void setThisHostResources(faabric::HostResources& res);
 
+    // Fetches the latest resources of all other available hosts into the
+    // cached cluster view
+    void refreshClusterResources();
+
     // ----------------------------------
     // Testing
     // ----------------------------------
@@ -323,13 +405,19 @@ class Scheduler
 
     std::atomic<bool> _isShutdown = false;
 
-    // ---- Executors ----
-    std::unordered_map<std::string, std::vector<std::shared_ptr<Executor>>>
-      executors;
+    // ---- Per-function state ----
+    std::shared_mutex shardsMx;
+    std::unordered_map<std::string, std::shared_ptr<FunctionShard>>
+      functionShards;
+
+    std::shared_ptr<FunctionShard> getFunctionShard(const std::string& funcStr);
+
+    std::vector<std::shared_ptr<FunctionShard>> getAllFunctionShards();
 
     // ---- Threads ----
     faabric::snapshot::SnapshotRegistry& reg;
 
+    std::mutex threadResultsMx;
     std::unordered_map<uint32_t, std::promise<int32_t>> threadResults;
     std::unordered_map<uint32_t, faabric::transport::Message>
       threadResultMessages;
@@ -338,43 +426,114 @@ class Scheduler
                        std::promise<std::unique_ptr<faabric::Message>>>
       localResults;
 
-    std::unordered_map<std::string, std::set<std::string>> pushedSnapshotsMap;
-
     std::mutex localResultsMutex;
 
+    // Results of remote calls that will be pushed back to this host. Callers
+    // may poll for these more than once, so the future is shared.
+    struct DirectResult
+    {
+        std::promise<faabric::Message> promise;
+        std::shared_future<faabric::Message> result;
+    };
+
+    std::unordered_map<uint32_t, DirectResult> directResults;
+
+    // When each result was pushed to this host, oldest first
+    std::deque<std::pair<uint32_t, long>> pushedResultTimes;
+
+    // Chained calls logged to Redis by messages executing on this host, until
+    // their results are set
+    std::unordered_map<uint32_t, std::vector<std::future<void>>>
+      pendingChainedLogs;
+    std::mutex chainedLogsMx;
+
     // ---- Host resources and hosts ----
     faabric::HostResources thisHostResources;
     std::atomic<int32_t> thisHostUsedSlots = 0;
 
+    int getThisHostSlots();
+
     void updateHostResources();
 
     faabric::HostResources getHostResources(const std::string& host);
-    int tryReserveHostSlots(const std::string& host, int slots);
+
+    void prepareClusterView(int nMessages,
+                            faabric::util::SchedulingTopologyHint topologyHint);
+
+    int reserveRemoteSlots(const std::string& host,
+                           int slotsRequested,
+                           int minSlots);
+
+    void confirmReservations();
+
+    // ---- Cluster resource view ----
+    ClusterResourceView clusterView;
+    ResourceGossipThread resourceGossipThread;
+
+    // Slots reserved in the view, waiting to be confirmed with the hosts
+    std::vector<std::pair<std::string, int>> pendingReservations;
+
+    // ---- Admission control ----
+    struct PendingTask
+    {
+        std::shared_ptr<faabric::BatchExecuteRequest> req;
+        int msgIdx = 0;
+        faabric::util::TimePoint queuedAt;
+    };
+
+    // Calls admitted with this host as their master hold one of its slots,
+    // just like reservations from other hosts, until they vacate it
+    std::mutex admissionMx;
+    WeightedFairQueue<PendingTask> pendingTasks;
+    AdmissionMetrics admissionMetrics;
+
+    // Calls below the given priority can't use the reserved slots
+    int getAdmissionLimit(int slots, int priority);
+
+    bool tryClaimSlot(int limit);
+
+    // Returns true if the task can start now. Otherwise it has been queued,
+    // or rejected if the queue is full.
+    bool admitTask(std::shared_ptr<faabric::BatchExecuteRequest> req,
+                   int msgIdx);
+
+    void rejectTask(faabric::Message& msg);
+
+    void startQueuedTasks();
 
     // ---- Actual scheduling ----
     SchedulerReaperThread reaperThread;
 
+    ExecutorPoolThread executorPoolThread;
+
     std::set<std::string> availableHostsCache;
 
-    std::unordered_map<std::string, std::set<std::string>> registeredHosts;
+    // All of these must be called with the function's shard locked
+    std::vector<std::string> rankHostsByLocality(
+      std::shared_ptr<faabric::BatchExecuteRequest> req,
+      FunctionShard& shard,
+      int nCalls);
 
     faabric::util::SchedulingDecision doSchedulingDecision(
       std::shared_ptr<faabric::BatchExecuteRequest> req,
+      FunctionShard& shard,
       faabric::util::SchedulingTopologyHint topologyHint);
 
     faabric::util::SchedulingDecision doCallFunctions(
       std::shared_ptr<faabric::BatchExecuteRequest> req,
       faabric::util::SchedulingDecision& decision,
-      faabric::util::FullLock& lock,
+      FunctionShard& shard,
+      faabric::util::UniqueLock& shardLock,
       faabric::util::SchedulingTopologyHint topologyHint);
 
     std::shared_ptr<Executor> claimExecutor(
       faabric::Message& msg,
-      faabric::util::FullLock& schedulerLock);
+      FunctionShard& shard,
+      faabric::util::UniqueLock& shardLock);
 
-    std::vector<std::string> getUnregisteredHosts(const std::string& user,
-                                                  const std::string& function,
-                                                  bool noCache = false);
+    std::vector<std::string> getUnregisteredHosts(
+      const std::set<std::string>& thisRegisteredHosts,
+      bool noCache = false);
 
     // ---- Accounting and debugging ----
     std::vector<faabric::Message> recordedMessagesAll;
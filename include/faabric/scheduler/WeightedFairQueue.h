@@ -0,0 +1,234 @@
+#pragma once
+
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace faabric::scheduler {
+
+/**
+ * Queue of work waiting for capacity, shared fairly between users rather than
+ * served first-come-first-served, so one user's large batch can't starve
+ * everyone else.
+ *
+ * Entries with a higher priority are always served first. Within a priority,
+ * each user gets a share in proportion to the weights on their entries, and
+ * each user's share is split between their functions the same way, so one
+ * function can't starve the user's others. Shares use virtual start times: an
+ * entry with weight w costs 1/w, and the entry that would finish soonest goes
+ * next. Users and functions that were idle don't build up credit, so can't
+ * burst ahead of everyone else when they come back.
+ *
+ * Flows are dropped once they're empty and have no claim left on the queue's
+ * virtual time, so memory only grows with the users and functions waiting.
+ *
+ * Not thread-safe, callers must do their own locking.
+ */
+template<typename T>
+class WeightedFairQueue
+{
+  public:
+    void enqueue(T item,
+                 const std::string& user,
+                 const std::string& function,
+                 int priority = 0,
+                 int weight = 1)
+    {
+        Flow& flow = flows[{ priority, user }];
+        if (flow.nEntries == 0) {
+            flow.headStart = std::max(virtualTime, flow.lastFinish);
+        }
+
+        FunctionFlow& functionFlow = flow.functions[function];
+        if (functionFlow.entries.empty()) {
+            functionFlow.headStart =
+              std::max(flow.virtualTime, functionFlow.lastFinish);
+        }
+
+        functionFlow.entries.push_back(
+          { std::move(item), 1.0 / std::max(1, weight) });
+
+        flow.nEntries++;
+        nEntries++;
+    }
+
+    T dequeue()
+    {
+        checkNotEmpty();
+
+        // Flows are ordered by priority, so the highest come last
+        auto next = flows.end();
+        typename FunctionFlows::iterator nextFunction;
+        double nextFinish = 0;
+        for (auto it = flows.rbegin(); it != flows.rend(); ++it) {
+            Flow& flow = it->second;
+            if (flow.nEntries == 0) {
+                continue;
+            }
+
+            int priority = it->first.first;
+            if (next != flows.end() && priority < next->first.first) {
+                break;
+            }
+
+            auto functionIt = getNextFunction(flow);
+            double finish =
+              flow.headStart + functionIt->second.entries.front().cost;
+            if (next == flows.end() || finish < nextFinish) {
+                next = std::prev(it.base());
+                nextFunction = functionIt;
+                nextFinish = finish;
+            }
+        }
+
+        Flow& flow = next->second;
+        FunctionFlow& functionFlow = nextFunction->second;
+        Entry entry = std::move(functionFlow.entries.front());
+        functionFlow.entries.pop_front();
+
+        // Charge the entry to its function within the user, then to the user
+        double functionStart = functionFlow.headStart;
+        functionFlow.lastFinish = functionStart + entry.cost;
+        functionFlow.headStart = functionFlow.lastFinish;
+        flow.virtualTime = std::max(flow.virtualTime, functionStart);
+
+        double start = flow.headStart;
+        flow.lastFinish = start + entry.cost;
+        flow.headStart = flow.lastFinish;
+        virtualTime = std::max(virtualTime, start);
+
+        flow.nEntries--;
+        nEntries--;
+
+        dropIdleFlows(flow);
+
+        return std::move(entry.item);
+    }
+
+    // Priority of the entry that would be dequeued next
+    int peekPriority() const
+    {
+        checkNotEmpty();
+
+        for (auto it = flows.rbegin(); it != flows.rend(); ++it) {
+            if (it->second.nEntries > 0) {
+                return it->first.first;
+            }
+        }
+
+        return 0;
+    }
+
+    size_t size() const { return nEntries; }
+
+    bool empty() const { return nEntries == 0; }
+
+    // Number of (priority, user) flows still held
+    size_t getFlowCount() const { return flows.size(); }
+
+    void clear()
+    {
+        flows.clear();
+        nEntries = 0;
+        virtualTime = 0;
+    }
+
+  private:
+    struct Entry
+    {
+        T item;
+        double cost = 0;
+    };
+
+    struct FunctionFlow
+    {
+        std::deque<Entry> entries;
+        double headStart = 0;
+        double lastFinish = 0;
+    };
+
+    using FunctionFlows = std::map<std::string, FunctionFlow>;
+
+    // The user's functions share the user's slots with their own virtual time
+    struct Flow
+    {
+        FunctionFlows functions;
+        size_t nEntries = 0;
+        double headStart = 0;
+        double lastFinish = 0;
+        double virtualTime = 0;
+    };
+
+    // Keyed on priority, then user
+    std::map<std::pair<int, std::string>, Flow> flows;
+
+    size_t nEntries = 0;
+    double virtualTime = 0;
+
+    void checkNotEmpty() const
+    {
+        if (nEntries == 0) {
+            SPDLOG_ERROR("Reading from empty fair queue");
+            throw std::runtime_error("Reading from empty fair queue");
+        }
+    }
+
+    static typename FunctionFlows::iterator getNextFunction(Flow& flow)
+    {
+        auto next = flow.functions.end();
+        double nextFinish = 0;
+        for (auto it = flow.functions.begin(); it != flow.functions.end();
+             ++it) {
+            if (it->second.entries.empty()) {
+                continue;
+            }
+
+            double finish =
+              it->second.headStart + it->second.entries.front().cost;
+            if (next == flow.functions.end() || finish < nextFinish) {
+                next = it;
+                nextFinish = finish;
+            }
+        }
+
+        return next;
+    }
+
+    // Empty flows only need keeping while they finish ahead of the virtual
+    // time, otherwise they'd start from the virtual time when they come back
+    // anyway. Once nothing is waiting, the virtual time moves past them all.
+    void dropIdleFlows(Flow& servedFlow)
+    {
+        std::erase_if(servedFlow.functions, [&servedFlow](const auto& f) {
+            return f.second.entries.empty() &&
+                   f.second.lastFinish <= servedFlow.virtualTime;
+        });
+
+        if (nEntries == 0) {
+            for (const auto& [key, flow] : flows) {
+                virtualTime = std::max(virtualTime, flow.lastFinish);
+            }
+            flows.clear();
+            return;
+        }
+
+        if (servedFlow.nEntries == 0) {
+            for (const auto& [function, functionFlow] : servedFlow.functions) {
+                servedFlow.virtualTime =
+                  std::max(servedFlow.virtualTime, functionFlow.lastFinish);
+            }
+            servedFlow.functions.clear();
+        }
+
+        std::erase_if(flows, [this](const auto& f) {
+            return f.second.nEntries == 0 &&
+                   f.second.lastFinish <= virtualTime;
+        });
+    }
+};
+}
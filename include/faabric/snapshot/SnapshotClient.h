@@ -40,7 +40,7 @@ void clearMockSnapshotRequests();
 class SnapshotClient final : public faabric::transport::MessageEndpointClient
 {
   public:
-    explicit SnapshotClient(const std::string& hostIn);
+    explicit SnapshotClient(const std::string& hostIn, bool pooled = false);
 
     void pushSnapshot(const std::string& key,
                       std::shared_ptr<faabric::util::SnapshotData> data);
@@ -58,4 +58,29 @@ class SnapshotClient final : public faabric::transport::MessageEndpointClient
       const std::string& key,
       const std::vector<faabric::util::SnapshotDiff>& diffs);
 };
+
+// -----------------------------------
+// Broadcasting
+// -----------------------------------
+
+// Splits the hosts into at most fanOut groups. The first host in each group is
+// sent to directly, and relays on to the rest of its group. With a fan-out of
+// zero or less, every host is sent to directly.
+std::vector<std::vector<std::string>> getBroadcastGroups(
+  const std::vector<std::string>& hosts,
+  int fanOut);
+
+// Pushes a snapshot, or an update to it, to several hosts concurrently. All the
+// hosts have received it once these return.
+void pushSnapshotToHosts(const std::vector<std::string>& hosts,
+                         const std::string& key,
+                         std::shared_ptr<faabric::util::SnapshotData> data,
+                         int fanOut);
+
+void pushSnapshotUpdateToHosts(
+  const std::vector<std::string>& hosts,
+  const std::string& snapshotKey,
+  const std::shared_ptr<faabric::util::SnapshotData>& data,
+  const std::vector<faabric::util::SnapshotDiff>& diffs,
+  int fanOut);
 }
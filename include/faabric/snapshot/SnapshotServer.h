@@ -21,12 +21,10 @@ class SnapshotServer final : public faabric::transport::MessageEndpointServer
       transport::Message& message) override;
 
     std::unique_ptr<google::protobuf::Message> recvPushSnapshot(
-      const uint8_t* buffer,
-      size_t bufferSize);
+      faabric::transport::Message& message);
 
     std::unique_ptr<google::protobuf::Message> recvPushSnapshotUpdate(
-      const uint8_t* buffer,
-      size_t bufferSize);
+      faabric::transport::Message& message);
 
     void recvDeleteSnapshot(const uint8_t* buffer, size_t bufferSize);
 
@@ -35,6 +33,11 @@ class SnapshotServer final : public faabric::transport::MessageEndpointServer
 
   private:
     faabric::transport::PointToPointBroker& broker;
+
+    std::vector<faabric::util::SnapshotDiff> getDiffsFromRequest(
+      const flatbuffers::Vector<flatbuffers::Offset<SnapshotDiffRequest>>*
+        diffsFb,
+      faabric::transport::Message& message);
     faabric::snapshot::SnapshotRegistry& reg;
 };
 }
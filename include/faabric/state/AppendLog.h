@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#define APPEND_LOG_SEGMENT_SIZE (1024 * 1024)
+
+namespace faabric::state {
+
+/**
+ * Log of appended values, held contiguously in large fixed-size segments
+ * rather than in one allocation per value. An index records where each value
+ * lives, so values can be read by their sequence number (i.e. the order in
+ * which they were appended).
+ *
+ * Values never span segments; one larger than the segment size gets a segment
+ * of its own. Segments are never moved once allocated, so ranges of values can
+ * be read straight out of them, one contiguous slice per segment.
+ */
+class AppendLog
+{
+  public:
+    explicit AppendLog(size_t segmentSizeIn = APPEND_LOG_SEGMENT_SIZE);
+
+    AppendLog(const AppendLog&) = delete;
+
+    AppendLog& operator=(const AppendLog&) = delete;
+
+    void append(const uint8_t* data, size_t length);
+
+    size_t size();
+
+    size_t getSegmentCount();
+
+    // Total bytes held by the given range of values
+    size_t getRangeBytes(size_t startIdx, size_t nValues);
+
+    // Calls the visitor with the contiguous slices making up the given range
+    // of values, in order. The log can't be modified until the visit is done.
+    void visitRange(
+      size_t startIdx,
+      size_t nValues,
+      const std::function<void(std::span<const uint8_t>)>& visitor);
+
+    // Copies the given range of values into the buffer, returning the number
+    // of bytes copied
+    size_t readRange(size_t startIdx,
+                     size_t nValues,
+                     uint8_t* buffer,
+                     size_t bufferLen);
+
+    void clear();
+
+  private:
+    struct Segment
+    {
+        std::unique_ptr<uint8_t[]> data;
+        size_t capacity = 0;
+        size_t used = 0;
+    };
+
+    struct Entry
+    {
+        uint32_t segmentIdx = 0;
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    const size_t segmentSize;
+
+    std::mutex mx;
+    std::vector<Segment> segments;
+    std::vector<Entry> entries;
+
+    void checkRange(size_t startIdx, size_t nValues);
+};
+}
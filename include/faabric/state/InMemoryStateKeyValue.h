@@ -1,5 +1,6 @@
 #pragma once
 
+#include <faabric/state/AppendLog.h>
 #include <faabric/state/InMemoryStateRegistry.h>
 #include <faabric/state/StateClient.h>
 #include <faabric/state/StateKeyValue.h>
@@ -8,6 +9,11 @@
 
 #include <faabric/util/clock.h>
 
+#include <unordered_map>
+
+// Version of a chunk whose contents a replica can't vouch for
+#define UNKNOWN_CHUNK_VERSION UINT64_MAX
+
 namespace faabric::state {
 enum InMemoryStateKeyStatus
 {
@@ -15,18 +21,6 @@ enum InMemoryStateKeyStatus
     MASTER,
 };
 
-class AppendedInMemoryState
-{
-  public:
-    AppendedInMemoryState(size_t lengthIn, std::unique_ptr<uint8_t[]>&& dataIn)
-      : length(lengthIn)
-      , data(std::move(dataIn))
-    {}
-
-    size_t length;
-    std::unique_ptr<uint8_t[]> data;
-};
-
 class InMemoryStateKeyValue final : public StateKeyValue
 {
   public:
@@ -49,18 +43,59 @@ class InMemoryStateKeyValue final : public StateKeyValue
 
     static void clearAll(bool global);
 
+    static void pullMultipleFromRemote(const std::vector<StateKeyValue*>& kvs);
+
+    static void pushMultipleToRemote(const DirtyStateChunks& dirtyChunks);
+
     bool isMaster();
 
-    AppendedInMemoryState& getAppendedValue(uint idx);
+    bool canEvict() override;
+
+    const std::string& getSegmentOwner(long segmentIdx);
+
+    AppendLog& getAppendLog();
+
+    uint64_t getEpoch() const;
+
+    uint64_t getChunkVersion(long chunkIdx);
+
+    std::vector<std::pair<uint32_t, uint64_t>> getChangedChunks(
+      uint64_t replicaEpoch,
+      const std::vector<uint64_t>& replicaVersions);
 
   private:
     const std::string thisIP;
+
+    // In sharded mode the value is split into fixed-size segments spread
+    // over several hosts, and the owner of the first segment acts as master
+    // for appends and size lookups
+    const bool sharded;
+    const size_t shardSize;
+    const std::vector<std::string> segmentOwners;
+
     const std::string masterIP;
     InMemoryStateKeyStatus status;
 
     InMemoryStateRegistry& stateRegistry;
 
-    std::vector<AppendedInMemoryState> appendedData;
+    AppendLog appendLog;
+
+    // Each streaming chunk has a version, bumped on the master whenever the
+    // chunk is modified. Replicas hold the versions of the chunks they last
+    // pulled, so they only need to pull the chunks that have since changed.
+    // The epoch identifies this copy of the value on the master, so replicas
+    // can tell when it's been deleted and recreated.
+    const uint64_t epoch;
+
+    std::mutex versionsMx;
+    uint64_t replicaEpoch = 0;
+    std::vector<uint64_t> chunkVersions;
+
+    void checkChunkVersionsSize();
+
+    void chunkModified(long offset, size_t length) override;
+
+    void valueEvicted() override;
 
     void pullFromRemote() override;
 
@@ -71,12 +106,27 @@ class InMemoryStateKeyValue final : public StateKeyValue
     void pushPartialToRemote(
       const std::vector<StateChunk>& dirtyChunks) override;
 
+    void pushMergeToRemote(
+      long offset,
+      const uint8_t* buffer,
+      size_t length,
+      faabric::util::SnapshotDataType dataType,
+      faabric::util::SnapshotMergeOperation operation) override;
+
     void appendToRemote(const uint8_t* data, size_t length) override;
 
     void pullAppendedFromRemote(uint8_t* data,
                                 size_t length,
+                                long startIdx,
                                 long nValues) override;
 
     void clearAppendedFromRemote() override;
+
+    std::unordered_map<std::string, std::vector<StateChunk>>
+    splitChunksByOwner(const std::vector<StateChunk>& chunks);
+
+    void pullChunksFromOwners(const std::vector<StateChunk>& chunks);
+
+    void pushChunksToOwners(const std::vector<StateChunk>& chunks);
 };
 }
@@ -3,8 +3,17 @@
 #include <shared_mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace faabric::state {
+
+// Size of a sharded value, and the hosts its segments are spread over
+struct StateShardInfo
+{
+    size_t valueSize = 0;
+    std::vector<std::string> hosts;
+};
+
 class InMemoryStateRegistry
 {
   public:
@@ -19,11 +28,26 @@ class InMemoryStateRegistry
                                           const std::string& keyIn,
                                           const std::string& thisIP);
 
+    StateShardInfo getShardInfo(const std::string& user,
+                                const std::string& key,
+                                const std::string& thisIP,
+                                size_t valueSize,
+                                bool claim);
+
+    // Forgets the shards of a deleted value on this host, and in the global
+    // registry too if requested
+    void deleteShardInfo(const std::string& user,
+                         const std::string& key,
+                         bool global);
+
     void clear();
 
   private:
     std::unordered_map<std::string, std::string> masterMap;
     std::shared_mutex masterMapMutex;
+
+    std::unordered_map<std::string, StateShardInfo> shardMap;
+    std::shared_mutex shardMapMutex;
 };
 
 InMemoryStateRegistry& getInMemoryStateRegistry();
@@ -24,6 +24,10 @@ class RedisStateKeyValue final : public StateKeyValue
 
     static void clearAll(bool global);
 
+    static void pullMultipleFromRemote(const std::vector<StateKeyValue*>& kvs);
+
+    static void pushMultipleToRemote(const DirtyStateChunks& dirtyChunks);
+
   private:
     const std::string joinedKey;
 
@@ -36,10 +40,18 @@ class RedisStateKeyValue final : public StateKeyValue
     void pushPartialToRemote(
       const std::vector<StateChunk>& dirtyChunks) override;
 
+    void pushMergeToRemote(
+      long offset,
+      const uint8_t* buffer,
+      size_t length,
+      faabric::util::SnapshotDataType dataType,
+      faabric::util::SnapshotMergeOperation operation) override;
+
     void appendToRemote(const uint8_t* data, size_t length) override;
 
     void pullAppendedFromRemote(uint8_t* data,
                                 size_t length,
+                                long startIdx,
                                 long nValues) override;
 
     void clearAppendedFromRemote() override;
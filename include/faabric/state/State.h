@@ -1,5 +1,6 @@
 #pragma once
 
+#include <faabric/state/StateFlusher.h>
 #include <faabric/state/StateKeyValue.h>
 
 #include <shared_mutex>
@@ -18,6 +19,11 @@ enum StateCalls
     ClearAppended = 5,
     PullAppended = 6,
     Delete = 7,
+    PushChunks = 8,
+    PushMerge = 9,
+    ValidateChunks = 10,
+    PullMultiple = 11,
+    PushMultiple = 12,
 };
 
 class State
@@ -40,6 +46,19 @@ class State
 
     void deleteKVLocally(const std::string& userIn, const std::string& keyIn);
 
+    // Pulls or pushes several values together, in as few requests as
+    // possible
+    void pullMultiple(const StateKeyValueList& kvs);
+
+    void pushMultiple(const StateKeyValueList& kvs);
+
+    // Pushes the value in the background, returning a future that completes
+    // once the push has been sent
+    std::shared_future<void> pushAsync(const std::shared_ptr<StateKeyValue>& kv,
+                                       bool full = false);
+
+    void flushPushes();
+
     size_t getKVCount();
 
     std::string getThisIP();
@@ -50,6 +69,8 @@ class State
     std::unordered_map<std::string, std::shared_ptr<StateKeyValue>> kvMap;
     std::shared_mutex mapMutex;
 
+    StateFlusher flusher;
+
     std::shared_ptr<StateKeyValue> doGetKV(const std::string& user,
                                            const std::string& key,
                                            bool sizeless,
@@ -19,12 +19,54 @@ class StateClient : public faabric::transport::MessageEndpointClient
 
     void pushChunks(const std::vector<StateChunk>& chunks);
 
+    void pushMerge(long offset,
+                   const uint8_t* data,
+                   size_t length,
+                   faabric::util::SnapshotDataType dataType,
+                   faabric::util::SnapshotMergeOperation operation);
+
     void pullChunks(const std::vector<StateChunk>& chunks,
                     uint8_t* bufferStart);
 
+    // Transfer chunks of a value spread over several hosts, keeping requests
+    // in flight to all the hosts at once over their pooled connections
+    static void pullChunksFromHosts(
+      const std::string& user,
+      const std::string& key,
+      const std::unordered_map<std::string, std::vector<StateChunk>>&
+        chunksByHost,
+      uint8_t* bufferStart);
+
+    static void pushChunksToHosts(
+      const std::string& user,
+      const std::string& key,
+      const std::unordered_map<std::string, std::vector<StateChunk>>&
+        chunksByHost);
+
+    static void pushMergeToHosts(
+      const std::string& user,
+      const std::string& key,
+      const std::unordered_map<std::string, std::vector<StateChunk>>&
+        chunksByHost,
+      faabric::util::SnapshotDataType dataType,
+      faabric::util::SnapshotMergeOperation operation);
+
+    // Transfer chunks of several values held on this client's host, each
+    // chunk's data pointing at the value's memory
+    void pullMultiple(const std::vector<StateKeyChunk>& chunks);
+
+    void pushMultiple(const std::vector<StateKeyChunk>& chunks);
+
+    faabric::StateValidateResponse validateChunks(
+      uint64_t epoch,
+      const std::vector<uint64_t>& versions);
+
     void append(const uint8_t* data, size_t length);
 
-    void pullAppended(uint8_t* buffer, size_t length, long nValues);
+    void pullAppended(uint8_t* buffer,
+                      size_t length,
+                      long nValues,
+                      long startIdx = 0);
 
     void clearAppended();
 
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <faabric/state/StateKeyValue.h>
+
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace faabric::state {
+
+/**
+ * Pushes state values to their masters in the background, so functions don't
+ * have to wait for their pushes to complete.
+ *
+ * Repeated pushes of the same value that are still waiting to be sent are
+ * coalesced into one. As each push sends whatever is dirty in the value at the
+ * time, later changes are picked up by the pending push. Pushes are sent by a
+ * single thread, in the order they were first requested.
+ */
+class StateFlusher
+{
+  public:
+    StateFlusher() = default;
+
+    ~StateFlusher();
+
+    StateFlusher(const StateFlusher&) = delete;
+
+    StateFlusher& operator=(const StateFlusher&) = delete;
+
+    std::shared_future<void> push(const std::shared_ptr<StateKeyValue>& kv,
+                                  bool full);
+
+    // Waits for all the pushes requested before the call, rethrowing the
+    // first failure
+    void flush();
+
+    size_t getPendingCount();
+
+    void stop();
+
+  private:
+    struct PendingPush
+    {
+        std::shared_ptr<StateKeyValue> kv;
+        bool full = false;
+        std::promise<void> promise;
+        std::shared_future<void> future;
+    };
+
+    std::mutex mx;
+    std::condition_variable cv;
+    bool stopped = false;
+
+    std::unordered_map<std::string, std::shared_ptr<PendingPush>> pending;
+    std::vector<std::shared_ptr<PendingPush>> queue;
+    std::vector<std::shared_ptr<PendingPush>> inFlight;
+
+    std::jthread flushThread;
+
+    void run();
+};
+}
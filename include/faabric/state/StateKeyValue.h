@@ -3,10 +3,14 @@
 #include <faabric/redis/Redis.h>
 #include <faabric/util/clock.h>
 #include <faabric/util/exception.h>
+#include <faabric/util/snapshot.h>
+#include <faabric/util/state.h>
 
 #include <atomic>
 #include <chrono>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 #include <string>
 #include <thread>
@@ -18,6 +22,9 @@ constexpr int REMOTE_LOCK_MAX_RETRIES(100);
 
 #define STATE_STREAMING_CHUNK_SIZE (64 * 1024)
 
+// Upper bound on the data moved in a single state transfer request
+#define STATE_TRANSFER_MAX_BYTES (1024 * 1024)
+
 namespace faabric::state {
 class StateChunk
 {
@@ -42,7 +49,24 @@ class StateChunk
     uint8_t* data;
 };
 
-class StateKeyValue
+// A chunk of a particular value, for requests covering several values
+struct StateKeyChunk
+{
+    std::string user;
+    std::string key;
+    StateChunk chunk;
+};
+
+class StateKeyValue;
+
+class StatePinScope;
+
+using StateKeyValueList = std::vector<std::shared_ptr<StateKeyValue>>;
+
+using DirtyStateChunks =
+  std::vector<std::pair<StateKeyValue*, std::vector<StateChunk>>>;
+
+class StateKeyValue : public std::enable_shared_from_this<StateKeyValue>
 {
   public:
     StateKeyValue(const std::string& userIn,
@@ -57,8 +81,21 @@ class StateKeyValue
 
     static uint32_t waitOnRedisRemoteLock(const std::string& redisKey);
 
+    // Batched operations on several values at once. The given function does
+    // the transfer for all the values together, while they're all locked.
+    static void pullMultiple(
+      const StateKeyValueList& kvs,
+      const std::function<void(const std::vector<StateKeyValue*>&)>& pullAll);
+
+    static void pushMultiple(
+      const StateKeyValueList& kvs,
+      const std::function<void(const DirtyStateChunks&)>& pushAll);
+
     void get(uint8_t* buffer);
 
+    // Pointers into the value pin it on this host until the thread's current
+    // StatePinScope ends, so it can't be evicted while they're in use.
+    // Pointers handed out outside a scope aren't protected.
     uint8_t* get();
 
     void getChunk(long offset, uint8_t* buffer, size_t length);
@@ -75,6 +112,12 @@ class StateKeyValue
 
     void getAppended(uint8_t* buffer, size_t length, long nValues);
 
+    // Reads the appended values with sequence numbers from startIdx onwards
+    void getAppendedRange(uint8_t* buffer,
+                          size_t length,
+                          long startIdx,
+                          long nValues);
+
     void clearAppended();
 
     void mapSharedMemory(void* destination, long pagesOffset, long nPages);
@@ -87,6 +130,21 @@ class StateKeyValue
 
     void pushPartialMask(const std::shared_ptr<StateKeyValue>& maskKv);
 
+    // Merges the given values into the remote copy of the chunk, e.g. adding
+    // deltas onto it, without needing a lock on the whole value
+    void pushMergeChunk(long offset,
+                        const uint8_t* buffer,
+                        size_t length,
+                        faabric::util::SnapshotDataType dataType,
+                        faabric::util::SnapshotMergeOperation operation);
+
+    // Merges the given values into this host's copy of the chunk
+    void mergeChunk(long offset,
+                    const uint8_t* buffer,
+                    size_t length,
+                    faabric::util::SnapshotDataType dataType,
+                    faabric::util::SnapshotMergeOperation operation);
+
     void lockRead();
 
     void unlockRead();
@@ -105,6 +163,14 @@ class StateKeyValue
 
     void pushFull();
 
+    // Whether this host's copy of the value can be dropped and pulled again
+    // later
+    virtual bool canEvict() { return true; }
+
+    // Drops this host's copy of the value if it's not in use, dirty, mapped
+    // or pinned, returning the number of bytes freed
+    size_t evict();
+
   protected:
     std::shared_mutex valueMutex;
 
@@ -127,6 +193,7 @@ class StateKeyValue
 
     virtual void pullAppendedFromRemote(uint8_t* data,
                                         size_t length,
+                                        long startIdx,
                                         long nValues) = 0;
 
     virtual void clearAppendedFromRemote() = 0;
@@ -134,24 +201,57 @@ class StateKeyValue
     virtual void pushPartialToRemote(
       const std::vector<StateChunk>& dirtyChunks) = 0;
 
+    // Called whenever part of the value is modified on this host
+    virtual void chunkModified(long offset, size_t length) {}
+
+    // Called when this host's copy of the value has been dropped
+    virtual void valueEvicted() {}
+
+    virtual void pushMergeToRemote(
+      long offset,
+      const uint8_t* buffer,
+      size_t length,
+      faabric::util::SnapshotDataType dataType,
+      faabric::util::SnapshotMergeOperation operation) = 0;
+
   private:
     // Flags for tracking allocation and initial pull
     std::atomic<bool> fullyAllocated = false;
     std::atomic<bool> fullyPulled = false;
-    std::unique_ptr<uint8_t[]> pulledMask = nullptr;
-    std::unique_ptr<uint8_t[]> dirtyMask = nullptr;
     bool isDirty = false;
 
-    void zeroDirtyMask();
+    // Mapped memory shares pages with the value, so mapped values can't be
+    // evicted
+    std::atomic<int> nMappings = 0;
+
+    // Number of pin scopes holding pointers into the value
+    std::atomic<int> nPins = 0;
+
+    friend class StatePinScope;
+
+    // Only modified with the full value lock
+    faabric::util::ByteRangeSet pulledRanges;
+
+    // Chunks can be flagged dirty with only a shared lock on the value
+    std::mutex dirtyRangesMx;
+    faabric::util::ByteRangeSet dirtyRanges;
+
+    void clearDirtyRanges();
 
     void configureSize();
 
     void checkSizeConfigured();
 
+    void pinForThisThread();
+
     void markDirtyChunk(long offset, long len);
 
+    void checkChunkInBounds(long offset, size_t length);
+
     bool isChunkPulled(long offset, size_t length);
 
+    size_t getPulledBytes();
+
     void allocateChunk(long offset, size_t length);
 
     void reserveStorage();
@@ -162,9 +262,38 @@ class StateKeyValue
 
     void doPushPartial(const uint8_t* dirtyMaskBytes);
 
+    std::vector<StateChunk> getDirtyChunks();
+
     std::vector<StateChunk> getDirtyChunks(const uint8_t* dirtyMaskBytes);
 };
 
+// Pins the values that this thread gets pointers into while the scope is
+// open. Scopes nest, and each releases its own pins when it ends.
+class StatePinScope
+{
+  public:
+    StatePinScope();
+
+    ~StatePinScope();
+
+    StatePinScope(const StatePinScope&) = delete;
+
+    StatePinScope& operator=(const StatePinScope&) = delete;
+
+    // Releases the pins early, e.g. before the end of the enclosing block
+    void release();
+
+    // Pins the value in this thread's innermost open scope, if any
+    static void pinInCurrentScope(StateKeyValue* kv);
+
+  private:
+    StatePinScope* parent = nullptr;
+
+    bool released = false;
+
+    std::unordered_map<StateKeyValue*, std::shared_ptr<StateKeyValue>> pinned;
+};
+
 class StateKeyValueException : public std::runtime_error
 {
   public:
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace faabric::state {
+
+class StateKeyValue;
+
+struct StateCacheStats
+{
+    long hits = 0;
+    long misses = 0;
+    long evictions = 0;
+    size_t evictedBytes = 0;
+    size_t residentBytes = 0;
+};
+
+/**
+ * Keeps the memory used by replicas of state values on this host within the
+ * configured limit, by evicting the least recently used replicas that aren't
+ * dirty, mapped or pinned by pointers handed out to a running task. Evicted
+ * values are pulled again when next accessed.
+ *
+ * Values are only held by weak pointer, so tracking a value doesn't keep it
+ * alive.
+ */
+class StateMemoryTracker
+{
+  public:
+    // Records an access to the value, and the number of bytes of it now held
+    // on this host. Misses may trigger evictions of other values.
+    void recordAccess(StateKeyValue* kv, bool hit, size_t residentBytes);
+
+    StateCacheStats getStats();
+
+    void clear();
+
+  private:
+    struct TrackedValue
+    {
+        std::weak_ptr<StateKeyValue> kv;
+        StateKeyValue* kvPtr = nullptr;
+        size_t bytes = 0;
+    };
+
+    std::mutex mx;
+
+    // Most recently used at the front
+    std::list<TrackedValue> lru;
+    std::unordered_map<StateKeyValue*, std::list<TrackedValue>::iterator>
+      lruIndex;
+
+    StateCacheStats stats;
+
+    void evictIfNeeded(StateKeyValue* accessed);
+};
+
+StateMemoryTracker& getStateMemoryTracker();
+}
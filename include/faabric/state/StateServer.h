@@ -31,6 +31,23 @@ class StateServer final : public faabric::transport::MessageEndpointServer
     std::unique_ptr<google::protobuf::Message> recvPush(const uint8_t* buffer,
                                                         size_t bufferSize);
 
+    std::unique_ptr<google::protobuf::Message> recvPushChunks(
+      transport::Message& message);
+
+    std::unique_ptr<google::protobuf::Message> recvPushMerge(
+      transport::Message& message);
+
+    std::unique_ptr<google::protobuf::Message> recvValidateChunks(
+      const uint8_t* buffer,
+      size_t bufferSize);
+
+    std::unique_ptr<google::protobuf::Message> recvPullMultiple(
+      const uint8_t* buffer,
+      size_t bufferSize);
+
+    std::unique_ptr<google::protobuf::Message> recvPushMultiple(
+      transport::Message& message);
+
     std::unique_ptr<google::protobuf::Message> recvAppend(const uint8_t* buffer,
                                                           size_t bufferSize);
 
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <faabric/transport/Message.h>
+#include <faabric/transport/MessageEndpoint.h>
+#include <faabric/util/latch.h>
+#include <faabric/util/queue.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace faabric::transport {
+
+/**
+ * A small pool of long-lived connections to a single remote server, which can
+ * be shared by any number of threads.
+ *
+ * ZeroMQ sockets must only be used from the thread that created them, so all
+ * the sockets live in a dedicated I/O thread. Callers submit requests on a
+ * lock-free queue and wake the I/O thread, which sends them and hands back
+ * any responses through futures. Async messages all go over the same socket,
+ * so messages from a given thread arrive in the order they were sent.
+ */
+class ConnectionPool
+{
+  public:
+    ConnectionPool(const std::string& hostIn,
+                   int asyncPortIn,
+                   int syncPortIn,
+                   int nConnectionsIn,
+                   int timeoutMsIn = DEFAULT_SOCKET_TIMEOUT_MS);
+
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    void asyncSend(uint8_t header,
+                   const uint8_t* data,
+                   size_t dataSize,
+                   int sequenceNum = NO_SEQUENCE_NUM);
+
+    Message syncSend(uint8_t header,
+                     const uint8_t* data,
+                     size_t dataSize,
+                     const MessageParts& parts = {});
+
+    // Submits a sync request without waiting, so callers can keep several
+    // requests in flight. The response must be collected with awaitResponse.
+    std::future<Message> submitSync(uint8_t header,
+                                    const uint8_t* data,
+                                    size_t dataSize,
+                                    const MessageParts& parts = {});
+
+    // Shared parts aren't copied, so the same ones can be submitted to any
+    // number of pools, e.g. when broadcasting
+    std::future<Message> submitSync(uint8_t header,
+                                    const uint8_t* data,
+                                    size_t dataSize,
+                                    SharedMessageParts parts);
+
+    Message awaitResponse(std::future<Message>& response);
+
+    int getConnectionCount() const;
+
+    void stop();
+
+  private:
+    struct PoolRequest
+    {
+        uint8_t header = 0;
+        int sequenceNum = NO_SEQUENCE_NUM;
+        std::vector<uint8_t> data;
+        SharedMessageParts parts;
+
+        // Only set for sync requests
+        std::unique_ptr<std::promise<Message>> response = nullptr;
+    };
+
+    const std::string host;
+    const int asyncPort;
+    const int syncPort;
+    const int nConnections;
+    const int timeoutMs;
+
+    faabric::util::MultiProducerQueue<PoolRequest> submissions;
+
+    int wakeFd = -1;
+    std::atomic<bool> wakePending = false;
+    std::atomic<bool> stopped = false;
+
+    std::jthread ioThread;
+
+    void submit(PoolRequest&& request);
+
+    void run(std::shared_ptr<faabric::util::Latch> startupLatch);
+};
+
+std::shared_ptr<ConnectionPool> getConnectionPool(const std::string& host,
+                                                  int asyncPort,
+                                                  int syncPort,
+                                                  int nConnections = 0);
+
+void clearConnectionPools();
+}
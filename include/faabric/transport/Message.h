@@ -1,6 +1,9 @@
 #pragma once
 
+#include <memory>
+#include <span>
 #include <string>
+#include <vector>
 #include <zmq.hpp>
 
 #define NO_SEQUENCE_NUM -1
@@ -21,7 +24,8 @@ enum MessageResponseCode
 /**
  * Represents message data passed around the transport layer. Essentially an
  * array of bytes, with a size and a flag to say whether there's more data to
- * follow.
+ * follow. Vectored sends can also attach further parts after the body, which
+ * are kept in the frames they were received in, rather than copied.
  *
  * Messages are not copyable, only movable, as they will regularly contain large
  * amounts of data.
@@ -60,9 +64,17 @@ class Message
 
     int getSequenceNum() const { return _sequenceNum; };
 
+    void addPart(zmq::message_t&& part);
+
+    std::vector<std::span<const uint8_t>> getParts() const;
+
   private:
     std::vector<uint8_t> buffer;
 
+    // Small frames hold their data inline, so we keep each frame at a fixed
+    // address to make sure spans over the parts stay valid if we're moved
+    std::vector<std::unique_ptr<zmq::message_t>> parts;
+
     MessageResponseCode responseCode = MessageResponseCode::SUCCESS;
 
     uint8_t _header = 0;
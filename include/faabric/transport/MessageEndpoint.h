@@ -3,8 +3,11 @@
 #include <faabric/transport/Message.h>
 #include <faabric/util/exception.h>
 
+#include <memory>
 #include <optional>
+#include <span>
 #include <thread>
+#include <vector>
 #include <zmq.hpp>
 
 // Defined in libzmq/include/zmq.h
@@ -29,11 +32,37 @@
 #define NO_HEADER 0
 #define HEADER_MSG_SIZE (sizeof(uint8_t) + sizeof(size_t) + sizeof(int))
 
+// Lower bound on the adaptive busy-poll before a blocking receive
+#define MIN_BUSY_POLL_US 1
+
+// Smaller parts of a vectored send are copied, as it's cheaper than having
+// ZeroMQ track and release the memory
+#define MIN_ZERO_COPY_BYTES 1024
+
 #define SHUTDOWN_HEADER 220
 static const std::vector<uint8_t> shutdownPayload = { 0, 0, 1, 1 };
 
 namespace faabric::transport {
 
+// Frames in front of a request on a router socket, up to the empty delimiter,
+// which must be sent back in front of the response
+typedef std::vector<std::vector<uint8_t>> RoutingEnvelope;
+
+// Separate regions of memory sent as extra frames after a message body
+typedef std::vector<std::span<const uint8_t>> MessageParts;
+
+// A part whose memory is kept alive by its owner until ZeroMQ has sent it, so
+// the same memory can be queued on several sockets without being copied
+struct SharedMessagePart
+{
+    std::span<const uint8_t> data;
+    std::shared_ptr<const void> owner;
+};
+
+typedef std::vector<SharedMessagePart> SharedMessageParts;
+
+struct ZeroCopyTracker;
+
 enum MessageEndpointConnectType
 {
     BIND = 0,
@@ -73,15 +102,43 @@ class MessageEndpoint
                      size_t dataSize,
                      int sequenceNumber = NO_SEQUENCE_NUM);
 
-    Message recvMessage(zmq::socket_t& socket, bool async);
+    void sendMessageParts(zmq::socket_t& socket,
+                          uint8_t header,
+                          const uint8_t* data,
+                          size_t dataSize,
+                          const MessageParts& parts,
+                          bool zeroCopy);
 
-  private:
-    Message recvBuffer(zmq::socket_t& socket, size_t size);
+    void sendSharedMessageParts(zmq::socket_t& socket,
+                                uint8_t header,
+                                const uint8_t* data,
+                                size_t dataSize,
+                                const SharedMessageParts& parts);
+
+    void awaitZeroCopyRelease();
+
+    Message recvMessage(zmq::socket_t& socket, bool async);
 
     void sendBuffer(zmq::socket_t& socket,
                     const uint8_t* data,
                     size_t dataSize,
                     bool more);
+
+    void sendEnvelope(zmq::socket_t& socket, const RoutingEnvelope& envelope);
+
+  private:
+    std::shared_ptr<ZeroCopyTracker> zeroCopyTracker = nullptr;
+
+    Message recvBuffer(zmq::socket_t& socket, size_t size);
+
+    void sendHeader(zmq::socket_t& socket,
+                    uint8_t header,
+                    size_t dataSize,
+                    int sequenceNum);
+
+    void sendZeroCopy(zmq::socket_t& socket,
+                      std::span<const uint8_t> part,
+                      bool more);
 };
 
 class AsyncSendMessageEndpoint final : public MessageEndpoint
@@ -128,10 +185,38 @@ class SyncSendMessageEndpoint final : public MessageEndpoint
                               const uint8_t* data,
                               size_t dataSize);
 
+    Message sendAwaitResponse(uint8_t header,
+                              const uint8_t* data,
+                              size_t dataSize,
+                              const MessageParts& parts);
+
   private:
     zmq::socket_t reqSocket;
 };
 
+/**
+ * Sends sync requests on a DEALER socket which, unlike a REQ socket, can have
+ * many requests in flight at once. Each request is tagged with an ID, which is
+ * returned along with its response.
+ */
+class SyncDealerMessageEndpoint final : public MessageEndpoint
+{
+  public:
+    SyncDealerMessageEndpoint(const std::string& hostIn,
+                              int portIn,
+                              int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS);
+
+    void sendRequest(uint64_t requestId,
+                     uint8_t header,
+                     const uint8_t* data,
+                     size_t dataSize,
+                     const SharedMessageParts& parts = {});
+
+    Message recvResponse(uint64_t& requestId);
+
+    zmq::socket_t socket;
+};
+
 class RecvMessageEndpoint : public MessageEndpoint
 {
   public:
@@ -158,52 +243,6 @@ class RecvMessageEndpoint : public MessageEndpoint
     Message doRecv(bool async);
 };
 
-class FanInMessageEndpoint : public RecvMessageEndpoint
-{
-  public:
-    FanInMessageEndpoint(int portIn,
-                         int timeoutMs,
-                         zmq::socket_type socketType);
-
-    void attachFanOut(zmq::socket_t& fanOutSock);
-
-    void stop();
-
-  private:
-    zmq::socket_t controlSock;
-    std::string controlSockAddress;
-};
-
-class AsyncFanOutMessageEndpoint final : public MessageEndpoint
-{
-  public:
-    AsyncFanOutMessageEndpoint(const std::string& inProcLabel,
-                               int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS);
-
-    zmq::socket_t socket;
-};
-
-class AsyncFanInMessageEndpoint final : public FanInMessageEndpoint
-{
-  public:
-    AsyncFanInMessageEndpoint(int portIn,
-                              int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS);
-};
-
-class SyncFanOutMessageEndpoint final : public RecvMessageEndpoint
-{
-  public:
-    SyncFanOutMessageEndpoint(const std::string& inProcLabel,
-                              int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS);
-};
-
-class SyncFanInMessageEndpoint final : public FanInMessageEndpoint
-{
-  public:
-    SyncFanInMessageEndpoint(int portIn,
-                             int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS);
-};
-
 class AsyncRecvMessageEndpoint final : public RecvMessageEndpoint
 {
   public:
@@ -220,9 +259,19 @@ class AsyncInternalRecvMessageEndpoint final : public RecvMessageEndpoint
 {
   public:
     AsyncInternalRecvMessageEndpoint(const std::string& inprocLabel,
-                                     int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS);
+                                     int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS,
+                                     int busyPollUsIn = 0);
 
     Message recv() override;
+
+  private:
+    // Receives can spin for up to this long before blocking. The actual spin
+    // adapts between the minimum and this bound depending on whether recent
+    // spins found a message.
+    const int maxBusyPollUs;
+    int busyPollUs;
+
+    bool busyPoll();
 };
 
 class SyncRecvMessageEndpoint final : public RecvMessageEndpoint
@@ -239,6 +288,46 @@ class SyncRecvMessageEndpoint final : public RecvMessageEndpoint
     void sendResponse(uint8_t header, const uint8_t* data, size_t dataSize);
 };
 
+/**
+ * Receives sync requests from remote clients on a ROUTER socket, keeping track
+ * of which client sent each one. Responses are handed back over an internal
+ * PULL socket, and relayed to the relevant client.
+ */
+class SyncRouterMessageEndpoint final : public MessageEndpoint
+{
+  public:
+    SyncRouterMessageEndpoint(int portIn,
+                              const std::string& inprocLabel,
+                              int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS);
+
+    void poll(bool& requestReady, bool& responseReady);
+
+    Message recv(RoutingEnvelope& envelope);
+
+    bool forwardResponse();
+
+  private:
+    zmq::socket_t routerSocket;
+    zmq::socket_t responseSocket;
+};
+
+class SyncResponseSendEndpoint final : public MessageEndpoint
+{
+  public:
+    SyncResponseSendEndpoint(const std::string& inprocLabel,
+                             int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS);
+
+    void sendResponse(const RoutingEnvelope& envelope,
+                      uint8_t header,
+                      const uint8_t* data,
+                      size_t dataSize);
+
+    void sendStopped();
+
+  private:
+    zmq::socket_t socket;
+};
+
 class AsyncDirectRecvEndpoint final : public RecvMessageEndpoint
 {
   public:
@@ -2,17 +2,23 @@
 
 #include <faabric/flat/faabric_generated.h>
 #include <faabric/proto/faabric.pb.h>
+#include <faabric/transport/ConnectionPool.h>
 #include <faabric/transport/Message.h>
 #include <faabric/transport/MessageEndpoint.h>
 
 namespace faabric::transport {
+
+// By default a client owns its sockets, so it must only be used from the
+// thread that created it. Pooled clients instead go through the shared
+// connection pool for the remote host, so they can be used from any thread.
 class MessageEndpointClient
 {
   public:
     MessageEndpointClient(std::string hostIn,
                           int asyncPort,
                           int syncPort,
-                          int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS);
+                          int timeoutMs = DEFAULT_SOCKET_TIMEOUT_MS,
+                          bool pooled = false);
 
     void asyncSend(int header,
                    google::protobuf::Message* msg,
@@ -32,6 +38,20 @@ class MessageEndpointClient
                   size_t bufferSize,
                   google::protobuf::Message* response);
 
+    // Sends the parts after the message in their own frames, avoiding
+    // copying them into one buffer. The parts must not be modified until
+    // the call returns.
+    void syncSend(int header,
+                  google::protobuf::Message* msg,
+                  const MessageParts& parts,
+                  google::protobuf::Message* response);
+
+    void syncSend(int header,
+                  const uint8_t* buffer,
+                  size_t bufferSize,
+                  const MessageParts& parts,
+                  google::protobuf::Message* response);
+
   protected:
     const std::string host;
 
@@ -39,8 +59,12 @@ class MessageEndpointClient
 
     const int syncPort;
 
-    faabric::transport::AsyncSendMessageEndpoint asyncEndpoint;
+    std::unique_ptr<faabric::transport::AsyncSendMessageEndpoint>
+      asyncEndpoint = nullptr;
+
+    std::unique_ptr<faabric::transport::SyncSendMessageEndpoint> syncEndpoint =
+      nullptr;
 
-    faabric::transport::SyncSendMessageEndpoint syncEndpoint;
+    std::shared_ptr<ConnectionPool> pool = nullptr;
 };
 }
@@ -4,6 +4,7 @@
 #include <faabric/transport/Message.h>
 #include <faabric/transport/MessageEndpoint.h>
 #include <faabric/util/latch.h>
+#include <faabric/util/queue.h>
 
 #include <thread>
 
@@ -12,7 +13,8 @@
 namespace faabric::transport {
 
 // Each server has two underlying sockets, one for synchronous communication and
-// one for asynchronous. Each is run inside its own background thread.
+// one for asynchronous. Each is run inside its own background thread, which
+// hands requests to a pool of worker threads.
 class MessageEndpointServer;
 
 class MessageEndpointServerHandler
@@ -28,6 +30,14 @@ class MessageEndpointServerHandler
     void join();
 
   private:
+    // Request passed from the receiver thread to a worker. For sync requests
+    // we keep the routing envelope so the response can be sent back.
+    struct Request
+    {
+        Message message;
+        RoutingEnvelope envelope;
+    };
+
     MessageEndpointServer* server;
     bool async = false;
     const std::string inprocLabel;
@@ -37,11 +47,17 @@ class MessageEndpointServerHandler
 
     std::vector<std::jthread> workerThreads;
 
-    std::unique_ptr<SyncFanInMessageEndpoint> syncFanIn = nullptr;
-    std::unique_ptr<SyncFanOutMessageEndpoint> syncFanOut = nullptr;
+    std::unique_ptr<faabric::util::WorkStealingQueue<Request>> queue = nullptr;
+
+    void runAsyncReceiver(int timeoutMs,
+                          std::shared_ptr<faabric::util::Latch> startupLatch);
+
+    void runSyncReceiver(int timeoutMs,
+                         std::shared_ptr<faabric::util::Latch> startupLatch);
 
-    std::unique_ptr<AsyncFanInMessageEndpoint> asyncFanIn = nullptr;
-    std::unique_ptr<AsyncFanOutMessageEndpoint> asyncFanOut = nullptr;
+    void dispatch(Message&& message, RoutingEnvelope envelope);
+
+    Request nextRequest(int workerIdx, int timeoutMs);
 };
 
 class MessageEndpointServer
@@ -70,6 +86,11 @@ class MessageEndpointServer
     virtual std::unique_ptr<google::protobuf::Message> doSyncRecv(
       transport::Message& message) = 0;
 
+    // Requests with a high priority header are handled before any others
+    // waiting for a worker, e.g. small control messages queued behind bulk
+    // transfers
+    virtual bool isHighPriority(uint8_t header, bool async);
+
   private:
     friend class MessageEndpointServerHandler;
 
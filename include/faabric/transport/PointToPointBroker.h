@@ -1,17 +1,20 @@
 #pragma once
 
 #include <faabric/transport/PointToPointClient.h>
+#include <faabric/util/clock.h>
 #include <faabric/util/config.h>
 #include <faabric/util/locks.h>
 #include <faabric/util/scheduling.h>
 
 #include <atomic>
 #include <condition_variable>
+#include <map>
 #include <queue>
 #include <set>
 #include <shared_mutex>
 #include <stack>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -90,6 +93,8 @@ class PointToPointBroker
   public:
     PointToPointBroker();
 
+    ~PointToPointBroker();
+
     std::string getHostForReceiver(int groupId, int recvIdx);
 
     std::set<std::string> setUpLocalMappingsFromSchedulingDecision(
@@ -126,6 +131,8 @@ class PointToPointBroker
                                      int recvIdx,
                                      bool mustOrderMsg = false);
 
+    void flushMessages();
+
     void clearGroup(int groupId);
 
     void clear();
@@ -135,6 +142,19 @@ class PointToPointBroker
   private:
     faabric::util::SystemConfig& conf;
 
+    // Messages held back by a client are flushed by this thread once their
+    // window expires, in case the sender never touches the client again
+    std::mutex flushMx;
+    std::condition_variable flushCv;
+    bool flushStopped = false;
+    std::multimap<faabric::util::TimePoint, std::weak_ptr<PointToPointClient>>
+      flushDeadlines;
+    std::jthread flushThread;
+
+    void scheduleFlush(std::shared_ptr<PointToPointClient> client);
+
+    void runFlushThread();
+
     std::shared_mutex brokerMutex;
 
     std::unordered_map<int, std::set<int>> groupIdIdxsMap;
@@ -10,5 +10,6 @@ enum PointToPointCall
     LOCK_GROUP_RECURSIVE = 3,
     UNLOCK_GROUP = 4,
     UNLOCK_GROUP_RECURSIVE = 5,
+    MESSAGE_BATCH = 6,
 };
 }
@@ -3,6 +3,9 @@
 #include <faabric/proto/faabric.pb.h>
 #include <faabric/transport/MessageEndpointClient.h>
 #include <faabric/transport/PointToPointCall.h>
+#include <faabric/util/clock.h>
+
+#include <mutex>
 
 namespace faabric::transport {
 
@@ -12,6 +15,9 @@ getSentMappings();
 std::vector<std::pair<std::string, faabric::PointToPointMessage>>
 getSentPointToPointMessages();
 
+std::vector<std::pair<std::string, faabric::PointToPointMessageBatch>>
+getSentPointToPointMessageBatches();
+
 std::vector<std::tuple<std::string,
                        faabric::transport::PointToPointCall,
                        faabric::PointToPointMessage>>
@@ -29,6 +35,12 @@ class PointToPointClient : public faabric::transport::MessageEndpointClient
     void sendMessage(faabric::PointToPointMessage& msg,
                      int sequenceNum = NO_SEQUENCE_NUM);
 
+    void flushMessages();
+
+    int getPendingMessageCount();
+
+    long getCoalesceWindowUs() const { return coalesceWindowUs; }
+
     void groupLock(int appId,
                    int groupId,
                    int groupIdx,
@@ -40,6 +52,22 @@ class PointToPointClient : public faabric::transport::MessageEndpointClient
                      bool recursive = false);
 
   private:
+    // Small messages may be held back and sent to the remote host in a single
+    // batch. Clients are cached per-thread by the broker, but its flusher
+    // thread may also send held messages once their window expires, so the
+    // batch and all asynchronous sends are guarded by the same mutex.
+    const size_t coalesceBytes;
+    const long coalesceWindowUs;
+
+    std::mutex pendingMx;
+    faabric::PointToPointMessageBatch pendingBatch;
+    size_t pendingBytes = 0;
+    faabric::util::TimePoint pendingSince;
+
+    void doSendMessage(faabric::PointToPointMessage& msg, int sequenceNum);
+
+    void doFlushMessages();
+
     void makeCoordinationRequest(int appId,
                                  int groupId,
                                  int groupIdx,
@@ -18,12 +18,16 @@ class PointToPointServer final : public MessageEndpointServer
     std::unique_ptr<google::protobuf::Message> doSyncRecv(
       transport::Message& message) override;
 
+    bool isHighPriority(uint8_t header, bool async) override;
+
     void onWorkerStop() override;
 
     std::unique_ptr<google::protobuf::Message> doRecvMappings(
       const uint8_t* buffer,
       size_t bufferSize);
 
+    void recvMessageBatch(const uint8_t* buffer, size_t bufferSize);
+
     void recvGroupLock(const uint8_t* buffer,
                        size_t bufferSize,
                        bool recursive);
@@ -4,7 +4,8 @@
 #include <zmq.hpp>
 
 // We specify a number of background I/O threads when constructing the ZeroMQ
-// context. Guidelines on how to scale this can be found here:
+// context, which can be overridden with TRANSPORT_IO_THREADS. Guidelines on
+// how to scale this can be found here:
 // https://zguide.zeromq.org/docs/chapter2/#I-O-Threads
 
 #define ZMQ_CONTEXT_IO_THREADS 1
@@ -28,6 +28,14 @@
         syncSend(T, _buffer, _size, &_response);                               \
     }
 
+#define SEND_FB_MSG_PARTS(T, _mb, _parts)                                      \
+    {                                                                          \
+        const uint8_t* _buffer = _mb.GetBufferPointer();                       \
+        int _size = _mb.GetSize();                                             \
+        faabric::EmptyResponse _response;                                      \
+        syncSend(T, _buffer, _size, _parts, &_response);                       \
+    }
+
 #define SEND_FB_MSG_ASYNC(T, _mb)                                              \
     {                                                                          \
         const uint8_t* _buffer = _mb.GetBufferPointer();                       \
@@ -24,12 +24,23 @@ class SystemConfig
     std::string redisStateHost;
     std::string redisQueueHost;
     std::string redisPort;
+    int redisPoolSize;
 
     // Scheduling
     int noScheduler;
     int overrideCpuCount;
     std::string noTopologyHints;
     int noSingleHostOptimisations;
+    int resourceGossipIntervalSeconds;
+    int snapshotBroadcastFanOut;
+    int executorPoolMin;
+    int executorPoolMax;
+    int executorPoolIntervalSeconds;
+    std::string functionResultMode;
+    std::string placementPolicy;
+    int snapshotTransferMbps;
+    int hostQueueCapacity;
+    int reservedPrioritySlots;
 
     // Worker-related timeouts
     int globalMessageTimeout;
@@ -51,6 +62,20 @@ class SystemConfig
     int stateServerThreads;
     int snapshotServerThreads;
     int pointToPointServerThreads;
+    int pointToPointCoalesceBytes;
+    int pointToPointCoalesceWindowUs;
+    int pointToPointBusyPollUs;
+    int transportIoThreads;
+    std::string transportIoCpus;
+    std::string transportServerCpus;
+    int transportClientPoolSize;
+    std::string transportBindHost;
+
+    // State
+    int stateShardSize;
+    int stateTransferWindow;
+    int stateTransferConnections;
+    int stateMemoryLimitMb;
 
     // Dirty tracking
     std::string dirtyTrackingMode;
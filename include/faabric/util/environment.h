@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace faabric::util {
 std::string getEnvVar(const std::string& key, const std::string& deflt);
@@ -10,4 +11,10 @@ std::string setEnvVar(const std::string& varName, const std::string& value);
 void unsetEnvVar(const std::string& varName);
 
 unsigned int getUsableCores();
+
+std::vector<int> parseCpuList(const std::string& cpuList);
+
+std::vector<int> filterUsableCpus(const std::vector<int>& cpus);
+
+bool pinThisThreadToCpus(const std::vector<int>& cpus);
 }
@@ -44,6 +44,19 @@ std::string statusKeyFromMessageId(unsigned int mid);
 
 std::vector<uint8_t> messageToBytes(const faabric::Message& msg);
 
+/*
+ * Serialises the header request as if the given messages from the original
+ * request had been added to it, without copying them. Each message has its
+ * executesLocally flag cleared, and its directResult flag set if requested.
+ * The flags are appended to each message, so the output parses to the same
+ * request as a copy would, but its bytes are not the same.
+ */
+std::vector<uint8_t> serialiseBatchSubset(
+  const faabric::BatchExecuteRequest& header,
+  const faabric::BatchExecuteRequest& req,
+  const std::vector<int>& msgIdxs,
+  const std::vector<bool>& directResults);
+
 std::vector<std::string> getArgvForMessage(const faabric::Message& msg);
 
 /*
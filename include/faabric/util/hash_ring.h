@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#define DEFAULT_HASH_RING_REPLICAS 64
+
+namespace faabric::util {
+
+/**
+ * Hash of a string that is the same on every host, unlike std::hash, so it
+ * can be used to agree on placement across the cluster.
+ */
+uint64_t stableHash(const std::string& input);
+
+/**
+ * Consistent hash ring for spreading keys over a set of nodes. Each node is
+ * placed at several points on the ring so that keys spread evenly, and adding
+ * or removing a node only moves the keys that hash next to its points.
+ */
+class HashRing
+{
+  public:
+    explicit HashRing(const std::vector<std::string>& nodesIn,
+                      int replicas = DEFAULT_HASH_RING_REPLICAS);
+
+    const std::string& getNode(const std::string& key) const;
+
+    const std::vector<std::string>& getNodes() const { return nodes; }
+
+  private:
+    std::vector<std::string> nodes;
+
+    // Point on the ring to index of the node
+    std::map<uint64_t, size_t> ring;
+};
+}
@@ -4,8 +4,14 @@
 #include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
+#include <optional>
 #include <queue>
+#include <vector>
 #include <readerwriterqueue/readerwritercircularbuffer.h>
 
 #define DEFAULT_QUEUE_TIMEOUT_MS 5000
@@ -215,6 +221,189 @@ class FixedCapacityQueue
     moodycamel::BlockingReaderWriterCircularBuffer<T> mq;
 };
 
+// Queue shared by a fixed pool of workers. Each worker has its own deque, and
+// items are spread across them round-robin. Workers consume their own deque
+// first, then steal from the others, so an item is never left waiting behind a
+// slow one while another worker is idle. High priority items go on a shared
+// deque which all workers check before their own.
+template<typename T>
+class WorkStealingQueue
+{
+  public:
+    explicit WorkStealingQueue(int nWorkersIn)
+      : nWorkers(nWorkersIn)
+      , workerDeques(std::max(nWorkersIn, 1))
+    {
+        if (nWorkers <= 0) {
+            SPDLOG_ERROR("Invalid number of queue workers: {} <= 0", nWorkers);
+            throw std::runtime_error("Invalid number of queue workers");
+        }
+    }
+
+    void enqueue(T value, bool highPriority = false)
+    {
+        if (highPriority) {
+            pushBack(priorityDeque, std::move(value));
+        } else {
+            int idx = nextWorker.fetch_add(1) % nWorkers;
+            pushBack(workerDeques.at(idx), std::move(value));
+        }
+
+        // Hold the lock to avoid racing with a worker about to wait
+        UniqueLock lock(mx);
+        nItems++;
+        enqueueNotifier.notify_one();
+    }
+
+    std::optional<T> tryDequeue(int workerIdx)
+    {
+        std::optional<T> value = popFront(priorityDeque);
+        if (value.has_value()) {
+            return value;
+        }
+
+        value = popFront(workerDeques.at(workerIdx));
+        if (value.has_value()) {
+            return value;
+        }
+
+        // Steal the oldest item from the other workers, starting with our
+        // neighbour so that thieves spread out
+        for (int i = 1; i < nWorkers; i++) {
+            value = popFront(workerDeques.at((workerIdx + i) % nWorkers));
+            if (value.has_value()) {
+                return value;
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    T dequeue(int workerIdx, long timeoutMs = DEFAULT_QUEUE_TIMEOUT_MS)
+    {
+        if (timeoutMs <= 0) {
+            SPDLOG_ERROR("Invalid queue timeout: {} <= 0", timeoutMs);
+            throw std::runtime_error("Invalid queue timeout");
+        }
+
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(timeoutMs);
+
+        while (true) {
+            std::optional<T> value = tryDequeue(workerIdx);
+            if (value.has_value()) {
+                return std::move(*value);
+            }
+
+            UniqueLock lock(mx);
+            bool hasItems = enqueueNotifier.wait_until(
+              lock, deadline, [this] { return nItems > 0; });
+
+            if (!hasItems) {
+                throw QueueTimeoutException("Timeout waiting for dequeue");
+            }
+        }
+    }
+
+    long size() { return nItems; }
+
+  private:
+    struct WorkerDeque
+    {
+        std::mutex mx;
+        std::deque<T> items;
+    };
+
+    const int nWorkers;
+    std::vector<WorkerDeque> workerDeques;
+    WorkerDeque priorityDeque;
+
+    std::atomic<unsigned int> nextWorker = 0;
+    std::atomic<long> nItems = 0;
+
+    std::condition_variable enqueueNotifier;
+    std::mutex mx;
+
+    void pushBack(WorkerDeque& d, T value)
+    {
+        UniqueLock lock(d.mx);
+        d.items.emplace_back(std::move(value));
+    }
+
+    std::optional<T> popFront(WorkerDeque& d)
+    {
+        UniqueLock lock(d.mx);
+        if (d.items.empty()) {
+            return std::nullopt;
+        }
+
+        std::optional<T> value = std::move(d.items.front());
+        d.items.pop_front();
+        nItems--;
+
+        return value;
+    }
+};
+
+// Unbounded lock-free queue with many producers and a single consumer.
+// Producers push onto an intrusive stack, and the consumer takes the whole
+// stack in one go, reversing it to get the items in the order they were
+// enqueued. As the consumer never pops individual items there is no ABA
+// problem.
+template<typename T>
+class MultiProducerQueue
+{
+  public:
+    MultiProducerQueue() = default;
+
+    MultiProducerQueue(const MultiProducerQueue&) = delete;
+
+    MultiProducerQueue& operator=(const MultiProducerQueue&) = delete;
+
+    ~MultiProducerQueue()
+    {
+        std::vector<T> remaining;
+        dequeueAll(remaining);
+    }
+
+    void enqueue(T value)
+    {
+        Node* node = new Node{ std::move(value), head.load() };
+        while (!head.compare_exchange_weak(node->next, node)) {
+        }
+    }
+
+    // Must only be called by the single consumer
+    size_t dequeueAll(std::vector<T>& out)
+    {
+        Node* node = head.exchange(nullptr);
+
+        size_t start = out.size();
+        while (node != nullptr) {
+            out.emplace_back(std::move(node->value));
+
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+
+        std::reverse(out.begin() + start, out.end());
+
+        return out.size() - start;
+    }
+
+    bool empty() { return head.load() == nullptr; }
+
+  private:
+    struct Node
+    {
+        T value;
+        Node* next;
+    };
+
+    std::atomic<Node*> head = nullptr;
+};
+
 class TokenPool
 {
   public:
@@ -8,6 +8,8 @@
 #include <faabric/proto/faabric.pb.h>
 #include <faabric/util/locks.h>
 
+#define AVAILABLE_HOST_SET "available_hosts"
+
 namespace faabric::util {
 
 class SchedulingDecision
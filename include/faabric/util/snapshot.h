@@ -343,4 +343,17 @@ class SnapshotData
 std::string snapshotDataTypeStr(SnapshotDataType dt);
 
 std::string snapshotMergeOpStr(SnapshotMergeOperation op);
+
+// Size of a single value of the given type, zero for raw data
+size_t snapshotDataTypeSize(SnapshotDataType dt);
+
+/**
+ * Merges an array of values into the target element by element, e.g. adding an
+ * array of deltas onto an array of doubles. The diff must hold a whole number
+ * of values of the given data type.
+ */
+void applyDiffValues(uint8_t* target,
+                     std::span<const uint8_t> diff,
+                     SnapshotDataType dataType,
+                     SnapshotMergeOperation operation);
 }
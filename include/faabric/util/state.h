@@ -1,6 +1,9 @@
 #pragma once
 
+#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #define STATE_MASK_8 0b11111111
 #define STATE_MASK_32 0b11111111111111111111111111111111
@@ -9,4 +12,35 @@ namespace faabric::util {
 std::string keyForUser(const std::string& user, const std::string& key);
 
 void maskDouble(unsigned int* maskArray, unsigned long idx);
+
+/**
+ * Set of byte ranges, kept as disjoint, non-adjacent intervals ordered by
+ * offset. This lets us track which parts of a large value are dirty or have
+ * been pulled with memory proportional to the number of ranges rather than
+ * the size of the value, and with logarithmic inserts and lookups.
+ *
+ * Not thread-safe.
+ */
+class ByteRangeSet
+{
+  public:
+    // Adds the range, merging with any ranges it overlaps or touches
+    void add(size_t offset, size_t length);
+
+    // Whether the range is entirely covered by the set
+    bool contains(size_t offset, size_t length) const;
+
+    // Offsets and lengths of all the ranges, in order
+    std::vector<std::pair<size_t, size_t>> getRanges() const;
+
+    size_t getRangeCount() const { return ranges.size(); }
+
+    bool empty() const { return ranges.empty(); }
+
+    void clear() { ranges.clear(); }
+
+  private:
+    // Start offset to end offset (exclusive)
+    std::map<size_t, size_t> ranges;
+};
 }
@@ -0,0 +1,442 @@
+#include <faabric/redis/AsyncRedis.h>
+#include <faabric/util/config.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <hiredis/async.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace faabric::redis {
+
+AsyncRedis::AsyncRedis(const RedisInstance& instanceIn,
+                       int nConnectionsIn,
+                       int timeoutMsIn)
+  : instance(instanceIn)
+  , nConnections(nConnectionsIn)
+  , timeoutMs(timeoutMsIn)
+{
+    if (nConnections <= 0) {
+        SPDLOG_ERROR("Invalid async redis pool size for {}: {}",
+                     instance.hostname,
+                     nConnections);
+        throw std::runtime_error("Invalid async redis pool size");
+    }
+
+    wakeFd = eventfd(0, EFD_NONBLOCK);
+    if (wakeFd < 0) {
+        SPDLOG_ERROR("Failed to create eventfd for async redis to {}",
+                     instance.hostname);
+        throw std::runtime_error("Failed to create eventfd");
+    }
+
+    // Connections are opened by the loop thread when first used
+    loopThread = std::jthread([this] { run(); });
+}
+
+AsyncRedis::~AsyncRedis()
+{
+    stop();
+
+    close(wakeFd);
+}
+
+AsyncRedis& AsyncRedis::getQueue()
+{
+    static AsyncRedis asyncQueue(
+      getRedisInstance(QUEUE),
+      faabric::util::getSystemConfig().redisPoolSize);
+    return asyncQueue;
+}
+
+void AsyncRedis::stop()
+{
+    if (stopped.exchange(true)) {
+        return;
+    }
+
+    SPDLOG_DEBUG("Stopping async redis to {}", instance.hostname);
+
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(uint64_t)) != sizeof(uint64_t)) {
+        SPDLOG_ERROR("Failed to wake async redis to {}", instance.hostname);
+    }
+
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+}
+
+int AsyncRedis::getConnectionCount() const
+{
+    return nConnections;
+}
+
+std::future<void> AsyncRedis::command(RedisCommand command)
+{
+    std::vector<RedisCommand> commands;
+    commands.emplace_back(std::move(command));
+    return pipeline(std::move(commands));
+}
+
+std::future<void> AsyncRedis::pipeline(std::vector<RedisCommand> commands,
+                                       std::optional<uint32_t> orderingKey)
+{
+    auto request = std::make_shared<PendingRequest>();
+    request->commands = std::move(commands);
+    if (orderingKey.has_value()) {
+        request->connectionIdx = (int)(*orderingKey % nConnections);
+    }
+
+    nSubmitted++;
+    return submit(std::move(request));
+}
+
+std::future<void> AsyncRedis::publishSchedulerResult(
+  const std::string& key,
+  const std::string& statusKey,
+  const std::vector<uint8_t>& result,
+  std::optional<uint32_t> orderingKey)
+{
+    // Same script as the blocking client, so results are published atomically
+    return pipeline({ { "EVALSHA",
+                        instance.schedPublishSha,
+                        "2",
+                        key,
+                        statusKey,
+                        std::string(result.begin(), result.end()),
+                        std::to_string(RESULT_KEY_EXPIRY),
+                        std::to_string(STATUS_KEY_EXPIRY) } },
+                    orderingKey);
+}
+
+void AsyncRedis::flush()
+{
+    uint64_t target = nSubmitted.load(std::memory_order_acquire);
+    if (nFlushed.load(std::memory_order_acquire) >= target) {
+        return;
+    }
+
+    // Each connection executes its commands in order, so once a ping has come
+    // back on every connection, everything submitted before it is done
+    std::vector<std::future<void>> pings;
+    for (int i = 0; i < nConnections; i++) {
+        auto request = std::make_shared<PendingRequest>();
+        request->commands = { { "PING" } };
+        request->connectionIdx = i;
+        pings.emplace_back(submit(std::move(request)));
+    }
+
+    for (auto& p : pings) {
+        if (p.wait_for(std::chrono::milliseconds(timeoutMs)) ==
+            std::future_status::timeout) {
+            SPDLOG_ERROR("Timed out flushing async redis to {}",
+                         instance.hostname);
+            throw RedisNoResponseException("Timed out flushing async redis");
+        }
+
+        p.get();
+    }
+
+    // Record the flush, unless a concurrent one has already got further
+    uint64_t flushed = nFlushed.load(std::memory_order_acquire);
+    while (flushed < target &&
+           !nFlushed.compare_exchange_weak(flushed, target)) {
+    }
+}
+
+std::future<void> AsyncRedis::submit(std::shared_ptr<PendingRequest> request)
+{
+    if (stopped) {
+        SPDLOG_ERROR("Submitting to stopped async redis to {}",
+                     instance.hostname);
+        throw std::runtime_error("Async redis stopped");
+    }
+
+    std::future<void> result = request->result.get_future();
+    submissions.enqueue(std::move(request));
+
+    // Only the first submission since the loop last woke up needs to wake it
+    // again
+    if (!wakePending.exchange(true)) {
+        uint64_t one = 1;
+        if (write(wakeFd, &one, sizeof(uint64_t)) != sizeof(uint64_t)) {
+            SPDLOG_ERROR("Failed to wake async redis to {}",
+                         instance.hostname);
+            throw std::runtime_error("Failed to wake async redis");
+        }
+    }
+
+    return result;
+}
+
+void AsyncRedis::run()
+{
+    // All contexts are created, used and freed on this thread
+    std::vector<Connection> connections(nConnections);
+
+    std::vector<pollfd> pollFds;
+    std::vector<int> pollConnections;
+    std::vector<std::shared_ptr<PendingRequest>> requests;
+    int nextConnection = 0;
+
+    // Queue everything submitted since we last woke up. Hiredis buffers the
+    // commands and writes them out together when the socket is next writable.
+    // We must reset the flag before taking the requests so none get missed
+    auto sendSubmitted = [&] {
+        wakePending = false;
+        requests.clear();
+        submissions.dequeueAll(requests);
+
+        for (auto& r : requests) {
+            int connIdx = r->connectionIdx;
+            if (connIdx < 0) {
+                connIdx = nextConnection;
+                nextConnection = (nextConnection + 1) % nConnections;
+            }
+
+            send(connections.at(connIdx), std::move(r));
+        }
+    };
+
+    while (!stopped) {
+        pollOnce(connections, pollFds, pollConnections);
+        sendSubmitted();
+    }
+
+    // Results are often published without waiting on them, so anything
+    // submitted before stopping still gets sent. Disconnecting closes each
+    // connection once all its replies are in.
+    sendSubmitted();
+    for (auto& conn : connections) {
+        if (conn.ctx != nullptr) {
+            redisAsyncDisconnect(conn.ctx);
+        }
+    }
+
+    auto isOpen = [](const Connection& conn) { return conn.ctx != nullptr; };
+    auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (std::any_of(connections.begin(), connections.end(), isOpen) &&
+           std::chrono::steady_clock::now() < deadline) {
+        pollOnce(connections, pollFds, pollConnections);
+    }
+
+    // Freeing the contexts fails any commands still waiting on a reply
+    for (auto& conn : connections) {
+        if (conn.ctx != nullptr) {
+            SPDLOG_WARN("Dropping unanswered commands to {}",
+                        instance.hostname);
+            redisAsyncFree(conn.ctx);
+        }
+    }
+
+    requests.clear();
+    submissions.dequeueAll(requests);
+    for (auto& r : requests) {
+        r->result.set_exception(
+          std::make_exception_ptr(std::runtime_error("Async redis stopped")));
+    }
+
+    SPDLOG_DEBUG("Closed async redis connections to {}", instance.hostname);
+}
+
+void AsyncRedis::pollOnce(std::vector<Connection>& connections,
+                          std::vector<pollfd>& pollFds,
+                          std::vector<int>& pollConnections)
+{
+    pollFds.clear();
+    pollConnections.clear();
+
+    pollFds.push_back({ wakeFd, POLLIN, 0 });
+    for (int i = 0; i < nConnections; i++) {
+        Connection& conn = connections.at(i);
+        if (conn.ctx == nullptr) {
+            continue;
+        }
+
+        short events = 0;
+        if (conn.reading) {
+            events |= POLLIN;
+        }
+        if (conn.writing) {
+            events |= POLLOUT;
+        }
+
+        pollFds.push_back({ conn.ctx->c.fd, events, 0 });
+        pollConnections.push_back(i);
+    }
+
+    if (::poll(pollFds.data(), pollFds.size(), timeoutMs) < 0 &&
+        errno != EINTR) {
+        SPDLOG_ERROR(
+          "Failed polling async redis to {}: {}", instance.hostname, errno);
+    }
+
+    if (pollFds.at(0).revents & POLLIN) {
+        uint64_t count;
+        if (read(wakeFd, &count, sizeof(uint64_t)) < 0) {
+            SPDLOG_ERROR("Failed to read eventfd for async redis to {}",
+                         instance.hostname);
+        }
+    }
+
+    // Handling I/O calls the reply callbacks, and may free the context if the
+    // connection has dropped
+    for (size_t i = 1; i < pollFds.size(); i++) {
+        Connection& conn = connections.at(pollConnections.at(i - 1));
+        short revents = pollFds.at(i).revents;
+
+        if (conn.ctx != nullptr && (revents & (POLLIN | POLLERR | POLLHUP))) {
+            redisAsyncHandleRead(conn.ctx);
+        }
+
+        if (conn.ctx != nullptr && (revents & POLLOUT)) {
+            redisAsyncHandleWrite(conn.ctx);
+        }
+    }
+}
+
+void AsyncRedis::connect(Connection& conn)
+{
+    conn.ctx = redisAsyncConnect(instance.ip.c_str(), instance.port);
+
+    if (conn.ctx == nullptr || conn.ctx->err) {
+        if (conn.ctx != nullptr) {
+            SPDLOG_ERROR("Error connecting async redis to {}: {}",
+                         instance.ip,
+                         conn.ctx->errstr);
+            redisAsyncFree(conn.ctx);
+        } else {
+            SPDLOG_ERROR("Error allocating async redis context");
+        }
+
+        conn.ctx = nullptr;
+        return;
+    }
+
+    // Hiredis tells us which events it's waiting on, which we pick up the
+    // next time round the poll loop. Cleanup is called when the context is
+    // freed for whatever reason, after which we reconnect on next use.
+    conn.ctx->ev.data = &conn;
+    conn.ctx->ev.addRead = [](void* c) {
+        static_cast<Connection*>(c)->reading = true;
+    };
+    conn.ctx->ev.delRead = [](void* c) {
+        static_cast<Connection*>(c)->reading = false;
+    };
+    conn.ctx->ev.addWrite = [](void* c) {
+        static_cast<Connection*>(c)->writing = true;
+    };
+    conn.ctx->ev.delWrite = [](void* c) {
+        static_cast<Connection*>(c)->writing = false;
+    };
+    conn.ctx->ev.cleanup = [](void* c) {
+        auto* conn = static_cast<Connection*>(c);
+        conn->ctx = nullptr;
+        conn->reading = false;
+        conn->writing = false;
+    };
+
+    redisAsyncSetConnectCallback(
+      conn.ctx, [](const redisAsyncContext* ctx, int status) {
+          if (status != REDIS_OK) {
+              SPDLOG_ERROR("Failed to connect async redis: {}", ctx->errstr);
+          }
+      });
+
+    redisAsyncSetDisconnectCallback(
+      conn.ctx, [](const redisAsyncContext* ctx, int status) {
+          if (status != REDIS_OK) {
+              SPDLOG_ERROR("Lost async redis connection: {}", ctx->errstr);
+          }
+      });
+}
+
+void AsyncRedis::send(Connection& conn,
+                      std::shared_ptr<PendingRequest> request)
+{
+    if (conn.ctx == nullptr) {
+        connect(conn);
+    }
+
+    if (conn.ctx == nullptr) {
+        request->result.set_exception(std::make_exception_ptr(
+          RedisNoResponseException("Failed to connect async redis")));
+        return;
+    }
+
+    request->remaining = request->commands.size();
+    if (request->remaining == 0) {
+        request->result.set_value();
+        return;
+    }
+
+    std::vector<const char*> argv;
+    std::vector<size_t> argvLen;
+    for (const auto& cmd : request->commands) {
+        argv.clear();
+        argvLen.clear();
+        for (const auto& arg : cmd) {
+            argv.push_back(arg.data());
+            argvLen.push_back(arg.size());
+        }
+
+        // Each command holds a reference to the request until it replies
+        auto* privdata = new std::shared_ptr<PendingRequest>(request);
+        int res = redisAsyncCommandArgv(conn.ctx,
+                                        &AsyncRedis::onReply,
+                                        privdata,
+                                        (int)argv.size(),
+                                        argv.data(),
+                                        argvLen.data());
+
+        if (res != REDIS_OK) {
+            delete privdata;
+            finishCommand(*request, "Failed to send async redis command");
+        }
+    }
+}
+
+void AsyncRedis::onReply(redisAsyncContext* ctx, void* reply, void* privdata)
+{
+    std::unique_ptr<std::shared_ptr<PendingRequest>> request(
+      static_cast<std::shared_ptr<PendingRequest>*>(privdata));
+
+    // Replies are null when the connection is closed before they arrive
+    auto* r = static_cast<redisReply*>(reply);
+    if (r == nullptr) {
+        finishCommand(**request, "No reply from async redis");
+    } else if (r->type == REDIS_REPLY_ERROR) {
+        finishCommand(**request, std::string(r->str, r->len));
+    } else {
+        finishCommand(**request, "");
+    }
+}
+
+void AsyncRedis::finishCommand(PendingRequest& request,
+                               const std::string& error)
+{
+    if (!error.empty()) {
+        // Most callers don't wait on the result, so errors are logged here
+        SPDLOG_ERROR("Async redis command failed: {}", error);
+        if (request.error.empty()) {
+            request.error = error;
+        }
+    }
+
+    if (--request.remaining > 0) {
+        return;
+    }
+
+    if (request.error.empty()) {
+        request.result.set_value();
+    } else {
+        request.result.set_exception(
+          std::make_exception_ptr(std::runtime_error(request.error)));
+    }
+}
+}
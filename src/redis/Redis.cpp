@@ -107,19 +107,28 @@ Redis::~Redis()
  *  ------ Utils ------
  */
 
+RedisInstance& getRedisInstance(RedisRole role)
+{
+    if (role == STATE) {
+        static RedisInstance stateInstance(STATE);
+        return stateInstance;
+    }
+
+    static RedisInstance queueInstance(QUEUE);
+    return queueInstance;
+}
+
 Redis& Redis::getState()
 {
     // Hiredis requires one instance per thread
-    static RedisInstance stateInstance(STATE);
-    static thread_local redis::Redis redisState(stateInstance);
+    static thread_local redis::Redis redisState(getRedisInstance(STATE));
     return redisState;
 }
 
 Redis& Redis::getQueue()
 {
     // Hiredis requires one instance per thread
-    static RedisInstance queueInstance(QUEUE);
-    static thread_local redis::Redis redisQueue(queueInstance);
+    static thread_local redis::Redis redisQueue(getRedisInstance(QUEUE));
     return redisQueue;
 }
 
@@ -493,6 +502,48 @@ void Redis::getRange(const std::string& key,
     getBytesFromReply(key, *reply, buffer, bufferLen);
 }
 
+/**
+ * Reads all the ranges in a single pipeline, i.e. with one round trip rather
+ * than one per range.
+ */
+void Redis::getRangesPipeline(const std::vector<RedisReadRange>& ranges)
+{
+    for (const auto& r : ranges) {
+        redisAppendCommand(context,
+                           "GETRANGE %s %li %li",
+                           r.key.c_str(),
+                           r.offset,
+                           r.offset + (long)r.length - 1);
+    }
+
+    // We must read every reply, even after a failure, to leave the
+    // connection in a usable state
+    std::exception_ptr failure = nullptr;
+    for (const auto& r : ranges) {
+        void* reply;
+        redisGetReply(context, &reply);
+        auto _replyGuard = wrapReply((redisReply*)reply);
+
+        if (reply == nullptr ||
+            ((redisReply*)reply)->type == REDIS_REPLY_ERROR) {
+            SPDLOG_ERROR("Failed pipelined GETRANGE on {}", r.key);
+            failure = std::make_exception_ptr(
+              std::runtime_error("Failed pipelined GETRANGE " + r.key));
+            continue;
+        }
+
+        try {
+            getBytesFromReply(r.key, *(redisReply*)reply, r.buffer, r.length);
+        } catch (std::exception& ex) {
+            failure = std::current_exception();
+        }
+    }
+
+    if (failure != nullptr) {
+        std::rethrow_exception(failure);
+    }
+}
+
 /**
  *  ------ Locking ------
  */
@@ -669,11 +720,15 @@ std::string Redis::dequeue(const std::string& queueName, int timeoutMs)
 void Redis::dequeueMultiple(const std::string& queueName,
                             uint8_t* buff,
                             long buffLen,
-                            long nElems)
+                            long nElems,
+                            long startIdx)
 {
     // Much like other range stuff with redis, this is *INCLUSIVE*
-    auto reply = safeRedisCommand(
-      context, "LRANGE %s 0 %i", queueName.c_str(), nElems - 1);
+    auto reply = safeRedisCommand(context,
+                                  "LRANGE %s %li %li",
+                                  queueName.c_str(),
+                                  startIdx,
+                                  startIdx + nElems - 1);
 
     long offset = 0;
     for (size_t i = 0; i < reply->elements; i++) {
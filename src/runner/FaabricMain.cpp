@@ -75,9 +75,9 @@ void FaabricMain::startPointToPointServer()
 
 void FaabricMain::startStateServer()
 {
-    // Skip state server if not in inmemory mode
+    // Skip state server if not in an in-memory mode
     faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
-    if (conf.stateMode != "inmemory") {
+    if (conf.stateMode != "inmemory" && conf.stateMode != "sharded") {
         SPDLOG_INFO("Not starting state server in state mode {}",
                     conf.stateMode);
         return;
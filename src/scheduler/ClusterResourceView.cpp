@@ -0,0 +1,89 @@
+#include <faabric/scheduler/ClusterResourceView.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+namespace faabric::scheduler {
+
+void ClusterResourceView::update(const std::string& host,
+                                 const faabric::HostResources& res)
+{
+    faabric::util::FullLock lock(mx);
+    hosts[host] = res;
+}
+
+bool ClusterResourceView::hasHost(const std::string& host)
+{
+    faabric::util::SharedLock lock(mx);
+    return hosts.find(host) != hosts.end();
+}
+
+faabric::HostResources ClusterResourceView::getResources(
+  const std::string& host)
+{
+    faabric::util::SharedLock lock(mx);
+
+    auto it = hosts.find(host);
+    if (it == hosts.end()) {
+        SPDLOG_ERROR("No cached resources for host {}", host);
+        throw std::runtime_error("No cached resources for host");
+    }
+
+    return it->second;
+}
+
+int ClusterResourceView::reserve(const std::string& host, int slotsRequested)
+{
+    faabric::util::FullLock lock(mx);
+
+    auto it = hosts.find(host);
+    if (it == hosts.end()) {
+        return 0;
+    }
+
+    // Hosts may be overloaded, in which case they have no free slots
+    faabric::HostResources& res = it->second;
+    int available = std::max<int>(0, res.slots() - res.usedslots());
+    int reserved = std::min<int>(available, slotsRequested);
+
+    res.set_usedslots(res.usedslots() + reserved);
+
+    return reserved;
+}
+
+void ClusterResourceView::release(const std::string& host, int slots)
+{
+    faabric::util::FullLock lock(mx);
+
+    auto it = hosts.find(host);
+    if (it == hosts.end()) {
+        return;
+    }
+
+    faabric::HostResources& res = it->second;
+    res.set_usedslots(std::max<int>(0, res.usedslots() - slots));
+}
+
+std::set<std::string> ClusterResourceView::getHosts()
+{
+    faabric::util::SharedLock lock(mx);
+
+    std::set<std::string> result;
+    for (const auto& p : hosts) {
+        result.insert(p.first);
+    }
+
+    return result;
+}
+
+void ClusterResourceView::removeHost(const std::string& host)
+{
+    faabric::util::FullLock lock(mx);
+    hosts.erase(host);
+}
+
+void ClusterResourceView::clear()
+{
+    faabric::util::FullLock lock(mx);
+    hosts.clear();
+}
+}
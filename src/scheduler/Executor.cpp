@@ -444,6 +444,9 @@ void Executor::threadPoolThread(std::stop_token st, int threadPoolIdx)
                      isThreads,
                      msg.groupid());
 
+        // Pointers into state values don't outlive the task
+        faabric::state::StatePinScope statePins;
+
         // Set up context
         ExecutorContext::set(this, task.req, task.messageIndex);
 
@@ -479,6 +482,12 @@ void Executor::threadPoolThread(std::stop_token st, int threadPoolIdx)
         // Unset context
         ExecutorContext::unset();
 
+        // Anything the task held back for coalescing must not wait for the
+        // next task on this thread
+        faabric::transport::getPointToPointBroker().flushMessages();
+
+        statePins.release();
+
         // Handle thread-local diffing for every thread
         if (doDirtyTracking) {
             // Stop dirty tracking
@@ -1,7 +1,10 @@
 #include <faabric/proto/faabric.pb.h>
 #include <faabric/scheduler/FunctionCallClient.h>
+#include <faabric/transport/ConnectionPool.h>
 #include <faabric/transport/common.h>
 #include <faabric/transport/macros.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
 #include <faabric/util/queue.h>
 #include <faabric/util/testing.h>
 
@@ -28,6 +31,9 @@ static std::unordered_map<std::string,
                           faabric::util::Queue<faabric::HostResources>>
   queuedResourceResponses;
 
+static std::vector<std::pair<std::string, faabric::ReservationRequest>>
+  reservationRequests;
+
 static std::vector<
   std::pair<std::string, std::shared_ptr<faabric::PendingMigrations>>>
   pendingMigrationsRequests;
@@ -35,6 +41,15 @@ static std::vector<
 static std::vector<std::pair<std::string, faabric::UnregisterRequest>>
   unregisterRequests;
 
+static std::unordered_map<std::string, std::shared_ptr<MockHost>> mockHosts;
+
+static std::shared_ptr<MockHost> getMockHost(const std::string& host)
+{
+    faabric::util::UniqueLock lock(mockMutex);
+    auto it = mockHosts.find(host);
+    return it == mockHosts.end() ? nullptr : it->second;
+}
+
 std::vector<std::pair<std::string, faabric::Message>> getFunctionCalls()
 {
     faabric::util::UniqueLock lock(mockMutex);
@@ -61,6 +76,13 @@ std::vector<std::pair<std::string, faabric::EmptyRequest>> getResourceRequests()
     return resourceRequests;
 }
 
+std::vector<std::pair<std::string, faabric::ReservationRequest>>
+getReservationRequests()
+{
+    faabric::util::UniqueLock lock(mockMutex);
+    return reservationRequests;
+}
+
 std::vector<std::pair<std::string, std::shared_ptr<faabric::PendingMigrations>>>
 getPendingMigrationsRequests()
 {
@@ -81,12 +103,19 @@ void queueResourceResponse(const std::string& host, faabric::HostResources& res)
     queuedResourceResponses[host].enqueue(res);
 }
 
+void setMockHost(const std::string& host, std::shared_ptr<MockHost> mockHost)
+{
+    faabric::util::UniqueLock lock(mockMutex);
+    mockHosts[host] = std::move(mockHost);
+}
+
 void clearMockRequests()
 {
     faabric::util::UniqueLock lock(mockMutex);
     functionCalls.clear();
     batchMessages.clear();
     resourceRequests.clear();
+    reservationRequests.clear();
     pendingMigrationsRequests.clear();
     unregisterRequests.clear();
 
@@ -94,15 +123,19 @@ void clearMockRequests()
         p.second.reset();
     }
     queuedResourceResponses.clear();
+
+    mockHosts.clear();
 }
 
 // -----------------------------------
 // Message Client
 // -----------------------------------
-FunctionCallClient::FunctionCallClient(const std::string& hostIn)
+FunctionCallClient::FunctionCallClient(const std::string& hostIn, bool pooled)
   : faabric::transport::MessageEndpointClient(hostIn,
                                               FUNCTION_CALL_ASYNC_PORT,
-                                              FUNCTION_CALL_SYNC_PORT)
+                                              FUNCTION_CALL_SYNC_PORT,
+                                              DEFAULT_SOCKET_TIMEOUT_MS,
+                                              pooled)
 {}
 
 void FunctionCallClient::sendFlush()
@@ -123,6 +156,11 @@ faabric::HostResources FunctionCallClient::getResources()
     faabric::HostResources response;
 
     if (faabric::util::isMockMode()) {
+        // Mock hosts may take a while to respond, so mustn't hold the lock
+        if (auto mockHost = getMockHost(host)) {
+            return mockHost->getResources();
+        }
+
         faabric::util::UniqueLock lock(mockMutex);
 
         // Register the request
@@ -163,6 +201,11 @@ void FunctionCallClient::executeFunctions(
   const std::shared_ptr<faabric::BatchExecuteRequest> req)
 {
     if (faabric::util::isMockMode()) {
+        if (auto mockHost = getMockHost(host)) {
+            mockHost->executeFunctions(req);
+            return;
+        }
+
         faabric::util::UniqueLock lock(mockMutex);
         batchMessages.emplace_back(host, req);
     } else {
@@ -171,19 +214,60 @@ void FunctionCallClient::executeFunctions(
     }
 }
 
-int FunctionCallClient::tryReserve(int numRequestedSlots)
+void FunctionCallClient::executeFunctions(
+  const faabric::BatchExecuteRequest& header,
+  const faabric::BatchExecuteRequest& req,
+  const std::vector<int>& msgIdxs,
+  const std::vector<bool>& directResults)
+{
+    std::vector<uint8_t> buffer =
+      faabric::util::serialiseBatchSubset(header, req, msgIdxs, directResults);
+
+    if (faabric::util::isMockMode()) {
+        // Mocks deal in whole requests, so parse it back as a host would
+        auto hostReq = std::make_shared<faabric::BatchExecuteRequest>();
+        if (!hostReq->ParseFromArray(buffer.data(), buffer.size())) {
+            throw std::runtime_error("Error deserialising batch subset");
+        }
+
+        executeFunctions(hostReq);
+        return;
+    }
+
+    asyncSend(faabric::scheduler::FunctionCalls::ExecuteFunctions,
+              buffer.data(),
+              buffer.size());
+}
+
+faabric::ReservationResponse FunctionCallClient::tryReserve(
+  int numRequestedSlots,
+  bool force)
 {
     faabric::ReservationRequest request;
+    request.set_slots(numRequestedSlots);
+    request.set_force(force);
+
     faabric::ReservationResponse response;
 
     if (faabric::util::isMockMode()) {
-        // TODO not sure what to do here.
+        // Like real hosts, mock hosts send back their latest resources
+        if (auto mockHost = getMockHost(host)) {
+            int reserved = mockHost->tryReserve(numRequestedSlots, force);
+            response.set_allocatedslots(reserved);
+            *response.mutable_resources() = mockHost->getResources();
+            return response;
+        }
+
+        // Otherwise mocked hosts grant everything they're asked for
+        faabric::util::UniqueLock lock(mockMutex);
+        reservationRequests.emplace_back(host, request);
+        response.set_allocatedslots(numRequestedSlots);
     } else {
         syncSend(
           faabric::scheduler::FunctionCalls::Reservation, &request, &response);
     }
 
-    return response.allocatedslots();
+    return response;
 }
 
 void FunctionCallClient::unregister(faabric::UnregisterRequest& req)
@@ -195,4 +279,132 @@ void FunctionCallClient::unregister(faabric::UnregisterRequest& req)
         asyncSend(faabric::scheduler::FunctionCalls::Unregister, &req);
     }
 }
+
+void FunctionCallClient::setFunctionResult(faabric::Message& msg)
+{
+    if (faabric::util::isMockMode()) {
+        faabric::util::UniqueLock lock(mockMutex);
+        functionCalls.emplace_back(host, msg);
+    } else {
+        asyncSend(faabric::scheduler::FunctionCalls::SetFunctionResult, &msg);
+    }
+}
+
+std::vector<std::pair<std::string, faabric::HostResources>> getResourcesOnHosts(
+  const std::vector<std::string>& hosts)
+{
+    std::vector<std::pair<std::string, faabric::HostResources>> resources;
+    resources.reserve(hosts.size());
+
+    if (faabric::util::isMockMode()) {
+        for (const auto& host : hosts) {
+            FunctionCallClient cli(host);
+            resources.emplace_back(host, cli.getResources());
+        }
+
+        return resources;
+    }
+
+    // Send all the requests before waiting on any of them, so the hosts
+    // handle them in parallel
+    int nConnections =
+      std::max(1, faabric::util::getSystemConfig().transportClientPoolSize);
+    std::vector<std::shared_ptr<faabric::transport::ConnectionPool>> pools;
+    std::vector<std::future<faabric::transport::Message>> inFlight;
+    for (const auto& host : hosts) {
+        faabric::EmptyRequest request;
+
+        auto pool =
+          faabric::transport::getConnectionPool(host,
+                                                FUNCTION_CALL_ASYNC_PORT,
+                                                FUNCTION_CALL_SYNC_PORT,
+                                                nConnections);
+
+        SERIALISE_MSG(request)
+        inFlight.emplace_back(
+          pool->submitSync(faabric::scheduler::FunctionCalls::GetResources,
+                           serialisedBuffer,
+                           serialisedSize));
+        pools.emplace_back(std::move(pool));
+    }
+
+    for (size_t i = 0; i < hosts.size(); i++) {
+        try {
+            faabric::transport::Message msg =
+              pools.at(i)->awaitResponse(inFlight.at(i));
+
+            faabric::HostResources res;
+            if (!res.ParseFromArray(msg.udata(), msg.size())) {
+                throw std::runtime_error("Error deserialising message");
+            }
+
+            resources.emplace_back(hosts.at(i), std::move(res));
+        } catch (std::exception& e) {
+            SPDLOG_ERROR(
+              "Failed to get resources from {}: {}", hosts.at(i), e.what());
+        }
+    }
+
+    return resources;
+}
+
+std::vector<faabric::ReservationResponse> tryReserveOnHosts(
+  const std::vector<std::pair<std::string, int>>& reservations,
+  bool force)
+{
+    std::vector<faabric::ReservationResponse> responses(reservations.size());
+
+    if (faabric::util::isMockMode()) {
+        for (size_t i = 0; i < reservations.size(); i++) {
+            FunctionCallClient cli(reservations.at(i).first);
+            responses.at(i) =
+              cli.tryReserve(reservations.at(i).second, force);
+        }
+
+        return responses;
+    }
+
+    // Send all the reservations before waiting on any of them, so the hosts
+    // handle them in parallel
+    int nConnections =
+      std::max(1, faabric::util::getSystemConfig().transportClientPoolSize);
+    std::vector<std::shared_ptr<faabric::transport::ConnectionPool>> pools;
+    std::vector<std::future<faabric::transport::Message>> inFlight;
+    for (const auto& [host, slots] : reservations) {
+        faabric::ReservationRequest request;
+        request.set_slots(slots);
+        request.set_force(force);
+
+        auto pool =
+          faabric::transport::getConnectionPool(host,
+                                                FUNCTION_CALL_ASYNC_PORT,
+                                                FUNCTION_CALL_SYNC_PORT,
+                                                nConnections);
+
+        SERIALISE_MSG(request)
+        inFlight.emplace_back(
+          pool->submitSync(faabric::scheduler::FunctionCalls::Reservation,
+                           serialisedBuffer,
+                           serialisedSize));
+        pools.emplace_back(std::move(pool));
+    }
+
+    for (size_t i = 0; i < reservations.size(); i++) {
+        try {
+            faabric::transport::Message msg =
+              pools.at(i)->awaitResponse(inFlight.at(i));
+            if (!responses.at(i).ParseFromArray(msg.udata(), msg.size())) {
+                throw std::runtime_error("Error deserialising message");
+            }
+        } catch (std::exception& e) {
+            SPDLOG_ERROR("Failed to reserve {} slots on {}: {}",
+                         reservations.at(i).second,
+                         reservations.at(i).first,
+                         e.what());
+            responses.at(i) = faabric::ReservationResponse();
+        }
+    }
+
+    return responses;
+}
 }
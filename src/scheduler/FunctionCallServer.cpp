@@ -30,6 +30,10 @@ void FunctionCallServer::doAsyncRecv(transport::Message& message)
             recvUnregister(message.udata(), message.size());
             break;
         }
+        case faabric::scheduler::FunctionCalls::SetFunctionResult: {
+            recvSetFunctionResult(message.udata(), message.size());
+            break;
+        }
         default: {
             throw std::runtime_error(
               fmt::format("Unrecognized async call header: {}", header));
@@ -61,6 +65,17 @@ std::unique_ptr<google::protobuf::Message> FunctionCallServer::doSyncRecv(
     }
 }
 
+bool FunctionCallServer::isHighPriority(uint8_t header, bool async)
+{
+    // Small control requests shouldn't wait behind function dispatch
+    if (async) {
+        return false;
+    }
+
+    return header == faabric::scheduler::FunctionCalls::Flush ||
+           header == faabric::scheduler::FunctionCalls::GetResources;
+}
+
 std::unique_ptr<google::protobuf::Message> FunctionCallServer::recvFlush(
   const uint8_t* buffer,
   size_t bufferSize)
@@ -101,6 +116,14 @@ void FunctionCallServer::recvUnregister(const uint8_t* buffer,
       parsedMsg.host(), parsedMsg.user(), parsedMsg.function());
 }
 
+void FunctionCallServer::recvSetFunctionResult(const uint8_t* buffer,
+                                               size_t bufferSize)
+{
+    PARSE_MSG(faabric::Message, buffer, bufferSize)
+
+    scheduler.setFunctionResultLocally(parsedMsg);
+}
+
 std::unique_ptr<google::protobuf::Message> FunctionCallServer::recvGetResources(
   const uint8_t* buffer,
   size_t bufferSize)
@@ -131,11 +154,14 @@ std::unique_ptr<google::protobuf::Message> FunctionCallServer::recvReservation(
     
     auto msgPtr = std::make_shared<faabric::ReservationRequest>(parsedMsg);
 
-    int allocated = scheduler.tryReserveSlots(msgPtr->slots());
+    int allocated = scheduler.tryReserveSlots(msgPtr->slots(), msgPtr->force());
     
     faabric::ReservationResponse res;
     res.set_allocatedslots(allocated);
 
+    // Piggy-back our current resources so the caller's view stays fresh
+    *res.mutable_resources() = scheduler.getThisHostResources();
+
     return std::make_unique<faabric::ReservationResponse>(res);
 }
 
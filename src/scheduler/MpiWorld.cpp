@@ -170,6 +170,9 @@ void MpiWorld::destroy()
 
     // Note that all ranks will call this function.
 
+    // Make sure no coalesced messages from this rank are left behind
+    broker.flushMessages();
+
     // Unacked message buffers
     if (!unackedMessageBuffers.empty()) {
         for (auto& umb : unackedMessageBuffers) {
@@ -0,0 +1,62 @@
+#include <faabric/scheduler/PlacementCostModel.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace faabric::scheduler {
+
+PlacementCostModel::PlacementCostModel(int transferMbpsIn)
+  : transferMbps(transferMbpsIn)
+{
+    if (transferMbps <= 0) {
+        SPDLOG_ERROR("Invalid snapshot transfer rate: {}Mbps", transferMbps);
+        throw std::runtime_error("Invalid snapshot transfer rate");
+    }
+}
+
+double PlacementCostModel::getTransferMillis(size_t nBytes) const
+{
+    // Megabits per second is the same as kilobits per millisecond
+    return ((double)nBytes * 8) / ((double)transferMbps * 1000);
+}
+
+double PlacementCostModel::getStartMillis(const PlacementCandidate& candidate,
+                                          size_t snapshotBytes,
+                                          int nCalls) const
+{
+    if (candidate.hasSnapshot || snapshotBytes == 0) {
+        return 0;
+    }
+
+    // Assume the host can take at least one call if we don't know better
+    int nOnHost = std::max(1, std::min(candidate.freeSlots, nCalls));
+
+    return getTransferMillis(snapshotBytes) / nOnHost;
+}
+
+std::vector<std::string> PlacementCostModel::rankHosts(
+  const std::vector<PlacementCandidate>& candidates,
+  size_t snapshotBytes,
+  int nCalls) const
+{
+    std::vector<std::pair<double, std::string>> costs;
+    costs.reserve(candidates.size());
+    for (const auto& c : candidates) {
+        costs.emplace_back(getStartMillis(c, snapshotBytes, nCalls), c.host);
+    }
+
+    std::stable_sort(
+      costs.begin(), costs.end(), [](const auto& a, const auto& b) {
+          return a.first < b.first;
+      });
+
+    std::vector<std::string> hosts;
+    hosts.reserve(costs.size());
+    for (auto& [cost, host] : costs) {
+        hosts.emplace_back(std::move(host));
+    }
+
+    return hosts;
+}
+}
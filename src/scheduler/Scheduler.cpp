@@ -1,5 +1,6 @@
 #include <atomic>
 #include <faabric/proto/faabric.pb.h>
+#include <faabric/redis/AsyncRedis.h>
 #include <faabric/redis/Redis.h>
 #include <faabric/scheduler/ExecutorFactory.h>
 #include <faabric/scheduler/FunctionCallClient.h>
@@ -20,13 +21,19 @@
 #include <faabric/util/testing.h>
 #include <faabric/util/timing.h>
 
+#include <algorithm>
+#include <cmath>
 #include <spdlog/spdlog.h>
+#include <unordered_map>
 #include <unordered_set>
 
 #define FLUSH_TIMEOUT_MS 10000
 #define GET_EXEC_GRAPH_SLEEP_MS 500
 #define MAX_GET_EXEC_GRAPH_RETRIES 3
 
+// Weight of the latest interval in each function's moving average call rate
+#define EXECUTOR_POOL_EWMA_ALPHA 0.5
+
 using namespace faabric::util;
 using namespace faabric::snapshot;
 
@@ -44,6 +51,38 @@ static thread_local std::unordered_map<std::string,
                                        faabric::snapshot::SnapshotClient>
   snapshotClients;
 
+// With a connection pool, clients are thread-safe, so all threads share the
+// same ones and the connections survive resetting the thread-local cache
+static std::unordered_map<std::string, std::unique_ptr<FunctionCallClient>>
+  sharedFunctionCallClients;
+
+static std::unordered_map<std::string, std::unique_ptr<SnapshotClient>>
+  sharedSnapshotClients;
+
+static std::shared_mutex sharedClientsMx;
+
+template<typename T>
+static T& getSharedClient(
+  std::unordered_map<std::string, std::unique_ptr<T>>& clients,
+  const std::string& otherHost)
+{
+    {
+        faabric::util::SharedLock lock(sharedClientsMx);
+        auto it = clients.find(otherHost);
+        if (it != clients.end()) {
+            return *it->second;
+        }
+    }
+
+    faabric::util::FullLock lock(sharedClientsMx);
+    if (clients.find(otherHost) == clients.end()) {
+        SPDLOG_DEBUG("Adding new shared client for {}", otherHost);
+        clients.emplace(otherHost, std::make_unique<T>(otherHost, true));
+    }
+
+    return *clients.at(otherHost);
+}
+
 Scheduler& getScheduler()
 {
     static Scheduler sch;
@@ -62,6 +101,16 @@ Scheduler::Scheduler()
 
     // Start the reaper thread
     reaperThread.start(conf.reaperIntervalSeconds);
+
+    // Start refreshing the cluster view if enabled
+    if (conf.resourceGossipIntervalSeconds > 0) {
+        resourceGossipThread.start(conf.resourceGossipIntervalSeconds);
+    }
+
+    // Start pre-warming executors if enabled
+    if (conf.executorPoolMax > 0) {
+        executorPoolThread.start(conf.executorPoolIntervalSeconds);
+    }
 }
 
 Scheduler::~Scheduler()
@@ -108,19 +157,43 @@ void Scheduler::reset()
     SPDLOG_DEBUG("Resetting scheduler");
     resetThreadLocalCache();
 
+    {
+        faabric::util::FullLock lock(sharedClientsMx);
+        sharedFunctionCallClients.clear();
+        sharedSnapshotClients.clear();
+    }
+
     // Stop the function migration thread
     functionMigrationThread.stop();
 
     // Stop the reaper thread
     reaperThread.stop();
 
-    // Shut down, then clear executors
-    for (auto& ep : executors) {
-        for (auto& e : ep.second) {
-            e->shutdown();
+    // Stop refreshing the cluster view
+    resourceGossipThread.stop();
+
+    // Stop pre-warming executors
+    executorPoolThread.stop();
+
+    // Shut down, then clear executors. Executors may call back into the
+    // scheduler while shutting down, so we mustn't hold any locks
+    std::vector<std::shared_ptr<Executor>> executorsToShutdown;
+    {
+        faabric::util::FullLock lock(shardsMx);
+        for (auto& p : functionShards) {
+            faabric::util::UniqueLock shardLock(p.second->mx);
+            for (auto& e : p.second->executors) {
+                executorsToShutdown.emplace_back(std::move(e));
+            }
+            p.second->executors.clear();
         }
+        functionShards.clear();
+    }
+
+    for (auto& e : executorsToShutdown) {
+        e->shutdown();
     }
-    executors.clear();
+    executorsToShutdown.clear();
 
     // Clear the point to point broker
     broker.clear();
@@ -133,14 +206,35 @@ void Scheduler::reset()
     // Reset resources
     thisHostResources = faabric::HostResources();
     thisHostResources.set_slots(faabric::util::getUsableCores());
+    thisHostUsedSlots.store(0, std::memory_order_release);
 
     // Reset scheduler state
     availableHostsCache.clear();
-    registeredHosts.clear();
-    threadResults.clear();
-    threadResultMessages.clear();
+    clusterView.clear();
+    pendingReservations.clear();
 
-    pushedSnapshotsMap.clear();
+    {
+        faabric::util::UniqueLock resultsLock(threadResultsMx);
+        threadResults.clear();
+        threadResultMessages.clear();
+    }
+
+    {
+        faabric::util::UniqueLock resultsLock(localResultsMutex);
+        directResults.clear();
+        pushedResultTimes.clear();
+    }
+
+    {
+        faabric::util::UniqueLock logsLock(chainedLogsMx);
+        pendingChainedLogs.clear();
+    }
+
+    {
+        faabric::util::UniqueLock admissionLock(admissionMx);
+        pendingTasks.clear();
+        admissionMetrics = AdmissionMetrics();
+    }
 
     // Reset function migration tracking
     inFlightRequests.clear();
@@ -153,6 +247,16 @@ void Scheduler::reset()
 
     // Restart reaper thread
     reaperThread.start(conf.reaperIntervalSeconds);
+
+    // Restart refreshing the cluster view if enabled
+    if (conf.resourceGossipIntervalSeconds > 0) {
+        resourceGossipThread.start(conf.resourceGossipIntervalSeconds);
+    }
+
+    // Restart pre-warming executors if enabled
+    if (conf.executorPoolMax > 0) {
+        executorPoolThread.start(conf.executorPoolIntervalSeconds);
+    }
 }
 
 void Scheduler::shutdown()
@@ -161,6 +265,10 @@ void Scheduler::shutdown()
 
     reaperThread.stop();
 
+    resourceGossipThread.stop();
+
+    executorPoolThread.stop();
+
     removeHostFromGlobalSet(thisHost);
 
     _isShutdown = true;
@@ -171,27 +279,72 @@ void SchedulerReaperThread::doWork()
     getScheduler().reapStaleExecutors();
 }
 
+void ResourceGossipThread::doWork()
+{
+    getScheduler().refreshClusterResources();
+}
+
+void ExecutorPoolThread::doWork()
+{
+    getScheduler().prewarmExecutors();
+}
+
+std::shared_ptr<FunctionShard> Scheduler::getFunctionShard(
+  const std::string& funcStr)
+{
+    {
+        faabric::util::SharedLock lock(shardsMx);
+        auto it = functionShards.find(funcStr);
+        if (it != functionShards.end()) {
+            return it->second;
+        }
+    }
+
+    faabric::util::FullLock lock(shardsMx);
+    std::shared_ptr<FunctionShard>& shard = functionShards[funcStr];
+    if (shard == nullptr) {
+        shard = std::make_shared<FunctionShard>();
+    }
+
+    return shard;
+}
+
+std::vector<std::shared_ptr<FunctionShard>> Scheduler::getAllFunctionShards()
+{
+    faabric::util::SharedLock lock(shardsMx);
+
+    std::vector<std::shared_ptr<FunctionShard>> shards;
+    shards.reserve(functionShards.size());
+    for (const auto& p : functionShards) {
+        shards.emplace_back(p.second);
+    }
+
+    return shards;
+}
+
 int Scheduler::reapStaleExecutors()
 {
-    faabric::util::FullLock lock(mx);
+    std::vector<std::shared_ptr<FunctionShard>> shards =
+      getAllFunctionShards();
 
-    if (executors.empty()) {
+    if (shards.empty()) {
         SPDLOG_DEBUG("No executors to check for reaping");
         return 0;
     }
 
-    std::vector<std::string> keysToRemove;
-
     int nReaped = 0;
-    for (auto& execPair : executors) {
-        std::string key = execPair.first;
-        std::vector<std::shared_ptr<Executor>>& execs = execPair.second;
+    for (auto& shard : shards) {
+        faabric::util::UniqueLock shardLock(shard->mx);
+
+        std::vector<std::shared_ptr<Executor>>& execs = shard->executors;
         std::vector<std::shared_ptr<Executor>> toRemove;
 
         if (execs.empty()) {
             continue;
         }
 
+        std::string key =
+          faabric::util::funcToString(execs.back()->getBoundMessage(), false);
         SPDLOG_TRACE(
           "Checking {} executors for {} for reaping", execs.size(), key);
 
@@ -201,6 +354,16 @@ int Scheduler::reapStaleExecutors()
         std::string masterHost = firstMsg.masterhost();
 
         for (auto exec : execs) {
+            // Keep the function's pool at its minimum size
+            if ((int)(execs.size() - toRemove.size()) <=
+                conf.executorPoolMin) {
+                SPDLOG_TRACE("Not reaping more executors for {}, at pool "
+                             "minimum ({})",
+                             key,
+                             conf.executorPoolMin);
+                break;
+            }
+
             long millisSinceLastExec = exec->getMillisSinceLastExec();
             if (millisSinceLastExec < conf.boundTimeout) {
                 // This executor has had an execution too recently
@@ -250,79 +413,288 @@ int Scheduler::reapStaleExecutors()
 
                 getFunctionCallClient(masterHost).unregister(req);
             }
-
-            keysToRemove.emplace_back(key);
         }
     }
 
-    // Remove and erase
-    for (auto& key : keysToRemove) {
-        SPDLOG_TRACE("Removing scheduler record for {}, no more executors",
-                     key);
-        executors.erase(key);
+    return nReaped;
+}
+
+int Scheduler::prewarmExecutors()
+{
+    if (conf.executorPoolMax <= 0) {
+        return 0;
     }
 
-    return nReaped;
+    std::shared_ptr<faabric::scheduler::ExecutorFactory> factory =
+      getExecutorFactory();
+
+    int nCreated = 0;
+    for (auto& shard : getAllFunctionShards()) {
+        faabric::util::UniqueLock shardLock(shard->mx);
+
+        if (shard->prewarmMsg == nullptr) {
+            continue;
+        }
+
+        // Expect as many calls in the next interval as we've seen on average,
+        // and make sure there are enough idle executors to take them
+        shard->callRate = EXECUTOR_POOL_EWMA_ALPHA * shard->nRecentCalls +
+                          (1 - EXECUTOR_POOL_EWMA_ALPHA) * shard->callRate;
+        shard->nRecentCalls = 0;
+
+        int nTarget = std::clamp((int)std::lround(shard->callRate),
+                                 std::min(conf.executorPoolMin,
+                                          conf.executorPoolMax),
+                                 conf.executorPoolMax);
+
+        int nIdle = std::count_if(
+          shard->executors.begin(),
+          shard->executors.end(),
+          [](const std::shared_ptr<Executor>& e) { return !e->isClaimed(); });
+
+        // The maximum bounds the whole pool, including claimed executors
+        int nToCreate =
+          std::min(nTarget - nIdle,
+                   conf.executorPoolMax - (int)shard->executors.size());
+        if (nToCreate <= 0) {
+            continue;
+        }
+
+        std::string funcStr =
+          faabric::util::funcToString(*shard->prewarmMsg, false);
+        SPDLOG_DEBUG("Pre-warming {} executors for {} (rate {:.2f}, idle {})",
+                     nToCreate,
+                     funcStr,
+                     shard->callRate,
+                     nIdle);
+
+        // Creating executors can be lengthy, so we don't hold up scheduling
+        // while doing so
+        faabric::Message msg = *shard->prewarmMsg;
+        shardLock.unlock();
+
+        std::vector<std::shared_ptr<Executor>> created;
+        for (int i = 0; i < nToCreate; i++) {
+            created.emplace_back(factory->createExecutor(msg));
+        }
+
+        shardLock.lock();
+        shard->executors.insert(
+          shard->executors.end(), created.begin(), created.end());
+        nCreated += created.size();
+    }
+
+    return nCreated;
 }
 
 long Scheduler::getFunctionExecutorCount(const faabric::Message& msg)
 {
-    faabric::util::SharedLock lock(mx);
-    const std::string funcStr = faabric::util::funcToString(msg, false);
-    return executors[funcStr].size();
+    auto shard = getFunctionShard(faabric::util::funcToString(msg, false));
+    faabric::util::UniqueLock lock(shard->mx);
+    return shard->executors.size();
 }
 
 int Scheduler::getFunctionRegisteredHostCount(const faabric::Message& msg)
 {
-    faabric::util::SharedLock lock(mx);
-    return getFunctionRegisteredHosts(msg.user(), msg.function(), false).size();
+    return getFunctionRegisteredHosts(msg.user(), msg.function()).size();
 }
 
-const std::set<std::string>& Scheduler::getFunctionRegisteredHosts(
+std::set<std::string> Scheduler::getFunctionRegisteredHosts(
   const std::string& user,
-  const std::string& func,
-  bool acquireLock)
+  const std::string& func)
 {
-    faabric::util::SharedLock lock;
-    if (acquireLock) {
-        lock = faabric::util::SharedLock(mx);
-    }
-    std::string key = user + "/" + func;
-    return registeredHosts[key];
+    auto shard = getFunctionShard(user + "/" + func);
+    faabric::util::UniqueLock lock(shard->mx);
+    return shard->registeredHosts;
 }
 
 void Scheduler::removeRegisteredHost(const std::string& host,
                                      const std::string& user,
                                      const std::string& function)
 {
-    faabric::util::FullLock lock(mx);
-    std::string key = user + "/" + function;
-    registeredHosts[key].erase(host);
+    auto shard = getFunctionShard(user + "/" + function);
+    faabric::util::UniqueLock lock(shard->mx);
+    shard->registeredHosts.erase(host);
 }
 
 void Scheduler::addRegisteredHost(const std::string& host,
                                   const std::string& user,
                                   const std::string& function)
 {
-    std::string key = user + "/" + function;
-    registeredHosts[key].insert(host);
+    auto shard = getFunctionShard(user + "/" + function);
+    faabric::util::UniqueLock lock(shard->mx);
+    shard->registeredHosts.insert(host);
 }
 
 void Scheduler::vacateSlot()
 {
     thisHostUsedSlots.fetch_sub(1, std::memory_order_acq_rel);
+
+    // Let in any calls waiting for the slot
+    if (conf.hostQueueCapacity > 0) {
+        startQueuedTasks();
+    }
+}
+
+// Claims one of this host's slots if fewer than the limit are in use. Calls
+// are never held back when nothing is running, as nothing would let them in.
+bool Scheduler::tryClaimSlot(int limit)
+{
+    int usedSlots = thisHostUsedSlots.load(std::memory_order_acquire);
+    do {
+        if (usedSlots > 0 && usedSlots >= limit) {
+            return false;
+        }
+    } while (!thisHostUsedSlots.compare_exchange_weak(
+      usedSlots, usedSlots + 1, std::memory_order_acq_rel));
+
+    return true;
+}
+
+bool Scheduler::admitTask(std::shared_ptr<faabric::BatchExecuteRequest> req,
+                          int msgIdx)
+{
+    if (conf.hostQueueCapacity <= 0) {
+        return true;
+    }
+
+    // Calls from other masters already hold the slot they reserved here
+    faabric::Message& msg = req->mutable_messages()->at(msgIdx);
+    if (msg.masterhost() != thisHost) {
+        return true;
+    }
+
+    int slots = getThisHostSlots();
+
+    {
+        faabric::util::UniqueLock lock(admissionMx);
+
+        // Calls already waiting go first, unless this one has a higher
+        // priority
+        bool isNext = pendingTasks.empty() ||
+                      pendingTasks.peekPriority() < msg.priority();
+        int limit = isNext ? getAdmissionLimit(slots, msg.priority()) : 0;
+        if (tryClaimSlot(limit)) {
+            return true;
+        }
+
+        if ((int)pendingTasks.size() < conf.hostQueueCapacity) {
+            auto queuedAt = faabric::util::startTimer();
+            pendingTasks.enqueue({ req, msgIdx, queuedAt },
+                                 msg.user(),
+                                 msg.function(),
+                                 msg.priority(),
+                                 msg.weight());
+            admissionMetrics.nQueued++;
+            admissionMetrics.queueDepth = pendingTasks.size();
+
+            SPDLOG_DEBUG("Queueing {} at capacity ({} queued, {} slots used)",
+                         msg.id(),
+                         pendingTasks.size(),
+                         thisHostUsedSlots.load(std::memory_order_acquire));
+            return false;
+        }
+
+        admissionMetrics.nRejected++;
+    }
+
+    rejectTask(msg);
+    return false;
+}
+
+void Scheduler::rejectTask(faabric::Message& msg)
+{
+    SPDLOG_WARN("Rejecting {} ({}), queue full at {} calls",
+                faabric::util::funcToString(msg, false),
+                msg.id(),
+                conf.hostQueueCapacity);
+
+    msg.set_returnvalue(REJECTED_FUNCTION_RETURN_VALUE);
+    msg.set_outputdata("Rejected, host queue full");
+    setFunctionResult(msg);
+}
+
+void Scheduler::startQueuedTasks()
+{
+    int slots = getThisHostSlots();
+
+    std::vector<PendingTask> toStart;
+    {
+        faabric::util::UniqueLock lock(admissionMx);
+
+        // The next call has the highest priority waiting, so if it can't use
+        // the remaining slots, nothing else can either
+        while (!pendingTasks.empty() &&
+               tryClaimSlot(
+                 getAdmissionLimit(slots, pendingTasks.peekPriority()))) {
+            PendingTask task = pendingTasks.dequeue();
+
+            long waitMillis =
+              (long)faabric::util::getTimeDiffMillis(task.queuedAt);
+            admissionMetrics.totalWaitMillis += waitMillis;
+            admissionMetrics.maxWaitMillis =
+              std::max(admissionMetrics.maxWaitMillis, waitMillis);
+
+            toStart.emplace_back(std::move(task));
+        }
+
+        admissionMetrics.queueDepth = pendingTasks.size();
+    }
+
+    // Executors may take a while to start, so don't hold up other tasks
+    for (auto& task : toStart) {
+        faabric::Message& msg = task.req->mutable_messages()->at(task.msgIdx);
+        SPDLOG_DEBUG("Starting queued call {}", msg.id());
+
+        auto shard = getFunctionShard(faabric::util::funcToString(msg, false));
+        faabric::util::UniqueLock shardLock(shard->mx);
+        std::shared_ptr<Executor> e = claimExecutor(msg, *shard, shardLock);
+        e->executeTasks({ task.msgIdx }, task.req);
+    }
+}
+
+int Scheduler::getAdmissionLimit(int slots, int priority)
+{
+    if (priority > 0) {
+        return slots;
+    }
+
+    // Always leave normal calls at least one slot
+    return std::min(slots, std::max(1, slots - conf.reservedPrioritySlots));
+}
+
+int Scheduler::getThisHostSlots()
+{
+    // Resources may be replaced at any time, so must be read under the lock
+    faabric::util::SharedLock lock(mx);
+    return thisHostResources.slots();
+}
+
+AdmissionMetrics Scheduler::getAdmissionMetrics()
+{
+    faabric::util::UniqueLock lock(admissionMx);
+    return admissionMetrics;
 }
 
 // Attempts to reserve slots, returns the number of actually allocated slots.
-int Scheduler::tryReserveSlots(int slotsRequested)
+int Scheduler::tryReserveSlots(int slotsRequested, bool force)
 {
-    int availableSlots =
-      thisHostResources.slots() -
-      this->thisHostUsedSlots.load(std::memory_order_acquire);
+    if (force) {
+        thisHostUsedSlots.fetch_add(slotsRequested, std::memory_order_acq_rel);
+        return slotsRequested;
+    }
 
-    int allocatedSlots = std::min(availableSlots, slotsRequested);
+    int slots = getThisHostSlots();
 
-    thisHostUsedSlots.fetch_add(allocatedSlots, std::memory_order_acq_rel);
+    // Reservations from several hosts may arrive at once, so we must not
+    // hand out the same free slots twice
+    int usedSlots = thisHostUsedSlots.load(std::memory_order_acquire);
+    int allocatedSlots = 0;
+    do {
+        int availableSlots = std::max<int>(0, slots - usedSlots);
+        allocatedSlots = std::min(availableSlots, slotsRequested);
+    } while (!thisHostUsedSlots.compare_exchange_weak(
+      usedSlots, usedSlots + allocatedSlots, std::memory_order_acq_rel));
 
     return allocatedSlots;
 }
@@ -356,25 +728,110 @@ faabric::util::SchedulingDecision Scheduler::callFunctions(
         return decision;
     }
 
-    faabric::util::FullLock lock(mx);
+    if (!isForceLocal) {
+        prepareClusterView(req->messages_size(), topologyHint);
+    }
+
+    std::shared_ptr<FunctionShard> shard =
+      getFunctionShard(faabric::util::funcToString(firstMsg, false));
+
+    SchedulingDecision result(firstMsg.appid(), firstMsg.groupid());
+    {
+        faabric::util::UniqueLock shardLock(shard->mx);
+
+        SchedulingDecision decision =
+          doSchedulingDecision(req, *shard, topologyHint);
+
+        // Pass decision as hint
+        result =
+          doCallFunctions(req, decision, *shard, shardLock, topologyHint);
+    }
 
-    SchedulingDecision decision = doSchedulingDecision(req, topologyHint);
+    // Confirm any slots taken from the cluster view without holding up other
+    // scheduling decisions
+    confirmReservations();
 
-    // Pass decision as hint
-    return doCallFunctions(req, decision, lock, topologyHint);
+    return result;
 }
 
 faabric::util::SchedulingDecision Scheduler::makeSchedulingDecision(
   std::shared_ptr<faabric::BatchExecuteRequest> req,
   faabric::util::SchedulingTopologyHint topologyHint)
 {
-    faabric::util::FullLock lock(mx);
+    if (topologyHint != faabric::util::SchedulingTopologyHint::FORCE_LOCAL) {
+        prepareClusterView(req->messages_size(), topologyHint);
+    }
+
+    std::shared_ptr<FunctionShard> shard =
+      getFunctionShard(faabric::util::funcToString(req));
+
+    SchedulingDecision decision(0, 0);
+    {
+        faabric::util::UniqueLock shardLock(shard->mx);
+        decision = doSchedulingDecision(req, *shard, topologyHint);
+    }
+
+    confirmReservations();
+
+    return decision;
+}
+
+std::vector<std::string> Scheduler::rankHostsByLocality(
+  std::shared_ptr<faabric::BatchExecuteRequest> req,
+  FunctionShard& shard,
+  int nCalls)
+{
+    const faabric::Message& firstMsg = req->messages().at(0);
+
+    std::string snapshotKey = firstMsg.snapshotkey();
+    if (req->type() == faabric::BatchExecuteRequest::THREADS) {
+        snapshotKey = faabric::util::getMainThreadSnapshotKey(firstMsg);
+    }
+
+    size_t snapshotBytes = 0;
+    if (!snapshotKey.empty() && reg.snapshotExists(snapshotKey)) {
+        snapshotBytes = reg.getSnapshot(snapshotKey)->getSize();
+    }
+
+    // Registered hosts are sent every update to the snapshot, so only need
+    // the diffs
+    std::vector<PlacementCandidate> candidates;
+    auto addCandidate = [&](const std::string& h, bool isRegistered) {
+        if (h == thisHost) {
+            return;
+        }
+
+        PlacementCandidate& c = candidates.emplace_back();
+        c.host = h;
+        c.hasSnapshot = isRegistered;
+
+        // We only know how many slots are free from the cluster view. The host
+        // may be dropped from the view while we're looking.
+        if (clusterView.hasHost(h)) {
+            try {
+                faabric::HostResources r = clusterView.getResources(h);
+                c.freeSlots = std::max<int>(0, r.slots() - r.usedslots());
+            } catch (std::runtime_error& e) {
+                c.freeSlots = 0;
+            }
+        }
+    };
+
+    for (const auto& h : shard.registeredHosts) {
+        addCandidate(h, true);
+    }
+
+    for (const auto& h : getUnregisteredHosts(shard.registeredHosts)) {
+        addCandidate(h, false);
+    }
 
-    return doSchedulingDecision(req, topologyHint);
+    PlacementCostModel model(conf.snapshotTransferMbps);
+    return model.rankHosts(candidates, snapshotBytes, nCalls);
 }
 
 faabric::util::SchedulingDecision Scheduler::doSchedulingDecision(
   std::shared_ptr<faabric::BatchExecuteRequest> req,
+  FunctionShard& shard,
   faabric::util::SchedulingTopologyHint topologyHint)
 {
     int nMessages = req->messages_size();
@@ -446,7 +903,7 @@ faabric::util::SchedulingDecision Scheduler::doSchedulingDecision(
         // asked to force full local execution.
 
         // Work out how many we can handle locally
-        int slots = thisHostResources.slots();
+        int slots = getThisHostSlots();
         if (topologyHint == faabric::util::SchedulingTopologyHint::UNDERFULL) {
             slots = slots / 2;
         }
@@ -469,37 +926,45 @@ faabric::util::SchedulingDecision Scheduler::doSchedulingDecision(
         // If some are left, we need to distribute.
         // First try and do so on already registered hosts.
         int remainder = nMessages - nLocally;
-        if (remainder > 0) {
-            const std::set<std::string>& thisRegisteredHosts =
-              getFunctionRegisteredHosts(
-                firstMsg.user(), firstMsg.function(), false);
-
-            for (const auto& h : thisRegisteredHosts) {
-                // Work out resources on the remote host
-                faabric::HostResources r = getHostResources(h);
-                int available = r.slots() - r.usedslots();
-
-                // We need to floor at zero here in case the remote host is
-                // overloaded, in which case its used slots will be greater than
-                // its available slots.
-                available = std::max<int>(0, available);
-
-                // reserve RPC call. If failed, continue in loop.
-                SPDLOG_DEBUG("Reserving {} slots on {}", available, h);
-                int availableReserved = tryReserveHostSlots(h, available);
-                SPDLOG_DEBUG("Got response: reserved {} slots on {}", available, h);
-                if (availableReserved <= 0) {
-                    // no available slots reserved.
+        int minSlots =
+          topologyHint == faabric::util::SchedulingTopologyHint::NEVER_ALONE
+            ? 2
+            : 1;
+
+        // With locality-aware placement we consider all other hosts at once,
+        // cheapest first
+        bool isLocality = conf.placementPolicy == "locality";
+        if (remainder > 0 && isLocality) {
+            for (const auto& h : rankHostsByLocality(req, shard, remainder)) {
+                int nOnThisHost = reserveRemoteSlots(h, remainder, minSlots);
+                if (nOnThisHost <= 0) {
                     continue;
                 }
 
-                int nOnThisHost = std::min<int>(availableReserved, remainder);
+                SPDLOG_TRACE("Scheduling {}/{} of {} on {} (locality)",
+                             nOnThisHost,
+                             nMessages,
+                             funcStr,
+                             h);
+
+                shard.registeredHosts.insert(h);
+                for (int i = 0; i < nOnThisHost; i++) {
+                    hosts.push_back(h);
+                }
+
+                remainder -= nOnThisHost;
+                if (remainder <= 0) {
+                    break;
+                }
+            }
+        }
 
+        if (remainder > 0 && !isLocality) {
+            for (const auto& h : shard.registeredHosts) {
                 // Under the NEVER_ALONE topology hint, we never choose a host
                 // unless we can schedule at least two requests in it.
-                if (topologyHint ==
-                      faabric::util::SchedulingTopologyHint::NEVER_ALONE &&
-                    nOnThisHost < 2) {
+                int nOnThisHost = reserveRemoteSlots(h, remainder, minSlots);
+                if (nOnThisHost <= 0) {
                     continue;
                 }
 
@@ -521,9 +986,9 @@ faabric::util::SchedulingDecision Scheduler::doSchedulingDecision(
         }
 
         // Now schedule to unregistered hosts if there are messages left
-        if (remainder > 0) {
+        if (remainder > 0 && !isLocality) {
             std::vector<std::string> unregisteredHosts =
-              getUnregisteredHosts(firstMsg.user(), firstMsg.function());
+              getUnregisteredHosts(shard.registeredHosts);
 
             for (const auto& h : unregisteredHosts) {
                 // Skip if this host
@@ -531,30 +996,8 @@ faabric::util::SchedulingDecision Scheduler::doSchedulingDecision(
                     continue;
                 }
 
-                // Work out resources on the remote host
-                faabric::HostResources r = getHostResources(h);
-                int available = r.slots() - r.usedslots();
-
-                // We need to floor at zero here in case the remote host is
-                // overloaded, in which case its used slots will be greater than
-                // its available slots.
-                available = std::max<int>(0, available);
-
-                // Reserve RPC call. If failed, continue in loop.
-                SPDLOG_DEBUG("Reserving {} slots on {}", available, h);
-                int availableReserved = tryReserveHostSlots(h, available);
-                SPDLOG_DEBUG("Got response: reserved {} slots on {}", available, h);
-
-                if (availableReserved <= 0) {
-                    // no available slots reserved.
-                    continue;
-                }
-
-                int nOnThisHost = std::min(availableReserved, remainder);
-
-                if (topologyHint ==
-                      faabric::util::SchedulingTopologyHint::NEVER_ALONE &&
-                    nOnThisHost < 2) {
+                int nOnThisHost = reserveRemoteSlots(h, remainder, minSlots);
+                if (nOnThisHost <= 0) {
                     continue;
                 }
 
@@ -566,7 +1009,7 @@ faabric::util::SchedulingDecision Scheduler::doSchedulingDecision(
 
                 // Register the host if it's exected a function
                 if (nOnThisHost > 0) {
-                    addRegisteredHost(h, firstMsg.user(), firstMsg.function());
+                    shard.registeredHosts.insert(h);
                 }
 
                 for (int i = 0; i < nOnThisHost; i++) {
@@ -633,15 +1076,22 @@ faabric::util::SchedulingDecision Scheduler::callFunctions(
   std::shared_ptr<faabric::BatchExecuteRequest> req,
   faabric::util::SchedulingDecision& hint)
 {
-    faabric::util::FullLock lock(mx);
-    return doCallFunctions(
-      req, hint, lock, faabric::util::SchedulingTopologyHint::NONE);
+    std::shared_ptr<FunctionShard> shard =
+      getFunctionShard(faabric::util::funcToString(req));
+
+    faabric::util::UniqueLock shardLock(shard->mx);
+    return doCallFunctions(req,
+                           hint,
+                           *shard,
+                           shardLock,
+                           faabric::util::SchedulingTopologyHint::NONE);
 }
 
 faabric::util::SchedulingDecision Scheduler::doCallFunctions(
   std::shared_ptr<faabric::BatchExecuteRequest> req,
   faabric::util::SchedulingDecision& decision,
-  faabric::util::FullLock& lock,
+  FunctionShard& shard,
+  faabric::util::UniqueLock& shardLock,
   faabric::util::SchedulingTopologyHint topologyHint)
 {
     faabric::Message& firstMsg = req->mutable_messages()->at(0);
@@ -688,6 +1138,7 @@ faabric::util::SchedulingDecision Scheduler::doCallFunctions(
 
     // Record in-flight request if function desires to be migrated
     if (!isMigration && firstMsg.migrationcheckperiod() > 0) {
+        faabric::util::FullLock lock(mx);
         doStartFunctionMigrationThread(req, decision);
     }
 
@@ -761,23 +1212,37 @@ faabric::util::SchedulingDecision Scheduler::doCallFunctions(
     if (!snapshotKey.empty()) {
         auto snap = reg.getSnapshot(snapshotKey);
 
-        for (const auto& host : getFunctionRegisteredHosts(
-               firstMsg.user(), firstMsg.function(), false)) {
-            SnapshotClient& c = getSnapshotClient(host);
-
-            // See if we've already pushed this snapshot to the given host,
-            // if so, just push the diffs that have occurred in this main thread
-            if (pushedSnapshotsMap[snapshotKey].contains(host)) {
-                std::vector<faabric::util::SnapshotDiff> snapshotDiffs =
-                  snap->getTrackedChanges();
-
-                c.pushSnapshotUpdate(snapshotKey, snap, snapshotDiffs);
+        // Hosts we've already pushed this snapshot to just need the diffs
+        // that have occurred in this main thread
+        std::vector<std::string> fullHosts;
+        std::vector<std::string> diffHosts;
+        std::set<std::string>& pushedHosts = shard.pushedSnapshots[snapshotKey];
+        for (const auto& host : shard.registeredHosts) {
+            if (pushedHosts.contains(host)) {
+                diffHosts.push_back(host);
             } else {
-                c.pushSnapshot(snapshotKey, snap);
-                pushedSnapshotsMap[snapshotKey].insert(host);
+                fullHosts.push_back(host);
             }
         }
 
+        // Push to all hosts concurrently, relaying through a broadcast tree
+        // if configured
+        if (!diffHosts.empty()) {
+            std::vector<faabric::util::SnapshotDiff> snapshotDiffs =
+              snap->getTrackedChanges();
+
+            faabric::snapshot::pushSnapshotUpdateToHosts(
+              diffHosts,
+              snapshotKey,
+              snap,
+              snapshotDiffs,
+              conf.snapshotBroadcastFanOut);
+        }
+
+        faabric::snapshot::pushSnapshotToHosts(
+          fullHosts, snapshotKey, snap, conf.snapshotBroadcastFanOut);
+        pushedHosts.insert(fullHosts.begin(), fullHosts.end());
+
         // Now reset the tracking on the snapshot before we start executing
         snap->clearTrackedChanges();
     } else if (!snapshotKey.empty() && isMigration && isForceLocal) {
@@ -795,134 +1260,179 @@ faabric::util::SchedulingDecision Scheduler::doCallFunctions(
     // -------------------------------------------
 
     // Records for tests - copy messages before execution to avoid racing on msg
-    size_t recordedMessagesOffset = recordedMessagesAll.size();
     if (faabric::util::isTestMode()) {
+        faabric::util::FullLock lock(mx);
         for (int i = 0; i < nMessages; i++) {
-            recordedMessagesAll.emplace_back(req->messages().at(i));
+            std::string executedHost = decision.hosts.at(i);
+            const faabric::Message& msg =
+              recordedMessagesAll.emplace_back(req->messages().at(i));
+
+            // Log results if in test mode
+            if (executedHost.empty() || executedHost == thisHost) {
+                recordedMessagesLocal.emplace_back(msg);
+            } else {
+                recordedMessagesShared.emplace_back(executedHost, msg);
+            }
         }
     }
 
-    // Iterate through unique hosts and dispatch messages
+    // Remote messages are serialised straight from the original request, so
+    // each host only needs the batch details and which messages are its own
+    struct RemoteBatch
+    {
+        std::string host;
+        std::shared_ptr<faabric::BatchExecuteRequest> header;
+        std::vector<int> msgIdxs;
+        std::vector<bool> directResults;
+    };
+
+    // Work out which messages go where
+    std::unordered_map<std::string, std::vector<int>> hostIdxs;
+    for (int i = 0; i < decision.hosts.size(); i++) {
+        hostIdxs[decision.hosts.at(i)].push_back(i);
+    }
+
+    bool isDirectResults = conf.functionResultMode != "redis";
+    std::vector<uint32_t> directResultIds;
+    std::vector<int> localIdxs;
+    std::vector<RemoteBatch> remoteBatches;
     for (const std::string& host : orderedHosts) {
-        // Work out which indexes are scheduled on this host
-        std::vector<int> thisHostIdxs;
-        for (int i = 0; i < decision.hosts.size(); i++) {
-            if (decision.hosts.at(i) == host) {
-                thisHostIdxs.push_back(i);
-            }
-        }
+        std::vector<int>& thisHostIdxs = hostIdxs[host];
 
         if (host == thisHost) {
-            // -------------------------------------------
-            // LOCAL EXECTUION
-            // -------------------------------------------
-            // For threads we only need one executor, for anything else we want
-            // one Executor per function in flight.
-
-            if (thisHostIdxs.empty()) {
-                SPDLOG_DEBUG("Not scheduling any calls to {} out of {} locally",
-                             funcStr,
-                             nMessages);
-                continue;
+            localIdxs = std::move(thisHostIdxs);
+            continue;
+        }
+
+        RemoteBatch& batch = remoteBatches.emplace_back();
+        batch.host = host;
+        batch.header = faabric::util::batchExecFactory();
+        batch.header->set_snapshotkey(req->snapshotkey());
+        batch.header->set_type(req->type());
+        batch.header->set_subtype(req->subtype());
+        batch.header->set_contextdata(req->contextdata());
+
+        // Results of sync calls made from this host can be sent straight back
+        // here rather than through Redis
+        for (auto msgIdx : thisHostIdxs) {
+            const faabric::Message& msg = req->messages().at(msgIdx);
+            bool isDirect = isDirectResults && !isThreads && !msg.isasync() &&
+                            msg.masterhost() == thisHost;
+            if (isDirect) {
+                directResultIds.push_back(msg.id());
             }
 
-            SPDLOG_DEBUG("Scheduling {}/{} calls to {} locally",
-                         thisHostIdxs.size(),
-                         nMessages,
-                         funcStr);
+            batch.directResults.push_back(isDirect);
+        }
 
-            // Update slots
-            /*
-            this->thisHostUsedSlots.fetch_add(thisHostIdxs.size(),
-                                              std::memory_order_acquire);
-            */
-
-            if (isThreads) {
-                // Threads use the existing executor. We assume there's only
-                // one running at a time.
-                std::vector<std::shared_ptr<Executor>>& thisExecutors =
-                  executors[funcStr];
-
-                std::shared_ptr<Executor> e = nullptr;
-                if (thisExecutors.empty()) {
-                    // Create executor if not exists
-                    e = claimExecutor(firstMsg, lock);
-                } else if (thisExecutors.size() == 1) {
-                    // Use existing executor if exists
-                    e = thisExecutors.back();
-                } else {
-                    SPDLOG_ERROR("Found {} executors for threaded function {}",
-                                 thisExecutors.size(),
-                                 funcStr);
-                    throw std::runtime_error(
-                      "Expected only one executor for threaded function");
-                }
+        batch.msgIdxs = std::move(thisHostIdxs);
+    }
 
-                assert(e != nullptr);
+    // -------------------------------------------
+    // REMOTE EXECTUION
+    // -------------------------------------------
+    // Snapshots have been pushed, so dispatching the calls doesn't need the
+    // function's state. We don't hold its lock while waiting on the network.
+    shardLock.unlock();
 
-                // Execute the tasks
-                e->executeTasks(thisHostIdxs, req);
-            } else {
-                // Non-threads require one executor per task
-                for (auto i : thisHostIdxs) {
-                    faabric::Message& localMsg = req->mutable_messages()->at(i);
-
-                    if (localMsg.executeslocally()) {
-                        faabric::util::UniqueLock resultsLock(
-                          localResultsMutex);
-                        localResults.insert(
-                          { localMsg.id(),
-                            std::promise<
-                              std::unique_ptr<faabric::Message>>() });
-                    }
+    // Results may come back as soon as the calls are dispatched, so we must be
+    // ready for them first
+    if (!directResultIds.empty()) {
+        faabric::util::UniqueLock resultsLock(localResultsMutex);
+        for (auto id : directResultIds) {
+            DirectResult& r = directResults[id];
+            r.result = r.promise.get_future().share();
+        }
+    }
 
-                    std::shared_ptr<Executor> e = claimExecutor(localMsg, lock);
-                    e->executeTasks({ i }, req);
-                }
-            }
+    for (const auto& batch : remoteBatches) {
+        SPDLOG_DEBUG("Scheduling {}/{} calls to {} on {}",
+                     batch.msgIdxs.size(),
+                     nMessages,
+                     funcStr,
+                     batch.host);
+
+        getFunctionCallClient(batch.host)
+          .executeFunctions(
+            *batch.header, *req, batch.msgIdxs, batch.directResults);
+    }
+
+    // -------------------------------------------
+    // LOCAL EXECTUION
+    // -------------------------------------------
+    // We schedule things on this host _last_, after all remote messages have
+    // been dispatched. For threads we only need one executor, for anything
+    // else we want one Executor per function in flight.
+    if (localIdxs.empty()) {
+        return decision;
+    }
+
+    SPDLOG_DEBUG("Scheduling {}/{} calls to {} locally",
+                 localIdxs.size(),
+                 nMessages,
+                 funcStr);
+
+    shardLock.lock();
+
+    if (isThreads) {
+        // Threads use the existing executor. We assume there's only
+        // one running at a time.
+        std::shared_ptr<Executor> e = nullptr;
+        if (shard.executors.empty()) {
+            // Create executor if not exists
+            e = claimExecutor(firstMsg, shard, shardLock);
+        } else if (shard.executors.size() == 1) {
+            // Use existing executor if exists
+            e = shard.executors.back();
         } else {
-            // -------------------------------------------
-            // REMOTE EXECTUION
-            // -------------------------------------------
-            SPDLOG_DEBUG("Scheduling {}/{} calls to {} on {}",
-                         thisHostIdxs.size(),
-                         nMessages,
-                         funcStr,
-                         host);
-
-            // Set up new request
-            std::shared_ptr<faabric::BatchExecuteRequest> hostRequest =
-              faabric::util::batchExecFactory();
-            hostRequest->set_snapshotkey(req->snapshotkey());
-            hostRequest->set_type(req->type());
-            hostRequest->set_subtype(req->subtype());
-            hostRequest->set_contextdata(req->contextdata());
-
-            // Add messages
-            for (auto msgIdx : thisHostIdxs) {
-                auto* newMsg = hostRequest->add_messages();
-                *newMsg = req->messages().at(msgIdx);
-                newMsg->set_executeslocally(false);
-            }
+            SPDLOG_ERROR("Found {} executors for threaded function {}",
+                         shard.executors.size(),
+                         funcStr);
+            throw std::runtime_error(
+              "Expected only one executor for threaded function");
+        }
+
+        assert(e != nullptr);
 
-            // Dispatch the calls
-            getFunctionCallClient(host).executeFunctions(hostRequest);
+        // Threaded functions only ever have the one executor
+        shard.prewarmMsg = nullptr;
+
+        // Threads can't wait in the queue, but with admission control they
+        // must still hold the slots they vacate when done
+        if (conf.hostQueueCapacity > 0 && firstMsg.masterhost() == thisHost) {
+            thisHostUsedSlots.fetch_add(localIdxs.size(),
+                                        std::memory_order_acq_rel);
         }
-    }
 
-    // Records for tests
-    if (faabric::util::isTestMode()) {
-        for (int i = 0; i < nMessages; i++) {
-            std::string executedHost = decision.hosts.at(i);
-            const faabric::Message& msg =
-              recordedMessagesAll.at(recordedMessagesOffset + i);
+        // Execute the tasks
+        e->executeTasks(localIdxs, req);
+    } else {
+        // Record the calls to size the function's pool of warm executors
+        shard.nRecentCalls += localIdxs.size();
+        if (shard.prewarmMsg == nullptr && conf.executorPoolMax > 0) {
+            shard.prewarmMsg = std::make_unique<faabric::Message>(firstMsg);
+            shard.prewarmMsg->clear_inputdata();
+        }
 
-            // Log results if in test mode
-            if (executedHost.empty() || executedHost == thisHost) {
-                recordedMessagesLocal.emplace_back(msg);
-            } else {
-                recordedMessagesShared.emplace_back(executedHost, msg);
+        // Non-threads require one executor per task
+        for (auto i : localIdxs) {
+            faabric::Message& localMsg = req->mutable_messages()->at(i);
+
+            if (localMsg.executeslocally()) {
+                faabric::util::UniqueLock resultsLock(localResultsMutex);
+                localResults.insert(
+                  { localMsg.id(),
+                    std::promise<std::unique_ptr<faabric::Message>>() });
+            }
+
+            // Calls beyond this host's capacity wait for others to finish
+            if (!admitTask(req, i)) {
+                continue;
             }
+
+            std::shared_ptr<Executor> e =
+              claimExecutor(localMsg, shard, shardLock);
+            e->executeTasks({ i }, req);
         }
     }
 
@@ -930,31 +1440,36 @@ faabric::util::SchedulingDecision Scheduler::doCallFunctions(
 }
 
 std::vector<std::string> Scheduler::getUnregisteredHosts(
-  const std::string& user,
-  const std::string& function,
+  const std::set<std::string>& thisRegisteredHosts,
   bool noCache)
 {
     // Load the list of available hosts
-    if (availableHostsCache.empty() || noCache) {
-        availableHostsCache = getAvailableHosts();
+    std::set<std::string> availableHosts;
+    {
+        faabric::util::SharedLock lock(mx);
+        availableHosts = availableHostsCache;
     }
 
-    // At this point we know we need to enlist unregistered hosts
-    const std::set<std::string>& thisRegisteredHosts =
-      getFunctionRegisteredHosts(user, function, false);
+    if (availableHosts.empty() || noCache) {
+        availableHosts = getAvailableHosts();
 
+        faabric::util::FullLock lock(mx);
+        availableHostsCache = availableHosts;
+    }
+
+    // At this point we know we need to enlist unregistered hosts
     std::vector<std::string> unregisteredHosts;
 
     std::set_difference(
-      availableHostsCache.begin(),
-      availableHostsCache.end(),
+      availableHosts.begin(),
+      availableHosts.end(),
       thisRegisteredHosts.begin(),
       thisRegisteredHosts.end(),
       std::inserter(unregisteredHosts, unregisteredHosts.begin()));
 
     // If we've not got any, try again without caching
     if (unregisteredHosts.empty() && !noCache) {
-        return getUnregisteredHosts(user, function, true);
+        return getUnregisteredHosts(thisRegisteredHosts, true);
     }
 
     return unregisteredHosts;
@@ -963,8 +1478,8 @@ std::vector<std::string> Scheduler::getUnregisteredHosts(
 void Scheduler::broadcastSnapshotDelete(const faabric::Message& msg,
                                         const std::string& snapshotKey)
 {
-    const std::set<std::string>& thisRegisteredHosts =
-      getFunctionRegisteredHosts(msg.user(), msg.function(), false);
+    std::set<std::string> thisRegisteredHosts =
+      getFunctionRegisteredHosts(msg.user(), msg.function());
 
     for (auto host : thisRegisteredHosts) {
         SnapshotClient& c = getSnapshotClient(host);
@@ -974,7 +1489,8 @@ void Scheduler::broadcastSnapshotDelete(const faabric::Message& msg,
 
 void Scheduler::callFunction(faabric::Message& msg, bool forceLocal)
 {
-    // TODO - avoid this copy
+    // Executors hold on to the request after this returns, so it needs its
+    // own copy of the message
     auto req = faabric::util::batchExecFactory();
     *req->add_messages() = msg;
 
@@ -1012,6 +1528,10 @@ std::vector<faabric::Message> Scheduler::getRecordedMessagesLocal()
 FunctionCallClient& Scheduler::getFunctionCallClient(
   const std::string& otherHost)
 {
+    if (conf.transportClientPoolSize > 0) {
+        return getSharedClient(sharedFunctionCallClients, otherHost);
+    }
+
     if (functionCallClients.find(otherHost) == functionCallClients.end()) {
         SPDLOG_DEBUG("Adding new function call client for {}", otherHost);
         functionCallClients.emplace(otherHost, otherHost);
@@ -1022,6 +1542,10 @@ FunctionCallClient& Scheduler::getFunctionCallClient(
 
 SnapshotClient& Scheduler::getSnapshotClient(const std::string& otherHost)
 {
+    if (conf.transportClientPoolSize > 0) {
+        return getSharedClient(sharedSnapshotClients, otherHost);
+    }
+
     if (snapshotClients.find(otherHost) == snapshotClients.end()) {
         SPDLOG_DEBUG("Adding new snapshot client for {}", otherHost);
         snapshotClients.emplace(otherHost, otherHost);
@@ -1039,11 +1563,12 @@ Scheduler::getRecordedMessagesShared()
 
 std::shared_ptr<Executor> Scheduler::claimExecutor(
   faabric::Message& msg,
-  faabric::util::FullLock& schedulerLock)
+  FunctionShard& shard,
+  faabric::util::UniqueLock& shardLock)
 {
     std::string funcStr = faabric::util::funcToString(msg, false);
 
-    std::vector<std::shared_ptr<Executor>>& thisExecutors = executors[funcStr];
+    std::vector<std::shared_ptr<Executor>>& thisExecutors = shard.executors;
 
     std::shared_ptr<faabric::scheduler::ExecutorFactory> factory =
       getExecutorFactory();
@@ -1067,9 +1592,9 @@ std::shared_ptr<Executor> Scheduler::claimExecutor(
 
         // Spinning up a new executor can be lengthy, allow other things
         // to run in parallel
-        schedulerLock.unlock();
+        shardLock.unlock();
         auto executor = factory->createExecutor(msg);
-        schedulerLock.lock();
+        shardLock.lock();
         thisExecutors.push_back(std::move(executor));
         claimed = thisExecutors.back();
 
@@ -1119,14 +1644,24 @@ void Scheduler::flushLocally()
 
 void Scheduler::setFunctionResult(faabric::Message& msg)
 {
-    redis::Redis& redis = redis::Redis::getQueue();
-
     // Record which host did the execution
     msg.set_executedhost(faabric::util::getSystemConfig().endpointHost);
 
     // Set finish timestamp
     msg.set_finishtimestamp(faabric::util::getGlobalClock().epochMillis());
 
+    // Chained calls logged by this message go over the same Redis connection
+    // as its result, so land first, but a pushed result must wait for them
+    std::vector<std::future<void>> chainedLogs;
+    {
+        faabric::util::UniqueLock logsLock(chainedLogsMx);
+        auto it = pendingChainedLogs.find(msg.id());
+        if (it != pendingChainedLogs.end()) {
+            chainedLogs = std::move(it->second);
+            pendingChainedLogs.erase(it);
+        }
+    }
+
     if (msg.executeslocally()) {
         faabric::util::UniqueLock resultsLock(localResultsMutex);
 
@@ -1142,6 +1677,32 @@ void Scheduler::setFunctionResult(faabric::Message& msg)
         }
     }
 
+    // Pushes are fire-and-forget, so the result always goes to Redis too, in
+    // case the caller doesn't get the pushed one in time
+    if (msg.directresult()) {
+        for (auto& f : chainedLogs) {
+            try {
+                f.get();
+            } catch (std::exception& e) {
+                SPDLOG_ERROR(
+                  "Failed logging chained call of {}: {}", msg.id(), e.what());
+            }
+        }
+
+        try {
+            if (msg.masterhost() == thisHost) {
+                setFunctionResultLocally(msg);
+            } else {
+                getFunctionCallClient(msg.masterhost()).setFunctionResult(msg);
+            }
+        } catch (std::exception& e) {
+            SPDLOG_ERROR("Failed pushing result for {} to {}: {}",
+                         msg.id(),
+                         msg.masterhost(),
+                         e.what());
+        }
+    }
+
     std::string key = msg.resultkey();
     if (key.empty()) {
         throw std::runtime_error("Result key empty. Cannot publish result");
@@ -1153,15 +1714,53 @@ void Scheduler::setFunctionResult(faabric::Message& msg)
         removePendingMigration(msg.appid());
     }
 
-    // Write the successful result to the result queue
+    // Write the successful result to the result queue. This is pipelined
+    // with other results rather than waiting on the round-trip, and any
+    // failure is logged by the client
     std::vector<uint8_t> inputData = faabric::util::messageToBytes(msg);
-    redis.publishSchedulerResult(key, msg.statuskey(), inputData);
+    redis::AsyncRedis::getQueue().publishSchedulerResult(
+      key, msg.statuskey(), inputData, msg.id());
+}
+
+void Scheduler::setFunctionResultLocally(const faabric::Message& msg)
+{
+    faabric::util::UniqueLock resultsLock(localResultsMutex);
+
+    // The caller may have already given up and read the result from Redis
+    auto it = directResults.find(msg.id());
+    if (it == directResults.end()) {
+        SPDLOG_DEBUG("No one waiting on pushed result for {}", msg.id());
+        return;
+    }
+
+    try {
+        it->second.promise.set_value(msg);
+    } catch (std::future_error& e) {
+        SPDLOG_ERROR("Result for {} pushed twice", msg.id());
+        return;
+    }
+
+    // Callers don't always read their results, so pushed results are only
+    // kept as long as the copy in Redis. Later reads go to Redis instead.
+    long now = faabric::util::getGlobalClock().epochMillis();
+    pushedResultTimes.emplace_back(msg.id(), now);
+    while (!pushedResultTimes.empty() &&
+           now - pushedResultTimes.front().second > RESULT_KEY_EXPIRY) {
+        directResults.erase(pushedResultTimes.front().first);
+        pushedResultTimes.pop_front();
+    }
+}
+
+void Scheduler::flushFunctionResults()
+{
+    redis::AsyncRedis::getQueue().flush();
 }
 
 void Scheduler::registerThread(uint32_t msgId)
 {
     // Here we need to ensure the promise is registered locally so
     // callers can start waiting
+    faabric::util::UniqueLock lock(threadResultsMx);
     threadResults[msgId];
 }
 
@@ -1201,7 +1800,7 @@ void Scheduler::setThreadResult(
 
 void Scheduler::setThreadResultLocally(uint32_t msgId, int32_t returnValue)
 {
-    faabric::util::FullLock lock(mx);
+    faabric::util::UniqueLock lock(threadResultsMx);
     SPDLOG_DEBUG("Setting result for thread {} to {}", msgId, returnValue);
     threadResults.at(msgId).set_value(returnValue);
 }
@@ -1213,7 +1812,7 @@ void Scheduler::setThreadResultLocally(uint32_t msgId,
     setThreadResultLocally(msgId, returnValue);
 
     // Keep the message
-    faabric::util::FullLock lock(mx);
+    faabric::util::UniqueLock lock(threadResultsMx);
     threadResultMessages.insert(std::make_pair(msgId, std::move(message)));
 }
 
@@ -1234,21 +1833,23 @@ std::vector<std::pair<uint32_t, int32_t>> Scheduler::awaitThreadResults(
 
 int32_t Scheduler::awaitThreadResult(uint32_t messageId)
 {
-    faabric::util::SharedLock lock(mx);
+    faabric::util::UniqueLock lock(threadResultsMx);
     auto it = threadResults.find(messageId);
     if (it == threadResults.end()) {
         SPDLOG_ERROR("Thread {} not registered on this host", messageId);
         throw std::runtime_error("Awaiting unregistered thread");
     }
+
+    std::future<int32_t> result = it->second.get_future();
     lock.unlock();
 
-    return it->second.get_future().get();
+    return result.get();
 }
 
 void Scheduler::deregisterThreads(
   std::shared_ptr<faabric::BatchExecuteRequest> req)
 {
-    faabric::util::FullLock eraseLock(mx);
+    faabric::util::UniqueLock eraseLock(threadResultsMx);
     for (auto m : req->messages()) {
         threadResults.erase(m.id());
         threadResultMessages.erase(m.id());
@@ -1258,14 +1859,14 @@ void Scheduler::deregisterThreads(
 void Scheduler::deregisterThread(uint32_t msgId)
 {
     // Erase the cached message and thread result
-    faabric::util::FullLock eraseLock(mx);
+    faabric::util::UniqueLock eraseLock(threadResultsMx);
     threadResults.erase(msgId);
     threadResultMessages.erase(msgId);
 }
 
 std::vector<uint32_t> Scheduler::getRegisteredThreads()
 {
-    faabric::util::SharedLock lock(mx);
+    faabric::util::UniqueLock lock(threadResultsMx);
 
     std::vector<uint32_t> registeredIds;
     for (auto const& p : threadResults) {
@@ -1279,6 +1880,7 @@ std::vector<uint32_t> Scheduler::getRegisteredThreads()
 
 size_t Scheduler::getCachedMessageCount()
 {
+    faabric::util::UniqueLock lock(threadResultsMx);
     return threadResultMessages.size();
 }
 
@@ -1320,6 +1922,37 @@ faabric::Message Scheduler::getFunctionResult(unsigned int messageId,
         return *fut.get();
     } while (0);
 
+    // Results pushed back from remote hosts. If they don't arrive in time we
+    // fall back to Redis
+    std::shared_future<faabric::Message> directResult;
+    {
+        faabric::util::UniqueLock resultsLock(localResultsMutex);
+        auto it = directResults.find(messageId);
+        if (it != directResults.end()) {
+            directResult = it->second.result;
+        }
+    }
+
+    if (directResult.valid()) {
+        auto status = directResult.wait_for(
+          std::chrono::milliseconds(std::max(timeoutMs, 0)));
+
+        // Non-blocking callers will poll again, so keep waiting on the push
+        if (status == std::future_status::ready || isBlocking) {
+            faabric::util::UniqueLock resultsLock(localResultsMutex);
+            directResults.erase(messageId);
+        }
+
+        if (status == std::future_status::ready) {
+            return directResult.get();
+        }
+
+        SPDLOG_DEBUG("No pushed result for {}, checking Redis", messageId);
+    }
+
+    // Make sure any result published from this host has landed
+    flushFunctionResults();
+
     redis::Redis& redis = redis::Redis::getQueue();
 
     std::string resultKey = faabric::util::resultKeyFromMessageId(messageId);
@@ -1347,6 +1980,10 @@ faabric::Message Scheduler::getFunctionResult(unsigned int messageId,
         } else {
             // Normal response if we get something from redis
             msgResult.ParseFromArray(result.data(), (int)result.size());
+
+            // No need to keep waiting on a push
+            faabric::util::UniqueLock resultsLock(localResultsMutex);
+            directResults.erase(messageId);
         }
     }
 
@@ -1364,9 +2001,17 @@ faabric::HostResources Scheduler::getThisHostResources()
 
 void Scheduler::setThisHostResources(faabric::HostResources& res)
 {
-    faabric::util::FullLock lock(mx);
-    thisHostResources = res;
-    this->thisHostUsedSlots.store(res.usedslots(), std::memory_order_release);
+    {
+        faabric::util::FullLock lock(mx);
+        thisHostResources = res;
+        this->thisHostUsedSlots.store(res.usedslots(),
+                                      std::memory_order_release);
+    }
+
+    // Queued calls may fit in the new resources
+    if (conf.hostQueueCapacity > 0) {
+        startQueuedTasks();
+    }
 }
 
 faabric::HostResources Scheduler::getHostResources(const std::string& host)
@@ -1375,11 +2020,147 @@ faabric::HostResources Scheduler::getHostResources(const std::string& host)
     return getFunctionCallClient(host).getResources();
 }
 
-int Scheduler::tryReserveHostSlots(const std::string& host, int requestedSlots)
+// Fetches the resources a decision may need from other hosts into the cluster
+// view. This must be done before locking the function, so that decisions
+// never wait on other hosts.
+void Scheduler::prepareClusterView(
+  int nMessages,
+  faabric::util::SchedulingTopologyHint topologyHint)
 {
-    SPDLOG_TRACE("Reserving {} resources on host {}", requestedSlots, host);
-    // host is remote host.
-    return getFunctionCallClient(host).tryReserve(requestedSlots);
+    // Only needed if the calls may not all fit on this host
+    int slots = getThisHostSlots();
+    if (topologyHint == faabric::util::SchedulingTopologyHint::UNDERFULL) {
+        slots = slots / 2;
+    }
+
+    int freeSlots = slots - thisHostUsedSlots.load(std::memory_order_acquire);
+    if (nMessages <= freeSlots) {
+        return;
+    }
+
+    // Hosts may have joined since we last looked, and we're not holding any
+    // locks, so we may as well refresh the cache
+    std::set<std::string> availableHosts = getAvailableHosts();
+    {
+        faabric::util::FullLock lock(mx);
+        availableHostsCache = availableHosts;
+    }
+
+    // With gossip we only need hosts we've not heard from yet, otherwise the
+    // view is only as fresh as the last decision, so we ask every host. Hosts
+    // are asked all at once, so this costs a single round-trip. Any that
+    // don't answer keep whatever the view last had for them.
+    bool isGossip = conf.resourceGossipIntervalSeconds > 0;
+    std::vector<std::string> toFetch;
+    for (const auto& h : availableHosts) {
+        if (h == thisHost || (isGossip && clusterView.hasHost(h))) {
+            continue;
+        }
+
+        toFetch.push_back(h);
+    }
+
+    if (toFetch.empty()) {
+        return;
+    }
+
+    SPDLOG_TRACE("Requesting resources from {} hosts", toFetch.size());
+    for (const auto& [host, res] : getResourcesOnHosts(toFetch)) {
+        clusterView.update(host, res);
+    }
+}
+
+// Reserves up to the requested number of slots on a remote host, returning
+// the number reserved. Returns zero if fewer than the minimum are available.
+// Hosts missing from the cluster view are treated as having no free slots.
+int Scheduler::reserveRemoteSlots(const std::string& host,
+                                  int slotsRequested,
+                                  int minSlots)
+{
+    int reserved = clusterView.reserve(host, slotsRequested);
+    if (reserved < minSlots) {
+        clusterView.release(host, reserved);
+        return 0;
+    }
+
+    SPDLOG_TRACE("Reserved {} slots on {} in cluster view", reserved, host);
+    {
+        faabric::util::FullLock lock(mx);
+        pendingReservations.emplace_back(host, reserved);
+    }
+
+    return reserved;
+}
+
+void Scheduler::confirmReservations()
+{
+    std::vector<std::pair<std::string, int>> toConfirm;
+    {
+        faabric::util::FullLock lock(mx);
+        if (pendingReservations.empty()) {
+            return;
+        }
+
+        std::swap(toConfirm, pendingReservations);
+    }
+
+    std::vector<faabric::ReservationResponse> responses =
+      tryReserveOnHosts(toConfirm);
+
+    // The messages have already been sent, so hosts that couldn't confirm all
+    // their slots have to overload. They still need to count the calls as
+    // running, as they'll free a slot when each one finishes.
+    std::vector<std::pair<std::string, int>> shortfalls;
+    for (size_t i = 0; i < toConfirm.size(); i++) {
+        const auto& [host, slots] = toConfirm.at(i);
+        const faabric::ReservationResponse& response = responses.at(i);
+
+        if (response.allocatedslots() < slots) {
+            SPDLOG_DEBUG("Host {} only confirmed {}/{} reserved slots",
+                         host,
+                         response.allocatedslots(),
+                         slots);
+            shortfalls.emplace_back(host, slots - response.allocatedslots());
+        } else if (response.has_resources()) {
+            clusterView.update(host, response.resources());
+        }
+    }
+
+    if (shortfalls.empty()) {
+        return;
+    }
+
+    std::vector<faabric::ReservationResponse> forcedResponses =
+      tryReserveOnHosts(shortfalls, true);
+
+    for (size_t i = 0; i < shortfalls.size(); i++) {
+        const faabric::ReservationResponse& response = forcedResponses.at(i);
+        if (response.has_resources()) {
+            clusterView.update(shortfalls.at(i).first, response.resources());
+        }
+    }
+}
+
+void Scheduler::refreshClusterResources()
+{
+    std::set<std::string> hosts = getAvailableHosts();
+    hosts.erase(getThisHost());
+
+    for (const auto& h : clusterView.getHosts()) {
+        if (hosts.find(h) == hosts.end()) {
+            clusterView.removeHost(h);
+        }
+    }
+
+    for (const auto& h : hosts) {
+        try {
+            clusterView.update(h, getHostResources(h));
+        } catch (std::exception& e) {
+            // Next decision involving this host will fetch its resources
+            SPDLOG_WARN("Failed to refresh resources of {}: {}", h, e.what());
+            clusterView.removeHost(h);
+        }
+    }
 }
 
 // --------------------------------------------
@@ -1395,15 +2176,22 @@ std::string getChainedKey(unsigned int msgId)
 void Scheduler::logChainedFunction(unsigned int parentMessageId,
                                    unsigned int chainedMessageId)
 {
-    redis::Redis& redis = redis::Redis::getQueue();
-
+    // Both go on the same connection as the parent's result, so the set is
+    // complete by the time anyone reads the result from Redis
     const std::string& key = getChainedKey(parentMessageId);
-    redis.sadd(key, std::to_string(chainedMessageId));
-    redis.expire(key, STATUS_KEY_EXPIRY);
+    std::future<void> logged = redis::AsyncRedis::getQueue().pipeline(
+      { { "SADD", key, std::to_string(chainedMessageId) },
+        { "EXPIRE", key, std::to_string(STATUS_KEY_EXPIRY) } },
+      parentMessageId);
+
+    faabric::util::UniqueLock logsLock(chainedLogsMx);
+    pendingChainedLogs[parentMessageId].emplace_back(std::move(logged));
 }
 
 std::set<unsigned int> Scheduler::getChainedFunctions(unsigned int msgId)
 {
+    flushFunctionResults();
+
     redis::Redis& redis = redis::Redis::getQueue();
 
     const std::string& key = getChainedKey(msgId);
@@ -1419,6 +2207,8 @@ std::set<unsigned int> Scheduler::getChainedFunctions(unsigned int msgId)
 
 ExecGraph Scheduler::getFunctionExecGraph(unsigned int messageId)
 {
+    flushFunctionResults();
+
     ExecGraphNode rootNode = getFunctionExecGraphNode(messageId);
     ExecGraph graph{ .rootNode = rootNode };
 
@@ -1493,13 +2283,15 @@ void Scheduler::checkForMigrationOpportunities()
 
     // If we find migration opportunites
     if (tmpPendingMigrations.size() > 0) {
-        // Acquire full lock to write to the pending migrations map
-        faabric::util::FullLock lock(mx);
-
+        // First, broadcast the pending migrations to other hosts. This needs
+        // the functions' state, so we can't hold the scheduler lock.
         for (auto msgPtr : tmpPendingMigrations) {
-            // First, broadcast the pending migrations to other hosts
             broadcastPendingMigrations(msgPtr);
-            // Second, update our local records
+        }
+
+        // Second, acquire full lock to update our local records
+        faabric::util::FullLock lock(mx);
+        for (auto msgPtr : tmpPendingMigrations) {
             pendingMigrations[msgPtr->appid()] = std::move(msgPtr);
         }
     }
@@ -1510,11 +2302,11 @@ void Scheduler::broadcastPendingMigrations(
 {
     // Get all hosts for the to-be migrated app
     auto msg = pendingMigrations->migrations().at(0).msg();
-    const std::set<std::string>& thisRegisteredHosts =
-      getFunctionRegisteredHosts(msg.user(), msg.function(), false);
+    std::set<std::string> thisRegisteredHosts =
+      getFunctionRegisteredHosts(msg.user(), msg.function());
 
     // Remove this host from the set
-    registeredHosts.erase(thisHost);
+    thisRegisteredHosts.erase(thisHost);
 
     // Send pending migrations to all involved hosts
     for (auto& otherHost : thisRegisteredHosts) {
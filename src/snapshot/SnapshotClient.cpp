@@ -1,4 +1,5 @@
 #include <faabric/snapshot/SnapshotClient.h>
+#include <faabric/transport/ConnectionPool.h>
 #include <faabric/transport/common.h>
 #include <faabric/transport/macros.h>
 #include <faabric/util/config.h>
@@ -62,14 +63,101 @@ void clearMockSnapshotRequests()
     threadResults.clear();
 }
 
+// -----------------------------------
+// Requests
+// -----------------------------------
+
+// The snapshot's data isn't copied into the request, but sent as a separate
+// message part
+static void buildPushRequest(
+  flatbuffers::FlatBufferBuilder& mb,
+  const std::string& key,
+  const std::shared_ptr<faabric::util::SnapshotData>& data,
+  const std::vector<std::string>& relayHosts,
+  int fanOut)
+{
+    std::vector<flatbuffers::Offset<SnapshotMergeRegionRequest>> mrsFbVector;
+    mrsFbVector.reserve(data->getMergeRegions().size());
+    for (const auto& m : data->getMergeRegions()) {
+        auto mr = CreateSnapshotMergeRegionRequest(
+          mb, m.offset, m.length, m.dataType, m.operation);
+        mrsFbVector.push_back(mr);
+    }
+
+    auto keyOffset = mb.CreateString(key);
+    auto mrsOffset = mb.CreateVector(mrsFbVector);
+    auto relayOffset = mb.CreateVectorOfStrings(relayHosts);
+    auto requestOffset = CreateSnapshotPushRequest(mb,
+                                                   keyOffset,
+                                                   data->getMaxSize(),
+                                                   mrsOffset,
+                                                   relayOffset,
+                                                   fanOut);
+
+    mb.Finish(requestOffset);
+}
+
+// The diffs' data isn't copied into the request, but sent as separate message
+// parts, one per diff
+static void buildUpdateRequest(
+  flatbuffers::FlatBufferBuilder& mb,
+  const std::string& snapshotKey,
+  const std::shared_ptr<faabric::util::SnapshotData>& data,
+  const std::vector<faabric::util::SnapshotDiff>& diffs,
+  const std::vector<std::string>& relayHosts,
+  int fanOut)
+{
+    // Create objects for all the diffs, with the data sent separately
+    std::vector<flatbuffers::Offset<SnapshotDiffRequest>> diffsFbVector;
+    diffsFbVector.reserve(diffs.size());
+    for (const auto& d : diffs) {
+        auto diff = CreateSnapshotDiffRequest(
+          mb, d.getOffset(), d.getDataType(), d.getOperation());
+        diffsFbVector.push_back(diff);
+    }
+
+    // Add merge regions
+    std::vector<flatbuffers::Offset<SnapshotMergeRegionRequest>> mrsFbVector;
+    mrsFbVector.reserve(data->getMergeRegions().size());
+    for (const auto& m : data->getMergeRegions()) {
+        auto mr = CreateSnapshotMergeRegionRequest(
+          mb, m.offset, m.length, m.dataType, m.operation);
+        mrsFbVector.push_back(mr);
+    }
+
+    auto keyOffset = mb.CreateString(snapshotKey);
+    auto diffsOffset = mb.CreateVector(diffsFbVector);
+    auto mrsOffset = mb.CreateVector(mrsFbVector);
+    auto relayOffset = mb.CreateVectorOfStrings(relayHosts);
+
+    auto requestOffset = CreateSnapshotUpdateRequest(
+      mb, keyOffset, mrsOffset, diffsOffset, relayOffset, fanOut);
+
+    mb.Finish(requestOffset);
+}
+
+static faabric::transport::MessageParts getDiffsData(
+  const std::vector<faabric::util::SnapshotDiff>& diffs)
+{
+    faabric::transport::MessageParts diffsData;
+    diffsData.reserve(diffs.size());
+    for (const auto& d : diffs) {
+        diffsData.push_back(d.getData());
+    }
+
+    return diffsData;
+}
+
 // -----------------------------------
 // Snapshot client
 // -----------------------------------
 
-SnapshotClient::SnapshotClient(const std::string& hostIn)
+SnapshotClient::SnapshotClient(const std::string& hostIn, bool pooled)
   : faabric::transport::MessageEndpointClient(hostIn,
                                               SNAPSHOT_ASYNC_PORT,
-                                              SNAPSHOT_SYNC_PORT)
+                                              SNAPSHOT_SYNC_PORT,
+                                              DEFAULT_SOCKET_TIMEOUT_MS,
+                                              pooled)
 {}
 
 void SnapshotClient::pushSnapshot(
@@ -89,30 +177,13 @@ void SnapshotClient::pushSnapshot(
 
         snapshotPushes.emplace_back(host, data);
     } else {
-        // Set up the main request
-        // TODO - avoid copying data here?
         flatbuffers::FlatBufferBuilder mb;
+        buildPushRequest(mb, key, data, {}, 0);
 
-        std::vector<flatbuffers::Offset<SnapshotMergeRegionRequest>>
-          mrsFbVector;
-        mrsFbVector.reserve(data->getMergeRegions().size());
-        for (const auto& m : data->getMergeRegions()) {
-            auto mr = CreateSnapshotMergeRegionRequest(
-              mb, m.offset, m.length, m.dataType, m.operation);
-            mrsFbVector.push_back(mr);
-        }
-
-        auto keyOffset = mb.CreateString(key);
-        auto dataOffset =
-          mb.CreateVector<uint8_t>(data->getDataPtr(), data->getSize());
-        auto mrsOffset = mb.CreateVector(mrsFbVector);
-        auto requestOffset = CreateSnapshotPushRequest(
-          mb, keyOffset, data->getMaxSize(), dataOffset, mrsOffset);
-
-        mb.Finish(requestOffset);
-
-        // Send it
-        SEND_FB_MSG(SnapshotCalls::PushSnapshot, mb)
+        faabric::transport::MessageParts contents = {
+            std::span<const uint8_t>(data->getDataPtr(), data->getSize())
+        };
+        SEND_FB_MSG_PARTS(SnapshotCalls::PushSnapshot, mb, contents)
     }
 }
 
@@ -132,40 +203,10 @@ void SnapshotClient::pushSnapshotUpdate(
         snapshotDiffPushes.emplace_back(host, diffs);
     } else {
         flatbuffers::FlatBufferBuilder mb;
+        buildUpdateRequest(mb, snapshotKey, data, diffs, {}, 0);
+        faabric::transport::MessageParts diffsData = getDiffsData(diffs);
 
-        // Create objects for all the diffs
-        std::vector<flatbuffers::Offset<SnapshotDiffRequest>> diffsFbVector;
-        diffsFbVector.reserve(diffs.size());
-        for (const auto& d : diffs) {
-            std::span<const uint8_t> diffData = d.getData();
-            auto dataOffset =
-              mb.CreateVector<uint8_t>(diffData.data(), diffData.size());
-
-            auto diff = CreateSnapshotDiffRequest(
-              mb, d.getOffset(), d.getDataType(), d.getOperation(), dataOffset);
-            diffsFbVector.push_back(diff);
-        }
-
-        // Add merge regions
-        std::vector<flatbuffers::Offset<SnapshotMergeRegionRequest>>
-          mrsFbVector;
-        mrsFbVector.reserve(data->getMergeRegions().size());
-        for (const auto& m : data->getMergeRegions()) {
-            auto mr = CreateSnapshotMergeRegionRequest(
-              mb, m.offset, m.length, m.dataType, m.operation);
-            mrsFbVector.push_back(mr);
-        }
-
-        auto keyOffset = mb.CreateString(snapshotKey);
-        auto diffsOffset = mb.CreateVector(diffsFbVector);
-        auto mrsOffset = mb.CreateVector(mrsFbVector);
-
-        auto requestOffset =
-          CreateSnapshotUpdateRequest(mb, keyOffset, mrsOffset, diffsOffset);
-
-        mb.Finish(requestOffset);
-
-        SEND_FB_MSG(SnapshotCalls::PushSnapshotUpdate, mb);
+        SEND_FB_MSG_PARTS(SnapshotCalls::PushSnapshotUpdate, mb, diffsData);
     }
 }
 
@@ -212,19 +253,16 @@ void SnapshotClient::pushThreadResult(
 
         auto keyOffset = mb.CreateString(key);
 
-        // Create objects for all the diffs
+        // Create objects for all the diffs, with the data sent separately
         std::vector<flatbuffers::Offset<SnapshotDiffRequest>> diffsFbVector;
+        faabric::transport::MessageParts diffsData;
         diffsFbVector.reserve(diffs.size());
+        diffsData.reserve(diffs.size());
         for (const auto& d : diffs) {
-            std::span<const uint8_t> diffData = d.getData();
-
-            // Note that we're doing a copy here, but it's unavoidable
-            auto dataOffset =
-              mb.CreateVector<uint8_t>(diffData.data(), diffData.size());
-
             auto diff = CreateSnapshotDiffRequest(
-              mb, d.getOffset(), d.getDataType(), d.getOperation(), dataOffset);
+              mb, d.getOffset(), d.getDataType(), d.getOperation());
             diffsFbVector.push_back(diff);
+            diffsData.push_back(d.getData());
         }
 
         auto diffsOffset = mb.CreateVector(diffsFbVector);
@@ -233,7 +271,198 @@ void SnapshotClient::pushThreadResult(
           mb, messageId, returnValue, keyOffset, diffsOffset);
 
         mb.Finish(requestOffset);
-        SEND_FB_MSG(SnapshotCalls::ThreadResult, mb);
+        SEND_FB_MSG_PARTS(SnapshotCalls::ThreadResult, mb, diffsData);
     }
 }
+
+// -----------------------------------
+// Broadcasting
+// -----------------------------------
+
+std::vector<std::vector<std::string>> getBroadcastGroups(
+  const std::vector<std::string>& hosts,
+  int fanOut)
+{
+    size_t nGroups = hosts.size();
+    if (fanOut > 0) {
+        nGroups = std::min<size_t>(fanOut, hosts.size());
+    }
+
+    // Spread the hosts as evenly as possible, so the tree stays balanced
+    std::vector<std::vector<std::string>> groups(nGroups);
+    size_t hostIdx = 0;
+    for (size_t i = 0; i < nGroups; i++) {
+        size_t groupSize =
+          hosts.size() / nGroups + (i < hosts.size() % nGroups ? 1 : 0);
+        groups.at(i).assign(hosts.begin() + hostIdx,
+                            hosts.begin() + hostIdx + groupSize);
+        hostIdx += groupSize;
+    }
+
+    return groups;
+}
+
+// Sends a request to the first host of every group, with the rest of the group
+// as relays, then waits for all of them. The build function fills in the
+// request for a given set of relays. The parts are the same for every host,
+// so are shared between the requests rather than copied into each.
+static void broadcastRequest(
+  SnapshotCalls header,
+  const std::vector<std::string>& hosts,
+  int fanOut,
+  const faabric::transport::SharedMessageParts& parts,
+  const std::function<void(flatbuffers::FlatBufferBuilder&,
+                           const std::vector<std::string>&)>& buildRequest)
+{
+    int nConnections =
+      std::max(1, faabric::util::getSystemConfig().transportClientPoolSize);
+
+    std::vector<std::vector<std::string>> groups =
+      getBroadcastGroups(hosts, fanOut);
+
+    // Requests without relays are the same for every host, so are only built
+    // once
+    std::unique_ptr<flatbuffers::FlatBufferBuilder> directMb = nullptr;
+
+    std::vector<std::shared_ptr<faabric::transport::ConnectionPool>> pools;
+    std::vector<std::future<faabric::transport::Message>> inFlight;
+    for (const auto& group : groups) {
+        std::vector<std::string> relayHosts(group.begin() + 1, group.end());
+
+        flatbuffers::FlatBufferBuilder relayMb;
+        flatbuffers::FlatBufferBuilder* mb = &relayMb;
+        if (relayHosts.empty()) {
+            if (directMb == nullptr) {
+                directMb = std::make_unique<flatbuffers::FlatBufferBuilder>();
+                buildRequest(*directMb, relayHosts);
+            }
+
+            mb = directMb.get();
+        } else {
+            buildRequest(relayMb, relayHosts);
+        }
+
+        auto pool =
+          faabric::transport::getConnectionPool(group.front(),
+                                                SNAPSHOT_ASYNC_PORT,
+                                                SNAPSHOT_SYNC_PORT,
+                                                nConnections);
+        inFlight.emplace_back(pool->submitSync(
+          header, mb->GetBufferPointer(), mb->GetSize(), parts));
+        pools.emplace_back(std::move(pool));
+    }
+
+    // Wait for everything, even if some fail
+    std::exception_ptr error = nullptr;
+    for (size_t i = 0; i < inFlight.size(); i++) {
+        try {
+            pools.at(i)->awaitResponse(inFlight.at(i));
+        } catch (std::exception& e) {
+            SPDLOG_ERROR("Failed broadcasting snapshot to {} (+{} relays): {}",
+                         groups.at(i).front(),
+                         groups.at(i).size() - 1,
+                         e.what());
+            if (error == nullptr) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if (error != nullptr) {
+        std::rethrow_exception(error);
+    }
+}
+
+void pushSnapshotToHosts(const std::vector<std::string>& hosts,
+                         const std::string& key,
+                         std::shared_ptr<faabric::util::SnapshotData> data,
+                         int fanOut)
+{
+    if (hosts.empty()) {
+        return;
+    }
+
+    if (faabric::util::isMockMode()) {
+        for (const auto& host : hosts) {
+            SnapshotClient(host).pushSnapshot(key, data);
+        }
+
+        return;
+    }
+
+    if (data->getSize() == 0) {
+        SPDLOG_ERROR("Cannot push snapshot {} with size zero", key);
+        throw std::runtime_error("Pushing snapshot with zero size");
+    }
+
+    SPDLOG_DEBUG("Pushing snapshot {} to {} hosts ({} bytes, fan-out {})",
+                 key,
+                 hosts.size(),
+                 data->getSize(),
+                 fanOut);
+
+    // The snapshot outlives the sends, however long they take
+    faabric::transport::SharedMessageParts contents = { {
+      std::span<const uint8_t>(data->getDataPtr(), data->getSize()),
+      data,
+    } };
+
+    broadcastRequest(SnapshotCalls::PushSnapshot,
+                     hosts,
+                     fanOut,
+                     contents,
+                     [&](flatbuffers::FlatBufferBuilder& mb,
+                         const std::vector<std::string>& relayHosts) {
+                         buildPushRequest(mb, key, data, relayHosts, fanOut);
+                     });
+}
+
+void pushSnapshotUpdateToHosts(
+  const std::vector<std::string>& hosts,
+  const std::string& snapshotKey,
+  const std::shared_ptr<faabric::util::SnapshotData>& data,
+  const std::vector<faabric::util::SnapshotDiff>& diffs,
+  int fanOut)
+{
+    if (hosts.empty()) {
+        return;
+    }
+
+    if (faabric::util::isMockMode()) {
+        for (const auto& host : hosts) {
+            SnapshotClient(host).pushSnapshotUpdate(snapshotKey, data, diffs);
+        }
+
+        return;
+    }
+
+    SPDLOG_DEBUG("Pushing update to snapshot {} to {} hosts ({} diffs, "
+                 "fan-out {})",
+                 snapshotKey,
+                 hosts.size(),
+                 diffs.size(),
+                 fanOut);
+
+    // The diffs may point into memory the caller reuses once we time out, so
+    // their data is copied once and shared by all the requests
+    auto diffsCopy = std::make_shared<std::vector<std::vector<uint8_t>>>();
+    diffsCopy->reserve(diffs.size());
+    faabric::transport::SharedMessageParts diffsData;
+    diffsData.reserve(diffs.size());
+    for (const auto& d : diffs) {
+        const std::vector<uint8_t>& copy =
+          diffsCopy->emplace_back(d.getData().begin(), d.getData().end());
+        diffsData.push_back({ copy, diffsCopy });
+    }
+
+    broadcastRequest(SnapshotCalls::PushSnapshotUpdate,
+                     hosts,
+                     fanOut,
+                     diffsData,
+                     [&](flatbuffers::FlatBufferBuilder& mb,
+                         const std::vector<std::string>& relayHosts) {
+                         buildUpdateRequest(
+                           mb, snapshotKey, data, diffs, relayHosts, fanOut);
+                     });
+}
 }
@@ -1,5 +1,6 @@
 #include <faabric/flat/faabric_generated.h>
 #include <faabric/proto/faabric.pb.h>
+#include <faabric/snapshot/SnapshotClient.h>
 #include <faabric/snapshot/SnapshotRegistry.h>
 #include <faabric/snapshot/SnapshotServer.h>
 #include <faabric/state/State.h>
@@ -15,6 +16,23 @@
 using namespace faabric::util;
 
 namespace faabric::snapshot {
+
+static std::vector<std::string> getRelayHosts(
+  const flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>* hostsFb)
+{
+    std::vector<std::string> hosts;
+    if (hostsFb == nullptr) {
+        return hosts;
+    }
+
+    hosts.reserve(hostsFb->size());
+    for (const auto* h : *hostsFb) {
+        hosts.emplace_back(h->str());
+    }
+
+    return hosts;
+}
+
 SnapshotServer::SnapshotServer()
   : faabric::transport::MessageEndpointServer(
       SNAPSHOT_ASYNC_PORT,
@@ -46,10 +64,10 @@ std::unique_ptr<google::protobuf::Message> SnapshotServer::doSyncRecv(
     uint8_t header = message.getHeader();
     switch (header) {
         case faabric::snapshot::SnapshotCalls::PushSnapshot: {
-            return recvPushSnapshot(message.udata(), message.size());
+            return recvPushSnapshot(message);
         }
         case faabric::snapshot::SnapshotCalls::PushSnapshotUpdate: {
-            return recvPushSnapshotUpdate(message.udata(), message.size());
+            return recvPushSnapshotUpdate(message);
         }
         case faabric::snapshot::SnapshotCalls::ThreadResult: {
             return recvThreadResult(message);
@@ -62,27 +80,28 @@ std::unique_ptr<google::protobuf::Message> SnapshotServer::doSyncRecv(
 }
 
 std::unique_ptr<google::protobuf::Message> SnapshotServer::recvPushSnapshot(
-  const uint8_t* buffer,
-  size_t bufferSize)
+  faabric::transport::Message& message)
 {
     const SnapshotPushRequest* r =
-      flatbuffers::GetRoot<SnapshotPushRequest>(buffer);
+      flatbuffers::GetRoot<SnapshotPushRequest>(message.udata());
 
-    if (r->contents()->size() == 0) {
+    // The contents follow the request in their own part
+    std::vector<std::span<const uint8_t>> parts = message.getParts();
+    if (parts.size() != 1 || parts.front().empty()) {
         SPDLOG_ERROR("Received shapshot {} with zero size", r->key()->c_str());
         throw std::runtime_error("Received snapshot with zero size");
     }
 
+    std::span<const uint8_t> contents = parts.front();
+
     SPDLOG_DEBUG("Receiving snapshot {} (size {}, max {})",
                  r->key()->c_str(),
-                 r->contents()->size(),
+                 contents.size(),
                  r->max_size());
 
     // Set up the snapshot
-    size_t snapSize = r->contents()->size();
     std::string snapKey = r->key()->str();
-    auto snap = std::make_shared<SnapshotData>(
-      std::span((uint8_t*)r->contents()->Data(), snapSize), r->max_size());
+    auto snap = std::make_shared<SnapshotData>(contents, r->max_size());
 
     // Add the merge regions
     for (const auto* mr : *r->merge_regions()) {
@@ -98,10 +117,47 @@ std::unique_ptr<google::protobuf::Message> SnapshotServer::recvPushSnapshot(
 
     snap->clearTrackedChanges();
 
+    // Pass it on to the rest of the broadcast tree before responding, so the
+    // sender knows every host has it once we've responded
+    std::vector<std::string> relayHosts = getRelayHosts(r->relay_hosts());
+    if (!relayHosts.empty()) {
+        SPDLOG_DEBUG(
+          "Relaying snapshot {} to {} hosts", snapKey, relayHosts.size());
+        pushSnapshotToHosts(relayHosts, snapKey, snap, r->fan_out());
+    }
+
     // Send response
     return std::make_unique<faabric::EmptyResponse>();
 }
 
+std::vector<SnapshotDiff> SnapshotServer::getDiffsFromRequest(
+  const flatbuffers::Vector<flatbuffers::Offset<SnapshotDiffRequest>>* diffsFb,
+  faabric::transport::Message& message)
+{
+    // The data for each diff is sent in its own part after the request, so
+    // the diffs only point into the message
+    std::vector<std::span<const uint8_t>> diffsData = message.getParts();
+    if (diffsData.size() != diffsFb->size()) {
+        SPDLOG_ERROR("Got {} diffs but {} diff data parts",
+                     diffsFb->size(),
+                     diffsData.size());
+        throw std::runtime_error("Mismatched snapshot diff data");
+    }
+
+    std::vector<SnapshotDiff> diffs;
+    diffs.reserve(diffsFb->size());
+    for (size_t i = 0; i < diffsFb->size(); i++) {
+        const auto* diff = diffsFb->Get(i);
+        diffs.emplace_back(
+          static_cast<SnapshotDataType>(diff->data_type()),
+          static_cast<SnapshotMergeOperation>(diff->merge_op()),
+          diff->offset(),
+          diffsData.at(i));
+    }
+
+    return diffs;
+}
+
 std::unique_ptr<google::protobuf::Message> SnapshotServer::recvThreadResult(
   faabric::transport::Message& message)
 {
@@ -116,17 +172,8 @@ std::unique_ptr<google::protobuf::Message> SnapshotServer::recvThreadResult(
     if (r->diffs()->size() > 0) {
         auto snap = reg.getSnapshot(r->key()->str());
 
-        // Convert diffs to snapshot diff objects
-        std::vector<SnapshotDiff> diffs;
-        diffs.reserve(r->diffs()->size());
-        for (const auto* diff : *r->diffs()) {
-            diffs.emplace_back(
-              static_cast<SnapshotDataType>(diff->data_type()),
-              static_cast<SnapshotMergeOperation>(diff->merge_op()),
-              diff->offset(),
-              std::span<const uint8_t>(diff->data()->Data(),
-                                       diff->data()->size()));
-        }
+        std::vector<SnapshotDiff> diffs =
+          getDiffsFromRequest(r->diffs(), message);
 
         // Queue on the snapshot
         snap->queueDiffs(diffs);
@@ -142,10 +189,10 @@ std::unique_ptr<google::protobuf::Message> SnapshotServer::recvThreadResult(
 }
 
 std::unique_ptr<google::protobuf::Message>
-SnapshotServer::recvPushSnapshotUpdate(const uint8_t* buffer, size_t bufferSize)
+SnapshotServer::recvPushSnapshotUpdate(faabric::transport::Message& message)
 {
     const SnapshotUpdateRequest* r =
-      flatbuffers::GetRoot<SnapshotUpdateRequest>(buffer);
+      flatbuffers::GetRoot<SnapshotUpdateRequest>(message.udata());
 
     SPDLOG_DEBUG(
       "Queueing {} diffs for snapshot {}", r->diffs()->size(), r->key()->str());
@@ -153,16 +200,7 @@ SnapshotServer::recvPushSnapshotUpdate(const uint8_t* buffer, size_t bufferSize)
     // Get the snapshot
     auto snap = reg.getSnapshot(r->key()->str());
 
-    // Convert diffs to snapshot diff objects
-    std::vector<SnapshotDiff> diffs;
-    diffs.reserve(r->diffs()->size());
-    for (const auto* diff : *r->diffs()) {
-        diffs.emplace_back(
-          static_cast<SnapshotDataType>(diff->data_type()),
-          static_cast<SnapshotMergeOperation>(diff->merge_op()),
-          diff->offset(),
-          std::span<const uint8_t>(diff->data()->data(), diff->data()->size()));
-    }
+    std::vector<SnapshotDiff> diffs = getDiffsFromRequest(r->diffs(), message);
 
     // Write diffs and set merge regions
     SPDLOG_DEBUG("Writing queued diffs to snapshot {} ({} regions)",
@@ -184,6 +222,17 @@ SnapshotServer::recvPushSnapshotUpdate(const uint8_t* buffer, size_t bufferSize)
           static_cast<SnapshotMergeOperation>(mr->merge_op()));
     }
 
+    // Relay before responding, the diffs still point into the message
+    std::vector<std::string> relayHosts = getRelayHosts(r->relay_hosts());
+    if (!relayHosts.empty()) {
+        SPDLOG_DEBUG("Relaying {} diffs for snapshot {} to {} hosts",
+                     diffs.size(),
+                     r->key()->str(),
+                     relayHosts.size());
+        pushSnapshotUpdateToHosts(
+          relayHosts, r->key()->str(), snap, diffs, r->fan_out());
+    }
+
     // Send response
     return std::make_unique<faabric::EmptyResponse>();
 }
@@ -0,0 +1,138 @@
+#include <faabric/state/AppendLog.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace faabric::state {
+
+AppendLog::AppendLog(size_t segmentSizeIn)
+  : segmentSize(segmentSizeIn)
+{
+    if (segmentSize == 0) {
+        SPDLOG_ERROR("Invalid append log segment size: {}", segmentSize);
+        throw std::runtime_error("Invalid append log segment size");
+    }
+}
+
+void AppendLog::append(const uint8_t* data, size_t length)
+{
+    faabric::util::UniqueLock lock(mx);
+
+    // Start a new segment if the value doesn't fit in the current one
+    if (segments.empty() ||
+        segments.back().capacity - segments.back().used < length) {
+        Segment& s = segments.emplace_back();
+        s.capacity = std::max(segmentSize, length);
+        s.data = std::make_unique<uint8_t[]>(s.capacity);
+    }
+
+    Segment& segment = segments.back();
+    std::copy(data, data + length, segment.data.get() + segment.used);
+
+    entries.push_back(
+      { (uint32_t)(segments.size() - 1), segment.used, length });
+    segment.used += length;
+}
+
+size_t AppendLog::size()
+{
+    faabric::util::UniqueLock lock(mx);
+    return entries.size();
+}
+
+size_t AppendLog::getSegmentCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return segments.size();
+}
+
+size_t AppendLog::getRangeBytes(size_t startIdx, size_t nValues)
+{
+    size_t total = 0;
+    visitRange(startIdx, nValues, [&total](std::span<const uint8_t> slice) {
+        total += slice.size();
+    });
+
+    return total;
+}
+
+void AppendLog::visitRange(
+  size_t startIdx,
+  size_t nValues,
+  const std::function<void(std::span<const uint8_t>)>& visitor)
+{
+    faabric::util::UniqueLock lock(mx);
+    checkRange(startIdx, nValues);
+
+    // Values in the same segment are contiguous, so each segment the range
+    // touches is visited as a single slice
+    size_t i = startIdx;
+    size_t end = startIdx + nValues;
+    while (i < end) {
+        const Entry& first = entries.at(i);
+        size_t j = i;
+        while (j + 1 < end &&
+               entries.at(j + 1).segmentIdx == first.segmentIdx) {
+            j++;
+        }
+
+        const Entry& last = entries.at(j);
+        const Segment& segment = segments.at(first.segmentIdx);
+        visitor(std::span<const uint8_t>(segment.data.get() + first.offset,
+                                         last.offset + last.length -
+                                           first.offset));
+
+        i = j + 1;
+    }
+}
+
+size_t AppendLog::readRange(size_t startIdx,
+                            size_t nValues,
+                            uint8_t* buffer,
+                            size_t bufferLen)
+{
+    size_t offset = 0;
+    visitRange(startIdx, nValues, [&](std::span<const uint8_t> slice) {
+        if (offset + slice.size() > bufferLen) {
+            SPDLOG_ERROR("Buffer not large enough for appended data "
+                         "(offset={}, slice={}, buffer={})",
+                         offset,
+                         slice.size(),
+                         bufferLen);
+            throw std::runtime_error(
+              "Buffer not large enough for appended data");
+        }
+
+        std::copy(slice.begin(), slice.end(), buffer + offset);
+        offset += slice.size();
+    });
+
+    return offset;
+}
+
+void AppendLog::clear()
+{
+    faabric::util::UniqueLock lock(mx);
+
+    entries.clear();
+
+    // Keep the first segment around to be reused by subsequent appends
+    if (!segments.empty()) {
+        segments.resize(1);
+        segments.front().used = 0;
+    }
+}
+
+void AppendLog::checkRange(size_t startIdx, size_t nValues)
+{
+    if (startIdx + nValues > entries.size()) {
+        SPDLOG_ERROR("Reading appended values {}-{} of {}",
+                     startIdx,
+                     startIdx + nValues,
+                     entries.size());
+        throw std::runtime_error("Reading past end of appended values");
+    }
+}
+}
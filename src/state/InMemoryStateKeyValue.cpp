@@ -3,11 +3,67 @@
 #include <cstdio>
 
 #include <faabric/util/bytes.h>
+#include <faabric/util/config.h>
+#include <faabric/util/gids.h>
+#include <faabric/util/hash_ring.h>
+#include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
 #include <faabric/util/state.h>
 
 namespace faabric::state {
+
+static bool isShardedMode()
+{
+    return faabric::util::getSystemConfig().stateMode == "sharded";
+}
+
+/**
+ * Works out which host owns each segment of a sharded value. Every host
+ * builds the same hash ring from the same shard info, so they all agree.
+ */
+static std::vector<std::string> getShardedSegmentOwners(
+  const std::string& user,
+  const std::string& key,
+  const std::string& thisIP,
+  size_t valueSize)
+{
+    if (!isShardedMode()) {
+        return {};
+    }
+
+    StateShardInfo info = getInMemoryStateRegistry().getShardInfo(
+      user, key, thisIP, valueSize, true);
+
+    faabric::util::HashRing ring(info.hosts);
+    size_t shardSize = faabric::util::getSystemConfig().stateShardSize;
+    size_t nSegments = (info.valueSize + shardSize - 1) / shardSize;
+
+    std::vector<std::string> owners;
+    owners.reserve(nSegments);
+    for (size_t i = 0; i < nSegments; i++) {
+        owners.emplace_back(
+          ring.getNode(faabric::util::keyForUser(user, key) + "_" +
+                       std::to_string(i)));
+    }
+
+    return owners;
+}
+
+// Sizeless sharded values can still be created from the shard info
+static size_t getShardedSize(const std::string& user,
+                             const std::string& key,
+                             const std::string& thisIP)
+{
+    if (!isShardedMode()) {
+        return 0;
+    }
+
+    return getInMemoryStateRegistry()
+      .getShardInfo(user, key, thisIP, 0, false)
+      .valueSize;
+}
+
 // --------------------------------------------
 // Static properties and methods
 // --------------------------------------------
@@ -16,6 +72,14 @@ size_t InMemoryStateKeyValue::getStateSizeFromRemote(const std::string& userIn,
                                                      const std::string& keyIn,
                                                      const std::string& thisIP)
 {
+    if (isShardedMode()) {
+        try {
+            return getShardedSize(userIn, keyIn, thisIP);
+        } catch (StateKeyValueException& ex) {
+            return 0;
+        }
+    }
+
     std::string masterIP;
     try {
         masterIP = getInMemoryStateRegistry().getMasterIPForOtherMaster(
@@ -34,6 +98,23 @@ void InMemoryStateKeyValue::deleteFromRemote(const std::string& userIn,
                                              const std::string& thisIPIn)
 {
     InMemoryStateRegistry& reg = getInMemoryStateRegistry();
+
+    // Every host in a sharded value holds some of it
+    if (isShardedMode()) {
+        StateShardInfo info =
+          reg.getShardInfo(userIn, keyIn, thisIPIn, 0, false);
+        for (const auto& host : info.hosts) {
+            if (host != thisIPIn) {
+                StateClient stateClient(userIn, keyIn, host);
+                stateClient.deleteState();
+            }
+        }
+
+        // The value may be created again with a different size or hosts
+        reg.deleteShardInfo(userIn, keyIn, true);
+        return;
+    }
+
     std::string masterIP = reg.getMasterIP(userIn, keyIn, thisIPIn, false);
 
     // Ignore if we're the master
@@ -49,6 +130,71 @@ void InMemoryStateKeyValue::clearAll(bool global)
 {
     InMemoryStateRegistry& reg = state::getInMemoryStateRegistry();
     reg.clear();
+
+    // Redis only holds the registry's masters and shards in this mode
+    if (global) {
+        redis::Redis::getState().flushAll();
+    }
+}
+
+/**
+ * Values mastered on the same host are all pulled with a single request.
+ * Sharded values are spread over several hosts, so are pulled one at a time.
+ */
+void InMemoryStateKeyValue::pullMultipleFromRemote(
+  const std::vector<StateKeyValue*>& kvs)
+{
+    std::unordered_map<std::string, std::vector<StateKeyChunk>> chunksByHost;
+    for (auto* kv : kvs) {
+        auto* inMemKv = static_cast<InMemoryStateKeyValue*>(kv);
+        if (inMemKv->sharded) {
+            inMemKv->pullFromRemote();
+            continue;
+        }
+
+        if (inMemKv->isMaster()) {
+            continue;
+        }
+
+        chunksByHost[inMemKv->masterIP].push_back(
+          { inMemKv->user,
+            inMemKv->key,
+            StateChunk(
+              0, inMemKv->valueSize, BYTES(inMemKv->sharedMemory)) });
+    }
+
+    for (const auto& [host, chunks] : chunksByHost) {
+        // Requests for several values aren't tied to a single key
+        StateClient cli("", "", host);
+        cli.pullMultiple(chunks);
+    }
+}
+
+void InMemoryStateKeyValue::pushMultipleToRemote(
+  const DirtyStateChunks& dirtyChunks)
+{
+    std::unordered_map<std::string, std::vector<StateKeyChunk>> chunksByHost;
+    for (const auto& [kv, chunks] : dirtyChunks) {
+        auto* inMemKv = static_cast<InMemoryStateKeyValue*>(kv);
+        if (inMemKv->sharded) {
+            inMemKv->pushChunksToOwners(chunks);
+            continue;
+        }
+
+        if (inMemKv->isMaster()) {
+            continue;
+        }
+
+        for (const auto& c : chunks) {
+            chunksByHost[inMemKv->masterIP].push_back(
+              { inMemKv->user, inMemKv->key, c });
+        }
+    }
+
+    for (const auto& [host, chunks] : chunksByHost) {
+        StateClient cli("", "", host);
+        cli.pushMultiple(chunks);
+    }
 }
 
 // --------------------------------------------
@@ -61,10 +207,16 @@ InMemoryStateKeyValue::InMemoryStateKeyValue(const std::string& userIn,
                                              const std::string& thisIPIn)
   : StateKeyValue(userIn, keyIn, sizeIn)
   , thisIP(thisIPIn)
-  , masterIP(getInMemoryStateRegistry().getMasterIP(user, key, thisIP, true))
+  , sharded(isShardedMode())
+  , shardSize(faabric::util::getSystemConfig().stateShardSize)
+  , segmentOwners(getShardedSegmentOwners(user, key, thisIP, sizeIn))
+  , masterIP(sharded ? segmentOwners.at(0)
+                     : getInMemoryStateRegistry().getMasterIP(
+                         user, key, thisIP, true))
   , status(masterIP == thisIP ? InMemoryStateKeyStatus::MASTER
                               : InMemoryStateKeyStatus::NOT_MASTER)
   , stateRegistry(getInMemoryStateRegistry())
+  , epoch(faabric::util::generateGid())
 {
     SPDLOG_TRACE("Creating in-memory state key-value for {}/{} size {} (this "
                  "host {}, master {})",
@@ -78,7 +230,10 @@ InMemoryStateKeyValue::InMemoryStateKeyValue(const std::string& userIn,
 InMemoryStateKeyValue::InMemoryStateKeyValue(const std::string& userIn,
                                              const std::string& keyIn,
                                              const std::string& thisIPIn)
-  : InMemoryStateKeyValue(userIn, keyIn, 0, thisIPIn)
+  : InMemoryStateKeyValue(userIn,
+                          keyIn,
+                          getShardedSize(userIn, keyIn, thisIPIn),
+                          thisIPIn)
 {}
 
 bool InMemoryStateKeyValue::isMaster()
@@ -86,35 +241,233 @@ bool InMemoryStateKeyValue::isMaster()
     return status == InMemoryStateKeyStatus::MASTER;
 }
 
+// Only plain replicas can be evicted, as anything else holds the only copy
+bool InMemoryStateKeyValue::canEvict()
+{
+    return !sharded && status != InMemoryStateKeyStatus::MASTER;
+}
+
+const std::string& InMemoryStateKeyValue::getSegmentOwner(long segmentIdx)
+{
+    if (!sharded) {
+        return masterIP;
+    }
+
+    return segmentOwners.at(segmentIdx);
+}
+
+// ----------------------------------------
+// Chunk versions
+// ----------------------------------------
+
+uint64_t InMemoryStateKeyValue::getEpoch() const
+{
+    return epoch;
+}
+
+void InMemoryStateKeyValue::checkChunkVersionsSize()
+{
+    size_t nChunks =
+      (valueSize + STATE_STREAMING_CHUNK_SIZE - 1) / STATE_STREAMING_CHUNK_SIZE;
+    if (chunkVersions.size() != nChunks) {
+        chunkVersions.resize(nChunks, 0);
+    }
+}
+
+uint64_t InMemoryStateKeyValue::getChunkVersion(long chunkIdx)
+{
+    faabric::util::UniqueLock lock(versionsMx);
+    checkChunkVersionsSize();
+    return chunkVersions.at(chunkIdx);
+}
+
+void InMemoryStateKeyValue::chunkModified(long offset, size_t length)
+{
+    if (sharded || length == 0) {
+        return;
+    }
+
+    faabric::util::UniqueLock lock(versionsMx);
+    checkChunkVersionsSize();
+
+    // Modifications may spill over the end of the value into the rest of the
+    // allocated memory
+    size_t startIdx = offset / STATE_STREAMING_CHUNK_SIZE;
+    size_t endIdx = std::min<size_t>(
+      (offset + length + STATE_STREAMING_CHUNK_SIZE - 1) /
+        STATE_STREAMING_CHUNK_SIZE,
+      chunkVersions.size());
+    for (size_t i = startIdx; i < endIdx; i++) {
+        if (status == InMemoryStateKeyStatus::MASTER) {
+            chunkVersions.at(i)++;
+        } else {
+            chunkVersions.at(i) = UNKNOWN_CHUNK_VERSION;
+        }
+    }
+}
+
+void InMemoryStateKeyValue::valueEvicted()
+{
+    // Make sure everything is pulled again
+    faabric::util::UniqueLock lock(versionsMx);
+    replicaEpoch = 0;
+}
+
+/**
+ * Works out which of the replica's chunks are out of date, returning their
+ * indexes along with their current versions. Everything is out of date if the
+ * replica's versions came from a different copy of the value.
+ */
+std::vector<std::pair<uint32_t, uint64_t>>
+InMemoryStateKeyValue::getChangedChunks(
+  uint64_t replicaEpochIn,
+  const std::vector<uint64_t>& replicaVersions)
+{
+    faabric::util::UniqueLock lock(versionsMx);
+    checkChunkVersionsSize();
+
+    bool allChanged = replicaEpochIn != epoch ||
+                      status != InMemoryStateKeyStatus::MASTER || sharded;
+
+    std::vector<std::pair<uint32_t, uint64_t>> changed;
+    for (size_t i = 0; i < chunkVersions.size(); i++) {
+        if (allChanged || i >= replicaVersions.size() ||
+            replicaVersions.at(i) != chunkVersions.at(i)) {
+            changed.emplace_back(i, chunkVersions.at(i));
+        }
+    }
+
+    return changed;
+}
+
+// ----------------------------------------
+// Sharding
+// ----------------------------------------
+
+/**
+ * Splits the chunks at segment boundaries and groups them by the host that
+ * owns each segment, leaving out anything this host owns.
+ */
+std::unordered_map<std::string, std::vector<StateChunk>>
+InMemoryStateKeyValue::splitChunksByOwner(const std::vector<StateChunk>& chunks)
+{
+    std::unordered_map<std::string, std::vector<StateChunk>> chunksByOwner;
+
+    for (const auto& chunk : chunks) {
+        size_t offset = chunk.offset;
+        size_t chunkEnd = chunk.offset + chunk.length;
+        while (offset < chunkEnd) {
+            size_t segmentIdx = offset / shardSize;
+            size_t segmentEnd =
+              std::min(chunkEnd, (segmentIdx + 1) * shardSize);
+
+            const std::string& owner = segmentOwners.at(segmentIdx);
+            if (owner != thisIP) {
+                chunksByOwner[owner].emplace_back(
+                  offset,
+                  segmentEnd - offset,
+                  chunk.data + (offset - chunk.offset));
+            }
+
+            offset = segmentEnd;
+        }
+    }
+
+    return chunksByOwner;
+}
+
+void InMemoryStateKeyValue::pullChunksFromOwners(
+  const std::vector<StateChunk>& chunks)
+{
+    StateClient::pullChunksFromHosts(
+      user, key, splitChunksByOwner(chunks), BYTES(sharedMemory));
+}
+
+void InMemoryStateKeyValue::pushChunksToOwners(
+  const std::vector<StateChunk>& chunks)
+{
+    StateClient::pushChunksToHosts(user, key, splitChunksByOwner(chunks));
+}
+
 // ----------------------------------------
 // Normal state key-value API
 // ----------------------------------------
 
 void InMemoryStateKeyValue::pullFromRemote()
 {
+    if (sharded) {
+        pullChunksFromOwners(getAllChunks());
+        return;
+    }
+
     if (status == InMemoryStateKeyStatus::MASTER) {
         return;
     }
 
-    std::vector<StateChunk> chunks = getAllChunks();
+    std::vector<uint64_t> versions;
+    uint64_t knownEpoch;
+    {
+        faabric::util::UniqueLock lock(versionsMx);
+        checkChunkVersionsSize();
+        versions = chunkVersions;
+        knownEpoch = replicaEpoch;
+    }
+
+    // Check which chunks have changed since we last pulled, and only pull
+    // those
     StateClient cli(user, key, masterIP);
-    cli.pullChunks(chunks, BYTES(sharedMemory));
+    faabric::StateValidateResponse changed =
+      cli.validateChunks(knownEpoch, versions);
+
+    std::vector<StateChunk> allChunks = getAllChunks();
+    std::vector<StateChunk> changedChunks;
+    changedChunks.reserve(changed.chunkidxs_size());
+    for (uint32_t idx : changed.chunkidxs()) {
+        changedChunks.push_back(allChunks.at(idx));
+    }
+
+    SPDLOG_TRACE("Pulling {}/{} changed chunks of {}/{}",
+                 changedChunks.size(),
+                 allChunks.size(),
+                 user,
+                 key);
+
+    cli.pullChunks(changedChunks, BYTES(sharedMemory));
+
+    // The versions we got are no newer than the data we pulled, so at worst
+    // we'll pull a chunk again unnecessarily next time
+    faabric::util::UniqueLock lock(versionsMx);
+    replicaEpoch = changed.epoch();
+    for (int i = 0; i < changed.chunkidxs_size(); i++) {
+        chunkVersions.at(changed.chunkidxs(i)) = changed.versions(i);
+    }
 }
 
 void InMemoryStateKeyValue::pullChunkFromRemote(long offset, size_t length)
 {
+    uint8_t* chunkStart = BYTES(sharedMemory) + offset;
+    std::vector<StateChunk> chunks = { StateChunk(offset, length, chunkStart) };
+
+    if (sharded) {
+        pullChunksFromOwners(chunks);
+        return;
+    }
+
     if (status == InMemoryStateKeyStatus::MASTER) {
         return;
     }
 
-    uint8_t* chunkStart = BYTES(sharedMemory) + offset;
-    std::vector<StateChunk> chunks = { StateChunk(offset, length, chunkStart) };
     StateClient cli(user, key, masterIP);
     cli.pullChunks(chunks, BYTES(sharedMemory));
 }
 
 void InMemoryStateKeyValue::pushToRemote()
 {
+    if (sharded) {
+        pushChunksToOwners(getAllChunks());
+        return;
+    }
+
     if (status == InMemoryStateKeyStatus::MASTER) {
         return;
     }
@@ -127,7 +480,9 @@ void InMemoryStateKeyValue::pushToRemote()
 void InMemoryStateKeyValue::pushPartialToRemote(
   const std::vector<StateChunk>& chunks)
 {
-    if (status == InMemoryStateKeyStatus::MASTER) {
+    if (sharded) {
+        pushChunksToOwners(chunks);
+    } else if (status == InMemoryStateKeyStatus::MASTER) {
         // Nothing to be done
     } else {
         StateClient cli(user, key, masterIP);
@@ -135,15 +490,61 @@ void InMemoryStateKeyValue::pushPartialToRemote(
     }
 }
 
+void InMemoryStateKeyValue::pushMergeToRemote(
+  long offset,
+  const uint8_t* buffer,
+  size_t length,
+  faabric::util::SnapshotDataType dataType,
+  faabric::util::SnapshotMergeOperation operation)
+{
+    if (!sharded) {
+        if (status == InMemoryStateKeyStatus::MASTER) {
+            mergeChunk(offset, buffer, length, dataType, operation);
+        } else {
+            StateClient cli(user, key, masterIP);
+            cli.pushMerge(offset, buffer, length, dataType, operation);
+        }
+
+        return;
+    }
+
+    // Each owner merges its own part. We check up front that the split
+    // won't cut a value in two, so we never apply only part of a merge
+    size_t valueBytes = faabric::util::snapshotDataTypeSize(dataType);
+    if (valueBytes > 1 && (offset % valueBytes != 0 ||
+                           shardSize % valueBytes != 0)) {
+        SPDLOG_ERROR("Sharded merge on {}/{} at {} not aligned to {} bytes",
+                     user,
+                     key,
+                     offset,
+                     valueBytes);
+        throw std::runtime_error("Misaligned sharded state merge");
+    }
+
+    std::vector<StateChunk> chunks = {
+        StateChunk(offset, length, const_cast<uint8_t*>(buffer))
+    };
+    StateClient::pushMergeToHosts(
+      user, key, splitChunksByOwner(chunks), dataType, operation);
+
+    // Merge the parts we own ourselves
+    size_t chunkEnd = offset + length;
+    for (size_t o = offset; o < chunkEnd;) {
+        size_t segmentIdx = o / shardSize;
+        size_t segmentEnd = std::min(chunkEnd, (segmentIdx + 1) * shardSize);
+        if (segmentOwners.at(segmentIdx) == thisIP) {
+            mergeChunk(
+              o, buffer + (o - offset), segmentEnd - o, dataType, operation);
+        }
+
+        o = segmentEnd;
+    }
+}
+
 void InMemoryStateKeyValue::appendToRemote(const uint8_t* data, size_t length)
 {
     if (status == InMemoryStateKeyStatus::MASTER) {
-        // Create new memory region to hold data
-        auto dataCopy = std::make_unique<uint8_t[]>(length);
-        std::copy(data, data + length, dataCopy.get());
-
-        // Add to list
-        appendedData.emplace_back(length, std::move(dataCopy));
+        appendLog.append(data, length);
     } else {
         StateClient cli(user, key, masterIP);
         cli.append(data, length);
@@ -152,36 +553,29 @@ void InMemoryStateKeyValue::appendToRemote(const uint8_t* data, size_t length)
 
 void InMemoryStateKeyValue::pullAppendedFromRemote(uint8_t* data,
                                                    size_t length,
+                                                   long startIdx,
                                                    long nValues)
 {
     if (status == InMemoryStateKeyStatus::MASTER) {
-        // Copy all appended data into buffer locally
-        size_t offset = 0;
-        for (int i = 0; i < nValues; i++) {
-            AppendedInMemoryState& appended = appendedData.at(i);
-            uint8_t* dataStart = appended.data.get();
-            std::copy(dataStart, dataStart + appended.length, data + offset);
-            offset += appended.length;
-        }
+        appendLog.readRange(startIdx, nValues, data, length);
     } else {
         StateClient cli(user, key, masterIP);
-        cli.pullAppended(data, length, nValues);
+        cli.pullAppended(data, length, nValues, startIdx);
     }
 }
 
 void InMemoryStateKeyValue::clearAppendedFromRemote()
 {
     if (status == InMemoryStateKeyStatus::MASTER) {
-        // Clear appended locally
-        appendedData.clear();
+        appendLog.clear();
     } else {
         StateClient cli(user, key, masterIP);
         cli.clearAppended();
     }
 }
 
-AppendedInMemoryState& InMemoryStateKeyValue::getAppendedValue(uint idx)
+AppendLog& InMemoryStateKeyValue::getAppendLog()
 {
-    return appendedData.at(idx);
+    return appendLog;
 }
 }
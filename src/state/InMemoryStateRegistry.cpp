@@ -4,11 +4,14 @@
 #include <faabric/util/bytes.h>
 #include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
+#include <faabric/util/scheduling.h>
 #include <faabric/util/state.h>
 
+#include <sstream>
 #include <vector>
 
 #define MASTER_KEY_PREFIX "master_"
+#define SHARDS_KEY_PREFIX "shards_"
 
 namespace faabric::state {
 InMemoryStateRegistry& getInMemoryStateRegistry()
@@ -23,6 +26,39 @@ static std::string getMasterKey(const std::string& user, const std::string& key)
     return masterKey;
 }
 
+static std::string getShardsKey(const std::string& user, const std::string& key)
+{
+    std::string shardsKey = SHARDS_KEY_PREFIX + user + "_" + key;
+    return shardsKey;
+}
+
+// Shard info is stored as the value size followed by the hosts, separated by
+// spaces
+static std::string serialiseShardInfo(const StateShardInfo& info)
+{
+    std::stringstream ss;
+    ss << info.valueSize;
+    for (const auto& host : info.hosts) {
+        ss << " " << host;
+    }
+
+    return ss.str();
+}
+
+static StateShardInfo parseShardInfo(const std::string& infoStr)
+{
+    StateShardInfo info;
+    std::stringstream ss(infoStr);
+    ss >> info.valueSize;
+
+    std::string host;
+    while (ss >> host) {
+        info.hosts.emplace_back(host);
+    }
+
+    return info;
+}
+
 std::string InMemoryStateRegistry::getMasterIP(const std::string& user,
                                                const std::string& key,
                                                const std::string& thisIP,
@@ -114,10 +150,111 @@ std::string InMemoryStateRegistry::getMasterIPForOtherMaster(
     return masterIP;
 }
 
+/**
+ * In sharded mode, the first host to create a value fixes its size and the
+ * hosts its segments are spread over, so every host agrees on where each
+ * segment lives even if hosts join or leave later.
+ */
+StateShardInfo InMemoryStateRegistry::getShardInfo(const std::string& user,
+                                                   const std::string& key,
+                                                   const std::string& thisIP,
+                                                   size_t valueSize,
+                                                   bool claim)
+{
+    std::string lookupKey = faabric::util::keyForUser(user, key);
+
+    {
+        faabric::util::SharedLock lock(shardMapMutex);
+        if (shardMap.count(lookupKey) > 0) {
+            return shardMap[lookupKey];
+        }
+    }
+
+    faabric::util::FullLock lock(shardMapMutex);
+
+    if (shardMap.count(lookupKey) > 0) {
+        return shardMap[lookupKey];
+    }
+
+    const std::string shardsKey = getShardsKey(user, key);
+    redis::Redis& redis = redis::Redis::getState();
+    std::vector<uint8_t> infoBytes = redis.get(shardsKey);
+
+    if (infoBytes.empty() && (!claim || valueSize == 0)) {
+        SPDLOG_TRACE("No shards found for {}", lookupKey);
+        throw StateKeyValueException("Found no shards for state " + shardsKey);
+    }
+
+    if (infoBytes.empty()) {
+        uint32_t lockId = StateKeyValue::waitOnRedisRemoteLock(shardsKey);
+        if (lockId == 0) {
+            SPDLOG_ERROR("Unable to acquire remote lock for {}", shardsKey);
+            throw std::runtime_error("Unable to get remote lock");
+        }
+
+        infoBytes = redis.get(shardsKey);
+        if (infoBytes.empty()) {
+            StateShardInfo newInfo;
+            newInfo.valueSize = valueSize;
+
+            // Spread over all the hosts currently in the cluster
+            redis::Redis& queueRedis = redis::Redis::getQueue();
+            std::set<std::string> hosts =
+              queueRedis.smembers(AVAILABLE_HOST_SET);
+            hosts.insert(thisIP);
+            newInfo.hosts.assign(hosts.begin(), hosts.end());
+
+            SPDLOG_DEBUG("Sharding {} ({} bytes) over {} hosts",
+                         lookupKey,
+                         valueSize,
+                         newInfo.hosts.size());
+
+            infoBytes =
+              faabric::util::stringToBytes(serialiseShardInfo(newInfo));
+            redis.set(shardsKey, infoBytes);
+        }
+
+        redis.releaseLock(shardsKey, lockId);
+    }
+
+    StateShardInfo info =
+      parseShardInfo(faabric::util::bytesToString(infoBytes));
+
+    if (valueSize > 0 && info.valueSize != valueSize) {
+        SPDLOG_ERROR("Sharded state {} has size {}, not {}",
+                     lookupKey,
+                     info.valueSize,
+                     valueSize);
+        throw StateKeyValueException("Mismatched size for sharded state " +
+                                     lookupKey);
+    }
+
+    shardMap[lookupKey] = info;
+
+    return info;
+}
+
+void InMemoryStateRegistry::deleteShardInfo(const std::string& user,
+                                            const std::string& key,
+                                            bool global)
+{
+    faabric::util::FullLock lock(shardMapMutex);
+    shardMap.erase(faabric::util::keyForUser(user, key));
+
+    if (global) {
+        redis::Redis::getState().del(getShardsKey(user, key));
+    }
+}
+
 void InMemoryStateRegistry::clear()
 {
-    faabric::util::FullLock lock(masterMapMutex);
-    masterMap.clear();
+    {
+        faabric::util::FullLock lock(masterMapMutex);
+        masterMap.clear();
+    }
+
+    faabric::util::FullLock lock(shardMapMutex);
+    shardMap.clear();
 }
 
 }
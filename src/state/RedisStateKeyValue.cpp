@@ -47,6 +47,52 @@ void RedisStateKeyValue::clearAll(bool global)
     }
 }
 
+void RedisStateKeyValue::pullMultipleFromRemote(
+  const std::vector<StateKeyValue*>& kvs)
+{
+    PROF_START(statePullMultiple)
+
+    std::vector<redis::RedisReadRange> ranges;
+    ranges.reserve(kvs.size());
+    for (auto* kv : kvs) {
+        auto* redisKv = static_cast<RedisStateKeyValue*>(kv);
+        ranges.push_back({ redisKv->joinedKey,
+                           0,
+                           redisKv->valueSize,
+                           static_cast<uint8_t*>(redisKv->sharedMemory) });
+    }
+
+    SPDLOG_DEBUG("Pipelining pulls of {} values", ranges.size());
+    redis::Redis::getState().getRangesPipeline(ranges);
+
+    PROF_END(statePullMultiple)
+}
+
+void RedisStateKeyValue::pushMultipleToRemote(
+  const DirtyStateChunks& dirtyChunks)
+{
+    PROF_START(pushMultiple)
+
+    redis::Redis& redis = redis::Redis::getState();
+
+    long nUpdates = 0;
+    for (const auto& [kv, chunks] : dirtyChunks) {
+        auto* redisKv = static_cast<RedisStateKeyValue*>(kv);
+        for (const auto& c : chunks) {
+            redis.setRangePipeline(
+              redisKv->joinedKey, c.offset, c.data, c.length);
+            nUpdates++;
+        }
+    }
+
+    SPDLOG_DEBUG("Pipelined {} updates on {} values",
+                 nUpdates,
+                 dirtyChunks.size());
+    redis.flushPipeline(nUpdates);
+
+    PROF_END(pushMultiple)
+}
+
 void RedisStateKeyValue::pullFromRemote()
 {
     PROF_START(statePull)
@@ -111,6 +157,43 @@ void RedisStateKeyValue::pushPartialToRemote(
     PROF_END(pushPartial)
 }
 
+void RedisStateKeyValue::pushMergeToRemote(
+  long offset,
+  const uint8_t* buffer,
+  size_t length,
+  faabric::util::SnapshotDataType dataType,
+  faabric::util::SnapshotMergeOperation operation)
+{
+    PROF_START(pushMerge)
+
+    // Redis can't merge for us, so we read-modify-write under the remote lock
+    std::string mergeKey = joinedKey + "_merge";
+    uint32_t lockId = waitOnRedisRemoteLock(mergeKey);
+    if (lockId == 0) {
+        SPDLOG_ERROR("Unable to acquire remote lock for {}", mergeKey);
+        throw std::runtime_error("Unable to get remote lock");
+    }
+
+    redis::Redis& redis = redis::Redis::getState();
+    try {
+        std::vector<uint8_t> current(length, 0);
+        redis.getRange(
+          joinedKey, current.data(), length, offset, offset + length - 1);
+
+        faabric::util::applyDiffValues(
+          current.data(), { buffer, length }, dataType, operation);
+
+        redis.setRange(joinedKey, offset, current.data(), length);
+    } catch (...) {
+        redis.releaseLock(mergeKey, lockId);
+        throw;
+    }
+
+    redis.releaseLock(mergeKey, lockId);
+
+    PROF_END(pushMerge)
+}
+
 void RedisStateKeyValue::appendToRemote(const uint8_t* data, size_t length)
 {
     redis::Redis::getState().enqueueBytes(joinedKey, data, length);
@@ -118,9 +201,11 @@ void RedisStateKeyValue::appendToRemote(const uint8_t* data, size_t length)
 
 void RedisStateKeyValue::pullAppendedFromRemote(uint8_t* data,
                                                 size_t length,
+                                                long startIdx,
                                                 long nValues)
 {
-    redis::Redis::getState().dequeueMultiple(joinedKey, data, length, nValues);
+    redis::Redis::getState().dequeueMultiple(
+      joinedKey, data, length, nValues, startIdx);
 }
 
 void RedisStateKeyValue::clearAppendedFromRemote()
@@ -1,6 +1,7 @@
 #include <faabric/state/InMemoryStateKeyValue.h>
 #include <faabric/state/RedisStateKeyValue.h>
 #include <faabric/state/State.h>
+#include <faabric/state/StateMemoryTracker.h>
 #include <faabric/util/config.h>
 #include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
@@ -26,7 +27,7 @@ void State::forceClearAll(bool global)
     std::string stateMode = faabric::util::getSystemConfig().stateMode;
     if (stateMode == "redis") {
         RedisStateKeyValue::clearAll(global);
-    } else if (stateMode == "inmemory") {
+    } else if (stateMode == "inmemory" || stateMode == "sharded") {
         InMemoryStateKeyValue::clearAll(global);
     } else {
         throw std::runtime_error("Unrecognised state mode: " + stateMode);
@@ -34,6 +35,8 @@ void State::forceClearAll(bool global)
 
     faabric::util::SharedLock sharedLock(mapMutex);
     kvMap.clear();
+
+    getStateMemoryTracker().clear();
 }
 
 size_t State::getStateSize(const std::string& user, const std::string& keyIn)
@@ -65,7 +68,7 @@ size_t State::getStateSize(const std::string& user, const std::string& keyIn)
     std::string stateMode = faabric::util::getSystemConfig().stateMode;
     if (stateMode == "redis") {
         return RedisStateKeyValue::getStateSizeFromRemote(user, keyIn);
-    } else if (stateMode == "inmemory") {
+    } else if (stateMode == "inmemory" || stateMode == "sharded") {
         return InMemoryStateKeyValue::getStateSizeFromRemote(
           user, keyIn, thisIP);
     } else {
@@ -78,7 +81,7 @@ void State::deleteKV(const std::string& userIn, const std::string& keyIn)
     std::string stateMode = faabric::util::getSystemConfig().stateMode;
     if (stateMode == "redis") {
         RedisStateKeyValue::deleteFromRemote(userIn, keyIn);
-    } else if (stateMode == "inmemory") {
+    } else if (stateMode == "inmemory" || stateMode == "sharded") {
         InMemoryStateKeyValue::deleteFromRemote(userIn, keyIn, thisIP);
     } else {
         throw std::runtime_error("Unrecognised state mode: " + stateMode);
@@ -153,7 +156,7 @@ std::shared_ptr<StateKeyValue> State::doGetKV(const std::string& user,
             auto kv = std::make_shared<RedisStateKeyValue>(user, key, size);
             kvMap.emplace(lookupKey, std::move(kv));
         }
-    } else if (stateMode == "inmemory") {
+    } else if (stateMode == "inmemory" || stateMode == "sharded") {
         // Passing IP here is crucial for testing
         if (sizeless) {
             auto kv =
@@ -171,6 +174,46 @@ std::shared_ptr<StateKeyValue> State::doGetKV(const std::string& user,
     return kvMap[lookupKey];
 }
 
+void State::pullMultiple(const StateKeyValueList& kvs)
+{
+    std::string stateMode = faabric::util::getSystemConfig().stateMode;
+    if (stateMode == "redis") {
+        StateKeyValue::pullMultiple(kvs,
+                                    RedisStateKeyValue::pullMultipleFromRemote);
+    } else if (stateMode == "inmemory" || stateMode == "sharded") {
+        StateKeyValue::pullMultiple(
+          kvs, InMemoryStateKeyValue::pullMultipleFromRemote);
+    } else {
+        throw std::runtime_error("Unrecognised state mode: " + stateMode);
+    }
+}
+
+void State::pushMultiple(const StateKeyValueList& kvs)
+{
+    std::string stateMode = faabric::util::getSystemConfig().stateMode;
+    if (stateMode == "redis") {
+        StateKeyValue::pushMultiple(kvs,
+                                    RedisStateKeyValue::pushMultipleToRemote);
+    } else if (stateMode == "inmemory" || stateMode == "sharded") {
+        StateKeyValue::pushMultiple(
+          kvs, InMemoryStateKeyValue::pushMultipleToRemote);
+    } else {
+        throw std::runtime_error("Unrecognised state mode: " + stateMode);
+    }
+}
+
+std::shared_future<void> State::pushAsync(
+  const std::shared_ptr<StateKeyValue>& kv,
+  bool full)
+{
+    return flusher.push(kv, full);
+}
+
+void State::flushPushes()
+{
+    flusher.flush();
+}
+
 size_t State::getKVCount()
 {
     faabric::util::SharedLock lock(mapMutex);
@@ -1,11 +1,292 @@
 #include <faabric/state/StateClient.h>
 #include <faabric/transport/common.h>
 #include <faabric/transport/macros.h>
+#include <faabric/util/config.h>
 #include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
 
+#include <deque>
+#include <functional>
+#include <future>
+
 namespace faabric::state {
 
+/**
+ * Merges chunks that are next to each other in the value into single ranges,
+ * then splits the ranges up so that no request moves more than
+ * STATE_TRANSFER_MAX_BYTES.
+ */
+static std::vector<StateChunk> getTransferChunks(
+  const std::vector<StateChunk>& chunks)
+{
+    std::vector<StateChunk> ranges;
+    for (const auto& chunk : chunks) {
+        if (!ranges.empty()) {
+            StateChunk& last = ranges.back();
+            if (last.offset + (long)last.length == chunk.offset &&
+                last.data + last.length == chunk.data) {
+                last.length += chunk.length;
+                continue;
+            }
+        }
+
+        ranges.emplace_back(chunk.offset, chunk.length, chunk.data);
+    }
+
+    std::vector<StateChunk> transferChunks;
+    for (const auto& range : ranges) {
+        for (size_t done = 0; done < range.length;
+             done += STATE_TRANSFER_MAX_BYTES) {
+            size_t length = std::min<size_t>(STATE_TRANSFER_MAX_BYTES,
+                                             range.length - done);
+            transferChunks.emplace_back(
+              range.offset + done, length, range.data + done);
+        }
+    }
+
+    return transferChunks;
+}
+
+/**
+ * Groups chunks of several values into batches of at most
+ * STATE_TRANSFER_MAX_BYTES, splitting up any chunks bigger than that.
+ */
+static std::vector<std::vector<StateKeyChunk>> getTransferBatches(
+  const std::vector<StateKeyChunk>& chunks)
+{
+    std::vector<std::vector<StateKeyChunk>> batches;
+    size_t batchBytes = STATE_TRANSFER_MAX_BYTES;
+    for (const auto& c : chunks) {
+        for (size_t done = 0; done < c.chunk.length;
+             done += STATE_TRANSFER_MAX_BYTES) {
+            size_t length = std::min<size_t>(STATE_TRANSFER_MAX_BYTES,
+                                             c.chunk.length - done);
+            if (batchBytes + length > STATE_TRANSFER_MAX_BYTES) {
+                batches.emplace_back();
+                batchBytes = 0;
+            }
+
+            StateChunk piece(
+              c.chunk.offset + done, length, c.chunk.data + done);
+            batches.back().push_back({ c.user, c.key, piece });
+            batchBytes += length;
+        }
+    }
+
+    return batches;
+}
+
+static std::vector<faabric::StateChunkRequest> getPullRequests(
+  const std::string& user,
+  const std::string& key,
+  const std::vector<StateChunk>& chunks)
+{
+    std::vector<faabric::StateChunkRequest> requests;
+    for (const auto& chunk : getTransferChunks(chunks)) {
+        faabric::StateChunkRequest& request = requests.emplace_back();
+        request.set_user(user);
+        request.set_key(key);
+        request.set_offset(chunk.offset);
+        request.set_chunksize(chunk.length);
+    }
+
+    return requests;
+}
+
+/**
+ * Batches up the chunks, each in its own message part, so that each request
+ * carries at most STATE_TRANSFER_MAX_BYTES
+ */
+static void getPushRequests(
+  const std::string& user,
+  const std::string& key,
+  const std::vector<StateChunk>& chunks,
+  std::vector<faabric::StatePushChunksRequest>& requests,
+  std::vector<faabric::transport::MessageParts>& requestsData)
+{
+    size_t batchBytes = STATE_TRANSFER_MAX_BYTES;
+    for (const auto& chunk : getTransferChunks(chunks)) {
+        if (batchBytes + chunk.length > STATE_TRANSFER_MAX_BYTES) {
+            requests.emplace_back();
+            requests.back().set_user(user);
+            requests.back().set_key(key);
+            requestsData.emplace_back();
+            batchBytes = 0;
+        }
+
+        requests.back().add_offsets(chunk.offset);
+        requestsData.back().emplace_back(chunk.data, chunk.length);
+        batchBytes += chunk.length;
+    }
+}
+
+static void copyPulledPart(faabric::transport::Message& msg,
+                           uint8_t* bufferStart)
+{
+    faabric::StatePart response;
+    if (!response.ParseFromArray(msg.data(), msg.size())) {
+        throw std::runtime_error("Error deserialising message");
+    }
+
+    std::copy(response.data().begin(),
+              response.data().end(),
+              bufferStart + response.offset());
+}
+
+static std::shared_ptr<faabric::transport::ConnectionPool> getTransferPool(
+  const std::string& host)
+{
+    return faabric::transport::getConnectionPool(
+      host,
+      STATE_ASYNC_PORT,
+      STATE_SYNC_PORT,
+      faabric::util::getSystemConfig().stateTransferConnections);
+}
+
+// Requests for one host, with the data parts of each if there are any
+static faabric::StateMergeRequest getMergeRequest(
+  const std::string& user,
+  const std::string& key,
+  long offset,
+  faabric::util::SnapshotDataType dataType,
+  faabric::util::SnapshotMergeOperation operation)
+{
+    faabric::StateMergeRequest request;
+    request.set_user(user);
+    request.set_key(key);
+    request.set_offset(offset);
+    request.set_datatype(dataType);
+    request.set_mergeop(operation);
+
+    return request;
+}
+
+template<typename T>
+struct HostRequests
+{
+    std::shared_ptr<faabric::transport::ConnectionPool> pool;
+    std::vector<T> requests;
+    std::vector<faabric::transport::MessageParts> requestsData;
+
+    size_t nSubmitted = 0;
+    std::deque<std::future<faabric::transport::Message>> inFlight;
+};
+
+/**
+ * Sends the requests to every host at once through the hosts' pooled
+ * connections, keeping a window of requests in flight to each. Responses are
+ * handled on this thread, in order for each host.
+ */
+template<typename T>
+static void pipelineRequests(
+  faabric::state::StateCalls call,
+  std::deque<HostRequests<T>>& hosts,
+  const std::function<void(faabric::transport::Message&)>& onResponse)
+{
+    size_t window =
+      std::max(1, faabric::util::getSystemConfig().stateTransferWindow);
+
+    bool awaited = true;
+    while (awaited) {
+        for (auto& h : hosts) {
+            while (h.inFlight.size() < window &&
+                   h.nSubmitted < h.requests.size()) {
+                size_t idx = h.nSubmitted++;
+                faabric::transport::MessageParts parts;
+                if (!h.requestsData.empty()) {
+                    parts = h.requestsData.at(idx);
+                }
+
+                SERIALISE_MSG(h.requests.at(idx))
+                h.inFlight.emplace_back(h.pool->submitSync(
+                  call, serialisedBuffer, serialisedSize, parts));
+            }
+        }
+
+        awaited = false;
+        for (auto& h : hosts) {
+            if (h.inFlight.empty()) {
+                continue;
+            }
+
+            faabric::transport::Message msg =
+              h.pool->awaitResponse(h.inFlight.front());
+            h.inFlight.pop_front();
+            onResponse(msg);
+            awaited = true;
+        }
+    }
+}
+
+void StateClient::pullChunksFromHosts(
+  const std::string& user,
+  const std::string& key,
+  const std::unordered_map<std::string, std::vector<StateChunk>>&
+    chunksByHost,
+  uint8_t* bufferStart)
+{
+    std::deque<HostRequests<faabric::StateChunkRequest>> hosts;
+    for (const auto& [host, chunks] : chunksByHost) {
+        SPDLOG_TRACE("Requesting pull-chunks on {}/{} at {}", user, key, host);
+        auto& h = hosts.emplace_back();
+        h.pool = getTransferPool(host);
+        h.requests = getPullRequests(user, key, chunks);
+    }
+
+    pipelineRequests<faabric::StateChunkRequest>(
+      faabric::state::StateCalls::Pull,
+      hosts,
+      [bufferStart](faabric::transport::Message& msg) {
+          copyPulledPart(msg, bufferStart);
+      });
+}
+
+void StateClient::pushChunksToHosts(
+  const std::string& user,
+  const std::string& key,
+  const std::unordered_map<std::string, std::vector<StateChunk>>&
+    chunksByHost)
+{
+    std::deque<HostRequests<faabric::StatePushChunksRequest>> hosts;
+    for (const auto& [host, chunks] : chunksByHost) {
+        SPDLOG_TRACE("Requesting push-chunks on {}/{} at {}", user, key, host);
+        auto& h = hosts.emplace_back();
+        h.pool = getTransferPool(host);
+        getPushRequests(user, key, chunks, h.requests, h.requestsData);
+    }
+
+    pipelineRequests<faabric::StatePushChunksRequest>(
+      faabric::state::StateCalls::PushChunks,
+      hosts,
+      [](faabric::transport::Message& msg) {});
+}
+
+void StateClient::pushMergeToHosts(
+  const std::string& user,
+  const std::string& key,
+  const std::unordered_map<std::string, std::vector<StateChunk>>&
+    chunksByHost,
+  faabric::util::SnapshotDataType dataType,
+  faabric::util::SnapshotMergeOperation operation)
+{
+    std::deque<HostRequests<faabric::StateMergeRequest>> hosts;
+    for (const auto& [host, chunks] : chunksByHost) {
+        SPDLOG_TRACE("Requesting push-merge on {}/{} at {}", user, key, host);
+        auto& h = hosts.emplace_back();
+        h.pool = getTransferPool(host);
+        for (const auto& chunk : chunks) {
+            h.requests.emplace_back(
+              getMergeRequest(user, key, chunk.offset, dataType, operation));
+            h.requestsData.push_back({ { chunk.data, chunk.length } });
+        }
+    }
+
+    pipelineRequests<faabric::StateMergeRequest>(
+      faabric::state::StateCalls::PushMerge,
+      hosts,
+      [](faabric::transport::Message& msg) {});
+}
+
 StateClient::StateClient(const std::string& userIn,
                          const std::string& keyIn,
                          const std::string& hostIn)
@@ -41,49 +322,160 @@ void StateClient::pushChunks(const std::vector<StateChunk>& chunks)
 {
     logRequest("push-chunks");
 
-    for (const auto& chunk : chunks) {
-        faabric::StatePart stateChunk;
-        stateChunk.set_user(user);
-        stateChunk.set_key(key);
-        stateChunk.set_offset(chunk.offset);
-        stateChunk.set_data(chunk.data, chunk.length);
+    if (chunks.empty()) {
+        return;
+    }
+
+    std::vector<faabric::StatePushChunksRequest> requests;
+    std::vector<faabric::transport::MessageParts> requestsData;
+    getPushRequests(user, key, chunks, requests, requestsData);
+
+    int window = faabric::util::getSystemConfig().stateTransferWindow;
+    if (window > 1 && requests.size() > 1) {
+        pushChunksToHosts(user, key, { { host, chunks } });
+        return;
+    }
 
+    for (size_t i = 0; i < requests.size(); i++) {
         faabric::EmptyResponse resp;
-        syncSend(faabric::state::StateCalls::Push, &stateChunk, &resp);
+        syncSend(faabric::state::StateCalls::PushChunks,
+                 &requests.at(i),
+                 requestsData.at(i),
+                 &resp);
     }
 }
 
+void StateClient::pushMerge(long offset,
+                            const uint8_t* data,
+                            size_t length,
+                            faabric::util::SnapshotDataType dataType,
+                            faabric::util::SnapshotMergeOperation operation)
+{
+    logRequest("push-merge");
+
+    faabric::StateMergeRequest request =
+      getMergeRequest(user, key, offset, dataType, operation);
+
+    faabric::transport::MessageParts parts = { { data, length } };
+
+    faabric::EmptyResponse resp;
+    syncSend(faabric::state::StateCalls::PushMerge, &request, parts, &resp);
+}
+
 void StateClient::pullChunks(const std::vector<StateChunk>& chunks,
                              uint8_t* bufferStart)
 {
     logRequest("pull-chunks");
 
-    for (const auto& chunk : chunks) {
-        // Prepare request
-        faabric::StateChunkRequest request;
-        request.set_user(user);
-        request.set_key(key);
-        request.set_offset(chunk.offset);
-        request.set_chunksize(chunk.length);
+    // Keep a window of requests in flight, rather than waiting for each
+    // response before sending the next request
+    std::vector<faabric::StateChunkRequest> requests =
+      getPullRequests(user, key, chunks);
+
+    int window = faabric::util::getSystemConfig().stateTransferWindow;
+    if (window > 1 && requests.size() > 1) {
+        pullChunksFromHosts(user, key, { { host, chunks } }, bufferStart);
+        return;
+    }
 
-        // Send request
+    for (auto& request : requests) {
         faabric::StatePart response;
         syncSend(faabric::state::StateCalls::Pull, &request, &response);
-
-        // Copy response data
         std::copy(response.data().begin(),
                   response.data().end(),
                   bufferStart + response.offset());
     }
 }
 
+void StateClient::pullMultiple(const std::vector<StateKeyChunk>& chunks)
+{
+    logRequest("pull-multiple");
+
+    for (const auto& batch : getTransferBatches(chunks)) {
+        faabric::StateMultiChunkRequest request;
+        for (const auto& c : batch) {
+            auto* chunkReq = request.add_chunks();
+            chunkReq->set_user(c.user);
+            chunkReq->set_key(c.key);
+            chunkReq->set_offset(c.chunk.offset);
+            chunkReq->set_chunksize(c.chunk.length);
+        }
+
+        faabric::StateMultiChunkResponse response;
+        syncSend(faabric::state::StateCalls::PullMultiple, &request, &response);
+
+        if (response.parts_size() != (int)batch.size()) {
+            SPDLOG_ERROR("Pulled {} chunks from {} but expected {}",
+                         response.parts_size(),
+                         host,
+                         batch.size());
+            throw std::runtime_error("Mismatched state chunks");
+        }
+
+        for (int i = 0; i < response.parts_size(); i++) {
+            const std::string& data = response.parts(i).data();
+            const StateChunk& chunk = batch.at(i).chunk;
+            if (data.size() != chunk.length) {
+                throw std::runtime_error("Mismatched state chunk size");
+            }
+
+            std::copy(data.begin(), data.end(), chunk.data);
+        }
+    }
+}
+
+void StateClient::pushMultiple(const std::vector<StateKeyChunk>& chunks)
+{
+    logRequest("push-multiple");
+
+    for (const auto& batch : getTransferBatches(chunks)) {
+        faabric::StateMultiChunkRequest request;
+        faabric::transport::MessageParts parts;
+        for (const auto& c : batch) {
+            auto* chunkReq = request.add_chunks();
+            chunkReq->set_user(c.user);
+            chunkReq->set_key(c.key);
+            chunkReq->set_offset(c.chunk.offset);
+            chunkReq->set_chunksize(c.chunk.length);
+            parts.emplace_back(c.chunk.data, c.chunk.length);
+        }
+
+        faabric::EmptyResponse resp;
+        syncSend(
+          faabric::state::StateCalls::PushMultiple, &request, parts, &resp);
+    }
+}
+
+faabric::StateValidateResponse StateClient::validateChunks(
+  uint64_t epoch,
+  const std::vector<uint64_t>& versions)
+{
+    logRequest("validate-chunks");
+
+    faabric::StateValidateRequest request;
+    request.set_user(user);
+    request.set_key(key);
+    request.set_epoch(epoch);
+    for (uint64_t v : versions) {
+        request.add_versions(v);
+    }
+
+    faabric::StateValidateResponse response;
+    syncSend(faabric::state::StateCalls::ValidateChunks, &request, &response);
+
+    return response;
+}
+
 void StateClient::append(const uint8_t* data, size_t length)
 {
     logRequest("append");
     sendStateRequest(faabric::state::StateCalls::Append, data, length);
 }
 
-void StateClient::pullAppended(uint8_t* buffer, size_t length, long nValues)
+void StateClient::pullAppended(uint8_t* buffer,
+                               size_t length,
+                               long nValues,
+                               long startIdx)
 {
     logRequest("pull-appended");
 
@@ -92,24 +484,22 @@ void StateClient::pullAppended(uint8_t* buffer, size_t length, long nValues)
     request.set_user(user);
     request.set_key(key);
     request.set_nvalues(nValues);
+    request.set_startidx(startIdx);
 
     faabric::StateAppendedResponse response;
     syncSend(faabric::state::StateCalls::PullAppended, &request, &response);
 
-    // Process response
-    size_t offset = 0;
-    for (auto& value : response.values()) {
-        if (offset > length) {
-            throw std::runtime_error(fmt::format(
-              "Buffer not large enough for appended data (offset={}, length{})",
-              offset,
-              length));
-        }
-
-        auto valueData = BYTES_CONST(value.data().c_str());
-        std::copy(valueData, valueData + value.data().size(), buffer + offset);
-        offset += value.data().size();
+    // The values come back already concatenated
+    const std::string& data = response.data();
+    if (data.size() > length) {
+        throw std::runtime_error(fmt::format(
+          "Buffer not large enough for appended data (size={}, length={})",
+          data.size(),
+          length));
     }
+
+    auto valueData = BYTES_CONST(data.data());
+    std::copy(valueData, valueData + data.size(), buffer);
 }
 
 void StateClient::clearAppended()
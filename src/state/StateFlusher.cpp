@@ -0,0 +1,151 @@
+#include <faabric/state/StateFlusher.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/state.h>
+
+namespace faabric::state {
+
+StateFlusher::~StateFlusher()
+{
+    stop();
+}
+
+std::shared_future<void> StateFlusher::push(
+  const std::shared_ptr<StateKeyValue>& kv,
+  bool full)
+{
+    faabric::util::UniqueLock lock(mx);
+
+    if (stopped) {
+        SPDLOG_ERROR("Pushing {}/{} with stopped state flusher",
+                     kv->user,
+                     kv->key);
+        throw std::runtime_error("State flusher stopped");
+    }
+
+    // Coalesce with any push of the same value that hasn't been sent yet
+    std::string lookupKey = faabric::util::keyForUser(kv->user, kv->key);
+    auto it = pending.find(lookupKey);
+    if (it != pending.end()) {
+        it->second->full |= full;
+        return it->second->future;
+    }
+
+    auto p = std::make_shared<PendingPush>();
+    p->kv = kv;
+    p->full = full;
+    p->future = p->promise.get_future().share();
+
+    pending.emplace(lookupKey, p);
+    queue.push_back(p);
+
+    // The thread is only started when first needed
+    if (!flushThread.joinable()) {
+        flushThread = std::jthread([this] { run(); });
+    }
+
+    cv.notify_one();
+
+    return p->future;
+}
+
+void StateFlusher::flush()
+{
+    std::vector<std::shared_future<void>> futures;
+    {
+        faabric::util::UniqueLock lock(mx);
+        for (const auto& p : inFlight) {
+            futures.push_back(p->future);
+        }
+
+        for (const auto& p : queue) {
+            futures.push_back(p->future);
+        }
+    }
+
+    // Wait for everything before reporting any failure
+    for (auto& f : futures) {
+        f.wait();
+    }
+
+    for (auto& f : futures) {
+        f.get();
+    }
+}
+
+size_t StateFlusher::getPendingCount()
+{
+    faabric::util::UniqueLock lock(mx);
+    return queue.size() + inFlight.size();
+}
+
+void StateFlusher::stop()
+{
+    {
+        faabric::util::UniqueLock lock(mx);
+        if (stopped) {
+            return;
+        }
+
+        stopped = true;
+    }
+
+    cv.notify_one();
+
+    // The thread sends anything still queued before exiting
+    if (flushThread.joinable()) {
+        flushThread.join();
+    }
+}
+
+void StateFlusher::run()
+{
+    while (true) {
+        {
+            faabric::util::UniqueLock lock(mx);
+            cv.wait(lock, [this] { return stopped || !queue.empty(); });
+
+            if (queue.empty()) {
+                return;
+            }
+
+            // Anything requested from now on needs a new push
+            inFlight.swap(queue);
+            pending.clear();
+        }
+
+        std::vector<std::exception_ptr> results(inFlight.size(), nullptr);
+        for (size_t i = 0; i < inFlight.size(); i++) {
+            auto& p = inFlight.at(i);
+            try {
+                if (p->full) {
+                    p->kv->pushFull();
+                } else {
+                    p->kv->pushPartial();
+                }
+            } catch (std::exception& ex) {
+                SPDLOG_ERROR("Background push of {}/{} failed: {}",
+                             p->kv->user,
+                             p->kv->key,
+                             ex.what());
+                results.at(i) = std::current_exception();
+            }
+        }
+
+        // Only complete the pushes once they're no longer counted as pending
+        std::vector<std::shared_ptr<PendingPush>> done;
+        {
+            faabric::util::UniqueLock lock(mx);
+            done.swap(inFlight);
+        }
+
+        for (size_t i = 0; i < done.size(); i++) {
+            if (results.at(i) == nullptr) {
+                done.at(i)->promise.set_value();
+            } else {
+                done.at(i)->promise.set_exception(results.at(i));
+            }
+        }
+    }
+}
+}
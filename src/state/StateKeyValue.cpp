@@ -1,4 +1,5 @@
 #include <faabric/state/StateKeyValue.h>
+#include <faabric/state/StateMemoryTracker.h>
 #include <faabric/util/config.h>
 #include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
@@ -6,14 +7,17 @@
 #include <faabric/util/memory.h>
 #include <faabric/util/timing.h>
 
+#include <algorithm>
 #include <cstring>
 #include <sys/mman.h>
 
 using namespace faabric::util;
 
-#define ONES_BITMASK 0b11111111
-
 namespace faabric::state {
+
+// Innermost pin scope open on this thread
+static thread_local StatePinScope* currentPinScope = nullptr;
+
 StateKeyValue::StateKeyValue(const std::string& userIn,
                              const std::string& keyIn)
   : StateKeyValue(userIn, keyIn, 0)
@@ -43,11 +47,8 @@ void StateKeyValue::configureSize()
     sharedMemSize = nHostPages * HOST_PAGE_SIZE;
     sharedMemory = nullptr;
 
-    dirtyMask = std::make_unique<uint8_t[]>(valueSize);
-    zeroDirtyMask();
-
-    pulledMask = std::make_unique<uint8_t[]>(valueSize);
-    ::memset(pulledMask.get(), 0, valueSize);
+    clearDirtyRanges();
+    pulledRanges.clear();
 }
 
 void StateKeyValue::checkSizeConfigured()
@@ -72,15 +73,7 @@ bool StateKeyValue::isChunkPulled(long offset, size_t length)
         return true;
     }
 
-    // TODO - more efficient way of checking this
-    auto pulledMaskBytes = pulledMask.get();
-    for (size_t i = 0; i < length; i++) {
-        if (pulledMaskBytes[offset + i] == 0) {
-            return false;
-        }
-    }
-
-    return true;
+    return pulledRanges.contains(offset, length);
 }
 
 void StateKeyValue::get(uint8_t* buffer)
@@ -94,6 +87,8 @@ void StateKeyValue::get(uint8_t* buffer)
 
 uint8_t* StateKeyValue::get()
 {
+    // Pin before pulling, so an eviction can't slip in between the two
+    pinForThisThread();
     doPull(true);
     return BYTES(sharedMemory);
 }
@@ -109,10 +104,60 @@ void StateKeyValue::getChunk(long offset, uint8_t* buffer, size_t length)
 
 uint8_t* StateKeyValue::getChunk(long offset, long len)
 {
+    pinForThisThread();
     doPullChunk(true, offset, len);
     return BYTES(sharedMemory) + offset;
 }
 
+void StateKeyValue::pinForThisThread()
+{
+    StatePinScope::pinInCurrentScope(this);
+}
+
+StatePinScope::StatePinScope()
+  : parent(currentPinScope)
+{
+    currentPinScope = this;
+}
+
+StatePinScope::~StatePinScope()
+{
+    release();
+}
+
+void StatePinScope::release()
+{
+    if (released) {
+        return;
+    }
+
+    for (auto& [kvPtr, kv] : pinned) {
+        kv->nPins--;
+    }
+    pinned.clear();
+
+    // Scopes end in the reverse order they're opened
+    currentPinScope = parent;
+    released = true;
+}
+
+void StatePinScope::pinInCurrentScope(StateKeyValue* kv)
+{
+    if (currentPinScope == nullptr) {
+        return;
+    }
+
+    // Values not owned by a shared pointer aren't tracked, so never evicted
+    std::shared_ptr<StateKeyValue> kvPtr = kv->weak_from_this().lock();
+    if (kvPtr == nullptr) {
+        return;
+    }
+
+    if (currentPinScope->pinned.try_emplace(kv, std::move(kvPtr)).second) {
+        kv->nPins++;
+    }
+}
+
 std::vector<StateChunk> StateKeyValue::getAllChunks()
 {
     // Divide the whole value up into chunks
@@ -139,6 +184,7 @@ void StateKeyValue::set(const uint8_t* buffer)
     FullLock lock(valueMutex);
     doSet(buffer);
     isDirty = true;
+    chunkModified(0, valueSize);
 }
 
 void StateKeyValue::doSet(const uint8_t* buffer)
@@ -163,10 +209,18 @@ void StateKeyValue::append(const uint8_t* buffer, size_t length)
 }
 
 void StateKeyValue::getAppended(uint8_t* buffer, size_t length, long nValues)
+{
+    getAppendedRange(buffer, length, 0, nValues);
+}
+
+void StateKeyValue::getAppendedRange(uint8_t* buffer,
+                                     size_t length,
+                                     long startIdx,
+                                     long nValues)
 {
     SharedLock lock(valueMutex);
 
-    pullAppendedFromRemote(buffer, length, nValues);
+    pullAppendedFromRemote(buffer, length, startIdx, nValues);
 }
 
 void StateKeyValue::clearAppended()
@@ -213,16 +267,64 @@ void StateKeyValue::doSetChunk(long offset,
     }
 }
 
+void StateKeyValue::checkChunkInBounds(long offset, size_t length)
+{
+    size_t chunkEnd = offset + length;
+    if (offset < 0 || chunkEnd > valueSize) {
+        SPDLOG_ERROR("Merging chunk out of bounds on {}/{} ({} > {})",
+                     user,
+                     key,
+                     chunkEnd,
+                     valueSize);
+        throw std::runtime_error("Attempting to merge chunk out of bounds");
+    }
+}
+
+void StateKeyValue::pushMergeChunk(
+  long offset,
+  const uint8_t* buffer,
+  size_t length,
+  faabric::util::SnapshotDataType dataType,
+  faabric::util::SnapshotMergeOperation operation)
+{
+    checkSizeConfigured();
+    checkChunkInBounds(offset, length);
+
+    // The merge happens wherever the value lives, so concurrent merges from
+    // different hosts don't need to hold the value lock across the round trip
+    pushMergeToRemote(offset, buffer, length, dataType, operation);
+}
+
+void StateKeyValue::mergeChunk(long offset,
+                               const uint8_t* buffer,
+                               size_t length,
+                               faabric::util::SnapshotDataType dataType,
+                               faabric::util::SnapshotMergeOperation operation)
+{
+    checkSizeConfigured();
+    checkChunkInBounds(offset, length);
+
+    FullLock lock(valueMutex);
+
+    allocateChunk(offset, length);
+    faabric::util::applyDiffValues(BYTES(sharedMemory) + offset,
+                                   { buffer, length },
+                                   dataType,
+                                   operation);
+    chunkModified(offset, length);
+}
+
 void StateKeyValue::flagDirty()
 {
     faabric::util::SharedLock lock(valueMutex);
     isDirty = true;
+    chunkModified(0, valueSize);
 }
 
-void StateKeyValue::zeroDirtyMask()
+void StateKeyValue::clearDirtyRanges()
 {
-    checkSizeConfigured();
-    ::memset(dirtyMask.get(), 0, valueSize);
+    faabric::util::UniqueLock lock(dirtyRangesMx);
+    dirtyRanges.clear();
 }
 
 void StateKeyValue::flagChunkDirty(long offset, long len)
@@ -235,8 +337,13 @@ void StateKeyValue::flagChunkDirty(long offset, long len)
 
 void StateKeyValue::markDirtyChunk(long offset, long len)
 {
-    isDirty |= true;
-    ::memset(dirtyMask.get() + offset, ONES_BITMASK, len);
+    {
+        faabric::util::UniqueLock lock(dirtyRangesMx);
+        isDirty |= true;
+        dirtyRanges.add(offset, len);
+    }
+
+    chunkModified(offset, len);
 }
 
 size_t StateKeyValue::size() const
@@ -264,6 +371,7 @@ void StateKeyValue::mapSharedMemory(void* destination,
 
     // Full lock to perform the shared mapping
     FullLock lock(valueMutex);
+    nMappings++;
 
     // Ensure the underlying memory is allocated
     size_t offset = pagesOffset * faabric::util::HOST_PAGE_SIZE;
@@ -304,6 +412,9 @@ void StateKeyValue::mapSharedMemory(void* destination,
 void StateKeyValue::unmapSharedMemory(void* mappedAddr)
 {
     FullLock lock(valueMutex);
+    if (nMappings > 0) {
+        nMappings--;
+    }
 
     if (!isPageAligned(mappedAddr)) {
         SPDLOG_ERROR("Attempting to unmap non-page-aligned memory at {} for {}",
@@ -410,8 +521,7 @@ void StateKeyValue::pushPartial()
 {
     checkSizeConfigured();
 
-    auto dirtyMaskBytes = dirtyMask.get();
-    doPushPartial(dirtyMaskBytes);
+    doPushPartial(nullptr);
 }
 
 void StateKeyValue::pushFull()
@@ -435,7 +545,7 @@ void StateKeyValue::pushFull()
 
     // Remove any dirty flags
     isDirty = false;
-    zeroDirtyMask();
+    clearDirtyRanges();
 }
 
 void StateKeyValue::doPull(bool lazy)
@@ -446,24 +556,29 @@ void StateKeyValue::doPull(bool lazy)
     {
         faabric::util::SharedLock lock(valueMutex);
         if (lazy && fullyPulled) {
+            getStateMemoryTracker().recordAccess(this, true, valueSize);
             return;
         }
     }
 
-    // Unique lock on the whole value
-    faabric::util::FullLock lock(valueMutex);
+    {
+        // Unique lock on the whole value
+        faabric::util::FullLock lock(valueMutex);
 
-    // Check again if we need to do this
-    if (lazy && fullyPulled) {
-        return;
-    }
+        // Check again if we need to do this
+        if (lazy && fullyPulled) {
+            return;
+        }
 
-    // Make sure storage is allocated
-    allocateChunk(0, sharedMemSize);
+        // Make sure storage is allocated
+        allocateChunk(0, sharedMemSize);
 
-    // Do the pull
-    pullFromRemote();
-    fullyPulled = true;
+        // Do the pull
+        pullFromRemote();
+        fullyPulled = true;
+    }
+
+    getStateMemoryTracker().recordAccess(this, false, valueSize);
 }
 
 void StateKeyValue::doPullChunk(bool lazy, long offset, size_t length)
@@ -485,28 +600,102 @@ void StateKeyValue::doPullChunk(bool lazy, long offset, size_t length)
     {
         faabric::util::SharedLock lock(valueMutex);
         if (lazy && isChunkPulled(offset, length)) {
+            getStateMemoryTracker().recordAccess(this, true, getPulledBytes());
             return;
         }
     }
 
-    // Unique lock
-    faabric::util::FullLock lock(valueMutex);
+    size_t pulledBytes = 0;
+    {
+        // Unique lock
+        faabric::util::FullLock lock(valueMutex);
 
-    // Check condition again
-    if (lazy && isChunkPulled(offset, length)) {
-        return;
+        // Check condition again
+        if (lazy && isChunkPulled(offset, length)) {
+            return;
+        }
+
+        // Allocate the required memory
+        allocateChunk(offset, length);
+
+        // Pull from remote
+        pullChunkFromRemote(offset, length);
+
+        // Mark the chunk as pulled
+        pulledRanges.add(offset, length);
+        pulledBytes = getPulledBytes();
     }
 
-    // Allocate the required memory
-    allocateChunk(offset, length);
+    getStateMemoryTracker().recordAccess(this, false, pulledBytes);
+}
+
+size_t StateKeyValue::getPulledBytes()
+{
+    if (fullyPulled) {
+        return valueSize;
+    }
+
+    size_t pulledBytes = 0;
+    for (const auto& [offset, length] : pulledRanges.getRanges()) {
+        pulledBytes += length;
+    }
+
+    return pulledBytes;
+}
 
-    // Pull from remote
-    pullChunkFromRemote(offset, length);
+size_t StateKeyValue::evict()
+{
+    // Values in use are left alone rather than waited for
+    FullLock lock(valueMutex, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return 0;
+    }
+
+    if (isDirty || nMappings > 0 || nPins > 0 || sharedMemory == nullptr ||
+        !canEvict()) {
+        return 0;
+    }
+
+    size_t freedBytes = getPulledBytes();
+    if (freedBytes == 0) {
+        return 0;
+    }
+
+    // The memory is shared, so MADV_DONTNEED would leave the pages in place,
+    // and we can only release the parts that have been made writable
+    std::vector<std::pair<size_t, size_t>> ranges;
+    if (fullyPulled) {
+        ranges.emplace_back(0, sharedMemSize);
+    } else {
+        ranges = pulledRanges.getRanges();
+    }
+
+    for (const auto& [offset, length] : ranges) {
+        AlignedChunk chunk = getPageAlignedChunk(offset, length);
+        int res = madvise(BYTES(sharedMemory) + chunk.nBytesOffset,
+                          chunk.nBytesLength,
+                          MADV_REMOVE);
+        if (res != 0) {
+            SPDLOG_ERROR("Failed to release memory of {}/{}: {} ({})",
+                         user,
+                         key,
+                         errno,
+                         strerror(errno));
+            throw std::runtime_error("Failed to release state memory");
+        }
+    }
 
-    // Mark the chunk as pulled
-    ::memset(pulledMask.get() + offset, ONES_BITMASK, length);
+    pulledRanges.clear();
+    fullyPulled = false;
+    valueEvicted();
+
+    return freedBytes;
 }
 
+/**
+ * Pushes the chunks set in the given mask, or the chunks flagged as dirty on
+ * this value if the mask is null.
+ */
 void StateKeyValue::doPushPartial(const uint8_t* dirtyMaskBytes)
 {
     // Ignore if not dirty
@@ -524,11 +713,15 @@ void StateKeyValue::doPushPartial(const uint8_t* dirtyMaskBytes)
         return;
     }
 
-    // Work out what's dirty
-    const std::vector<StateChunk>& chunks = getDirtyChunks(dirtyMaskBytes);
-
-    // Zero the mask now that we're finished with it
-    ::memset((void*)dirtyMaskBytes, 0, valueSize);
+    // Work out what's dirty, and reset it now that we're finished with it
+    std::vector<StateChunk> chunks;
+    if (dirtyMaskBytes == nullptr) {
+        chunks = getDirtyChunks();
+        clearDirtyRanges();
+    } else {
+        chunks = getDirtyChunks(dirtyMaskBytes);
+        ::memset((void*)dirtyMaskBytes, 0, valueSize);
+    }
 
     // Push
     pushPartialToRemote(chunks);
@@ -542,6 +735,85 @@ void StateKeyValue::doPushPartial(const uint8_t* dirtyMaskBytes)
     isDirty = false;
 }
 
+/**
+ * Values are locked in address order, so concurrent batches covering the same
+ * values can't deadlock.
+ */
+static std::vector<StateKeyValue*> getSortedValues(const StateKeyValueList& kvs)
+{
+    std::vector<StateKeyValue*> sorted;
+    sorted.reserve(kvs.size());
+    for (const auto& kv : kvs) {
+        sorted.push_back(kv.get());
+    }
+
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    return sorted;
+}
+
+void StateKeyValue::pullMultiple(
+  const StateKeyValueList& kvs,
+  const std::function<void(const std::vector<StateKeyValue*>&)>& pullAll)
+{
+    std::vector<StateKeyValue*> sorted = getSortedValues(kvs);
+
+    {
+        std::vector<FullLock> locks;
+        locks.reserve(sorted.size());
+        for (auto* kv : sorted) {
+            kv->checkSizeConfigured();
+            locks.emplace_back(kv->valueMutex);
+            kv->allocateChunk(0, kv->sharedMemSize);
+        }
+
+        pullAll(sorted);
+
+        for (auto* kv : sorted) {
+            kv->fullyPulled = true;
+        }
+    }
+
+    for (auto* kv : sorted) {
+        getStateMemoryTracker().recordAccess(kv, false, kv->valueSize);
+    }
+}
+
+/**
+ * Pushes the dirty chunks of all the values together. Unlike pushPartial, the
+ * values are not pulled again afterwards.
+ */
+void StateKeyValue::pushMultiple(
+  const StateKeyValueList& kvs,
+  const std::function<void(const DirtyStateChunks&)>& pushAll)
+{
+    std::vector<StateKeyValue*> sorted = getSortedValues(kvs);
+
+    std::vector<FullLock> locks;
+    locks.reserve(sorted.size());
+    DirtyStateChunks dirtyChunks;
+    for (auto* kv : sorted) {
+        locks.emplace_back(kv->valueMutex);
+        if (!kv->isDirty) {
+            continue;
+        }
+
+        dirtyChunks.emplace_back(kv, kv->getDirtyChunks());
+        kv->clearDirtyRanges();
+    }
+
+    if (dirtyChunks.empty()) {
+        return;
+    }
+
+    pushAll(dirtyChunks);
+
+    for (auto& [kv, chunks] : dirtyChunks) {
+        kv->isDirty = false;
+    }
+}
+
 uint32_t StateKeyValue::waitOnRedisRemoteLock(const std::string& redisKey)
 {
     PROF_START(remoteLock)
@@ -589,6 +861,26 @@ void StateKeyValue::unlockWrite()
     valueMutex.unlock();
 }
 
+std::vector<StateChunk> StateKeyValue::getDirtyChunks()
+{
+    std::vector<StateChunk> chunks;
+    auto sharedMemoryBytes = BYTES(sharedMemory);
+
+    faabric::util::UniqueLock lock(dirtyRangesMx);
+    for (const auto& [offset, length] : dirtyRanges.getRanges()) {
+        // Chunks may be flagged beyond the end of the value, in the rest of
+        // the allocated memory, but we only push the value itself
+        if (offset >= valueSize) {
+            break;
+        }
+
+        size_t chunkLength = std::min(length, valueSize - offset);
+        chunks.emplace_back(offset, chunkLength, sharedMemoryBytes + offset);
+    }
+
+    return chunks;
+}
+
 std::vector<StateChunk> StateKeyValue::getDirtyChunks(
   const uint8_t* dirtyMaskBytes)
 {
@@ -0,0 +1,97 @@
+#include <faabric/state/StateKeyValue.h>
+#include <faabric/state/StateMemoryTracker.h>
+#include <faabric/util/config.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+
+namespace faabric::state {
+
+StateMemoryTracker& getStateMemoryTracker()
+{
+    static StateMemoryTracker tracker;
+    return tracker;
+}
+
+void StateMemoryTracker::recordAccess(StateKeyValue* kv,
+                                      bool hit,
+                                      size_t residentBytes)
+{
+    faabric::util::UniqueLock lock(mx);
+
+    if (hit) {
+        stats.hits++;
+    } else {
+        stats.misses++;
+    }
+
+    // Values that can't be evicted aren't tracked
+    std::weak_ptr<StateKeyValue> weakKv = kv->weak_from_this();
+    if (weakKv.expired() || !kv->canEvict()) {
+        return;
+    }
+
+    auto it = lruIndex.find(kv);
+    if (it != lruIndex.end()) {
+        stats.residentBytes -= it->second->bytes;
+        lru.erase(it->second);
+    }
+
+    lru.push_front({ weakKv, kv, residentBytes });
+    lruIndex[kv] = lru.begin();
+    stats.residentBytes += residentBytes;
+
+    if (!hit) {
+        evictIfNeeded(kv);
+    }
+}
+
+void StateMemoryTracker::evictIfNeeded(StateKeyValue* accessed)
+{
+    size_t limitBytes =
+      (size_t)faabric::util::getSystemConfig().stateMemoryLimitMb * 1024 * 1024;
+    if (limitBytes == 0) {
+        return;
+    }
+
+    auto it = lru.end();
+    while (stats.residentBytes > limitBytes && it != lru.begin()) {
+        --it;
+        if (it->kvPtr == accessed) {
+            continue;
+        }
+
+        // Values that are in use are skipped rather than waited for
+        std::shared_ptr<StateKeyValue> kv = it->kv.lock();
+        if (kv != nullptr && kv->evict() == 0) {
+            continue;
+        }
+
+        if (kv != nullptr) {
+            SPDLOG_DEBUG("Evicted {} bytes of {}/{} from state memory",
+                         it->bytes,
+                         kv->user,
+                         kv->key);
+            stats.evictions++;
+            stats.evictedBytes += it->bytes;
+        }
+
+        stats.residentBytes -= it->bytes;
+        lruIndex.erase(it->kvPtr);
+        it = lru.erase(it);
+    }
+}
+
+StateCacheStats StateMemoryTracker::getStats()
+{
+    faabric::util::UniqueLock lock(mx);
+    return stats;
+}
+
+void StateMemoryTracker::clear()
+{
+    faabric::util::UniqueLock lock(mx);
+    lru.clear();
+    lruIndex.clear();
+    stats = StateCacheStats();
+}
+}
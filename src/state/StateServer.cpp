@@ -6,6 +6,7 @@
 #include <faabric/util/config.h>
 #include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
+#include <faabric/util/snapshot.h>
 
 #define KV_FROM_REQUEST(request)                                               \
     auto kv = std::static_pointer_cast<InMemoryStateKeyValue>(                 \
@@ -37,6 +38,21 @@ std::unique_ptr<google::protobuf::Message> StateServer::doSyncRecv(
         case faabric::state::StateCalls::Push: {
             return recvPush(message.udata(), message.size());
         }
+        case faabric::state::StateCalls::PushChunks: {
+            return recvPushChunks(message);
+        }
+        case faabric::state::StateCalls::PushMerge: {
+            return recvPushMerge(message);
+        }
+        case faabric::state::StateCalls::ValidateChunks: {
+            return recvValidateChunks(message.udata(), message.size());
+        }
+        case faabric::state::StateCalls::PullMultiple: {
+            return recvPullMultiple(message.udata(), message.size());
+        }
+        case faabric::state::StateCalls::PushMultiple: {
+            return recvPushMultiple(message);
+        }
         case faabric::state::StateCalls::Size: {
             return recvSize(message.udata(), message.size());
         }
@@ -92,14 +108,17 @@ std::unique_ptr<google::protobuf::Message> StateServer::recvPull(
     KV_FROM_REQUEST(parsedMsg)
     uint64_t chunkOffset = parsedMsg.offset();
     uint64_t chunkLen = parsedMsg.chunksize();
-    uint8_t* chunk = kv->getChunk(chunkOffset, chunkLen);
 
     auto response = std::make_unique<faabric::StatePart>();
     response->set_user(parsedMsg.user());
     response->set_key(parsedMsg.key());
     response->set_offset(chunkOffset);
-    // TODO: avoid copying here
-    response->set_data(chunk, chunkLen);
+
+    // Copy straight into the response rather than holding a pointer into the
+    // value, which would need pinning on this server thread
+    std::string* data = response->mutable_data();
+    data->resize(chunkLen);
+    kv->getChunk(chunkOffset, BYTES(data->data()), chunkLen);
 
     return response;
 }
@@ -126,6 +145,153 @@ std::unique_ptr<google::protobuf::Message> StateServer::recvPush(
     return response;
 }
 
+std::unique_ptr<google::protobuf::Message> StateServer::recvPushChunks(
+  transport::Message& message)
+{
+    PARSE_MSG(faabric::StatePushChunksRequest, message.udata(), message.size())
+
+    std::vector<std::span<const uint8_t>> chunksData = message.getParts();
+    if (chunksData.size() != (size_t)parsedMsg.offsets_size()) {
+        SPDLOG_ERROR("Push to {}/{} has {} offsets but {} chunks",
+                     parsedMsg.user(),
+                     parsedMsg.key(),
+                     parsedMsg.offsets_size(),
+                     chunksData.size());
+        throw std::runtime_error("Mismatched state chunks");
+    }
+
+    SPDLOG_TRACE("Received push of {} chunks to {}/{}",
+                 chunksData.size(),
+                 parsedMsg.user(),
+                 parsedMsg.key());
+
+    KV_FROM_REQUEST(parsedMsg)
+    for (size_t i = 0; i < chunksData.size(); i++) {
+        kv->setChunk(parsedMsg.offsets(i),
+                     chunksData.at(i).data(),
+                     chunksData.at(i).size());
+    }
+
+    return std::make_unique<faabric::EmptyResponse>();
+}
+
+std::unique_ptr<google::protobuf::Message> StateServer::recvPushMerge(
+  transport::Message& message)
+{
+    PARSE_MSG(faabric::StateMergeRequest, message.udata(), message.size())
+
+    std::vector<std::span<const uint8_t>> mergeData = message.getParts();
+    if (mergeData.size() != 1) {
+        SPDLOG_ERROR("Merge to {}/{} has {} parts, expected one",
+                     parsedMsg.user(),
+                     parsedMsg.key(),
+                     mergeData.size());
+        throw std::runtime_error("Invalid state merge");
+    }
+
+    auto dataType =
+      static_cast<faabric::util::SnapshotDataType>(parsedMsg.datatype());
+    auto operation =
+      static_cast<faabric::util::SnapshotMergeOperation>(parsedMsg.mergeop());
+
+    SPDLOG_TRACE("Received {} {} merge {}/{} ({}->{})",
+                 faabric::util::snapshotDataTypeStr(dataType),
+                 faabric::util::snapshotMergeOpStr(operation),
+                 parsedMsg.user(),
+                 parsedMsg.key(),
+                 parsedMsg.offset(),
+                 parsedMsg.offset() + mergeData.at(0).size());
+
+    // Merges are applied under the value's lock, so concurrent merges from
+    // many clients are all applied in full
+    KV_FROM_REQUEST(parsedMsg)
+    kv->mergeChunk(parsedMsg.offset(),
+                   mergeData.at(0).data(),
+                   mergeData.at(0).size(),
+                   dataType,
+                   operation);
+
+    return std::make_unique<faabric::EmptyResponse>();
+}
+
+std::unique_ptr<google::protobuf::Message> StateServer::recvValidateChunks(
+  const uint8_t* buffer,
+  size_t bufferSize)
+{
+    PARSE_MSG(faabric::StateValidateRequest, buffer, bufferSize)
+
+    SPDLOG_TRACE("Received validate {}/{} ({} chunks)",
+                 parsedMsg.user(),
+                 parsedMsg.key(),
+                 parsedMsg.versions_size());
+
+    KV_FROM_REQUEST(parsedMsg)
+    std::vector<uint64_t> versions(parsedMsg.versions().begin(),
+                                   parsedMsg.versions().end());
+
+    auto response = std::make_unique<faabric::StateValidateResponse>();
+    response->set_epoch(kv->getEpoch());
+    for (const auto& [idx, version] :
+         kv->getChangedChunks(parsedMsg.epoch(), versions)) {
+        response->add_chunkidxs(idx);
+        response->add_versions(version);
+    }
+
+    return response;
+}
+
+std::unique_ptr<google::protobuf::Message> StateServer::recvPullMultiple(
+  const uint8_t* buffer,
+  size_t bufferSize)
+{
+    PARSE_MSG(faabric::StateMultiChunkRequest, buffer, bufferSize)
+
+    SPDLOG_TRACE("Received pull of {} chunks", parsedMsg.chunks_size());
+
+    auto response = std::make_unique<faabric::StateMultiChunkResponse>();
+    for (const auto& chunkReq : parsedMsg.chunks()) {
+        KV_FROM_REQUEST(chunkReq)
+
+        auto* part = response->add_parts();
+        part->set_user(chunkReq.user());
+        part->set_key(chunkReq.key());
+        part->set_offset(chunkReq.offset());
+
+        std::string* data = part->mutable_data();
+        data->resize(chunkReq.chunksize());
+        kv->getChunk(
+          chunkReq.offset(), BYTES(data->data()), chunkReq.chunksize());
+    }
+
+    return response;
+}
+
+std::unique_ptr<google::protobuf::Message> StateServer::recvPushMultiple(
+  transport::Message& message)
+{
+    PARSE_MSG(faabric::StateMultiChunkRequest, message.udata(), message.size())
+
+    std::vector<std::span<const uint8_t>> chunksData = message.getParts();
+    if (chunksData.size() != (size_t)parsedMsg.chunks_size()) {
+        SPDLOG_ERROR("Push has {} chunks but {} parts",
+                     parsedMsg.chunks_size(),
+                     chunksData.size());
+        throw std::runtime_error("Mismatched state chunks");
+    }
+
+    SPDLOG_TRACE("Received push of {} chunks", chunksData.size());
+
+    for (int i = 0; i < parsedMsg.chunks_size(); i++) {
+        const auto& chunkReq = parsedMsg.chunks(i);
+        KV_FROM_REQUEST(chunkReq)
+        kv->setChunk(chunkReq.offset(),
+                     chunksData.at(i).data(),
+                     chunksData.at(i).size());
+    }
+
+    return std::make_unique<faabric::EmptyResponse>();
+}
+
 std::unique_ptr<google::protobuf::Message> StateServer::recvAppend(
   const uint8_t* buffer,
   size_t bufferSize)
@@ -156,12 +322,19 @@ std::unique_ptr<google::protobuf::Message> StateServer::recvPullAppended(
     auto response = std::make_unique<faabric::StateAppendedResponse>();
     response->set_user(parsedMsg.user());
     response->set_key(parsedMsg.key());
-    for (uint32_t i = 0; i < parsedMsg.nvalues(); i++) {
-        AppendedInMemoryState& value = kv->getAppendedValue(i);
-        auto appendedValue = response->add_values();
-        appendedValue->set_data(reinterpret_cast<char*>(value.data.get()),
-                                value.length);
-    }
+
+    // Copy the values out a segment at a time rather than one by one
+    AppendLog& appendLog = kv->getAppendLog();
+    std::string* data = response->mutable_data();
+    data->reserve(
+      appendLog.getRangeBytes(parsedMsg.startidx(), parsedMsg.nvalues()));
+    appendLog.visitRange(parsedMsg.startidx(),
+                         parsedMsg.nvalues(),
+                         [data](std::span<const uint8_t> slice) {
+                             data->append(
+                               reinterpret_cast<const char*>(slice.data()),
+                               slice.size());
+                         });
 
     return response;
 }
@@ -172,9 +345,11 @@ std::unique_ptr<google::protobuf::Message> StateServer::recvDelete(
 {
     PARSE_MSG(faabric::StateRequest, buffer, bufferSize)
 
-    // Delete value
+    // Only delete our copy, as the sender takes care of any other hosts
     SPDLOG_TRACE("Received delete {}/{}", parsedMsg.user(), parsedMsg.key());
-    state.deleteKV(parsedMsg.user(), parsedMsg.key());
+    state.deleteKVLocally(parsedMsg.user(), parsedMsg.key());
+    getInMemoryStateRegistry().deleteShardInfo(
+      parsedMsg.user(), parsedMsg.key(), false);
 
     auto response = std::make_unique<faabric::StateResponse>();
     return response;
@@ -0,0 +1,360 @@
+#include <faabric/transport/ConnectionPool.h>
+#include <faabric/transport/MessageEndpoint.h>
+#include <faabric/util/config.h>
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/timing.h>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace faabric::transport {
+
+ConnectionPool::ConnectionPool(const std::string& hostIn,
+                               int asyncPortIn,
+                               int syncPortIn,
+                               int nConnectionsIn,
+                               int timeoutMsIn)
+  : host(hostIn)
+  , asyncPort(asyncPortIn)
+  , syncPort(syncPortIn)
+  , nConnections(nConnectionsIn)
+  , timeoutMs(timeoutMsIn)
+{
+    if (nConnections <= 0) {
+        SPDLOG_ERROR("Invalid connection pool size for {}: {}",
+                     host,
+                     nConnections);
+        throw std::runtime_error("Invalid connection pool size");
+    }
+
+    wakeFd = eventfd(0, EFD_NONBLOCK);
+    if (wakeFd < 0) {
+        SPDLOG_ERROR("Failed to create eventfd for connection pool to {}",
+                     host);
+        throw std::runtime_error("Failed to create eventfd");
+    }
+
+    // Wait for the sockets to be set up before returning
+    std::shared_ptr<faabric::util::Latch> startupLatch =
+      faabric::util::Latch::create(2);
+
+    ioThread = std::jthread([this, startupLatch] { run(startupLatch); });
+
+    startupLatch->wait();
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    stop();
+
+    close(wakeFd);
+}
+
+void ConnectionPool::stop()
+{
+    if (stopped.exchange(true)) {
+        return;
+    }
+
+    SPDLOG_DEBUG("Stopping connection pool to {}", host);
+
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(uint64_t)) != sizeof(uint64_t)) {
+        SPDLOG_ERROR("Failed to wake connection pool to {}", host);
+    }
+
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+}
+
+int ConnectionPool::getConnectionCount() const
+{
+    // One async socket plus the sync sockets
+    return nConnections + 1;
+}
+
+void ConnectionPool::asyncSend(uint8_t header,
+                               const uint8_t* data,
+                               size_t dataSize,
+                               int sequenceNum)
+{
+    PoolRequest request;
+    request.header = header;
+    request.sequenceNum = sequenceNum;
+    request.data.assign(data, data + dataSize);
+
+    submit(std::move(request));
+}
+
+Message ConnectionPool::syncSend(uint8_t header,
+                                 const uint8_t* data,
+                                 size_t dataSize,
+                                 const MessageParts& parts)
+{
+    std::future<Message> response = submitSync(header, data, dataSize, parts);
+    return awaitResponse(response);
+}
+
+std::future<Message> ConnectionPool::submitSync(uint8_t header,
+                                                const uint8_t* data,
+                                                size_t dataSize,
+                                                const MessageParts& parts)
+{
+    // The caller may reuse its buffers as soon as we time out, so the parts
+    // can't be sent from the caller's memory
+    SharedMessageParts sharedParts;
+    sharedParts.reserve(parts.size());
+    for (const auto& p : parts) {
+        auto copy = std::make_shared<std::vector<uint8_t>>(p.begin(), p.end());
+        sharedParts.push_back({ *copy, copy });
+    }
+
+    return submitSync(header, data, dataSize, std::move(sharedParts));
+}
+
+std::future<Message> ConnectionPool::submitSync(uint8_t header,
+                                                const uint8_t* data,
+                                                size_t dataSize,
+                                                SharedMessageParts parts)
+{
+    PoolRequest request;
+    request.header = header;
+    request.data.assign(data, data + dataSize);
+    request.parts = std::move(parts);
+    request.response = std::make_unique<std::promise<Message>>();
+
+    std::future<Message> response = request.response->get_future();
+    submit(std::move(request));
+
+    return response;
+}
+
+Message ConnectionPool::awaitResponse(std::future<Message>& response)
+{
+    if (response.wait_for(std::chrono::milliseconds(timeoutMs)) ==
+        std::future_status::timeout) {
+        SPDLOG_ERROR("Timed out waiting for response from {}:{}",
+                     host,
+                     syncPort);
+        throw MessageTimeoutException("Timed out waiting for response");
+    }
+
+    return response.get();
+}
+
+void ConnectionPool::submit(PoolRequest&& request)
+{
+    if (stopped) {
+        SPDLOG_ERROR("Submitting request to stopped connection pool to {}",
+                     host);
+        throw std::runtime_error("Connection pool stopped");
+    }
+
+    submissions.enqueue(std::move(request));
+
+    // Only the first submission since the I/O thread last woke up needs to
+    // wake it again
+    if (!wakePending.exchange(true)) {
+        uint64_t one = 1;
+        if (write(wakeFd, &one, sizeof(uint64_t)) != sizeof(uint64_t)) {
+            SPDLOG_ERROR("Failed to wake connection pool to {}", host);
+            throw std::runtime_error("Failed to wake connection pool");
+        }
+    }
+}
+
+void ConnectionPool::run(std::shared_ptr<faabric::util::Latch> startupLatch)
+{
+    struct PendingResponse
+    {
+        std::unique_ptr<std::promise<Message>> response;
+        faabric::util::TimePoint sent;
+    };
+
+    // All sockets are created, used and closed on this thread
+    {
+        AsyncSendMessageEndpoint asyncEndpoint(host, asyncPort, timeoutMs);
+
+        std::vector<std::unique_ptr<SyncDealerMessageEndpoint>> syncEndpoints;
+        for (int i = 0; i < nConnections; i++) {
+            syncEndpoints.emplace_back(
+              std::make_unique<SyncDealerMessageEndpoint>(
+                host, syncPort, timeoutMs));
+        }
+
+        std::vector<zmq::pollitem_t> pollItems;
+        pollItems.push_back({ nullptr, wakeFd, ZMQ_POLLIN, 0 });
+        for (auto& e : syncEndpoints) {
+            pollItems.push_back({ e->socket.handle(), 0, ZMQ_POLLIN, 0 });
+        }
+
+        SPDLOG_DEBUG("Opened {} pooled connections to {}",
+                     getConnectionCount(),
+                     host);
+
+        startupLatch->wait();
+
+        std::unordered_map<uint64_t, PendingResponse> pending;
+        std::vector<PoolRequest> requests;
+        uint64_t nextRequestId = 0;
+        int nextConnection = 0;
+
+        while (!stopped) {
+            zmq::poll(pollItems.data(),
+                      pollItems.size(),
+                      std::chrono::milliseconds(timeoutMs));
+
+            if (pollItems.at(0).revents & ZMQ_POLLIN) {
+                uint64_t count;
+                if (read(wakeFd, &count, sizeof(uint64_t)) < 0) {
+                    SPDLOG_ERROR("Failed to read eventfd for {}", host);
+                }
+            }
+
+            // Send everything submitted since we last woke up. We must reset
+            // the flag before taking the requests so none get missed
+            wakePending = false;
+            requests.clear();
+            submissions.dequeueAll(requests);
+
+            for (auto& r : requests) {
+                if (r.response == nullptr) {
+                    try {
+                        asyncEndpoint.send(r.header,
+                                           r.data.data(),
+                                           r.data.size(),
+                                           r.sequenceNum);
+                    } catch (std::exception& ex) {
+                        SPDLOG_ERROR("Failed pooled async send to {}: {}",
+                                     host,
+                                     ex.what());
+                    }
+
+                    continue;
+                }
+
+                uint64_t requestId = nextRequestId++;
+                try {
+                    syncEndpoints.at(nextConnection)
+                      ->sendRequest(requestId,
+                                    r.header,
+                                    r.data.data(),
+                                    r.data.size(),
+                                    r.parts);
+                } catch (std::exception& ex) {
+                    r.response->set_exception(std::current_exception());
+                    continue;
+                }
+
+                // ZeroMQ holds its own references to anything it still needs
+                r.parts.clear();
+
+                nextConnection = (nextConnection + 1) % nConnections;
+                pending.emplace(
+                  requestId,
+                  PendingResponse{ std::move(r.response),
+                                   faabric::util::startTimer() });
+            }
+
+            // Hand out any responses
+            for (int i = 0; i < nConnections; i++) {
+                if (!(pollItems.at(i + 1).revents & ZMQ_POLLIN)) {
+                    continue;
+                }
+
+                uint64_t requestId;
+                Message response =
+                  syncEndpoints.at(i)->recvResponse(requestId);
+                if (response.getResponseCode() !=
+                    MessageResponseCode::SUCCESS) {
+                    continue;
+                }
+
+                auto it = pending.find(requestId);
+                if (it == pending.end()) {
+                    SPDLOG_DEBUG("Dropping late response {} from {}",
+                                 requestId,
+                                 host);
+                    continue;
+                }
+
+                it->second.response->set_value(std::move(response));
+                pending.erase(it);
+            }
+
+            // Forget requests whose callers have already given up
+            std::erase_if(pending, [this](const auto& p) {
+                return faabric::util::getTimeDiffMillis(p.second.sent) >
+                       timeoutMs;
+            });
+        }
+
+        // Fail anything still waiting
+        for (auto& p : pending) {
+            p.second.response->set_exception(std::make_exception_ptr(
+              std::runtime_error("Connection pool stopped")));
+        }
+    }
+
+    SPDLOG_DEBUG("Closed pooled connections to {}", host);
+}
+
+// -----------------------------------
+// Global pools
+// -----------------------------------
+
+static std::unordered_map<std::string, std::shared_ptr<ConnectionPool>> pools;
+
+static std::shared_mutex poolsMx;
+
+/**
+ * Pools are shared by everything talking to the same host and ports. The
+ * number of connections defaults to the client pool size in the config, and
+ * is fixed by whichever caller creates the pool.
+ */
+std::shared_ptr<ConnectionPool> getConnectionPool(const std::string& host,
+                                                  int asyncPort,
+                                                  int syncPort,
+                                                  int nConnections)
+{
+    std::string key =
+      host + ":" + std::to_string(asyncPort) + ":" + std::to_string(syncPort);
+
+    {
+        faabric::util::SharedLock lock(poolsMx);
+        auto it = pools.find(key);
+        if (it != pools.end()) {
+            return it->second;
+        }
+    }
+
+    faabric::util::FullLock lock(poolsMx);
+    if (pools.find(key) == pools.end()) {
+        SPDLOG_DEBUG("Creating connection pool for {}", key);
+        if (nConnections <= 0) {
+            nConnections =
+              faabric::util::getSystemConfig().transportClientPoolSize;
+        }
+
+        pools.emplace(key,
+                      std::make_shared<ConnectionPool>(
+                        host, asyncPort, syncPort, nConnections));
+    }
+
+    return pools.at(key);
+}
+
+void clearConnectionPools()
+{
+    faabric::util::FullLock lock(poolsMx);
+
+    for (auto& p : pools) {
+        p.second->stop();
+    }
+
+    pools.clear();
+}
+}
@@ -30,4 +30,20 @@ int Message::size()
 {
     return buffer.size();
 }
+
+void Message::addPart(zmq::message_t&& part)
+{
+    parts.emplace_back(std::make_unique<zmq::message_t>(std::move(part)));
+}
+
+std::vector<std::span<const uint8_t>> Message::getParts() const
+{
+    std::vector<std::span<const uint8_t>> spans;
+    spans.reserve(parts.size());
+    for (const auto& p : parts) {
+        spans.emplace_back(p->data<uint8_t>(), p->size());
+    }
+
+    return spans;
+}
 }
@@ -3,10 +3,14 @@
 #include <faabric/transport/common.h>
 #include <faabric/transport/context.h>
 #include <faabric/util/bytes.h>
+#include <faabric/util/config.h>
 #include <faabric/util/gids.h>
+#include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
+#include <faabric/util/timing.h>
 
+#include <condition_variable>
 #include <unistd.h>
 
 #define RETRY_SLEEP_MS 1000
@@ -49,6 +53,36 @@
 
 namespace faabric::transport {
 
+/**
+ * Counts the zero-copy frames that ZeroMQ has not yet released. ZeroMQ may
+ * release a frame from its own threads at any point, so each frame holds a
+ * reference to the tracker rather than to the endpoint.
+ */
+struct ZeroCopyTracker
+{
+    std::mutex mx;
+    std::condition_variable cv;
+    int inFlight = 0;
+};
+
+static void releaseZeroCopyFrame(void* data, void* hint)
+{
+    auto* tracker = static_cast<std::shared_ptr<ZeroCopyTracker>*>(hint);
+
+    {
+        faabric::util::UniqueLock lock((*tracker)->mx);
+        (*tracker)->inFlight--;
+        (*tracker)->cv.notify_all();
+    }
+
+    delete tracker;
+}
+
+static void releaseSharedFrame(void* data, void* hint)
+{
+    delete static_cast<std::shared_ptr<const void>*>(hint);
+}
+
 /**
  * This is where we set up all our sockets. It handles setting timeouts and
  * catching errors in the creation process, as well as logging and validating
@@ -132,6 +166,13 @@ zmq::socket_t socketFactory(zmq::socket_type socketType,
         }
         case (MessageEndpointConnectType::CONNECT): {
             switch (socketType) {
+                case zmq::socket_type::dealer: {
+                    SPDLOG_TRACE("Connect socket: dealer {} (timeout {}ms)",
+                                 address,
+                                 timeoutMs);
+                    CATCH_ZMQ_ERR_RETRY_ONCE(socket.connect(address), "connect")
+                    break;
+                }
                 case zmq::socket_type::pair: {
                     SPDLOG_TRACE("Connect socket: pair {} (timeout {}ms)",
                                  address,
@@ -226,11 +267,10 @@ zmq::socket_t MessageEndpoint::setUpSocket(
     return socketFactory(socketType, connectType, timeoutMs, address);
 }
 
-void MessageEndpoint::sendMessage(zmq::socket_t& socket,
-                                  uint8_t header,
-                                  const uint8_t* data,
-                                  size_t dataSize,
-                                  int sequenceNum)
+void MessageEndpoint::sendHeader(zmq::socket_t& socket,
+                                 uint8_t header,
+                                 size_t dataSize,
+                                 int sequenceNum)
 {
     uint8_t buffer[HEADER_MSG_SIZE];
     faabric::util::unalignedWrite<uint8_t>(header, buffer);
@@ -239,9 +279,149 @@ void MessageEndpoint::sendMessage(zmq::socket_t& socket,
       sequenceNum, buffer + sizeof(uint8_t) + sizeof(size_t));
 
     sendBuffer(socket, buffer, HEADER_MSG_SIZE, true);
+}
+
+void MessageEndpoint::sendMessage(zmq::socket_t& socket,
+                                  uint8_t header,
+                                  const uint8_t* data,
+                                  size_t dataSize,
+                                  int sequenceNum)
+{
+    sendHeader(socket, header, dataSize, sequenceNum);
     sendBuffer(socket, data, dataSize, false);
 }
 
+/**
+ * Sends the message body followed by each of the parts in its own frame, so
+ * the caller doesn't have to assemble them into a single buffer. With
+ * zero-copy, ZeroMQ reads large parts straight from the caller's memory, so
+ * the caller must not modify it until awaitZeroCopyRelease has returned.
+ */
+void MessageEndpoint::sendMessageParts(zmq::socket_t& socket,
+                                       uint8_t header,
+                                       const uint8_t* data,
+                                       size_t dataSize,
+                                       const MessageParts& parts,
+                                       bool zeroCopy)
+{
+    sendHeader(socket, header, dataSize, NO_SEQUENCE_NUM);
+    sendBuffer(socket, data, dataSize, !parts.empty());
+
+    for (size_t i = 0; i < parts.size(); i++) {
+        bool more = i < parts.size() - 1;
+        if (zeroCopy && parts.at(i).size() >= MIN_ZERO_COPY_BYTES) {
+            sendZeroCopy(socket, parts.at(i), more);
+        } else {
+            sendBuffer(socket, parts.at(i).data(), parts.at(i).size(), more);
+        }
+    }
+}
+
+/**
+ * Like sendMessageParts, but large parts are always sent without copying, and
+ * hold a reference to their owner until ZeroMQ is done with them. The caller
+ * doesn't need to wait for anything before moving on.
+ */
+void MessageEndpoint::sendSharedMessageParts(zmq::socket_t& socket,
+                                             uint8_t header,
+                                             const uint8_t* data,
+                                             size_t dataSize,
+                                             const SharedMessageParts& parts)
+{
+    sendHeader(socket, header, dataSize, NO_SEQUENCE_NUM);
+    sendBuffer(socket, data, dataSize, !parts.empty());
+
+    for (size_t i = 0; i < parts.size(); i++) {
+        const SharedMessagePart& part = parts.at(i);
+        bool more = i < parts.size() - 1;
+        if (part.data.size() < MIN_ZERO_COPY_BYTES) {
+            sendBuffer(socket, part.data.data(), part.data.size(), more);
+            continue;
+        }
+
+        zmq::message_t msg(const_cast<uint8_t*>(part.data.data()),
+                           part.data.size(),
+                           &releaseSharedFrame,
+                           new std::shared_ptr<const void>(part.owner));
+
+        zmq::send_flags sendFlags =
+          more ? zmq::send_flags::sndmore : zmq::send_flags::none;
+
+        CATCH_ZMQ_ERR(
+          {
+              auto res = socket.send(msg, sendFlags);
+              if (res != part.data.size()) {
+                  SPDLOG_ERROR("Sent different bytes than expected (sent "
+                               "{}, expected {})",
+                               res.value_or(0),
+                               part.data.size());
+                  throw std::runtime_error("Error sending message");
+              }
+          },
+          "send_shared")
+    }
+}
+
+void MessageEndpoint::sendZeroCopy(zmq::socket_t& socket,
+                                   std::span<const uint8_t> part,
+                                   bool more)
+{
+    assert(tid == std::this_thread::get_id());
+
+    if (zeroCopyTracker == nullptr) {
+        zeroCopyTracker = std::make_shared<ZeroCopyTracker>();
+    }
+
+    {
+        faabric::util::UniqueLock lock(zeroCopyTracker->mx);
+        zeroCopyTracker->inFlight++;
+    }
+
+    // ZeroMQ calls the release function once it no longer needs the data,
+    // including if the send fails
+    zmq::message_t msg(const_cast<uint8_t*>(part.data()),
+                       part.size(),
+                       &releaseZeroCopyFrame,
+                       new std::shared_ptr<ZeroCopyTracker>(zeroCopyTracker));
+
+    zmq::send_flags sendFlags =
+      more ? zmq::send_flags::sndmore : zmq::send_flags::none;
+
+    CATCH_ZMQ_ERR(
+      {
+          auto res = socket.send(msg, sendFlags);
+          if (res != part.size()) {
+              SPDLOG_ERROR("Sent different bytes than expected (sent "
+                           "{}, expected {})",
+                           res.value_or(0),
+                           part.size());
+              throw std::runtime_error("Error sending message");
+          }
+      },
+      "send_zero_copy")
+}
+
+void MessageEndpoint::awaitZeroCopyRelease()
+{
+    if (zeroCopyTracker == nullptr) {
+        return;
+    }
+
+    faabric::util::UniqueLock lock(zeroCopyTracker->mx);
+    bool released = zeroCopyTracker->cv.wait_for(
+      lock, std::chrono::milliseconds(timeoutMs), [this] {
+          return zeroCopyTracker->inFlight == 0;
+      });
+
+    if (!released) {
+        SPDLOG_ERROR("{} zero-copy frames on {} not released after {}ms",
+                     zeroCopyTracker->inFlight,
+                     address,
+                     timeoutMs);
+        throw MessageTimeoutException("Zero-copy frames not released");
+    }
+}
+
 Message MessageEndpoint::recvMessage(zmq::socket_t& socket, bool async)
 {
     assert(tid == std::this_thread::get_id());
@@ -268,6 +448,14 @@ Message MessageEndpoint::recvMessage(zmq::socket_t& socket, bool async)
     body.setHeader(header);
     body.setSequenceNum(sequenceNum);
 
+    // Receive any parts sent after the body by a vectored send
+    while (body.getResponseCode() == MessageResponseCode::SUCCESS &&
+           socket.get(zmq::sockopt::rcvmore)) {
+        zmq::message_t part;
+        CATCH_ZMQ_ERR(socket.recv(part), "recv_part")
+        body.addPart(std::move(part));
+    }
+
     if (body.getHeader() == SHUTDOWN_HEADER) {
         if (body.dataCopy() == shutdownPayload) {
             SPDLOG_TRACE("Server thread on {} got shutdown message",
@@ -357,6 +545,17 @@ void MessageEndpoint::sendBuffer(zmq::socket_t& socket,
       "send")
 }
 
+void MessageEndpoint::sendEnvelope(zmq::socket_t& socket,
+                                   const RoutingEnvelope& envelope)
+{
+    for (const auto& frame : envelope) {
+        sendBuffer(socket, frame.data(), frame.size(), true);
+    }
+
+    // Empty delimiter between the envelope and the message
+    sendBuffer(socket, nullptr, 0, true);
+}
+
 // ----------------------------------------------
 // ASYNC SEND ENDPOINT
 // ----------------------------------------------
@@ -436,6 +635,89 @@ Message SyncSendMessageEndpoint::sendAwaitResponse(uint8_t header,
     return msg;
 }
 
+/**
+ * As we block until the response arrives, by which point the server has
+ * received the whole request, it's safe to send the parts without copying.
+ */
+Message SyncSendMessageEndpoint::sendAwaitResponse(uint8_t header,
+                                                   const uint8_t* data,
+                                                   size_t dataSize,
+                                                   const MessageParts& parts)
+{
+    SPDLOG_TRACE(
+      "REQ {} ({} bytes, {} parts)", address, dataSize, parts.size());
+    sendMessageParts(reqSocket, header, data, dataSize, parts, true);
+
+    SPDLOG_TRACE("RECV (REQ) {}", address);
+    Message msg = recvMessage(reqSocket, false);
+    if (msg.getResponseCode() != MessageResponseCode::SUCCESS) {
+        // The request may still be queued, so we have to drop it before the
+        // caller can reuse the memory
+        reqSocket.close();
+        awaitZeroCopyRelease();
+
+        SPDLOG_ERROR("Failed getting response on {}: code {}",
+                     address,
+                     msg.getResponseCode());
+        throw MessageTimeoutException("Error on waiting for response.");
+    }
+
+    awaitZeroCopyRelease();
+
+    return msg;
+}
+
+// ----------------------------------------------
+// SYNC DEALER ENDPOINT
+// ----------------------------------------------
+
+SyncDealerMessageEndpoint::SyncDealerMessageEndpoint(const std::string& hostIn,
+                                                     int portIn,
+                                                     int timeoutMs)
+  : MessageEndpoint(hostIn, portIn, timeoutMs)
+{
+    socket = setUpSocket(zmq::socket_type::dealer,
+                         MessageEndpointConnectType::CONNECT);
+}
+
+void SyncDealerMessageEndpoint::sendRequest(uint64_t requestId,
+                                            uint8_t header,
+                                            const uint8_t* data,
+                                            size_t dataSize,
+                                            const SharedMessageParts& parts)
+{
+    SPDLOG_TRACE(
+      "DEALER {} request {} ({} bytes)", address, requestId, dataSize);
+
+    // The request ID and delimiter make up the envelope the server returns
+    // with the response
+    sendBuffer(socket, BYTES(&requestId), sizeof(uint64_t), true);
+    sendBuffer(socket, nullptr, 0, true);
+    sendSharedMessageParts(socket, header, data, dataSize, parts);
+}
+
+Message SyncDealerMessageEndpoint::recvResponse(uint64_t& requestId)
+{
+    zmq::message_t idFrame;
+    zmq::recv_result_t res;
+    CATCH_ZMQ_ERR(res = socket.recv(idFrame), "recv_request_id")
+    if (!res.has_value()) {
+        return Message(MessageResponseCode::TIMEOUT);
+    }
+
+    zmq::message_t delimiter;
+    CATCH_ZMQ_ERR(res = socket.recv(delimiter), "recv_delimiter")
+    if (idFrame.size() != sizeof(uint64_t) || delimiter.size() != 0) {
+        SPDLOG_ERROR("Malformed response on {}", address);
+        throw std::runtime_error("Malformed response on dealer socket");
+    }
+
+    requestId = faabric::util::unalignedRead<uint64_t>(idFrame.data<uint8_t>());
+
+    SPDLOG_TRACE("DEALER {} response {}", address, requestId);
+    return recvMessage(socket, true);
+}
+
 // ----------------------------------------------
 // RECV ENDPOINT
 // ----------------------------------------------
@@ -452,7 +734,9 @@ RecvMessageEndpoint::RecvMessageEndpoint(std::string inProcLabel,
 RecvMessageEndpoint::RecvMessageEndpoint(int portIn,
                                          int timeoutMs,
                                          zmq::socket_type socketType)
-  : MessageEndpoint(ANY_HOST, portIn, timeoutMs)
+  : MessageEndpoint(faabric::util::getSystemConfig().transportBindHost,
+                    portIn,
+                    timeoutMs)
 {
     socket = setUpSocket(socketType, MessageEndpointConnectType::BIND);
 }
@@ -467,80 +751,6 @@ Message RecvMessageEndpoint::doRecv(bool async)
     return recvMessage(socket, async);
 }
 
-// ----------------------------------------------
-// ASYNC FAN IN AND FAN OUT
-// ----------------------------------------------
-
-FanInMessageEndpoint::FanInMessageEndpoint(int portIn,
-                                           int timeoutMs,
-                                           zmq::socket_type socketType)
-  : RecvMessageEndpoint(portIn, timeoutMs, socketType)
-  , controlSockAddress("inproc://" + std::to_string(portIn) + "-control")
-{
-    // Connect the control sock. Note that even though the control socket lives
-    // longer than the control killer socket, we must *connect* here, not bind.
-    controlSock = socketFactory(zmq::socket_type::sub,
-                                MessageEndpointConnectType::CONNECT,
-                                timeoutMs,
-                                controlSockAddress);
-
-    // Subscribe to all topics
-    controlSock.set(zmq::sockopt::subscribe, zmq::str_buffer(""));
-}
-
-void FanInMessageEndpoint::attachFanOut(zmq::socket_t& fanOutSock)
-{
-    // Useful discussion on proxy_steerable here:
-    // https://github.com/zeromq/cppzmq/issues/478
-    SPDLOG_TRACE("Connecting proxy on {} ({})", address, controlSockAddress);
-    zmq::proxy_steerable(socket, fanOutSock, zmq::socket_ref(), controlSock);
-}
-
-void FanInMessageEndpoint::stop()
-{
-    SPDLOG_TRACE("Sending TERMINATE on control socket {}", controlSockAddress);
-    // Note that even though this killer socket is short-lived sending a message
-    // to the control socket, we must *bind* here, not connect.
-    zmq::socket_t controlKillerSock =
-      socketFactory(zmq::socket_type::pub,
-                    MessageEndpointConnectType::BIND,
-                    timeoutMs,
-                    controlSockAddress);
-
-    controlKillerSock.send(zmq::str_buffer("TERMINATE"), zmq::send_flags::none);
-    controlKillerSock.close();
-}
-
-AsyncFanOutMessageEndpoint::AsyncFanOutMessageEndpoint(
-  const std::string& inprocLabel,
-  int timeoutMs)
-  : MessageEndpoint("inproc://" + inprocLabel, timeoutMs)
-{
-    socket =
-      setUpSocket(zmq::socket_type::push, MessageEndpointConnectType::BIND);
-}
-
-AsyncFanInMessageEndpoint::AsyncFanInMessageEndpoint(int portIn, int timeoutMs)
-  : FanInMessageEndpoint(portIn, timeoutMs, zmq::socket_type::pull)
-{}
-
-// ----------------------------------------------
-// SYNC FAN IN AND FAN OUT
-// ----------------------------------------------
-
-SyncFanOutMessageEndpoint::SyncFanOutMessageEndpoint(
-  const std::string& inProcLabel,
-  int timeoutMs)
-  : RecvMessageEndpoint(inProcLabel,
-                        timeoutMs,
-                        zmq::socket_type::dealer,
-                        MessageEndpointConnectType::BIND)
-{}
-
-SyncFanInMessageEndpoint::SyncFanInMessageEndpoint(int portIn, int timeoutMs)
-  : FanInMessageEndpoint(portIn, timeoutMs, zmq::socket_type::router)
-{}
-
 // ----------------------------------------------
 // ASYNC RECV ENDPOINT
 // ----------------------------------------------
@@ -566,19 +776,49 @@ Message AsyncRecvMessageEndpoint::recv()
 
 AsyncInternalRecvMessageEndpoint::AsyncInternalRecvMessageEndpoint(
   const std::string& inprocLabel,
-  int timeoutMs)
+  int timeoutMs,
+  int busyPollUsIn)
   : RecvMessageEndpoint(inprocLabel,
                         timeoutMs,
                         zmq::socket_type::pull,
                         MessageEndpointConnectType::BIND)
+  , maxBusyPollUs(busyPollUsIn)
+  , busyPollUs(busyPollUsIn)
 {}
 
 Message AsyncInternalRecvMessageEndpoint::recv()
 {
     SPDLOG_TRACE("PULL {}", address);
+
+    if (maxBusyPollUs > 0) {
+        busyPoll();
+    }
+
     return RecvMessageEndpoint::recv();
 }
 
+/**
+ * Spins checking for a pending message, to avoid the wake-up latency of a
+ * blocking receive when messages arrive in quick succession. If the spin finds
+ * nothing we halve the next spin, and if it does we double it, so idle
+ * receivers quickly stop burning CPU.
+ */
+bool AsyncInternalRecvMessageEndpoint::busyPoll()
+{
+    assert(tid == std::this_thread::get_id());
+
+    faabric::util::TimePoint start = faabric::util::startTimer();
+    while (faabric::util::getTimeDiffMicros(start) < busyPollUs) {
+        if (socket.get(zmq::sockopt::events) & ZMQ_POLLIN) {
+            busyPollUs = std::min(busyPollUs * 2, maxBusyPollUs);
+            return true;
+        }
+    }
+
+    busyPollUs = std::max(busyPollUs / 2, MIN_BUSY_POLL_US);
+    return false;
+}
+
 // ----------------------------------------------
 // SYNC RECV ENDPOINT
 // ----------------------------------------------
@@ -609,6 +849,147 @@ void SyncRecvMessageEndpoint::sendResponse(uint8_t header,
     sendMessage(socket, header, data, size);
 }
 
+// ----------------------------------------------
+// SYNC ROUTER AND RESPONSE ENDPOINTS
+// ----------------------------------------------
+
+SyncRouterMessageEndpoint::SyncRouterMessageEndpoint(
+  int portIn,
+  const std::string& inprocLabel,
+  int timeoutMs)
+  : MessageEndpoint(faabric::util::getSystemConfig().transportBindHost,
+                    portIn,
+                    timeoutMs)
+{
+    routerSocket =
+      setUpSocket(zmq::socket_type::router, MessageEndpointConnectType::BIND);
+
+    responseSocket = socketFactory(zmq::socket_type::pull,
+                                   MessageEndpointConnectType::BIND,
+                                   timeoutMs,
+                                   "inproc://" + inprocLabel + "-responses");
+}
+
+/**
+ * Waits until there is either a new request from a client, or a response from
+ * a worker to relay back.
+ */
+void SyncRouterMessageEndpoint::poll(bool& requestReady, bool& responseReady)
+{
+    assert(tid == std::this_thread::get_id());
+
+    zmq::pollitem_t items[] = {
+        { routerSocket.handle(), 0, ZMQ_POLLIN, 0 },
+        { responseSocket.handle(), 0, ZMQ_POLLIN, 0 },
+    };
+
+    CATCH_ZMQ_ERR(zmq::poll(items, 2, std::chrono::milliseconds(timeoutMs)),
+                  "poll")
+
+    requestReady = (items[0].revents & ZMQ_POLLIN) != 0;
+    responseReady = (items[1].revents & ZMQ_POLLIN) != 0;
+}
+
+Message SyncRouterMessageEndpoint::recv(RoutingEnvelope& envelope)
+{
+    SPDLOG_TRACE("RECV (ROUTER) {}", address);
+
+    // Each request is prefixed with the identity of the client socket, any
+    // routing frames added by the client, and an empty delimiter frame
+    envelope.clear();
+    while (true) {
+        zmq::message_t frame;
+        zmq::recv_result_t res;
+        CATCH_ZMQ_ERR(res = routerSocket.recv(frame), "recv_envelope")
+        if (!res.has_value()) {
+            if (envelope.empty()) {
+                return Message(MessageResponseCode::TIMEOUT);
+            }
+
+            SPDLOG_ERROR("Incomplete request envelope on {}", address);
+            throw std::runtime_error("Incomplete request on router socket");
+        }
+
+        if (frame.size() == 0) {
+            break;
+        }
+
+        envelope.emplace_back(frame.data<uint8_t>(),
+                              frame.data<uint8_t>() + frame.size());
+    }
+
+    Message body = recvMessage(routerSocket, true);
+
+    // Shutdown messages never reach a worker, so we respond to them here
+    if (body.getResponseCode() == MessageResponseCode::TERM) {
+        std::vector<uint8_t> empty(4, 0);
+        sendEnvelope(routerSocket, envelope);
+        sendMessage(routerSocket, NO_HEADER, empty.data(), empty.size());
+    }
+
+    return body;
+}
+
+/**
+ * Relays a single response from a worker to the client it's destined for.
+ * Workers send the envelope and delimiter in front of the response, so all
+ * frames can be passed on as they are. Returns false if the worker has
+ * instead notified us it's stopped.
+ */
+bool SyncRouterMessageEndpoint::forwardResponse()
+{
+    bool first = true;
+    bool more = true;
+    while (more) {
+        zmq::message_t frame;
+        zmq::recv_result_t res;
+        CATCH_ZMQ_ERR(res = responseSocket.recv(frame), "recv_response")
+        if (!res.has_value()) {
+            return true;
+        }
+
+        more = frame.more();
+        if (first && frame.size() == 0 && !more) {
+            return false;
+        }
+        first = false;
+
+        CATCH_ZMQ_ERR(routerSocket.send(frame,
+                                        more ? zmq::send_flags::sndmore
+                                             : zmq::send_flags::none),
+                      "send_response")
+    }
+
+    SPDLOG_TRACE("ROUTER response {}", address);
+
+    return true;
+}
+
+SyncResponseSendEndpoint::SyncResponseSendEndpoint(
+  const std::string& inprocLabel,
+  int timeoutMs)
+  : MessageEndpoint("inproc://" + inprocLabel + "-responses", timeoutMs)
+{
+    socket =
+      setUpSocket(zmq::socket_type::push, MessageEndpointConnectType::CONNECT);
+}
+
+void SyncResponseSendEndpoint::sendResponse(const RoutingEnvelope& envelope,
+                                            uint8_t header,
+                                            const uint8_t* data,
+                                            size_t dataSize)
+{
+    SPDLOG_TRACE("PUSH response {} ({} bytes)", address, dataSize);
+    sendEnvelope(socket, envelope);
+    sendMessage(socket, header, data, dataSize);
+}
+
+void SyncResponseSendEndpoint::sendStopped()
+{
+    // A lone empty frame tells the router this worker won't send any more
+    sendBuffer(socket, nullptr, 0, false);
+}
+
 // ----------------------------------------------
 // INTERNAL DIRECT MESSAGE ENDPOINTS
 // ----------------------------------------------
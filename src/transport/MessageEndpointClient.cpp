@@ -5,13 +5,21 @@ namespace faabric::transport {
 MessageEndpointClient::MessageEndpointClient(std::string hostIn,
                                              int asyncPortIn,
                                              int syncPortIn,
-                                             int timeoutMs)
+                                             int timeoutMs,
+                                             bool pooled)
   : host(hostIn)
   , asyncPort(asyncPortIn)
   , syncPort(syncPortIn)
-  , asyncEndpoint(host, asyncPort, timeoutMs)
-  , syncEndpoint(host, syncPort, timeoutMs)
-{}
+{
+    if (pooled) {
+        pool = getConnectionPool(host, asyncPort, syncPort);
+    } else {
+        asyncEndpoint = std::make_unique<AsyncSendMessageEndpoint>(
+          host, asyncPort, timeoutMs);
+        syncEndpoint = std::make_unique<SyncSendMessageEndpoint>(
+          host, syncPort, timeoutMs);
+    }
+}
 
 void MessageEndpointClient::asyncSend(int header,
                                       google::protobuf::Message* msg,
@@ -32,7 +40,11 @@ void MessageEndpointClient::asyncSend(int header,
                                       size_t bufferSize,
                                       int sequenceNum)
 {
-    asyncEndpoint.send(header, buffer, bufferSize, sequenceNum);
+    if (pool != nullptr) {
+        pool->asyncSend(header, buffer, bufferSize, sequenceNum);
+    } else {
+        asyncEndpoint->send(header, buffer, bufferSize, sequenceNum);
+    }
 }
 
 void MessageEndpointClient::syncSend(int header,
@@ -52,9 +64,34 @@ void MessageEndpointClient::syncSend(int header,
                                      const uint8_t* buffer,
                                      const size_t bufferSize,
                                      google::protobuf::Message* response)
+{
+    syncSend(header, buffer, bufferSize, {}, response);
+}
+
+void MessageEndpointClient::syncSend(int header,
+                                     google::protobuf::Message* msg,
+                                     const MessageParts& parts,
+                                     google::protobuf::Message* response)
+{
+    size_t msgSize = msg->ByteSizeLong();
+    uint8_t buffer[msgSize];
+    if (!msg->SerializeToArray(buffer, msgSize)) {
+        throw std::runtime_error("Error serialising message");
+    }
+
+    syncSend(header, buffer, msgSize, parts, response);
+}
+
+void MessageEndpointClient::syncSend(int header,
+                                     const uint8_t* buffer,
+                                     const size_t bufferSize,
+                                     const MessageParts& parts,
+                                     google::protobuf::Message* response)
 {
     Message responseMsg =
-      syncEndpoint.sendAwaitResponse(header, buffer, bufferSize);
+      pool != nullptr
+        ? pool->syncSend(header, buffer, bufferSize, parts)
+        : syncEndpoint->sendAwaitResponse(header, buffer, bufferSize, parts);
 
     // Deserialise response
     if (!response->ParseFromArray(responseMsg.data(), responseMsg.size())) {
@@ -3,6 +3,8 @@
 #include <faabric/transport/MessageEndpointServer.h>
 #include <faabric/transport/common.h>
 #include <faabric/util/bytes.h>
+#include <faabric/util/config.h>
+#include <faabric/util/environment.h>
 #include <faabric/util/latch.h>
 #include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
@@ -28,13 +30,16 @@ MessageEndpointServerHandler::MessageEndpointServerHandler(
 
 void MessageEndpointServerHandler::start(int timeoutMs)
 {
-    // For both sync and async, we want to fan out the messages to multiple
-    // worker threads.
-    // For sync, we use the router/ dealer pattern:
-    // https://zguide.zeromq.org/docs/chapter2/#Multithreading-with-ZeroMQ
-    // For push/ pull we receive on a pull socket, then proxy with another push
-    // to multiple downstream pull sockets
-    // In both cases, the downstream fan-out is done over inproc sockets.
+    // For both sync and async, a single receiver thread owns the external
+    // socket, and puts each request on a work-stealing queue shared by the
+    // worker threads. This means a request is never stuck behind a slow one
+    // while another worker is free, and lets servers mark some headers as high
+    // priority so that they overtake bulk requests.
+    // For sync, the receiver uses a router socket so it knows which client
+    // each request came from, and workers send their responses back to the
+    // receiver over an inproc socket.
+    queue =
+      std::make_unique<faabric::util::WorkStealingQueue<Request>>(nThreads);
 
     // Latch to make sure we can control the order of the setup
     std::shared_ptr<faabric::util::Latch> startupLatch =
@@ -44,53 +49,40 @@ void MessageEndpointServerHandler::start(int timeoutMs)
                  inprocLabel,
                  nThreads);
 
-    receiverThread = std::jthread([this, timeoutMs, startupLatch] {
-        int port = async ? server->asyncPort : server->syncPort;
+    // Optionally keep the receiver and worker threads off the cores used by
+    // executors. Pinning failures are logged rather than thrown, as they'd
+    // take down the host from inside these threads.
+    std::vector<int> serverCpus = faabric::util::parseCpuList(
+      faabric::util::getSystemConfig().transportServerCpus);
 
-        // Connect the relevant fan-in/ out sockets (these will run until
-        // they receive a terminate message)
-        if (async) {
-            // Set up push/ pull pair
-            asyncFanIn = std::make_unique<AsyncFanInMessageEndpoint>(port);
-            asyncFanOut = std::make_unique<AsyncFanOutMessageEndpoint>(
-              inprocLabel, timeoutMs);
-        } else {
-            // Set up router/ dealer
-            syncFanIn = std::make_unique<SyncFanInMessageEndpoint>(port);
-            syncFanOut = std::make_unique<SyncFanOutMessageEndpoint>(
-              inprocLabel, timeoutMs);
-        }
-
-        SPDLOG_TRACE("Endpoint server {} receiver thread set up", inprocLabel);
-
-        // Wait until the workers are set up
-        startupLatch->wait();
-
-        SPDLOG_TRACE("Endpoint server {} connecting fan-out", inprocLabel);
+    receiverThread = std::jthread([this, timeoutMs, startupLatch, serverCpus] {
+        faabric::util::pinThisThreadToCpus(serverCpus);
 
-        // This will block the receiver thread until it's killed
         if (async) {
-            asyncFanIn->attachFanOut(asyncFanOut->socket);
+            runAsyncReceiver(timeoutMs, startupLatch);
         } else {
-            syncFanIn->attachFanOut(syncFanOut->socket);
+            runSyncReceiver(timeoutMs, startupLatch);
         }
     });
 
     for (int i = 0; i < nThreads; i++) {
-        workerThreads.emplace_back([this, i, timeoutMs, startupLatch] {
+        workerThreads.emplace_back([this,
+                                    i,
+                                    timeoutMs,
+                                    startupLatch,
+                                    serverCpus] {
+            faabric::util::pinThisThreadToCpus(serverCpus);
+
             // Here we want to isolate all ZeroMQ stuff in its own
             // context, so we can do things after it's been destroyed
             {
-                std::unique_ptr<RecvMessageEndpoint> endpoint = nullptr;
-
-                if (async) {
-                    // Async workers have a PULL socket
-                    endpoint = std::make_unique<AsyncRecvMessageEndpoint>(
-                      inprocLabel, timeoutMs);
-                } else {
-                    // Sync workers have an in-proc REP socket
-                    endpoint = std::make_unique<SyncRecvMessageEndpoint>(
-                      inprocLabel, timeoutMs);
+                // Sync workers send responses back via the receiver
+                std::unique_ptr<SyncResponseSendEndpoint> responseEndpoint =
+                  nullptr;
+                if (!async) {
+                    responseEndpoint =
+                      std::make_unique<SyncResponseSendEndpoint>(inprocLabel,
+                                                                 timeoutMs);
                 }
 
                 // Notify receiver that this worker is set up
@@ -102,10 +94,14 @@ void MessageEndpointServerHandler::start(int timeoutMs)
 
                 while (true) {
                     // Receive the message
-                    Message body = endpoint->recv();
+                    Request request = nextRequest(i, timeoutMs);
+                    Message& body = request.message;
 
                     // Shut down if necessary
                     if (body.getResponseCode() == MessageResponseCode::TERM) {
+                        if (!async) {
+                            responseEndpoint->sendStopped();
+                        }
                         break;
                     }
 
@@ -143,8 +139,8 @@ void MessageEndpointServerHandler::start(int timeoutMs)
                         }
 
                         // Return the response
-                        static_cast<SyncRecvMessageEndpoint*>(endpoint.get())
-                          ->sendResponse(NO_HEADER, buffer, respSize);
+                        responseEndpoint->sendResponse(
+                          request.envelope, NO_HEADER, buffer, respSize);
                     }
 
                     // Wait on the request latch if necessary
@@ -179,18 +175,93 @@ void MessageEndpointServerHandler::start(int timeoutMs)
                  nThreads);
 }
 
-void MessageEndpointServerHandler::join()
+void MessageEndpointServerHandler::runAsyncReceiver(
+  int timeoutMs,
+  std::shared_ptr<faabric::util::Latch> startupLatch)
+{
+    AsyncRecvMessageEndpoint endpoint(server->asyncPort, timeoutMs);
+
+    SPDLOG_TRACE("Endpoint server {} receiver thread set up", inprocLabel);
+    startupLatch->wait();
+
+    // Each shutdown message stops one worker, so once they've all been passed
+    // on there's nothing left to receive
+    int nShutdown = 0;
+    while (nShutdown < nThreads) {
+        Message body = endpoint.recv();
+
+        if (body.getResponseCode() == MessageResponseCode::TIMEOUT) {
+            continue;
+        }
+
+        if (body.getResponseCode() == MessageResponseCode::TERM) {
+            nShutdown++;
+        }
+
+        dispatch(std::move(body), {});
+    }
+}
+
+void MessageEndpointServerHandler::runSyncReceiver(
+  int timeoutMs,
+  std::shared_ptr<faabric::util::Latch> startupLatch)
 {
-    // Note that we have to kill any running proxies before anything else
-    // https://github.com/zeromq/cppzmq/issues/478
-    if (syncFanIn != nullptr) {
-        syncFanIn->stop();
+    SyncRouterMessageEndpoint endpoint(
+      server->syncPort, inprocLabel, timeoutMs);
+
+    SPDLOG_TRACE("Endpoint server {} receiver thread set up", inprocLabel);
+    startupLatch->wait();
+
+    // Here we must keep relaying responses until every worker has told us it's
+    // stopped, as they may still be finishing off requests after we've passed
+    // on all the shutdown messages
+    int nStopped = 0;
+    while (nStopped < nThreads) {
+        bool requestReady = false;
+        bool responseReady = false;
+        endpoint.poll(requestReady, responseReady);
+
+        if (responseReady && !endpoint.forwardResponse()) {
+            nStopped++;
+        }
+
+        if (requestReady) {
+            RoutingEnvelope envelope;
+            Message body = endpoint.recv(envelope);
+
+            if (body.getResponseCode() == MessageResponseCode::TIMEOUT) {
+                continue;
+            }
+
+            dispatch(std::move(body), std::move(envelope));
+        }
     }
+}
+
+void MessageEndpointServerHandler::dispatch(Message&& message,
+                                            RoutingEnvelope envelope)
+{
+    bool highPriority =
+      message.getResponseCode() == MessageResponseCode::SUCCESS &&
+      server->isHighPriority(message.getHeader(), async);
 
-    if (asyncFanIn != nullptr) {
-        asyncFanIn->stop();
+    queue->enqueue(Request{ std::move(message), std::move(envelope) },
+                   highPriority);
+}
+
+MessageEndpointServerHandler::Request MessageEndpointServerHandler::nextRequest(
+  int workerIdx,
+  int timeoutMs)
+{
+    try {
+        return queue->dequeue(workerIdx, timeoutMs);
+    } catch (faabric::util::QueueTimeoutException& ex) {
+        return Request{ Message(MessageResponseCode::TIMEOUT), {} };
     }
+}
 
+void MessageEndpointServerHandler::join()
+{
     // Join each worker
     for (auto& t : workerThreads) {
         if (t.joinable()) {
@@ -198,10 +269,12 @@ void MessageEndpointServerHandler::join()
         }
     }
 
-    // Join the receiver thread
+    // The receiver exits once all the workers have been shut down
     if (receiverThread.joinable()) {
         receiverThread.join();
     }
+
+    workerThreads.clear();
 }
 
 MessageEndpointServer::MessageEndpointServer(int asyncPortIn,
@@ -226,12 +299,9 @@ void MessageEndpointServer::start(int timeoutMs)
 {
     started = true;
 
+    // Both handlers have bound their sockets by the time they return
     asyncHandler.start(timeoutMs);
     syncHandler.start(timeoutMs);
-
-    // Unfortunately we can't know precisely when the proxies have started,
-    // hence have to add a sleep.
-    SLEEP_MS(500);
 }
 
 void MessageEndpointServer::stop()
@@ -241,13 +311,11 @@ void MessageEndpointServer::stop()
         return;
     }
 
-    // Here we send shutdown messages to each worker in turn, however, because
-    // they're all connected on the same inproc port, we have to wait until each
-    // one has shut down fully (i.e. the zmq socket has gone out of scope),
-    // before sending the next shutdown message.
-    // If we don't do this, zmq will direct messages to sockets that are in the
-    // process of shutting down and cause errors.
-    // To ensure each socket has closed, we use a latch with two slots, where
+    // Here we send shutdown messages to each worker in turn. Each one is
+    // picked up by exactly one worker, and we wait until that worker has shut
+    // down fully (i.e. its zmq sockets have gone out of scope and it has
+    // finished onWorkerStop), before sending the next shutdown message.
+    // To ensure each worker has finished, we use a latch with two slots, where
     // this thread takes one of the slots, and the worker thread takes the other
     // once it's finished shutting down.
     for (int i = 0; i < nThreads; i++) {
@@ -299,6 +367,11 @@ void MessageEndpointServer::stop()
     started = false;
 }
 
+bool MessageEndpointServer::isHighPriority(uint8_t header, bool async)
+{
+    return false;
+}
+
 void MessageEndpointServer::onWorkerStop()
 {
     // Nothing to do by default
@@ -6,6 +6,7 @@
 #include <faabric/util/config.h>
 #include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
+#include <faabric/util/timing.h>
 
 #include <list>
 
@@ -319,6 +320,9 @@ void PointToPointGroup::notifyLocked(int groupIdx)
 
     ptpBroker.sendMessage(
       groupId, POINT_TO_POINT_MASTER_IDX, groupIdx, data.data(), data.size());
+
+    // The new lock owner is blocked waiting for this message
+    ptpBroker.flushMessages();
 }
 
 void PointToPointGroup::barrier(int groupIdx)
@@ -369,6 +373,7 @@ void PointToPointGroup::notify(int groupIdx)
                               POINT_TO_POINT_MASTER_IDX,
                               data.data(),
                               data.size());
+        ptpBroker.flushMessages();
     }
 }
 
@@ -390,6 +395,20 @@ PointToPointBroker::PointToPointBroker()
   : conf(faabric::util::getSystemConfig())
 {}
 
+PointToPointBroker::~PointToPointBroker()
+{
+    {
+        faabric::util::UniqueLock lock(flushMx);
+        flushStopped = true;
+    }
+
+    flushCv.notify_one();
+
+    if (flushThread.joinable()) {
+        flushThread.join();
+    }
+}
+
 std::string PointToPointBroker::getHostForReceiver(int groupId, int recvIdx)
 {
     faabric::util::SharedLock lock(brokerMutex);
@@ -674,6 +693,11 @@ void PointToPointBroker::sendMessage(int groupId,
                      host);
 
         cli->sendMessage(msg, remoteSendSeqNum);
+
+        // The first message held back by the client starts a new window
+        if (cli->getPendingMessageCount() == 1) {
+            scheduleFlush(cli);
+        }
     }
 }
 
@@ -684,7 +708,8 @@ Message PointToPointBroker::doRecvMessage(int groupId, int sendIdx, int recvIdx)
     // Note: this map is thread-local so no locking required
     if (recvEndpoints.find(label) == recvEndpoints.end()) {
         recvEndpoints[label] =
-          std::make_unique<AsyncInternalRecvMessageEndpoint>(label);
+          std::make_unique<AsyncInternalRecvMessageEndpoint>(
+            label, DEFAULT_SOCKET_TIMEOUT_MS, conf.pointToPointBusyPollUs);
         SPDLOG_TRACE("Created new internal recv endpoint {}",
                      recvEndpoints[label]->getAddress());
     }
@@ -697,6 +722,12 @@ std::vector<uint8_t> PointToPointBroker::recvMessage(int groupId,
                                                      int recvIdx,
                                                      bool mustOrderMsg)
 {
+    // Anything this thread has held back for coalescing must go out before we
+    // block, as the reply may depend on it
+    if (conf.pointToPointCoalesceBytes > 0) {
+        flushMessages();
+    }
+
     // If we don't need to receive messages in order, return here
     if (!mustOrderMsg) {
         // TODO - can we avoid this copy?
@@ -761,6 +792,75 @@ std::vector<uint8_t> PointToPointBroker::recvMessage(int groupId,
     }
 }
 
+void PointToPointBroker::flushMessages()
+{
+    // Clients are thread-local, so this only flushes messages sent from the
+    // calling thread
+    for (auto& it : clients) {
+        it.second->flushMessages();
+    }
+}
+
+void PointToPointBroker::scheduleFlush(
+  std::shared_ptr<PointToPointClient> client)
+{
+    faabric::util::TimePoint deadline =
+      faabric::util::startTimer() +
+      std::chrono::microseconds(client->getCoalesceWindowUs());
+
+    {
+        faabric::util::UniqueLock lock(flushMx);
+        if (flushStopped) {
+            return;
+        }
+
+        flushDeadlines.emplace(deadline, client);
+
+        // The thread is only started when first needed
+        if (!flushThread.joinable()) {
+            flushThread = std::jthread([this] { runFlushThread(); });
+        }
+    }
+
+    flushCv.notify_one();
+}
+
+void PointToPointBroker::runFlushThread()
+{
+    faabric::util::UniqueLock lock(flushMx);
+    while (!flushStopped) {
+        if (flushDeadlines.empty()) {
+            flushCv.wait(
+              lock, [this] { return flushStopped || !flushDeadlines.empty(); });
+            continue;
+        }
+
+        auto it = flushDeadlines.begin();
+        if (faabric::util::startTimer() < it->first) {
+            flushCv.wait_until(lock, it->first);
+            continue;
+        }
+
+        std::shared_ptr<PointToPointClient> client = it->second.lock();
+        flushDeadlines.erase(it);
+        if (client == nullptr) {
+            continue;
+        }
+
+        // Flushing early is harmless, so this doesn't check whether the
+        // client's messages are from the same window. Sending must not be done
+        // with the lock held.
+        lock.unlock();
+        try {
+            client->flushMessages();
+        } catch (std::exception& ex) {
+            SPDLOG_ERROR("Failed to flush point-to-point messages: {}",
+                         ex.what());
+        }
+        lock.lock();
+    }
+}
+
 void PointToPointBroker::clearGroup(int groupId)
 {
     SPDLOG_TRACE("Clearing point-to-point group {}", groupId);
@@ -797,6 +897,8 @@ void PointToPointBroker::clear()
 void PointToPointBroker::resetThreadLocalCache()
 {
     SPDLOG_TRACE("Resetting point-to-point thread-local cache");
+    flushMessages();
+
     sendEndpoints.clear();
     recvEndpoints.clear();
     clients.clear();
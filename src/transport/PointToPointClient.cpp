@@ -4,7 +4,10 @@
 #include <faabric/transport/PointToPointClient.h>
 #include <faabric/transport/common.h>
 #include <faabric/transport/macros.h>
+#include <faabric/util/config.h>
+#include <faabric/util/locks.h>
 #include <faabric/util/testing.h>
+#include <faabric/util/timing.h>
 
 namespace faabric::transport {
 
@@ -16,6 +19,9 @@ static std::vector<std::pair<std::string, faabric::PointToPointMappings>>
 static std::vector<std::pair<std::string, faabric::PointToPointMessage>>
   sentMessages;
 
+static std::vector<std::pair<std::string, faabric::PointToPointMessageBatch>>
+  sentMessageBatches;
+
 static std::vector<std::tuple<std::string,
                               faabric::transport::PointToPointCall,
                               faabric::PointToPointMessage>>
@@ -33,6 +39,13 @@ getSentPointToPointMessages()
     return sentMessages;
 }
 
+std::vector<std::pair<std::string, faabric::PointToPointMessageBatch>>
+getSentPointToPointMessageBatches()
+{
+    faabric::util::UniqueLock lock(mockMutex);
+    return sentMessageBatches;
+}
+
 std::vector<std::tuple<std::string,
                        faabric::transport::PointToPointCall,
                        faabric::PointToPointMessage>>
@@ -43,8 +56,10 @@ getSentLockMessages()
 
 void clearSentMessages()
 {
+    faabric::util::UniqueLock lock(mockMutex);
     sentMappings.clear();
     sentMessages.clear();
+    sentMessageBatches.clear();
     sentLockMessages.clear();
 }
 
@@ -52,6 +67,10 @@ PointToPointClient::PointToPointClient(const std::string& hostIn)
   : faabric::transport::MessageEndpointClient(hostIn,
                                               POINT_TO_POINT_ASYNC_PORT,
                                               POINT_TO_POINT_SYNC_PORT)
+  , coalesceBytes(
+      std::max(0, faabric::util::getSystemConfig().pointToPointCoalesceBytes))
+  , coalesceWindowUs(
+      faabric::util::getSystemConfig().pointToPointCoalesceWindowUs)
 {}
 
 void PointToPointClient::sendMappings(faabric::PointToPointMappings& mappings)
@@ -66,6 +85,33 @@ void PointToPointClient::sendMappings(faabric::PointToPointMappings& mappings)
 
 void PointToPointClient::sendMessage(faabric::PointToPointMessage& msg,
                                      int sequenceNum)
+{
+    faabric::util::UniqueLock lock(pendingMx);
+
+    // Messages at or above the threshold are sent straight away, but only
+    // after anything already pending to preserve ordering
+    if (coalesceBytes == 0 || msg.data().size() >= coalesceBytes) {
+        doFlushMessages();
+        doSendMessage(msg, sequenceNum);
+        return;
+    }
+
+    if (pendingBatch.messages_size() == 0) {
+        pendingSince = faabric::util::startTimer();
+    }
+
+    *pendingBatch.add_messages() = msg;
+    pendingBatch.add_sequencenums(sequenceNum);
+    pendingBytes += msg.data().size();
+
+    if (pendingBytes >= coalesceBytes ||
+        faabric::util::getTimeDiffMicros(pendingSince) >= coalesceWindowUs) {
+        doFlushMessages();
+    }
+}
+
+void PointToPointClient::doSendMessage(faabric::PointToPointMessage& msg,
+                                       int sequenceNum)
 {
     if (faabric::util::isMockMode()) {
         sentMessages.emplace_back(host, msg);
@@ -74,6 +120,41 @@ void PointToPointClient::sendMessage(faabric::PointToPointMessage& msg,
     }
 }
 
+void PointToPointClient::flushMessages()
+{
+    faabric::util::UniqueLock lock(pendingMx);
+    doFlushMessages();
+}
+
+void PointToPointClient::doFlushMessages()
+{
+    if (pendingBatch.messages_size() == 0) {
+        return;
+    }
+
+    SPDLOG_TRACE("Flushing {} coalesced point-to-point messages ({} bytes) "
+                 "to {}",
+                 pendingBatch.messages_size(),
+                 pendingBytes,
+                 host);
+
+    if (faabric::util::isMockMode()) {
+        faabric::util::UniqueLock lock(mockMutex);
+        sentMessageBatches.emplace_back(host, pendingBatch);
+    } else {
+        asyncSend(PointToPointCall::MESSAGE_BATCH, &pendingBatch);
+    }
+
+    pendingBatch.Clear();
+    pendingBytes = 0;
+}
+
+int PointToPointClient::getPendingMessageCount()
+{
+    faabric::util::UniqueLock lock(pendingMx);
+    return pendingBatch.messages_size();
+}
+
 void PointToPointClient::makeCoordinationRequest(
   int appId,
   int groupId,
@@ -111,6 +192,10 @@ void PointToPointClient::makeCoordinationRequest(
         }
     }
 
+    // Lock requests must not overtake messages already sent to this host
+    faabric::util::UniqueLock pendingLock(pendingMx);
+    doFlushMessages();
+
     if (faabric::util::isMockMode()) {
         faabric::util::UniqueLock lock(mockMutex);
         sentLockMessages.emplace_back(host, call, req);
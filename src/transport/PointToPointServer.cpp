@@ -43,6 +43,10 @@ void PointToPointServer::doAsyncRecv(transport::Message& message)
                                sequenceNum);
             break;
         }
+        case (faabric::transport::PointToPointCall::MESSAGE_BATCH): {
+            recvMessageBatch(message.udata(), message.size());
+            break;
+        }
         case faabric::transport::PointToPointCall::LOCK_GROUP: {
             recvGroupLock(message.udata(), message.size(), false);
             break;
@@ -97,6 +101,29 @@ std::unique_ptr<google::protobuf::Message> PointToPointServer::doRecvMappings(
     return std::make_unique<faabric::EmptyResponse>();
 }
 
+void PointToPointServer::recvMessageBatch(const uint8_t* buffer,
+                                          size_t bufferSize)
+{
+    PARSE_MSG(faabric::PointToPointMessageBatch, buffer, bufferSize)
+
+    SPDLOG_TRACE("Receiving batch of {} point-to-point messages",
+                 parsedMsg.messages_size());
+
+    // Route each message locally in the order they were sent
+    for (int i = 0; i < parsedMsg.messages_size(); i++) {
+        const faabric::PointToPointMessage& msg = parsedMsg.messages(i);
+        int sequenceNum = parsedMsg.sequencenums(i);
+
+        broker.sendMessage(msg.groupid(),
+                           msg.sendidx(),
+                           msg.recvidx(),
+                           BYTES_CONST(msg.data().c_str()),
+                           msg.data().size(),
+                           sequenceNum != NO_SEQUENCE_NUM,
+                           sequenceNum);
+    }
+}
+
 void PointToPointServer::recvGroupLock(const uint8_t* buffer,
                                        size_t bufferSize,
                                        bool recursive)
@@ -126,6 +153,27 @@ void PointToPointServer::recvGroupUnlock(const uint8_t* buffer,
       ->unlock(parsedMsg.sendidx(), recursive);
 }
 
+bool PointToPointServer::isHighPriority(uint8_t header, bool async)
+{
+    // Group locks are on the critical path of all the functions in the group,
+    // so they shouldn't queue behind bulk messages
+    if (!async) {
+        return false;
+    }
+
+    switch (header) {
+        case (faabric::transport::PointToPointCall::LOCK_GROUP):
+        case (faabric::transport::PointToPointCall::LOCK_GROUP_RECURSIVE):
+        case (faabric::transport::PointToPointCall::UNLOCK_GROUP):
+        case (faabric::transport::PointToPointCall::UNLOCK_GROUP_RECURSIVE): {
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
 void PointToPointServer::onWorkerStop()
 {
     // Clear any thread-local cached sockets
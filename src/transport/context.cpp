@@ -1,4 +1,7 @@
+#include <faabric/transport/ConnectionPool.h>
 #include <faabric/transport/context.h>
+#include <faabric/util/config.h>
+#include <faabric/util/environment.h>
 #include <faabric/util/locks.h>
 #include <faabric/util/logging.h>
 
@@ -15,9 +18,30 @@ void initGlobalMessageContext()
         return;
     }
 
-    SPDLOG_TRACE("Initialising global ZeroMQ context");
-    instance = std::make_shared<zmq::context_t>(ZMQ_CONTEXT_IO_THREADS,
-                                                FAASM_ZMQ_MAX_SOCKETS);
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    int ioThreads = conf.transportIoThreads > 0 ? conf.transportIoThreads
+                                                : ZMQ_CONTEXT_IO_THREADS;
+
+    SPDLOG_TRACE("Initialising global ZeroMQ context ({} I/O threads)",
+                 ioThreads);
+    instance =
+      std::make_shared<zmq::context_t>(ioThreads, FAASM_ZMQ_MAX_SOCKETS);
+
+    // The I/O threads are only started when the first socket is created, so
+    // we can still set their affinity here
+    std::vector<int> ioCpus = faabric::util::filterUsableCpus(
+      faabric::util::parseCpuList(conf.transportIoCpus));
+    for (int cpu : ioCpus) {
+        SPDLOG_DEBUG("Pinning ZeroMQ I/O threads to CPU {}", cpu);
+        int res =
+          zmq_ctx_set(instance->handle(), ZMQ_THREAD_AFFINITY_CPU_ADD, cpu);
+        if (res != 0) {
+            SPDLOG_ERROR("Failed to pin ZeroMQ I/O threads to CPU {}: {}",
+                         cpu,
+                         zmq_strerror(zmq_errno()));
+            throw std::runtime_error("Failed to pin ZeroMQ I/O threads");
+        }
+    }
 }
 
 std::shared_ptr<zmq::context_t> getGlobalMessageContext()
@@ -38,6 +62,10 @@ void closeGlobalMessageContext()
         return;
     }
 
+    // Pooled connections live in their own threads, which must close their
+    // sockets before the context can be closed
+    clearConnectionPools();
+
     SPDLOG_TRACE("Destroying global ZeroMQ context");
 
     // Force outstanding ops to return ETERM
@@ -30,6 +30,7 @@ void SystemConfig::initialise()
     redisStateHost = getEnvVar("REDIS_STATE_HOST", "localhost");
     redisQueueHost = getEnvVar("REDIS_QUEUE_HOST", "localhost");
     redisPort = getEnvVar("REDIS_PORT", "6379");
+    redisPoolSize = this->getSystemConfIntParam("REDIS_POOL_SIZE", "2");
 
     // Scheduling
     noScheduler = this->getSystemConfIntParam("NO_SCHEDULER", "0");
@@ -37,6 +38,21 @@ void SystemConfig::initialise()
     noTopologyHints = getEnvVar("NO_TOPOLOGY_HINTS", "off");
     noSingleHostOptimisations =
       this->getSystemConfIntParam("NO_SINGLE_HOST", "0");
+    resourceGossipIntervalSeconds =
+      this->getSystemConfIntParam("RESOURCE_GOSSIP_INTERVAL_SECS", "0");
+    snapshotBroadcastFanOut =
+      this->getSystemConfIntParam("SNAPSHOT_BROADCAST_FANOUT", "0");
+    executorPoolMin = this->getSystemConfIntParam("EXECUTOR_POOL_MIN", "0");
+    executorPoolMax = this->getSystemConfIntParam("EXECUTOR_POOL_MAX", "0");
+    executorPoolIntervalSeconds =
+      this->getSystemConfIntParam("EXECUTOR_POOL_INTERVAL_SECS", "1");
+    functionResultMode = getEnvVar("FUNCTION_RESULT_MODE", "redis");
+    placementPolicy = getEnvVar("PLACEMENT_POLICY", "binpack");
+    snapshotTransferMbps =
+      this->getSystemConfIntParam("SNAPSHOT_TRANSFER_MBPS", "1000");
+    hostQueueCapacity = this->getSystemConfIntParam("HOST_QUEUE_CAPACITY", "0");
+    reservedPrioritySlots =
+      this->getSystemConfIntParam("RESERVED_PRIORITY_SLOTS", "0");
 
     // Worker-related timeouts (all in seconds)
     globalMessageTimeout =
@@ -73,6 +89,50 @@ void SystemConfig::initialise()
     pointToPointServerThreads =
       this->getSystemConfIntParam("POINT_TO_POINT_SERVER_THREADS", "2");
 
+    // Coalescing of small remote point-to-point messages, disabled when the
+    // byte threshold is zero
+    pointToPointCoalesceBytes =
+      this->getSystemConfIntParam("POINT_TO_POINT_COALESCE_BYTES", "0");
+    pointToPointCoalesceWindowUs =
+      this->getSystemConfIntParam("POINT_TO_POINT_COALESCE_WINDOW_US", "100");
+
+    // Upper bound on spinning before a blocking point-to-point receive, zero
+    // means never spin
+    pointToPointBusyPollUs =
+      this->getSystemConfIntParam("POINT_TO_POINT_BUSY_POLL_US", "0");
+
+    // ZeroMQ I/O threads, and optional CPU lists (e.g. "0-1,4") to pin the
+    // I/O threads and the endpoint server threads to
+    transportIoThreads =
+      this->getSystemConfIntParam("TRANSPORT_IO_THREADS", "1");
+    transportIoCpus = getEnvVar("TRANSPORT_IO_CPUS", "");
+    transportServerCpus = getEnvVar("TRANSPORT_SERVER_CPUS", "");
+
+    // Connections per remote host shared by all threads' function call and
+    // snapshot clients. Zero means each thread has its own clients.
+    transportClientPoolSize =
+      this->getSystemConfIntParam("TRANSPORT_CLIENT_POOL_SIZE", "0");
+
+    // Address servers listen on, e.g. to run several on one machine, each on
+    // its own loopback address
+    transportBindHost = getEnvVar("TRANSPORT_BIND_HOST", "0.0.0.0");
+
+    // Size of the segments each value is split into in sharded state mode
+    stateShardSize =
+      this->getSystemConfIntParam("STATE_SHARD_SIZE", "1048576");
+
+    // Chunk requests kept in flight, and connections used, when moving state
+    // values between hosts. A window of one sends each request in turn.
+    stateTransferWindow =
+      this->getSystemConfIntParam("STATE_TRANSFER_WINDOW", "16");
+    stateTransferConnections =
+      this->getSystemConfIntParam("STATE_TRANSFER_CONNECTIONS", "2");
+
+    // Memory replicas of state values may use before the least recently used
+    // are evicted. Zero means no limit.
+    stateMemoryLimitMb =
+      this->getSystemConfIntParam("STATE_MEMORY_LIMIT_MB", "0");
+
     // Dirty tracking
     dirtyTrackingMode = getEnvVar("DIRTY_TRACKING_MODE", "segfault");
     diffingMode = getEnvVar("DIFFING_MODE", "xor");
@@ -99,17 +159,33 @@ void SystemConfig::print()
     SPDLOG_INFO("LOG_LEVEL                  {}", logLevel);
     SPDLOG_INFO("LOG_FILE                   {}", logFile);
     SPDLOG_INFO("STATE_MODE                 {}", stateMode);
+    SPDLOG_INFO("STATE_SHARD_SIZE           {}", stateShardSize);
+    SPDLOG_INFO("STATE_TRANSFER_WINDOW      {}", stateTransferWindow);
+    SPDLOG_INFO("STATE_TRANSFER_CONNECTIONS {}", stateTransferConnections);
+    SPDLOG_INFO("STATE_MEMORY_LIMIT_MB      {}", stateMemoryLimitMb);
     SPDLOG_INFO("DELTA_SNAPSHOT_ENCODING    {}", deltaSnapshotEncoding);
 
     SPDLOG_INFO("--- Redis ---");
     SPDLOG_INFO("REDIS_STATE_HOST           {}", redisStateHost);
     SPDLOG_INFO("REDIS_QUEUE_HOST           {}", redisQueueHost);
     SPDLOG_INFO("REDIS_PORT                 {}", redisPort);
+    SPDLOG_INFO("REDIS_POOL_SIZE            {}", redisPoolSize);
 
     SPDLOG_INFO("--- Scheduling ---");
     SPDLOG_INFO("NO_SCHEDULER               {}", noScheduler);
     SPDLOG_INFO("OVERRIDE_CPU_COUNT         {}", overrideCpuCount);
     SPDLOG_INFO("NO_TOPOLOGY_HINTS         {}", noTopologyHints);
+    SPDLOG_INFO("RESOURCE_GOSSIP_INTERVAL_SECS {}",
+                resourceGossipIntervalSeconds);
+    SPDLOG_INFO("SNAPSHOT_BROADCAST_FANOUT  {}", snapshotBroadcastFanOut);
+    SPDLOG_INFO("EXECUTOR_POOL_MIN          {}", executorPoolMin);
+    SPDLOG_INFO("EXECUTOR_POOL_MAX          {}", executorPoolMax);
+    SPDLOG_INFO("EXECUTOR_POOL_INTERVAL_SECS {}", executorPoolIntervalSeconds);
+    SPDLOG_INFO("FUNCTION_RESULT_MODE       {}", functionResultMode);
+    SPDLOG_INFO("PLACEMENT_POLICY           {}", placementPolicy);
+    SPDLOG_INFO("SNAPSHOT_TRANSFER_MBPS     {}", snapshotTransferMbps);
+    SPDLOG_INFO("HOST_QUEUE_CAPACITY        {}", hostQueueCapacity);
+    SPDLOG_INFO("RESERVED_PRIORITY_SLOTS    {}", reservedPrioritySlots);
 
     SPDLOG_INFO("--- Timeouts ---");
     SPDLOG_INFO("GLOBAL_MESSAGE_TIMEOUT     {}", globalMessageTimeout);
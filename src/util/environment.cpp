@@ -1,6 +1,11 @@
 #include <faabric/util/config.h>
 #include <faabric/util/environment.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/string_tools.h>
 
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
 #include <stdexcept>
 #include <thread>
 
@@ -53,4 +58,112 @@ unsigned int getUsableCores()
 
     return nCores;
 }
+
+/**
+ * Parses a Linux-style CPU list, e.g. "0-3,6", into individual CPU ids. An
+ * empty string gives an empty list. CPU ids must fit in a cpu_set_t.
+ */
+std::vector<int> parseCpuList(const std::string& cpuList)
+{
+    std::vector<int> cpus;
+
+    std::stringstream ss(cpuList);
+    std::string part;
+    while (std::getline(ss, part, ',')) {
+        if (isAllWhitespace(part)) {
+            continue;
+        }
+
+        size_t dashPos = part.find('-');
+        std::string startStr = part.substr(0, dashPos);
+        std::string endStr =
+          dashPos == std::string::npos ? startStr : part.substr(dashPos + 1);
+
+        if (!stringIsInt(startStr) || !stringIsInt(endStr)) {
+            SPDLOG_ERROR("Invalid CPU list: {}", cpuList);
+            throw std::runtime_error("Invalid CPU list");
+        }
+
+        int start = std::stoi(startStr);
+        int end = std::stoi(endStr);
+        if (start < 0 || end < start) {
+            SPDLOG_ERROR("Invalid CPU range in list: {}", cpuList);
+            throw std::runtime_error("Invalid CPU list");
+        }
+
+        if (end >= CPU_SETSIZE) {
+            SPDLOG_ERROR("CPU {} out of range (max {}) in list: {}",
+                         end,
+                         CPU_SETSIZE - 1,
+                         cpuList);
+            throw std::runtime_error("Invalid CPU list");
+        }
+
+        for (int cpu = start; cpu <= end; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+/**
+ * Returns those of the given CPUs that this process can run on, i.e. that are
+ * online and in its cpuset. Any others are dropped with a warning.
+ */
+std::vector<int> filterUsableCpus(const std::vector<int>& cpus)
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        SPDLOG_WARN("Failed to get process CPU affinity, not filtering CPUs");
+        return cpus;
+    }
+
+    std::vector<int> usable;
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+            usable.push_back(cpu);
+        } else {
+            SPDLOG_WARN("Ignoring CPU {}, not available to this process", cpu);
+        }
+    }
+
+    return usable;
+}
+
+/**
+ * Restricts the calling thread to those of the given CPUs it can run on. Does
+ * nothing if the list is empty. This is called from server threads, so
+ * failures are logged and the thread left unpinned, returning false.
+ */
+bool pinThisThreadToCpus(const std::vector<int>& cpus)
+{
+    if (cpus.empty()) {
+        return true;
+    }
+
+    std::vector<int> usable = filterUsableCpus(cpus);
+    if (usable.empty()) {
+        SPDLOG_ERROR("None of CPUs {} available, not pinning thread",
+                     vectorToString<int>(cpus));
+        return false;
+    }
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : usable) {
+        CPU_SET(cpu, &cpuSet);
+    }
+
+    int res = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (res != 0) {
+        SPDLOG_ERROR("Failed to pin thread to CPUs {}: {}",
+                     vectorToString<int>(usable),
+                     res);
+        return false;
+    }
+
+    return true;
+}
 }
@@ -7,8 +7,13 @@
 #include <faabric/util/environment.h>
 #include <faabric/util/func.h>
 #include <faabric/util/gids.h>
+#include <faabric/util/logging.h>
 #include <faabric/util/random.h>
 
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format_lite.h>
+
 namespace faabric::util {
 
 std::vector<uint8_t> messageToBytes(const faabric::Message& msg)
@@ -20,6 +25,83 @@ std::vector<uint8_t> messageToBytes(const faabric::Message& msg)
     return inputData;
 }
 
+std::vector<uint8_t> serialiseBatchSubset(
+  const faabric::BatchExecuteRequest& header,
+  const faabric::BatchExecuteRequest& req,
+  const std::vector<int>& msgIdxs,
+  const std::vector<bool>& directResults)
+{
+    using google::protobuf::internal::WireFormatLite;
+    using google::protobuf::io::CodedOutputStream;
+
+    if (header.messages_size() > 0 || directResults.size() != msgIdxs.size()) {
+        SPDLOG_ERROR("Invalid batch subset ({} header messages, {} indexes, "
+                     "{} direct result flags)",
+                     header.messages_size(),
+                     msgIdxs.size(),
+                     directResults.size());
+        throw std::runtime_error("Invalid batch subset");
+    }
+
+    const int messagesField =
+      faabric::BatchExecuteRequest::kMessagesFieldNumber;
+    const int localField = faabric::Message::kExecutesLocallyFieldNumber;
+    const int directField = faabric::Message::kDirectResultFieldNumber;
+
+    // Fields that appear more than once in a message take the last value, so
+    // the flags can be appended to each message rather than changed on a copy
+    size_t localSize =
+      WireFormatLite::TagSize(localField, WireFormatLite::TYPE_BOOL) +
+      WireFormatLite::kBoolSize;
+    size_t directSize =
+      WireFormatLite::TagSize(directField, WireFormatLite::TYPE_BOOL) +
+      WireFormatLite::kBoolSize;
+    size_t messageTagSize = WireFormatLite::TagSize(
+      messagesField, WireFormatLite::TYPE_MESSAGE);
+
+    std::vector<size_t> msgSizes;
+    msgSizes.reserve(msgIdxs.size());
+    size_t totalSize = header.ByteSizeLong();
+    for (size_t i = 0; i < msgIdxs.size(); i++) {
+        size_t msgSize = req.messages().at(msgIdxs.at(i)).ByteSizeLong() +
+                         localSize + (directResults.at(i) ? directSize : 0);
+        msgSizes.push_back(msgSize);
+
+        totalSize += messageTagSize +
+                     CodedOutputStream::VarintSize64(msgSize) + msgSize;
+    }
+
+    std::vector<uint8_t> buffer(totalSize);
+    {
+        google::protobuf::io::ArrayOutputStream arrayStream(buffer.data(),
+                                                            buffer.size());
+        CodedOutputStream out(&arrayStream);
+
+        header.SerializeWithCachedSizes(&out);
+        for (size_t i = 0; i < msgIdxs.size(); i++) {
+            WireFormatLite::WriteTag(
+              messagesField, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, &out);
+            out.WriteVarint64(msgSizes.at(i));
+
+            // Sizes were cached by the calls above
+            req.messages().at(msgIdxs.at(i)).SerializeWithCachedSizes(&out);
+            WireFormatLite::WriteBool(localField, false, &out);
+            if (directResults.at(i)) {
+                WireFormatLite::WriteBool(directField, true, &out);
+            }
+        }
+
+        if (out.HadError() || (size_t)out.ByteCount() != totalSize) {
+            SPDLOG_ERROR("Error serialising batch subset ({}/{} bytes)",
+                         out.ByteCount(),
+                         totalSize);
+            throw std::runtime_error("Error serialising batch subset");
+        }
+    }
+
+    return buffer;
+}
+
 std::string funcToString(const faabric::Message& msg, bool includeId)
 {
     std::string str = msg.user() + "/" + msg.function();
@@ -0,0 +1,55 @@
+#include <faabric/util/hash_ring.h>
+#include <faabric/util/logging.h>
+
+#define FNV_OFFSET_BASIS 14695981039346656037UL
+#define FNV_PRIME 1099511628211UL
+
+namespace faabric::util {
+
+uint64_t stableHash(const std::string& input)
+{
+    // FNV-1a, followed by a finalising mix to spread similar inputs (e.g.
+    // keys that differ only in a trailing index) around the ring
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (char c : input) {
+        hash ^= (uint8_t)c;
+        hash *= FNV_PRIME;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdUL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53UL;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+HashRing::HashRing(const std::vector<std::string>& nodesIn, int replicas)
+  : nodes(nodesIn)
+{
+    if (nodes.empty()) {
+        SPDLOG_ERROR("Creating hash ring with no nodes");
+        throw std::runtime_error("Hash ring with no nodes");
+    }
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        for (int r = 0; r < replicas; r++) {
+            std::string point = nodes.at(i) + "#" + std::to_string(r);
+            ring.emplace(stableHash(point), i);
+        }
+    }
+}
+
+const std::string& HashRing::getNode(const std::string& key) const
+{
+    // The key belongs to the first point on or after its hash, wrapping
+    // around to the start
+    auto it = ring.lower_bound(stableHash(key));
+    if (it == ring.end()) {
+        it = ring.begin();
+    }
+
+    return nodes.at(it->second);
+}
+}
@@ -639,6 +639,104 @@ std::string snapshotMergeOpStr(SnapshotMergeOperation op)
     }
 }
 
+size_t snapshotDataTypeSize(SnapshotDataType dt)
+{
+    switch (dt) {
+        case (SnapshotDataType::Raw): {
+            return 0;
+        }
+        case (SnapshotDataType::Bool): {
+            return sizeof(bool);
+        }
+        case (SnapshotDataType::Int): {
+            return sizeof(int32_t);
+        }
+        case (SnapshotDataType::Long): {
+            return sizeof(long);
+        }
+        case (SnapshotDataType::Float): {
+            return sizeof(float);
+        }
+        case (SnapshotDataType::Double): {
+            return sizeof(double);
+        }
+        default: {
+            SPDLOG_ERROR("Cannot get size of snapshot data type: {}", dt);
+            throw std::runtime_error("Cannot get size of data type");
+        }
+    }
+}
+
+template<typename T>
+static void applyDiffValuesTyped(uint8_t* target,
+                                 std::span<const uint8_t> diff,
+                                 SnapshotMergeOperation operation)
+{
+    if (diff.size() % sizeof(T) != 0) {
+        SPDLOG_ERROR("Merge of {} bytes not a whole number of {}-byte values",
+                     diff.size(),
+                     sizeof(T));
+        throw std::runtime_error("Misaligned merge values");
+    }
+
+    for (size_t i = 0; i < diff.size(); i += sizeof(T)) {
+        T finalValue =
+          applyDiffValue<T>(target + i, diff.data() + i, operation);
+        unalignedWrite<T>(finalValue, target + i);
+    }
+}
+
+void applyDiffValues(uint8_t* target,
+                     std::span<const uint8_t> diff,
+                     SnapshotDataType dataType,
+                     SnapshotMergeOperation operation)
+{
+    switch (operation) {
+        case (SnapshotMergeOperation::Ignore): {
+            return;
+        }
+        case (SnapshotMergeOperation::Bytewise): {
+            std::copy(diff.begin(), diff.end(), target);
+            return;
+        }
+        case (SnapshotMergeOperation::XOR): {
+            std::transform(diff.begin(),
+                           diff.end(),
+                           target,
+                           target,
+                           std::bit_xor<uint8_t>());
+            return;
+        }
+        default:
+            break;
+    }
+
+    switch (dataType) {
+        case (SnapshotDataType::Int): {
+            applyDiffValuesTyped<int32_t>(target, diff, operation);
+            break;
+        }
+        case (SnapshotDataType::Long): {
+            applyDiffValuesTyped<long>(target, diff, operation);
+            break;
+        }
+        case (SnapshotDataType::Float): {
+            applyDiffValuesTyped<float>(target, diff, operation);
+            break;
+        }
+        case (SnapshotDataType::Double): {
+            applyDiffValuesTyped<double>(target, diff, operation);
+            break;
+        }
+        default: {
+            SPDLOG_ERROR("Unsupported {} merge of {} values",
+                         snapshotMergeOpStr(operation),
+                         snapshotDataTypeStr(dataType));
+            throw std::runtime_error("Unsupported merge data type");
+        }
+    }
+}
+
 SnapshotMergeRegion::SnapshotMergeRegion(uint32_t offsetIn,
                                          size_t lengthIn,
                                          SnapshotDataType dataTypeIn,
@@ -22,4 +22,60 @@ void maskDouble(unsigned int* maskArray, unsigned long idx)
     maskArray[intIdx + 1] |= STATE_MASK_32;
 }
 
+void ByteRangeSet::add(size_t offset, size_t length)
+{
+    if (length == 0) {
+        return;
+    }
+
+    size_t start = offset;
+    size_t end = offset + length;
+
+    // Merge with the range before, if it reaches the start of this one
+    auto it = ranges.upper_bound(start);
+    if (it != ranges.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second >= start) {
+            start = prev->first;
+            end = std::max(end, prev->second);
+            it = ranges.erase(prev);
+        }
+    }
+
+    // Merge with any ranges that start before the end of this one
+    while (it != ranges.end() && it->first <= end) {
+        end = std::max(end, it->second);
+        it = ranges.erase(it);
+    }
+
+    ranges.emplace_hint(it, start, end);
+}
+
+bool ByteRangeSet::contains(size_t offset, size_t length) const
+{
+    if (length == 0) {
+        return true;
+    }
+
+    // As ranges are never adjacent, only the range starting at or before the
+    // offset can cover it
+    auto it = ranges.upper_bound(offset);
+    if (it == ranges.begin()) {
+        return false;
+    }
+
+    return std::prev(it)->second >= offset + length;
+}
+
+std::vector<std::pair<size_t, size_t>> ByteRangeSet::getRanges() const
+{
+    std::vector<std::pair<size_t, size_t>> result;
+    result.reserve(ranges.size());
+    for (const auto& [start, end] : ranges) {
+        result.emplace_back(start, end - start);
+    }
+
+    return result;
+}
+
 }
@@ -0,0 +1,58 @@
+#include "BenchUtils.h"
+
+#include <faabric/util/logging.h>
+
+#include <sstream>
+#include <stdexcept>
+
+namespace tests {
+
+void parseBenchArgs(int argc,
+                    char* argv[],
+                    const std::string& usage,
+                    const BenchArgs& args)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            fmt::print("{}", usage);
+            exit(0);
+        }
+
+        auto it = args.find(arg);
+        if (it == args.end()) {
+            fmt::print("{}", usage);
+            throw std::runtime_error("Unrecognised option " + arg);
+        }
+
+        if (i + 1 >= argc) {
+            fmt::print("{}", usage);
+            throw std::runtime_error("Missing value for " + arg);
+        }
+
+        it->second(argv[++i]);
+    }
+}
+
+std::vector<int> parseIntList(const std::string& value)
+{
+    std::vector<int> values;
+    std::stringstream ss(value);
+    std::string n;
+    while (std::getline(ss, n, ',')) {
+        values.push_back(std::stoi(n));
+    }
+
+    return values;
+}
+
+void printPercentiles(const std::string& label, std::vector<long>& values)
+{
+    fmt::print("  {:<18} p50={} p90={} p99={} max={}\n",
+               label + ":",
+               percentile(values, 50),
+               percentile(values, 90),
+               percentile(values, 99),
+               percentile(values, 100));
+}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace tests {
+
+// Setters for each option's value, keyed by its flag, e.g. "--messages"
+using BenchArgs =
+  std::map<std::string, std::function<void(const std::string&)>>;
+
+// Parses "--flag value" pairs, printing the usage and exiting on --help, and
+// throwing on anything not in the given setters
+void parseBenchArgs(int argc,
+                    char* argv[],
+                    const std::string& usage,
+                    const BenchArgs& args);
+
+// Parses a comma-separated list of numbers, e.g. "1,4,16"
+std::vector<int> parseIntList(const std::string& value);
+
+template<typename T>
+T percentile(std::vector<T>& values, double p)
+{
+    if (values.empty()) {
+        return 0;
+    }
+
+    std::sort(values.begin(), values.end());
+    size_t idx = std::min(values.size() - 1,
+                          (size_t)(p / 100.0 * (double)values.size()));
+    return values.at(idx);
+}
+
+// Prints the p50, p90, p99 and max of the values on one line
+void printPercentiles(const std::string& label, std::vector<long>& values);
+}
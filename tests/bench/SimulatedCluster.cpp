@@ -0,0 +1,191 @@
+#include "SimulatedCluster.h"
+
+#include <faabric/util/locks.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/macros.h>
+
+namespace tests {
+
+BenchExecutor::BenchExecutor(faabric::Message& msg,
+                             int execMillisIn,
+                             size_t memSizeIn)
+  : Executor(msg)
+  , execMillis(execMillisIn)
+  , memSize(memSizeIn)
+{
+    memory = faabric::util::allocatePrivateMemory(memSize);
+}
+
+std::span<uint8_t> BenchExecutor::getMemoryView()
+{
+    return { memory.get(), memSize };
+}
+
+int32_t BenchExecutor::executeTask(
+  int threadPoolIdx,
+  int msgIdx,
+  std::shared_ptr<faabric::BatchExecuteRequest> req)
+{
+    if (execMillis > 0) {
+        SLEEP_MS(execMillis);
+    }
+
+    return 0;
+}
+
+BenchExecutorFactory::BenchExecutorFactory(int execMillisIn, size_t memSizeIn)
+  : execMillis(execMillisIn)
+  , memSize(memSizeIn)
+{}
+
+std::shared_ptr<faabric::scheduler::Executor>
+BenchExecutorFactory::createExecutor(faabric::Message& msg)
+{
+    return std::make_shared<BenchExecutor>(msg, execMillis, memSize);
+}
+
+SimulatedHost::SimulatedHost(const std::string& hostIn,
+                             int slotsIn,
+                             int latencyMillisIn,
+                             int execMillisIn)
+  : host(hostIn)
+  , slots(slotsIn)
+  , latencyMillis(latencyMillisIn)
+  , execMillis(execMillisIn)
+{
+    completionThread = std::jthread([this] { completeCalls(); });
+}
+
+SimulatedHost::~SimulatedHost()
+{
+    stop();
+}
+
+void SimulatedHost::stop()
+{
+    {
+        faabric::util::UniqueLock lock(mx);
+        if (stopped) {
+            return;
+        }
+
+        stopped = true;
+    }
+
+    cv.notify_all();
+
+    if (completionThread.joinable()) {
+        completionThread.join();
+    }
+}
+
+faabric::HostResources SimulatedHost::getResources()
+{
+    if (latencyMillis > 0) {
+        SLEEP_MS(latencyMillis);
+    }
+
+    faabric::HostResources res;
+    res.set_slots(slots);
+    res.set_usedslots(usedSlots.load(std::memory_order_acquire));
+    return res;
+}
+
+int SimulatedHost::tryReserve(int slotsRequested, bool force)
+{
+    if (latencyMillis > 0) {
+        SLEEP_MS(latencyMillis);
+    }
+
+    if (force) {
+        usedSlots.fetch_add(slotsRequested, std::memory_order_acq_rel);
+        return slotsRequested;
+    }
+
+    // Same as a real host, only hand out slots that are actually free
+    int used = usedSlots.load(std::memory_order_acquire);
+    int allocated = 0;
+    do {
+        allocated = std::min(std::max(0, slots - used), slotsRequested);
+    } while (!usedSlots.compare_exchange_weak(
+      used, used + allocated, std::memory_order_acq_rel));
+
+    return allocated;
+}
+
+void SimulatedHost::executeFunctions(
+  std::shared_ptr<faabric::BatchExecuteRequest> req)
+{
+    bool isThreads = req->type() == faabric::BatchExecuteRequest::THREADS;
+    int nCalls = req->messages_size();
+
+    int nNowRunning = nRunning.fetch_add(nCalls) + nCalls;
+    if (nNowRunning > slots) {
+        nOverloaded += std::min(nCalls, nNowRunning - slots);
+    }
+    nExecuted += nCalls;
+
+    // Sending the calls is asynchronous, so only the calls themselves wait on
+    // the network
+    Clock::time_point at =
+      Clock::now() + std::chrono::milliseconds(latencyMillis + execMillis);
+    {
+        faabric::util::UniqueLock lock(mx);
+        for (const auto& m : req->messages()) {
+            completions.push({ at, m, isThreads });
+        }
+    }
+
+    cv.notify_one();
+}
+
+void SimulatedHost::completeCalls()
+{
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+
+    std::vector<Completion> due;
+    faabric::util::UniqueLock lock(mx);
+    while (!stopped) {
+        if (completions.empty()) {
+            cv.wait(lock, [this] { return stopped || !completions.empty(); });
+            continue;
+        }
+
+        Clock::time_point next = completions.top().at;
+        if (Clock::now() < next) {
+            cv.wait_until(lock, next);
+            continue;
+        }
+
+        due.clear();
+        while (!completions.empty() && completions.top().at <= Clock::now()) {
+            due.push_back(completions.top());
+            completions.pop();
+        }
+
+        // Results go back through the scheduler, which mustn't be called
+        // with the lock held
+        lock.unlock();
+        for (auto& c : due) {
+            if (c.isThread) {
+                sch.setThreadResultLocally(c.msg.id(), 0);
+            } else {
+                c.msg.set_returnvalue(0);
+                sch.setFunctionResult(c.msg);
+            }
+
+            nRunning--;
+
+            int used = usedSlots.load(std::memory_order_acquire);
+            while (used > 0 && !usedSlots.compare_exchange_weak(
+                                 used, used - 1, std::memory_order_acq_rel)) {
+            }
+        }
+        lock.lock();
+    }
+
+    SPDLOG_DEBUG("Simulated host {} stopped with {} calls outstanding",
+                 host,
+                 completions.size());
+}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <faabric/scheduler/ExecutorFactory.h>
+#include <faabric/scheduler/FunctionCallClient.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/util/memory.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tests {
+
+// Executor that just takes a fixed time to run each task. Its memory is only
+// there for threads to restore snapshots into.
+class BenchExecutor final : public faabric::scheduler::Executor
+{
+  public:
+    BenchExecutor(faabric::Message& msg, int execMillisIn, size_t memSizeIn);
+
+    std::span<uint8_t> getMemoryView() override;
+
+  protected:
+    int32_t executeTask(
+      int threadPoolIdx,
+      int msgIdx,
+      std::shared_ptr<faabric::BatchExecuteRequest> req) override;
+
+  private:
+    const int execMillis;
+    const size_t memSize;
+
+    faabric::util::MemoryRegion memory = nullptr;
+};
+
+class BenchExecutorFactory final : public faabric::scheduler::ExecutorFactory
+{
+  public:
+    BenchExecutorFactory(int execMillisIn, size_t memSizeIn);
+
+    std::shared_ptr<faabric::scheduler::Executor> createExecutor(
+      faabric::Message& msg) override;
+
+  private:
+    const int execMillis;
+    const size_t memSize;
+};
+
+/**
+ * A remote host with a fixed number of slots, answering the scheduler's
+ * requests in mock mode as a real host would, only with simulated latency.
+ *
+ * Synchronous requests take a round-trip before returning, while calls
+ * complete a round-trip plus their execution time after being sent, at which
+ * point their results are sent back to this host as if from the remote one.
+ */
+class SimulatedHost final : public faabric::scheduler::MockHost
+{
+  public:
+    SimulatedHost(const std::string& hostIn,
+                  int slotsIn,
+                  int latencyMillisIn,
+                  int execMillisIn);
+
+    ~SimulatedHost();
+
+    faabric::HostResources getResources() override;
+
+    int tryReserve(int slots, bool force) override;
+
+    void executeFunctions(
+      std::shared_ptr<faabric::BatchExecuteRequest> req) override;
+
+    void stop();
+
+    const std::string& getHost() const { return host; }
+
+    int getSlots() const { return slots; }
+
+    long getExecutedCount() const { return nExecuted; }
+
+    // Calls that arrived while all the host's slots were busy
+    long getOverloadedCount() const { return nOverloaded; }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Completion
+    {
+        Clock::time_point at;
+        faabric::Message msg;
+        bool isThread = false;
+
+        bool operator>(const Completion& other) const
+        {
+            return at > other.at;
+        }
+    };
+
+    const std::string host;
+    const int slots;
+    const int latencyMillis;
+    const int execMillis;
+
+    std::atomic<int> usedSlots = 0;
+    std::atomic<int> nRunning = 0;
+    std::atomic<long> nExecuted = 0;
+    std::atomic<long> nOverloaded = 0;
+
+    std::mutex mx;
+    std::condition_variable cv;
+    std::priority_queue<Completion,
+                        std::vector<Completion>,
+                        std::greater<Completion>>
+      completions;
+    bool stopped = false;
+
+    std::jthread completionThread;
+
+    void completeCalls();
+};
+}
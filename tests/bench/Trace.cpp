@@ -0,0 +1,135 @@
+#include "Trace.h"
+
+#include <faabric/util/logging.h>
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace tests {
+
+std::vector<TraceEntry> generateTrace(const TraceOptions& options)
+{
+    if (options.maxBatchSize <= 0 || options.nFunctions <= 0) {
+        SPDLOG_ERROR("Invalid trace options: batch size {}, {} functions",
+                     options.maxBatchSize,
+                     options.nFunctions);
+        throw std::runtime_error("Invalid trace options");
+    }
+
+    std::mt19937 gen(options.seed);
+    std::uniform_real_distribution<double> typeDist(0, 1);
+    std::uniform_int_distribution<int> sizeDist(1, options.maxBatchSize);
+    std::uniform_int_distribution<int> funcDist(0, options.nFunctions - 1);
+
+    std::vector<TraceEntry> trace;
+    trace.reserve(options.nBatches);
+
+    double arrival = 0;
+    for (int i = 0; i < options.nBatches; i++) {
+        TraceEntry& entry = trace.emplace_back();
+        entry.arrivalMillis = (long)arrival;
+
+        double r = typeDist(gen);
+        if (r < options.threadsFraction) {
+            entry.type = TraceCallType::THREADS;
+            entry.nMessages = options.maxBatchSize;
+        } else if (r < options.threadsFraction + options.mpiFraction) {
+            entry.type = TraceCallType::MPI;
+            entry.nMessages = options.maxBatchSize;
+        } else {
+            entry.type = TraceCallType::FUNCTIONS;
+            entry.nMessages = sizeDist(gen);
+        }
+
+        entry.function = "func_" + std::to_string(funcDist(gen));
+
+        if (options.meanIntervalMillis > 0) {
+            std::exponential_distribution<double> intervalDist(
+              1.0 / options.meanIntervalMillis);
+            arrival += intervalDist(gen);
+        }
+    }
+
+    return trace;
+}
+
+std::vector<TraceEntry> loadTrace(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        SPDLOG_ERROR("Could not open trace file {}", path);
+        throw std::runtime_error("Could not open trace file");
+    }
+
+    std::vector<TraceEntry> trace;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+
+        std::stringstream ss(line);
+        std::string arrival, type, nMessages, function;
+        std::getline(ss, arrival, ',');
+        std::getline(ss, type, ',');
+        std::getline(ss, nMessages, ',');
+        std::getline(ss, function, ',');
+
+        TraceEntry& entry = trace.emplace_back();
+        try {
+            entry.arrivalMillis = std::stol(arrival);
+            entry.nMessages = std::stoi(nMessages);
+        } catch (std::exception& e) {
+            SPDLOG_ERROR("Invalid trace line {}: {}", lineNumber, line);
+            throw std::runtime_error("Invalid trace line");
+        }
+
+        if (type == "functions") {
+            entry.type = TraceCallType::FUNCTIONS;
+        } else if (type == "threads") {
+            entry.type = TraceCallType::THREADS;
+        } else if (type == "mpi") {
+            entry.type = TraceCallType::MPI;
+        } else {
+            SPDLOG_ERROR("Invalid call type on trace line {}: {}",
+                         lineNumber,
+                         type);
+            throw std::runtime_error("Invalid trace call type");
+        }
+
+        if (entry.nMessages <= 0 || function.empty()) {
+            SPDLOG_ERROR("Invalid trace line {}: {}", lineNumber, line);
+            throw std::runtime_error("Invalid trace line");
+        }
+
+        entry.function = function;
+    }
+
+    // Entries are replayed in order of arrival
+    std::stable_sort(
+      trace.begin(), trace.end(), [](const auto& a, const auto& b) {
+          return a.arrivalMillis < b.arrivalMillis;
+      });
+
+    return trace;
+}
+
+std::string traceCallTypeToString(TraceCallType type)
+{
+    switch (type) {
+        case TraceCallType::FUNCTIONS:
+            return "functions";
+        case TraceCallType::THREADS:
+            return "threads";
+        case TraceCallType::MPI:
+            return "mpi";
+    }
+
+    return "unknown";
+}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace tests {
+
+enum class TraceCallType
+{
+    FUNCTIONS,
+    THREADS,
+    MPI,
+};
+
+// A single batch arriving at the scheduler
+struct TraceEntry
+{
+    long arrivalMillis = 0;
+    TraceCallType type = TraceCallType::FUNCTIONS;
+    int nMessages = 1;
+    std::string function;
+};
+
+struct TraceOptions
+{
+    int nBatches = 1000;
+
+    // Arrivals are a Poisson process with this mean interval. Zero sends
+    // everything at once.
+    double meanIntervalMillis = 1;
+
+    // Function batches are between one and this many messages, while thread
+    // and MPI batches are always this size
+    int maxBatchSize = 4;
+
+    double threadsFraction = 0.1;
+    double mpiFraction = 0.05;
+
+    // Calls are spread across this many distinct functions
+    int nFunctions = 10;
+
+    unsigned int seed = 1;
+};
+
+std::vector<TraceEntry> generateTrace(const TraceOptions& options);
+
+// Loads a trace from a CSV file with one batch per line, in the form:
+//   <arrival millis>,<functions|threads|mpi>,<messages>,<function>
+// Blank lines and lines starting with # are ignored.
+std::vector<TraceEntry> loadTrace(const std::string& path);
+
+std::string traceCallTypeToString(TraceCallType type);
+}
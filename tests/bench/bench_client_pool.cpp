@@ -0,0 +1,244 @@
+#include "BenchUtils.h"
+
+#include <faabric/proto/faabric.pb.h>
+#include <faabric/transport/ConnectionPool.h>
+#include <faabric/transport/MessageEndpointClient.h>
+#include <faabric/transport/MessageEndpointServer.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/config.h>
+#include <faabric/util/latch.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/network.h>
+#include <faabric/util/timing.h>
+
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+using namespace tests;
+
+#define BENCH_ASYNC_PORT 9994
+#define BENCH_SYNC_PORT 9995
+
+#define ECHO_HEADER 0
+
+// Threads wait on each other for as long as the slowest one's calls take
+#define BENCH_LATCH_TIMEOUT_MS 300000
+
+struct PoolBenchOptions
+{
+    int nCalls = 200;
+    int nWorkers = 4;
+    int poolSize = 4;
+    std::vector<int> threadCounts = { 16, 128, 512 };
+};
+
+static const std::string usage =
+  "Usage: faabric_client_pool_bench [options]\n"
+  "  --threads <list>  executor threads to try (16,128,512)\n"
+  "  --calls <n>       sync calls made by each thread (200)\n"
+  "  --pool-size <n>   connections in the pool (4)\n"
+  "  --workers <n>     server worker threads (4)\n";
+
+class EchoServer final : public faabric::transport::MessageEndpointServer
+{
+  public:
+    explicit EchoServer(int nWorkers)
+      : MessageEndpointServer(BENCH_ASYNC_PORT,
+                              BENCH_SYNC_PORT,
+                              "bench-echo",
+                              nWorkers)
+    {}
+
+  protected:
+    void doAsyncRecv(faabric::transport::Message& message) override
+    {
+        throw std::runtime_error("Bench server not expecting async recv");
+    }
+
+    std::unique_ptr<google::protobuf::Message> doSyncRecv(
+      faabric::transport::Message& message) override
+    {
+        return std::make_unique<faabric::EmptyResponse>();
+    }
+};
+
+// Counts the established TCP connections from clients to the given port
+static int countConnectionsTo(int port)
+{
+    int count = 0;
+    for (const std::string path : { "/proc/net/tcp", "/proc/net/tcp6" }) {
+        std::ifstream in(path);
+        std::string line;
+
+        // Skip the header
+        std::getline(in, line);
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string slot;
+            std::string local;
+            std::string remote;
+            std::string state;
+            fields >> slot >> local >> remote >> state;
+
+            // Addresses are <hex address>:<hex port>, and 01 is established
+            size_t colon = remote.rfind(':');
+            if (colon == std::string::npos || state != "01") {
+                continue;
+            }
+
+            if (std::stoi(remote.substr(colon + 1), nullptr, 16) == port) {
+                count++;
+            }
+        }
+    }
+
+    return count;
+}
+
+struct PoolRun
+{
+    int nConnections = 0;
+    double callsPerSec = 0;
+    std::vector<long> callMicros;
+};
+
+// Every thread makes its own client, as executor threads do, and makes its
+// calls. Connections are counted once all the calls are done, while every
+// client is still open.
+static PoolRun runThreads(const PoolBenchOptions& opts,
+                          int nThreads,
+                          bool pooled)
+{
+    std::mutex resultsMx;
+    PoolRun run;
+
+    auto startLatch =
+      faabric::util::Latch::create(nThreads + 1, BENCH_LATCH_TIMEOUT_MS);
+    auto doneLatch =
+      faabric::util::Latch::create(nThreads + 1, BENCH_LATCH_TIMEOUT_MS);
+    auto countedLatch =
+      faabric::util::Latch::create(nThreads + 1, BENCH_LATCH_TIMEOUT_MS);
+
+    faabric::util::TimePoint t;
+    double secs = 0;
+    {
+        std::vector<std::jthread> threads;
+        for (int i = 0; i < nThreads; i++) {
+            threads.emplace_back([&] {
+                faabric::transport::MessageEndpointClient cli(
+                  LOCALHOST,
+                  BENCH_ASYNC_PORT,
+                  BENCH_SYNC_PORT,
+                  DEFAULT_SOCKET_TIMEOUT_MS,
+                  pooled);
+
+                std::vector<long> micros;
+                micros.reserve(opts.nCalls);
+
+                startLatch->wait();
+                for (int c = 0; c < opts.nCalls; c++) {
+                    faabric::util::TimePoint callT =
+                      faabric::util::startTimer();
+                    faabric::EmptyRequest req;
+                    faabric::EmptyResponse resp;
+                    cli.syncSend(ECHO_HEADER, &req, &resp);
+                    micros.push_back(faabric::util::getTimeDiffMicros(callT));
+                }
+
+                {
+                    std::scoped_lock lock(resultsMx);
+                    run.callMicros.insert(
+                      run.callMicros.end(), micros.begin(), micros.end());
+                }
+
+                doneLatch->wait();
+                countedLatch->wait();
+            });
+        }
+
+        startLatch->wait();
+        t = faabric::util::startTimer();
+
+        doneLatch->wait();
+        secs = faabric::util::getTimeDiffMillis(t) / 1000.0;
+        run.nConnections = countConnectionsTo(BENCH_SYNC_PORT);
+
+        countedLatch->wait();
+    }
+
+    run.callsPerSec = (double)run.callMicros.size() / secs;
+
+    // Pooled connections are shared until cleared, so each run starts afresh
+    faabric::transport::clearConnectionPools();
+
+    return run;
+}
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    PoolBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--threads",
+          [&](const std::string& v) { opts.threadCounts = parseIntList(v); } },
+        { "--calls",
+          [&](const std::string& v) { opts.nCalls = std::stoi(v); } },
+        { "--pool-size",
+          [&](const std::string& v) {
+              opts.poolSize = std::max(1, std::stoi(v));
+          } },
+        { "--workers",
+          [&](const std::string& v) { opts.nWorkers = std::stoi(v); } },
+      });
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.transportClientPoolSize = opts.poolSize;
+
+    faabric::transport::initGlobalMessageContext();
+
+    {
+        EchoServer server(opts.nWorkers);
+        server.start();
+
+        fmt::print("\n---- Pooled client benchmark ----\n");
+        fmt::print("{} sync calls per thread, pool of {} connections, {} "
+                   "server workers\n\n",
+                   opts.nCalls,
+                   opts.poolSize,
+                   opts.nWorkers);
+
+        fmt::print("{:<8} {:<10} {:>12} {:>12} {:>10} {:>10}\n",
+                   "Threads",
+                   "Clients",
+                   "Connections",
+                   "Calls/s",
+                   "p50 us",
+                   "p99 us");
+
+        for (int nThreads : opts.threadCounts) {
+            for (bool pooled : { false, true }) {
+                PoolRun run = runThreads(opts, nThreads, pooled);
+                fmt::print("{:<8} {:<10} {:>12} {:>12.0f} {:>10} {:>10}\n",
+                           nThreads,
+                           pooled ? "pooled" : "per-thread",
+                           run.nConnections,
+                           run.callsPerSec,
+                           percentile(run.callMicros, 50),
+                           percentile(run.callMicros, 99));
+            }
+        }
+
+        server.stop();
+    }
+
+    faabric::transport::closeGlobalMessageContext();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,209 @@
+#include "BenchUtils.h"
+
+#include <faabric/proto/faabric.pb.h>
+#include <faabric/transport/MessageEndpointClient.h>
+#include <faabric/transport/MessageEndpointServer.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/macros.h>
+#include <faabric/util/network.h>
+#include <faabric/util/timing.h>
+
+#include <atomic>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+using namespace tests;
+
+#define BENCH_ASYNC_PORT 9996
+#define BENCH_SYNC_PORT 9997
+
+#define BULK_HEADER 0
+#define SMALL_HEADER 1
+
+struct ServerBenchOptions
+{
+    int nWorkers = 4;
+    int nBulkClients = 4;
+    int bulkKb = 4096;
+    int nSmallClients = 1;
+    int nSmallRequests = 2000;
+    int smallIntervalMicros = 500;
+    bool prioritiseSmall = false;
+};
+
+static const std::string usage =
+  "Usage: faabric_endpoint_server_bench [options]\n"
+  "  --workers <n>            server worker threads (4)\n"
+  "  --bulk-clients <n>       clients sending bulk requests nonstop (4)\n"
+  "  --bulk-kb <n>            size of each bulk request (4096)\n"
+  "  --small-clients <n>      clients sending small requests (1)\n"
+  "  --small-requests <n>     small requests per client (2000)\n"
+  "  --small-interval-us <n>  pause between small requests (500)\n"
+  "  --priority <0|1>         let small requests overtake bulk ones (0)\n";
+
+// Bulk requests are read through, as a server would when copying them into
+// place, while small ones are answered straight away
+class MixedServer final : public faabric::transport::MessageEndpointServer
+{
+  public:
+    MixedServer(int nWorkers, bool prioritiseSmallIn)
+      : MessageEndpointServer(BENCH_ASYNC_PORT,
+                              BENCH_SYNC_PORT,
+                              "bench-mixed",
+                              nWorkers)
+      , prioritiseSmall(prioritiseSmallIn)
+    {}
+
+  protected:
+    void doAsyncRecv(faabric::transport::Message& message) override
+    {
+        throw std::runtime_error("Bench server not expecting async recv");
+    }
+
+    std::unique_ptr<google::protobuf::Message> doSyncRecv(
+      faabric::transport::Message& message) override
+    {
+        if (message.getHeader() == BULK_HEADER) {
+            volatile uint8_t sum = std::accumulate(
+              message.udata(), message.udata() + message.size(), (uint8_t)0);
+            UNUSED(sum);
+        }
+
+        return std::make_unique<faabric::EmptyResponse>();
+    }
+
+    bool isHighPriority(uint8_t header, bool async) override
+    {
+        return prioritiseSmall && header == SMALL_HEADER;
+    }
+
+  private:
+    const bool prioritiseSmall;
+};
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    ServerBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--workers",
+          [&](const std::string& v) { opts.nWorkers = std::stoi(v); } },
+        { "--bulk-clients",
+          [&](const std::string& v) { opts.nBulkClients = std::stoi(v); } },
+        { "--bulk-kb",
+          [&](const std::string& v) { opts.bulkKb = std::stoi(v); } },
+        { "--small-clients",
+          [&](const std::string& v) { opts.nSmallClients = std::stoi(v); } },
+        { "--small-requests",
+          [&](const std::string& v) { opts.nSmallRequests = std::stoi(v); } },
+        { "--small-interval-us",
+          [&](const std::string& v) {
+              opts.smallIntervalMicros = std::stoi(v);
+          } },
+        { "--priority",
+          [&](const std::string& v) {
+              opts.prioritiseSmall = std::stoi(v) != 0;
+          } },
+      });
+
+    faabric::transport::initGlobalMessageContext();
+
+    std::mutex resultsMx;
+    std::vector<long> bulkMicros;
+    std::vector<long> smallMicros;
+    std::atomic<bool> stopBulk = false;
+
+    std::vector<uint8_t> bulkData((size_t)std::max(1, opts.bulkKb) * 1024, 1);
+
+    double totalSeconds = 0;
+    {
+        MixedServer server(opts.nWorkers, opts.prioritiseSmall);
+        server.start();
+
+        faabric::util::TimePoint startedAt = faabric::util::startTimer();
+        {
+            // Bulk clients keep the workers busy until the small clients finish
+            std::vector<std::jthread> bulkClients;
+            for (int i = 0; i < opts.nBulkClients; i++) {
+                bulkClients.emplace_back([&] {
+                    faabric::transport::MessageEndpointClient cli(
+                      LOCALHOST, BENCH_ASYNC_PORT, BENCH_SYNC_PORT);
+
+                    std::vector<long> micros;
+                    while (!stopBulk) {
+                        faabric::util::TimePoint t =
+                          faabric::util::startTimer();
+                        faabric::EmptyResponse resp;
+                        cli.syncSend(
+                          BULK_HEADER, bulkData.data(), bulkData.size(), &resp);
+                        micros.push_back(faabric::util::getTimeDiffMicros(t));
+                    }
+
+                    std::scoped_lock lock(resultsMx);
+                    bulkMicros.insert(
+                      bulkMicros.end(), micros.begin(), micros.end());
+                });
+            }
+
+            std::vector<std::jthread> smallClients;
+            for (int i = 0; i < opts.nSmallClients; i++) {
+                smallClients.emplace_back([&] {
+                    faabric::transport::MessageEndpointClient cli(
+                      LOCALHOST, BENCH_ASYNC_PORT, BENCH_SYNC_PORT);
+
+                    std::vector<long> micros;
+                    uint8_t data = 0;
+                    for (int r = 0; r < opts.nSmallRequests; r++) {
+                        faabric::util::TimePoint t =
+                          faabric::util::startTimer();
+                        faabric::EmptyResponse resp;
+                        cli.syncSend(SMALL_HEADER, &data, sizeof(data), &resp);
+                        micros.push_back(faabric::util::getTimeDiffMicros(t));
+
+                        std::this_thread::sleep_for(
+                          std::chrono::microseconds(opts.smallIntervalMicros));
+                    }
+
+                    std::scoped_lock lock(resultsMx);
+                    smallMicros.insert(
+                      smallMicros.end(), micros.begin(), micros.end());
+                });
+            }
+
+            for (auto& t : smallClients) {
+                t.join();
+            }
+            stopBulk = true;
+        }
+        totalSeconds = faabric::util::getTimeDiffMillis(startedAt) / 1000;
+
+        server.stop();
+    }
+
+    faabric::transport::closeGlobalMessageContext();
+
+    double bulkMb =
+      (double)bulkMicros.size() * bulkData.size() / (1024.0 * 1024.0);
+
+    fmt::print("\n---- Endpoint server benchmark ----\n");
+    fmt::print("{} workers, {} bulk clients x {}KB, {} small clients, "
+               "small priority {}\n\n",
+               opts.nWorkers,
+               opts.nBulkClients,
+               opts.bulkKb,
+               opts.nSmallClients,
+               opts.prioritiseSmall ? "on" : "off");
+    printPercentiles("small us", smallMicros);
+    printPercentiles("bulk us", bulkMicros);
+    fmt::print("  bulk MB/s:          {:.1f}\n",
+               totalSeconds > 0 ? bulkMb / totalSeconds : 0);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,157 @@
+#include "BenchUtils.h"
+
+#include <faabric/transport/PointToPointBroker.h>
+#include <faabric/transport/PointToPointServer.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/network.h>
+#include <faabric/util/scheduling.h>
+#include <faabric/util/timing.h>
+
+#include <thread>
+
+using namespace tests;
+
+#define BENCH_APP_ID 1
+#define BENCH_GROUP_ID 1
+#define PING_IDX 0
+#define PONG_IDX 1
+
+struct PtpBenchOptions
+{
+    int nMessages = 10000;
+    int nWarmup = 1000;
+    int messageBytes = 64;
+    bool local = false;
+};
+
+static const std::string usage =
+  "Usage: faabric_ptp_bench [options]\n"
+  "  --messages <n>  round trips measured (10000)\n"
+  "  --warmup <n>    round trips before measuring (1000)\n"
+  "  --size <n>      bytes per message (64)\n"
+  "  --local <0|1>   stay in-process rather than go over TCP (0)\n"
+  "Transport settings, e.g. TRANSPORT_IO_THREADS, TRANSPORT_IO_CPUS, "
+  "TRANSPORT_SERVER_CPUS and POINT_TO_POINT_BUSY_POLL_US, are read from the "
+  "environment as usual.\n";
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    PtpBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--messages",
+          [&](const std::string& v) { opts.nMessages = std::stoi(v); } },
+        { "--warmup",
+          [&](const std::string& v) { opts.nWarmup = std::stoi(v); } },
+        { "--size",
+          [&](const std::string& v) { opts.messageBytes = std::stoi(v); } },
+        { "--local",
+          [&](const std::string& v) { opts.local = std::stoi(v) != 0; } },
+      });
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.print();
+
+    // Both ends live in this process. Unless staying local, messages are
+    // addressed to this host under another name, so they go over TCP and
+    // through the point-to-point server as they would between hosts.
+    conf.endpointHost = LOCALHOST;
+    const std::string sendHost = opts.local ? LOCALHOST : "localhost";
+
+    faabric::transport::initGlobalMessageContext();
+
+    {
+        faabric::transport::PointToPointServer server;
+        server.start();
+
+        faabric::util::SchedulingDecision decision(BENCH_APP_ID,
+                                                   BENCH_GROUP_ID);
+        for (int idx : { PING_IDX, PONG_IDX }) {
+            faabric::Message msg =
+              faabric::util::messageFactory("bench", "ptp");
+            msg.set_appid(BENCH_APP_ID);
+            msg.set_groupid(BENCH_GROUP_ID);
+            msg.set_groupidx(idx);
+            decision.addMessage(LOCALHOST, msg);
+        }
+
+        auto& broker = faabric::transport::getPointToPointBroker();
+        broker.setUpLocalMappingsFromSchedulingDecision(decision);
+
+        int nTotal = opts.nWarmup + opts.nMessages;
+        std::vector<uint8_t> data(std::max(1, opts.messageBytes), 1);
+
+        std::jthread ponger([nTotal, &sendHost] {
+            auto& b = faabric::transport::getPointToPointBroker();
+            for (int i = 0; i < nTotal; i++) {
+                std::vector<uint8_t> msg =
+                  b.recvMessage(BENCH_GROUP_ID, PING_IDX, PONG_IDX);
+                b.sendMessage(BENCH_GROUP_ID,
+                              PONG_IDX,
+                              PING_IDX,
+                              msg.data(),
+                              msg.size(),
+                              sendHost);
+            }
+
+            b.resetThreadLocalCache();
+        });
+
+        std::vector<long> roundTripMicros;
+        roundTripMicros.reserve(opts.nMessages);
+        faabric::util::TimePoint startedAt;
+        for (int i = 0; i < nTotal; i++) {
+            if (i == opts.nWarmup) {
+                startedAt = faabric::util::startTimer();
+            }
+
+            faabric::util::TimePoint t = faabric::util::startTimer();
+            broker.sendMessage(BENCH_GROUP_ID,
+                               PING_IDX,
+                               PONG_IDX,
+                               data.data(),
+                               data.size(),
+                               sendHost);
+            broker.recvMessage(BENCH_GROUP_ID, PONG_IDX, PING_IDX);
+
+            if (i >= opts.nWarmup) {
+                roundTripMicros.push_back(faabric::util::getTimeDiffMicros(t));
+            }
+        }
+        double totalSeconds =
+          faabric::util::getTimeDiffMillis(startedAt) / 1000;
+
+        ponger.join();
+        broker.resetThreadLocalCache();
+
+        fmt::print("\n---- Point-to-point benchmark ----\n");
+        fmt::print("{} round trips of {} bytes {}\n",
+                   opts.nMessages,
+                   data.size(),
+                   opts.local ? "in-process" : "over TCP");
+        fmt::print("I/O threads {}, I/O CPUs '{}', server CPUs '{}', "
+                   "busy-poll {}us\n\n",
+                   conf.transportIoThreads,
+                   conf.transportIoCpus,
+                   conf.transportServerCpus,
+                   conf.pointToPointBusyPollUs);
+        printPercentiles("round trip us", roundTripMicros);
+        fmt::print("  round trips/s:      {:.1f}\n",
+                   totalSeconds > 0 ? opts.nMessages / totalSeconds : 0);
+
+        broker.clear();
+        server.stop();
+    }
+
+    faabric::transport::closeGlobalMessageContext();
+
+    return EXIT_SUCCESS;
+}
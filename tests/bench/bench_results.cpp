@@ -0,0 +1,132 @@
+#include "BenchUtils.h"
+
+#include <faabric/redis/Redis.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/bytes.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/timing.h>
+
+#include <thread>
+
+using namespace tests;
+
+struct ResultsBenchOptions
+{
+    int nResults = 2000;
+    int resultBytes = 256;
+    std::vector<int> threadCounts = { 1, 4, 16, 64 };
+};
+
+static const std::string usage =
+  "Usage: faabric_results_bench [options]\n"
+  "  --results <n>   results published by each thread (2000)\n"
+  "  --bytes <n>     output data in each result (256)\n"
+  "  --threads <list> publishing threads to try (1,4,16,64)\n"
+  "Needs Redis, and clears out the queue instance between runs.\n";
+
+// Publishes every thread's results at once, then waits for them all to land,
+// returning results per second
+template<typename P, typename W>
+double timePublishing(
+  std::vector<std::vector<faabric::Message>>& msgsPerThread,
+  P publish,
+  W waitForResults)
+{
+    faabric::util::TimePoint t = faabric::util::startTimer();
+
+    std::vector<std::jthread> threads;
+    for (auto& msgs : msgsPerThread) {
+        threads.emplace_back([&msgs, &publish] {
+            for (auto& msg : msgs) {
+                publish(msg);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    waitForResults();
+
+    double secs = faabric::util::getTimeDiffMillis(t) / 1000.0;
+    size_t nResults = msgsPerThread.size() * msgsPerThread.at(0).size();
+    return (double)nResults / secs;
+}
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    ResultsBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--results",
+          [&](const std::string& v) { opts.nResults = std::stoi(v); } },
+        { "--bytes",
+          [&](const std::string& v) { opts.resultBytes = std::stoi(v); } },
+        { "--threads",
+          [&](const std::string& v) { opts.threadCounts = parseIntList(v); } },
+      });
+
+    faabric::transport::initGlobalMessageContext();
+
+    faabric::scheduler::Scheduler& sch = faabric::scheduler::getScheduler();
+    std::string outputData(std::max(0, opts.resultBytes), 'x');
+
+    fmt::print("\n---- Function results benchmark ----\n");
+    fmt::print("{} results of {} bytes per thread\n\n",
+               opts.nResults,
+               outputData.size());
+    fmt::print("{:<10} {:>16} {:>16}\n", "Threads", "Blocking/s", "Pooled/s");
+
+    for (int nThreads : opts.threadCounts) {
+        auto makeMessages = [&] {
+            std::vector<std::vector<faabric::Message>> msgs(nThreads);
+            for (auto& threadMsgs : msgs) {
+                for (int i = 0; i < opts.nResults; i++) {
+                    faabric::Message& msg = threadMsgs.emplace_back(
+                      faabric::util::messageFactory("bench", "results"));
+                    msg.set_outputdata(outputData);
+                }
+            }
+            return msgs;
+        };
+
+        // Each thread waits on its own connection for every result
+        faabric::redis::Redis::getQueue().flushAll();
+        auto blockingMsgs = makeMessages();
+        double blockingRate =
+          timePublishing(
+            blockingMsgs,
+            [](faabric::Message& msg) {
+                std::vector<uint8_t> bytes = faabric::util::messageToBytes(msg);
+                faabric::redis::Redis::getQueue().publishSchedulerResult(
+                  msg.resultkey(), msg.statuskey(), bytes);
+            },
+            [] {});
+
+        // The scheduler pipelines results over the shared async pool, so the
+        // time includes flushing them all at the end
+        faabric::redis::Redis::getQueue().flushAll();
+        auto pooledMsgs = makeMessages();
+        double pooledRate = timePublishing(
+          pooledMsgs,
+          [&sch](faabric::Message& msg) { sch.setFunctionResult(msg); },
+          [&sch] { sch.flushFunctionResults(); });
+
+        fmt::print(
+          "{:<10} {:>16.0f} {:>16.0f}\n", nThreads, blockingRate, pooledRate);
+    }
+
+    faabric::redis::Redis::getQueue().flushAll();
+    sch.shutdown();
+
+    faabric::transport::closeGlobalMessageContext();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+#include "BenchUtils.h"
+#include "SimulatedCluster.h"
+
+#include <faabric/scheduler/FunctionCallClient.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/latch.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/memory.h>
+#include <faabric/util/testing.h>
+#include <faabric/util/timing.h>
+
+#include <thread>
+
+using namespace faabric::scheduler;
+using namespace tests;
+
+#define CONTENTION_RESULT_TIMEOUT_MS 60000
+
+struct ContentionBenchOptions
+{
+    int nHosts = 16;
+    int hostSlots = 8;
+    int localSlots = 8;
+    int latencyMillis = 0;
+    int execMillis = 1;
+    int nBatches = 100;
+    int batchSize = 4;
+    int nFunctions = 1;
+    std::vector<int> callerCounts = { 1, 8, 32, 128, 256 };
+};
+
+static const std::string usage =
+  "Usage: faabric_scheduler_contention_bench [options]\n"
+  "  --callers <list>  concurrent callers to try (1,8,32,128,256)\n"
+  "  --batches <n>     batches sent by each caller (100)\n"
+  "  --batch-size <n>  calls in each batch (4)\n"
+  "  --functions <n>   distinct functions the callers share (1)\n"
+  "  --hosts <n>       simulated remote hosts (16)\n"
+  "  --slots <n>       slots per remote host (8)\n"
+  "  --local-slots <n> slots on this host (8)\n"
+  "  --latency-ms <n>  round-trip to remote hosts (0)\n"
+  "  --exec-ms <n>     execution time of each call (1)\n"
+  "Needs Redis for results. Scheduler settings, e.g. "
+  "RESOURCE_GOSSIP_INTERVAL_SECS, are read from the environment as usual.\n";
+
+struct ContentionRun
+{
+    double decisionsPerSec = 0;
+    std::vector<long> decisionMicros;
+};
+
+// Starts all the callers at once, each sending its batches back to back, and
+// only waits for results once every caller is done
+static ContentionRun runCallers(const ContentionBenchOptions& opts,
+                                int nCallers)
+{
+    Scheduler& sch = getScheduler();
+
+    std::vector<std::vector<long>> micros(nCallers);
+    std::vector<std::vector<int>> msgIds(nCallers);
+    auto startLatch = faabric::util::Latch::create(nCallers + 1);
+
+    faabric::util::TimePoint t;
+    {
+        std::vector<std::jthread> callers;
+        for (int c = 0; c < nCallers; c++) {
+            callers.emplace_back([&, c] {
+                std::string function =
+                  "contend_" + std::to_string(c % opts.nFunctions);
+
+                startLatch->wait();
+                for (int b = 0; b < opts.nBatches; b++) {
+                    auto req = faabric::util::batchExecFactory(
+                      "bench", function, opts.batchSize);
+                    for (const auto& m : req->messages()) {
+                        msgIds.at(c).push_back(m.id());
+                    }
+
+                    faabric::util::TimePoint callT =
+                      faabric::util::startTimer();
+                    sch.callFunctions(req);
+                    micros.at(c).push_back(
+                      faabric::util::getTimeDiffMicros(callT));
+                }
+            });
+        }
+
+        startLatch->wait();
+        t = faabric::util::startTimer();
+    }
+    double secs = faabric::util::getTimeDiffMillis(t) / 1000.0;
+
+    ContentionRun run;
+    for (int c = 0; c < nCallers; c++) {
+        run.decisionMicros.insert(
+          run.decisionMicros.end(), micros.at(c).begin(), micros.at(c).end());
+
+        for (int id : msgIds.at(c)) {
+            sch.getFunctionResult(id, CONTENTION_RESULT_TIMEOUT_MS);
+        }
+    }
+
+    run.decisionsPerSec = (double)run.decisionMicros.size() / secs;
+    return run;
+}
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    ContentionBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--callers",
+          [&](const std::string& v) { opts.callerCounts = parseIntList(v); } },
+        { "--batches",
+          [&](const std::string& v) { opts.nBatches = std::stoi(v); } },
+        { "--batch-size",
+          [&](const std::string& v) { opts.batchSize = std::stoi(v); } },
+        { "--functions",
+          [&](const std::string& v) {
+              opts.nFunctions = std::max(1, std::stoi(v));
+          } },
+        { "--hosts",
+          [&](const std::string& v) { opts.nHosts = std::stoi(v); } },
+        { "--slots",
+          [&](const std::string& v) { opts.hostSlots = std::stoi(v); } },
+        { "--local-slots",
+          [&](const std::string& v) { opts.localSlots = std::stoi(v); } },
+        { "--latency-ms",
+          [&](const std::string& v) { opts.latencyMillis = std::stoi(v); } },
+        { "--exec-ms",
+          [&](const std::string& v) { opts.execMillis = std::stoi(v); } },
+      });
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.print();
+
+    faabric::transport::initGlobalMessageContext();
+
+    // Everything remote is simulated, but results still go through Redis
+    faabric::util::setMockMode(true);
+
+    setExecutorFactory(std::make_shared<BenchExecutorFactory>(
+      opts.execMillis, faabric::util::HOST_PAGE_SIZE));
+
+    Scheduler& sch = getScheduler();
+    sch.shutdown();
+
+    for (const auto& h : sch.getAvailableHosts()) {
+        sch.removeHostFromGlobalSet(h);
+    }
+    sch.addHostToGlobalSet();
+
+    faabric::HostResources res;
+    res.set_slots(opts.localSlots);
+    sch.setThisHostResources(res);
+
+    std::vector<std::shared_ptr<SimulatedHost>> hosts;
+    for (int i = 0; i < opts.nHosts; i++) {
+        std::string host = "sim-host-" + std::to_string(i);
+        auto simHost = std::make_shared<SimulatedHost>(
+          host, opts.hostSlots, opts.latencyMillis, opts.execMillis);
+
+        hosts.push_back(simHost);
+        setMockHost(host, simHost);
+        sch.addHostToGlobalSet(host);
+    }
+
+    fmt::print("\n---- Scheduler contention benchmark ----\n");
+    fmt::print("{} batches of {} calls per caller, {} function(s), this host "
+               "({} slots) + {} hosts x {} slots, {}ms round-trip\n\n",
+               opts.nBatches,
+               opts.batchSize,
+               opts.nFunctions,
+               opts.localSlots,
+               opts.nHosts,
+               opts.hostSlots,
+               opts.latencyMillis);
+
+    fmt::print("{:<8} {:>14} {:>10} {:>10} {:>10}\n",
+               "Callers",
+               "Decisions/s",
+               "p50 us",
+               "p99 us",
+               "max us");
+
+    for (int nCallers : opts.callerCounts) {
+        ContentionRun run = runCallers(opts, nCallers);
+        fmt::print("{:<8} {:>14.0f} {:>10} {:>10} {:>10}\n",
+                   nCallers,
+                   run.decisionsPerSec,
+                   percentile(run.decisionMicros, 50),
+                   percentile(run.decisionMicros, 99),
+                   percentile(run.decisionMicros, 100));
+    }
+
+    for (auto& h : hosts) {
+        h->stop();
+    }
+
+    sch.shutdown();
+    faabric::scheduler::clearMockRequests();
+    faabric::util::setMockMode(false);
+
+    faabric::transport::closeGlobalMessageContext();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+#include "BenchUtils.h"
+
+#include <faabric/snapshot/SnapshotClient.h>
+#include <faabric/snapshot/SnapshotServer.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/config.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/snapshot.h>
+#include <faabric/util/timing.h>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace tests;
+
+struct FanOutBenchOptions
+{
+    int snapshotMb = 16;
+    int nRepeats = 5;
+    std::vector<int> hostCounts = { 1, 2, 4, 8, 16, 32 };
+    std::vector<int> fanOuts = { 0, 2, 4 };
+};
+
+static const std::string usage =
+  "Usage: faabric_snapshot_fanout_bench [options]\n"
+  "  --mb <n>        snapshot size (16)\n"
+  "  --repeats <n>   pushes timed for each setting (5)\n"
+  "  --hosts <list>  hosts to push to (1,2,4,8,16,32)\n"
+  "  --fan-outs <list> broadcast fan-outs, 0 for no relays (0,2,4)\n"
+  "Each simulated host is a child process with a snapshot server bound to "
+  "its own loopback address, from 127.0.0.2 up.\n";
+
+static std::string getSimulatedHost(int idx)
+{
+    return "127.0.0." + std::to_string(idx + 2);
+}
+
+// Runs a snapshot server as the given host until the parent closes the pipe
+static void runSimulatedHost(const std::string& host, int readyFd, int stopFd)
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.endpointHost = host;
+    conf.transportBindHost = host;
+
+    faabric::transport::initGlobalMessageContext();
+    faabric::snapshot::SnapshotServer server;
+    server.start();
+
+    char ready = 1;
+    if (write(readyFd, &ready, 1) != 1) {
+        SPDLOG_ERROR("Simulated host {} failed to report ready", host);
+    }
+
+    char stop;
+    while (read(stopFd, &stop, 1) > 0) {
+    }
+
+    server.stop();
+    faabric::transport::closeGlobalMessageContext();
+}
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    FanOutBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--mb",
+          [&](const std::string& v) { opts.snapshotMb = std::stoi(v); } },
+        { "--repeats",
+          [&](const std::string& v) { opts.nRepeats = std::stoi(v); } },
+        { "--hosts",
+          [&](const std::string& v) { opts.hostCounts = parseIntList(v); } },
+        { "--fan-outs",
+          [&](const std::string& v) { opts.fanOuts = parseIntList(v); } },
+      });
+
+    int nHosts = 0;
+    for (int n : opts.hostCounts) {
+        nHosts = std::max(nHosts, n);
+    }
+
+    if (nHosts <= 0 || nHosts > 250) {
+        fmt::print("{}", usage);
+        throw std::runtime_error("Unsupported number of hosts");
+    }
+
+    // The simulated hosts are forked before this process touches ZeroMQ
+    int readyPipe[2];
+    int stopPipe[2];
+    if (pipe(readyPipe) != 0 || pipe(stopPipe) != 0) {
+        throw std::runtime_error("Failed to create pipes");
+    }
+
+    std::vector<pid_t> children;
+    std::vector<std::string> hosts;
+    for (int i = 0; i < nHosts; i++) {
+        std::string host = getSimulatedHost(i);
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("Failed to fork simulated host");
+        }
+
+        if (pid == 0) {
+            close(readyPipe[0]);
+            close(stopPipe[1]);
+            runSimulatedHost(host, readyPipe[1], stopPipe[0]);
+            _exit(0);
+        }
+
+        children.push_back(pid);
+        hosts.push_back(host);
+    }
+
+    close(readyPipe[1]);
+    close(stopPipe[0]);
+
+    for (int i = 0; i < nHosts; i++) {
+        char ready;
+        if (read(readyPipe[0], &ready, 1) != 1) {
+            throw std::runtime_error("Simulated host failed to start");
+        }
+    }
+
+    faabric::transport::initGlobalMessageContext();
+
+    size_t snapshotSize = (size_t)std::max(1, opts.snapshotMb) * 1024 * 1024;
+    auto snap = std::make_shared<faabric::util::SnapshotData>(snapshotSize);
+    std::vector<uint8_t> contents(snapshotSize, 3);
+    snap->copyInData(contents);
+
+    fmt::print("\n---- Snapshot fan-out benchmark ----\n");
+    fmt::print("{}MB snapshot, median of {} pushes in ms\n\n",
+               snapshotSize / (1024 * 1024),
+               opts.nRepeats);
+
+    fmt::print("{:<8}", "Hosts");
+    for (int fanOut : opts.fanOuts) {
+        fmt::print(" {:>12}", fmt::format("fan-out {}", fanOut));
+    }
+    fmt::print("\n");
+
+    for (int n : opts.hostCounts) {
+        std::vector<std::string> targets(hosts.begin(), hosts.begin() + n);
+
+        fmt::print("{:<8}", n);
+        for (int fanOut : opts.fanOuts) {
+            // Pushing the same key again replaces the snapshot on each host
+            std::vector<long> millis;
+            for (int r = 0; r < opts.nRepeats; r++) {
+                faabric::util::TimePoint t = faabric::util::startTimer();
+                faabric::snapshot::pushSnapshotToHosts(
+                  targets, "fanout-bench", snap, fanOut);
+                millis.push_back((long)faabric::util::getTimeDiffMillis(t));
+            }
+
+            fmt::print(" {:>12}", percentile(millis, 50));
+        }
+        fmt::print("\n");
+    }
+
+    close(stopPipe[1]);
+    for (pid_t pid : children) {
+        waitpid(pid, nullptr, 0);
+    }
+
+    faabric::transport::closeGlobalMessageContext();
+
+    return EXIT_SUCCESS;
+}
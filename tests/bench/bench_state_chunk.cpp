@@ -0,0 +1,164 @@
+#include "BenchUtils.h"
+
+#include <faabric/state/StateKeyValue.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/memory.h>
+#include <faabric/util/timing.h>
+
+#include <fstream>
+#include <random>
+#include <unistd.h>
+
+using namespace tests;
+
+struct ChunkBenchOptions
+{
+    size_t minMb = 1;
+    size_t maxMb = 4096;
+    int chunkKb = 64;
+    int nOps = 1000;
+    unsigned long seed = 1;
+};
+
+static const std::string usage =
+  "Usage: faabric_state_chunk_bench [options]\n"
+  "  --min-mb <n>    smallest value (1)\n"
+  "  --max-mb <n>    largest value, doubling from the smallest (4096)\n"
+  "  --chunk-kb <n>  size of each chunk read or written (64)\n"
+  "  --ops <n>       chunk reads and writes per value (1000)\n"
+  "  --seed <n>      seed for the chunk offsets (1)\n";
+
+/**
+ * A value with nothing behind it, so only the cost of tracking what's pulled
+ * and dirty on this host is measured
+ */
+class LocalStateKeyValue final : public faabric::state::StateKeyValue
+{
+  public:
+    LocalStateKeyValue(const std::string& key, size_t size)
+      : StateKeyValue("bench", key, size)
+    {}
+
+  protected:
+    void pullFromRemote() override {}
+
+    void pullChunkFromRemote(long offset, size_t length) override {}
+
+    void pushToRemote() override {}
+
+    void appendToRemote(const uint8_t* data, size_t length) override {}
+
+    void pullAppendedFromRemote(uint8_t* data,
+                                size_t length,
+                                long startIdx,
+                                long nValues) override
+    {}
+
+    void clearAppendedFromRemote() override {}
+
+    void pushPartialToRemote(
+      const std::vector<faabric::state::StateChunk>& dirtyChunks) override
+    {}
+
+    void pushMergeToRemote(
+      long offset,
+      const uint8_t* buffer,
+      size_t length,
+      faabric::util::SnapshotDataType dataType,
+      faabric::util::SnapshotMergeOperation operation) override
+    {}
+};
+
+static size_t getResidentBytes()
+{
+    size_t nPages = 0;
+    size_t nResident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> nPages >> nResident;
+    return nResident * sysconf(_SC_PAGESIZE);
+}
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    ChunkBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--min-mb",
+          [&](const std::string& v) { opts.minMb = std::stoul(v); } },
+        { "--max-mb",
+          [&](const std::string& v) { opts.maxMb = std::stoul(v); } },
+        { "--chunk-kb",
+          [&](const std::string& v) { opts.chunkKb = std::stoi(v); } },
+        { "--ops", [&](const std::string& v) { opts.nOps = std::stoi(v); } },
+        { "--seed",
+          [&](const std::string& v) { opts.seed = std::stoul(v); } },
+      });
+
+    size_t chunkSize = (size_t)std::max(1, opts.chunkKb) * 1024;
+    std::vector<uint8_t> buffer(chunkSize, 1);
+
+    fmt::print("\n---- State chunk benchmark ----\n");
+    fmt::print("{} reads and {} writes of {}KB chunks per value\n",
+               opts.nOps,
+               opts.nOps,
+               opts.chunkKb);
+    fmt::print("RSS growth includes the pages of the value that are touched, "
+               "at most {}MB\n\n",
+               2 * (size_t)opts.nOps * chunkSize / (1024 * 1024));
+    fmt::print("  {:>8} {:>14} {:>14} {:>14} {:>14}\n",
+               "value MB",
+               "getChunk us",
+               "setChunk us",
+               "pushPartial us",
+               "RSS growth MB");
+
+    for (size_t mb = std::max<size_t>(1, opts.minMb); mb <= opts.maxMb;
+         mb *= 2) {
+        size_t valueSize = mb * 1024 * 1024;
+        size_t maxOffset = valueSize - std::min(valueSize, chunkSize);
+
+        std::mt19937_64 gen(opts.seed);
+        std::uniform_int_distribution<size_t> offsetDist(0, maxOffset);
+        size_t chunkLength = std::min(valueSize, chunkSize);
+
+        size_t rssBefore = getResidentBytes();
+        {
+            auto kv = std::make_shared<LocalStateKeyValue>(
+              "chunks_" + std::to_string(mb), valueSize);
+
+            // Scattered reads leave many separate pulled ranges
+            faabric::util::TimePoint t = faabric::util::startTimer();
+            for (int i = 0; i < opts.nOps; i++) {
+                kv->getChunk(offsetDist(gen), buffer.data(), chunkLength);
+            }
+            long getMicros = faabric::util::getTimeDiffMicros(t);
+
+            // Likewise for dirty ranges
+            t = faabric::util::startTimer();
+            for (int i = 0; i < opts.nOps; i++) {
+                kv->setChunk(offsetDist(gen), buffer.data(), chunkLength);
+            }
+            long setMicros = faabric::util::getTimeDiffMicros(t);
+
+            t = faabric::util::startTimer();
+            kv->pushPartial();
+            long pushMicros = faabric::util::getTimeDiffMicros(t);
+
+            size_t rssAfter = getResidentBytes();
+            size_t rssGrowth = rssAfter - std::min(rssBefore, rssAfter);
+            fmt::print("  {:>8} {:>14.2f} {:>14.2f} {:>14} {:>14.1f}\n",
+                       mb,
+                       (double)getMicros / opts.nOps,
+                       (double)setMicros / opts.nOps,
+                       pushMicros,
+                       (double)rssGrowth / (1024 * 1024));
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+#include "BenchUtils.h"
+
+#include <faabric/state/State.h>
+#include <faabric/state/StateKeyValue.h>
+#include <faabric/state/StateServer.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/config.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/macros.h>
+#include <faabric/util/network.h>
+#include <faabric/util/snapshot.h>
+#include <faabric/util/timing.h>
+
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+using namespace tests;
+
+#define BENCH_USER "bench"
+
+struct MergeBenchOptions
+{
+    int valueKb = 1024;
+    int updateKb = 64;
+    int nPushes = 200;
+    std::vector<int> pusherCounts = { 1, 2, 4, 8, 16, 32, 64 };
+};
+
+static const std::string usage =
+  "Usage: faabric_state_merge_bench [options]\n"
+  "  --kb <n>         size of the value, as doubles (1024)\n"
+  "  --update-kb <n>  size of each update (64)\n"
+  "  --pushes <n>     updates per pusher (200)\n"
+  "  --pushers <list> concurrent pushers to try (1,2,4,8,16,32,64)\n"
+  "The master's location is kept in Redis, as in the in-memory state mode.\n";
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    MergeBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--kb", [&](const std::string& v) { opts.valueKb = std::stoi(v); } },
+        { "--update-kb",
+          [&](const std::string& v) { opts.updateKb = std::stoi(v); } },
+        { "--pushes",
+          [&](const std::string& v) { opts.nPushes = std::stoi(v); } },
+        { "--pushers",
+          [&](const std::string& v) {
+              opts.pusherCounts.clear();
+              std::stringstream ss(v);
+              std::string n;
+              while (std::getline(ss, n, ',')) {
+                  opts.pusherCounts.push_back(std::stoi(n));
+              }
+          } },
+      });
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.stateMode = "inmemory";
+
+    size_t nValueDoubles = (size_t)std::max(1, opts.valueKb) * 1024 /
+                           sizeof(double);
+    size_t nUpdateDoubles =
+      std::min(nValueDoubles,
+               (size_t)std::max(1, opts.updateKb) * 1024 / sizeof(double));
+    size_t valueSize = nValueDoubles * sizeof(double);
+    size_t updateSize = nUpdateDoubles * sizeof(double);
+    size_t nSlots = nValueDoubles / nUpdateDoubles;
+
+    // Every update adds one to each of its doubles
+    std::vector<double> update(nUpdateDoubles, 1.0);
+
+    faabric::transport::initGlobalMessageContext();
+
+    {
+        faabric::state::State masterState(LOCALHOST);
+        faabric::state::StateServer server(masterState);
+        server.start();
+
+        faabric::state::State replicaState("bench-replica");
+
+        fmt::print("\n---- State merge benchmark ----\n");
+        fmt::print(
+          "{}KB value of doubles, {}KB summed updates, {} per pusher\n\n",
+          valueSize / 1024,
+          updateSize / 1024,
+          opts.nPushes);
+
+        for (int nPushers : opts.pusherCounts) {
+            std::string key = "merge_" + std::to_string(nPushers);
+
+            std::string originalHost = conf.endpointHost;
+            conf.endpointHost = LOCALHOST;
+            auto masterKv = masterState.getKV(BENCH_USER, key, valueSize);
+            std::vector<double> zeros(nValueDoubles, 0);
+            masterKv->set(BYTES(zeros.data()));
+            conf.endpointHost = originalHost;
+
+            auto replicaKv = replicaState.getKV(BENCH_USER, key, valueSize);
+
+            std::mutex latenciesMx;
+            std::vector<long> pushMicros;
+            faabric::util::TimePoint startedAt = faabric::util::startTimer();
+            {
+                std::vector<std::jthread> pushers;
+                for (int p = 0; p < nPushers; p++) {
+                    pushers.emplace_back([&, p] {
+                        std::vector<long> micros;
+                        for (int i = 0; i < opts.nPushes; i++) {
+                            // Pushers spread out over the value, but overlap
+                            size_t slot = (p + i) % nSlots;
+                            faabric::util::TimePoint t =
+                              faabric::util::startTimer();
+                            replicaKv->pushMergeChunk(
+                              slot * updateSize,
+                              BYTES(update.data()),
+                              updateSize,
+                              faabric::util::SnapshotDataType::Double,
+                              faabric::util::SnapshotMergeOperation::Sum);
+                            micros.push_back(
+                              faabric::util::getTimeDiffMicros(t));
+                        }
+
+                        std::scoped_lock lock(latenciesMx);
+                        pushMicros.insert(
+                          pushMicros.end(), micros.begin(), micros.end());
+                    });
+                }
+            }
+            double seconds = faabric::util::getTimeDiffMillis(startedAt) / 1000;
+
+            // No update may be lost, however many pushers there are
+            std::vector<double> actual(nValueDoubles, 0);
+            masterKv->get(BYTES(actual.data()));
+            double total = std::accumulate(actual.begin(), actual.end(), 0.0);
+            double expected =
+              (double)nPushers * opts.nPushes * (double)nUpdateDoubles;
+
+            long nUpdates = (long)nPushers * opts.nPushes;
+            fmt::print("  {:>2} pushers: {:.1f} updates/s, {:.1f} MB/s, {}\n",
+                       nPushers,
+                       seconds > 0 ? nUpdates / seconds : 0,
+                       seconds > 0
+                         ? nUpdates * updateSize / (1024.0 * 1024.0) / seconds
+                         : 0,
+                       total == expected ? "no updates lost" : "UPDATES LOST");
+            printPercentiles("push us", pushMicros);
+
+            replicaState.deleteKVLocally(BENCH_USER, key);
+            masterState.deleteKVLocally(BENCH_USER, key);
+        }
+
+        server.stop();
+    }
+
+    faabric::transport::closeGlobalMessageContext();
+
+    return EXIT_SUCCESS;
+}
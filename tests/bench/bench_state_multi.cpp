@@ -0,0 +1,144 @@
+#include "BenchUtils.h"
+
+#include <faabric/state/State.h>
+#include <faabric/state/StateKeyValue.h>
+#include <faabric/state/StateServer.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/config.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/network.h>
+#include <faabric/util/timing.h>
+
+#include <sstream>
+
+using namespace tests;
+
+#define BENCH_USER "bench"
+
+struct MultiBenchOptions
+{
+    std::string mode = "inmemory";
+    int keyBytes = 256;
+    int nRepeats = 200;
+    std::vector<int> keyCounts = { 1, 8, 32, 128 };
+};
+
+static const std::string usage =
+  "Usage: faabric_state_multi_bench [options]\n"
+  "  --mode <m>      state mode, inmemory or redis (inmemory)\n"
+  "  --key-bytes <n> size of each value (256)\n"
+  "  --repeats <n>   reads timed for each key count (200)\n"
+  "  --keys <list>   key counts to try (1,8,32,128)\n"
+  "Both modes need Redis, the in-memory mode to record where masters are.\n";
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    MultiBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--mode", [&](const std::string& v) { opts.mode = v; } },
+        { "--key-bytes",
+          [&](const std::string& v) { opts.keyBytes = std::stoi(v); } },
+        { "--repeats",
+          [&](const std::string& v) { opts.nRepeats = std::stoi(v); } },
+        { "--keys",
+          [&](const std::string& v) {
+              opts.keyCounts.clear();
+              std::stringstream ss(v);
+              std::string n;
+              while (std::getline(ss, n, ',')) {
+                  opts.keyCounts.push_back(std::stoi(n));
+              }
+          } },
+      });
+
+    if (opts.mode != "inmemory" && opts.mode != "redis") {
+        fmt::print("{}", usage);
+        throw std::runtime_error("Unsupported state mode " + opts.mode);
+    }
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.stateMode = opts.mode;
+
+    size_t keyBytes = std::max(1, opts.keyBytes);
+    std::vector<uint8_t> values(keyBytes, 1);
+
+    faabric::transport::initGlobalMessageContext();
+
+    {
+        // In-memory values are mastered in their own state instance behind a
+        // server on this host, Redis values are read back from Redis
+        faabric::state::State masterState(LOCALHOST);
+        faabric::state::StateServer server(masterState);
+        server.start();
+
+        faabric::state::State replicaState("bench-replica");
+
+        fmt::print("\n---- State multi-key benchmark ----\n");
+        fmt::print("{} state, {} byte values, {} reads of each set of keys\n\n",
+                   opts.mode,
+                   keyBytes,
+                   opts.nRepeats);
+
+        for (int nKeys : opts.keyCounts) {
+            faabric::state::StateKeyValueList kvs;
+            for (int k = 0; k < nKeys; k++) {
+                std::string key =
+                  fmt::format("multi_{}_{}_{}", opts.mode, nKeys, k);
+
+                if (opts.mode == "inmemory") {
+                    std::string originalHost = conf.endpointHost;
+                    conf.endpointHost = LOCALHOST;
+                    masterState.getKV(BENCH_USER, key, keyBytes)
+                      ->set(values.data());
+                    conf.endpointHost = originalHost;
+                }
+
+                auto kv = replicaState.getKV(BENCH_USER, key, keyBytes);
+                if (opts.mode == "redis") {
+                    kv->set(values.data());
+                    kv->pushFull();
+                }
+                kvs.push_back(kv);
+            }
+
+            std::vector<long> oneByOneMicros;
+            std::vector<long> batchedMicros;
+            for (int i = 0; i < opts.nRepeats; i++) {
+                faabric::util::TimePoint t = faabric::util::startTimer();
+                for (auto& kv : kvs) {
+                    kv->pull();
+                }
+                oneByOneMicros.push_back(faabric::util::getTimeDiffMicros(t));
+
+                t = faabric::util::startTimer();
+                replicaState.pullMultiple(kvs);
+                batchedMicros.push_back(faabric::util::getTimeDiffMicros(t));
+            }
+
+            fmt::print("  {} keys\n", nKeys);
+            printPercentiles("one by one us", oneByOneMicros);
+            printPercentiles("batched us", batchedMicros);
+
+            for (const auto& kv : kvs) {
+                if (opts.mode == "redis") {
+                    replicaState.deleteKV(BENCH_USER, kv->key);
+                } else {
+                    replicaState.deleteKVLocally(BENCH_USER, kv->key);
+                    masterState.deleteKVLocally(BENCH_USER, kv->key);
+                }
+            }
+        }
+
+        server.stop();
+    }
+
+    faabric::transport::closeGlobalMessageContext();
+
+    return EXIT_SUCCESS;
+}
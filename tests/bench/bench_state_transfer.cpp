@@ -0,0 +1,113 @@
+#include "BenchUtils.h"
+
+#include <faabric/state/State.h>
+#include <faabric/state/StateKeyValue.h>
+#include <faabric/state/StateServer.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/config.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/network.h>
+#include <faabric/util/timing.h>
+
+using namespace tests;
+
+#define BENCH_USER "bench"
+
+struct TransferBenchOptions
+{
+    size_t valueMb = 256;
+    int nRepeats = 5;
+};
+
+static const std::string usage =
+  "Usage: faabric_state_transfer_bench [options]\n"
+  "  --mb <n>       size of the value moved (256)\n"
+  "  --repeats <n>  pulls and pushes timed (5)\n"
+  "State settings, e.g. STATE_TRANSFER_WINDOW and "
+  "STATE_TRANSFER_CONNECTIONS, are read from the environment as usual. The "
+  "master's location is kept in Redis, as in the in-memory state mode.\n";
+
+static double toMbPerSec(size_t nBytes, double millis)
+{
+    return millis > 0 ? (nBytes / (1024.0 * 1024.0)) / (millis / 1000) : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    TransferBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--mb", [&](const std::string& v) { opts.valueMb = std::stoul(v); } },
+        { "--repeats",
+          [&](const std::string& v) { opts.nRepeats = std::stoi(v); } },
+      });
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.stateMode = "inmemory";
+    conf.print();
+
+    size_t valueSize = std::max<size_t>(1, opts.valueMb) * 1024 * 1024;
+    std::string key = "transfer_" + std::to_string(opts.valueMb);
+    std::vector<uint8_t> values(valueSize, 1);
+
+    faabric::transport::initGlobalMessageContext();
+
+    {
+        // The master lives in its own state instance behind a server on this
+        // host, while the replica is pulled into another
+        faabric::state::State masterState(LOCALHOST);
+        faabric::state::StateServer server(masterState);
+        server.start();
+
+        std::string originalHost = conf.endpointHost;
+        conf.endpointHost = LOCALHOST;
+        auto masterKv = masterState.getKV(BENCH_USER, key, valueSize);
+        masterKv->set(values.data());
+        conf.endpointHost = originalHost;
+
+        faabric::state::State replicaState("bench-replica");
+        auto replicaKv = replicaState.getKV(BENCH_USER, key, valueSize);
+
+        std::vector<double> pullMbPerSec;
+        std::vector<double> pushMbPerSec;
+        for (int i = 0; i < opts.nRepeats; i++) {
+            faabric::util::TimePoint t = faabric::util::startTimer();
+            replicaKv->pull();
+            pullMbPerSec.push_back(
+              toMbPerSec(valueSize, faabric::util::getTimeDiffMillis(t)));
+
+            replicaKv->set(values.data());
+            t = faabric::util::startTimer();
+            replicaKv->pushFull();
+            pushMbPerSec.push_back(
+              toMbPerSec(valueSize, faabric::util::getTimeDiffMillis(t)));
+        }
+
+        fmt::print("\n---- State transfer benchmark ----\n");
+        fmt::print("{}MB value, window {}, {} connections\n\n",
+                   opts.valueMb,
+                   conf.stateTransferWindow,
+                   conf.stateTransferConnections);
+        fmt::print("  pull MB/s:          p50={:.1f} min={:.1f} max={:.1f}\n",
+                   percentile(pullMbPerSec, 50),
+                   percentile(pullMbPerSec, 0),
+                   percentile(pullMbPerSec, 100));
+        fmt::print("  push MB/s:          p50={:.1f} min={:.1f} max={:.1f}\n",
+                   percentile(pushMbPerSec, 50),
+                   percentile(pushMbPerSec, 0),
+                   percentile(pushMbPerSec, 100));
+
+        replicaState.deleteKVLocally(BENCH_USER, key);
+        masterState.deleteKVLocally(BENCH_USER, key);
+        server.stop();
+    }
+
+    faabric::transport::closeGlobalMessageContext();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,195 @@
+#include "BenchUtils.h"
+
+#include <faabric/state/State.h>
+#include <faabric/state/StateKeyValue.h>
+#include <faabric/state/StateServer.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/config.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/network.h>
+#include <faabric/util/timing.h>
+
+#include <cstring>
+
+using namespace tests;
+
+#define BENCH_USER "bench"
+
+struct WriteBehindBenchOptions
+{
+    int valueKb = 1024;
+    int writeKb = 64;
+    int nValues = 4;
+    int nIterations = 200;
+    int computeMicros = 200;
+};
+
+static const std::string usage =
+  "Usage: faabric_state_write_behind_bench [options]\n"
+  "  --kb <n>          size of each value (1024)\n"
+  "  --write-kb <n>    size of each write (64)\n"
+  "  --values <n>      values written in each iteration (4)\n"
+  "  --iterations <n>  iterations of writes and compute (200)\n"
+  "  --compute-us <n>  compute after each iteration's writes (200)\n"
+  "The master's location is kept in Redis, as in the in-memory state mode.\n";
+
+// Spins rather than sleeps, so the compute really does hold the thread
+static void compute(int micros)
+{
+    faabric::util::TimePoint t = faabric::util::startTimer();
+    while (faabric::util::getTimeDiffMicros(t) < micros) {
+    }
+}
+
+struct WriteBehindRun
+{
+    double totalMillis = 0;
+    double flushMillis = 0;
+    std::vector<long> stallMicros;
+    bool valuesMatch = true;
+};
+
+// Each iteration writes a chunk of every value, pushes them, then computes.
+// Pushing either blocks the iteration, or happens behind it and is only
+// waited on at the end.
+static WriteBehindRun runWrites(const WriteBehindBenchOptions& opts,
+                                faabric::state::State& masterState,
+                                faabric::state::State& replicaState,
+                                bool writeBehind)
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+
+    size_t valueSize = (size_t)std::max(1, opts.valueKb) * 1024;
+    size_t writeSize =
+      std::min(valueSize, (size_t)std::max(1, opts.writeKb) * 1024);
+    size_t nSlots = valueSize / writeSize;
+
+    std::string prefix = writeBehind ? "behind_" : "sync_";
+    std::vector<std::shared_ptr<faabric::state::StateKeyValue>> masterKvs;
+    std::vector<std::shared_ptr<faabric::state::StateKeyValue>> replicaKvs;
+    std::vector<uint8_t> zeros(valueSize, 0);
+    for (int v = 0; v < opts.nValues; v++) {
+        std::string key = prefix + std::to_string(v);
+
+        std::string originalHost = conf.endpointHost;
+        conf.endpointHost = LOCALHOST;
+        auto masterKv = masterState.getKV(BENCH_USER, key, valueSize);
+        masterKv->set(zeros.data());
+        conf.endpointHost = originalHost;
+
+        auto replicaKv = replicaState.getKV(BENCH_USER, key, valueSize);
+        replicaKv->pull();
+
+        masterKvs.push_back(masterKv);
+        replicaKvs.push_back(replicaKv);
+    }
+
+    WriteBehindRun run;
+    std::vector<uint8_t> update(writeSize);
+
+    faabric::util::TimePoint t = faabric::util::startTimer();
+    for (int i = 0; i < opts.nIterations; i++) {
+        std::fill(update.begin(), update.end(), (uint8_t)(i + 1));
+        size_t offset = (i % nSlots) * writeSize;
+
+        faabric::util::TimePoint stallT = faabric::util::startTimer();
+        for (auto& kv : replicaKvs) {
+            kv->setChunk(offset, update.data(), update.size());
+            if (writeBehind) {
+                replicaState.pushAsync(kv);
+            } else {
+                kv->pushPartial();
+            }
+        }
+        run.stallMicros.push_back(faabric::util::getTimeDiffMicros(stallT));
+
+        compute(opts.computeMicros);
+    }
+
+    faabric::util::TimePoint flushT = faabric::util::startTimer();
+    if (writeBehind) {
+        replicaState.flushPushes();
+    }
+    run.flushMillis = faabric::util::getTimeDiffMillis(flushT);
+    run.totalMillis = faabric::util::getTimeDiffMillis(t);
+
+    // Whichever way they're pushed, the master ends up with every write
+    std::vector<uint8_t> actual(valueSize);
+    for (int v = 0; v < opts.nValues; v++) {
+        masterKvs.at(v)->get(actual.data());
+        if (std::memcmp(actual.data(), replicaKvs.at(v)->get(), valueSize) !=
+            0) {
+            run.valuesMatch = false;
+        }
+
+        std::string key = prefix + std::to_string(v);
+        replicaState.deleteKVLocally(BENCH_USER, key);
+        masterState.deleteKVLocally(BENCH_USER, key);
+    }
+
+    return run;
+}
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    WriteBehindBenchOptions opts;
+    parseBenchArgs(
+      argc,
+      argv,
+      usage,
+      {
+        { "--kb", [&](const std::string& v) { opts.valueKb = std::stoi(v); } },
+        { "--write-kb",
+          [&](const std::string& v) { opts.writeKb = std::stoi(v); } },
+        { "--values",
+          [&](const std::string& v) {
+              opts.nValues = std::max(1, std::stoi(v));
+          } },
+        { "--iterations",
+          [&](const std::string& v) { opts.nIterations = std::stoi(v); } },
+        { "--compute-us",
+          [&](const std::string& v) { opts.computeMicros = std::stoi(v); } },
+      });
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.stateMode = "inmemory";
+
+    faabric::transport::initGlobalMessageContext();
+
+    {
+        faabric::state::State masterState(LOCALHOST);
+        faabric::state::StateServer server(masterState);
+        server.start();
+
+        faabric::state::State replicaState("bench-replica");
+
+        fmt::print("\n---- State write-behind benchmark ----\n");
+        fmt::print("{} values of {}KB, {}KB writes, {} iterations with {}us "
+                   "compute each\n\n",
+                   opts.nValues,
+                   opts.valueKb,
+                   opts.writeKb,
+                   opts.nIterations,
+                   opts.computeMicros);
+
+        for (bool writeBehind : { false, true }) {
+            WriteBehindRun run =
+              runWrites(opts, masterState, replicaState, writeBehind);
+
+            fmt::print("{}: {:.1f}ms total, {:.1f}ms flushing, {}\n",
+                       writeBehind ? "pushAsync + flushPushes" : "pushPartial",
+                       run.totalMillis,
+                       run.flushMillis,
+                       run.valuesMatch ? "values match" : "VALUES DIFFER");
+            printPercentiles("stall us", run.stallMicros);
+        }
+
+        server.stop();
+    }
+
+    faabric::transport::closeGlobalMessageContext();
+
+    return EXIT_SUCCESS;
+}
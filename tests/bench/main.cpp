@@ -0,0 +1,484 @@
+#include "BenchUtils.h"
+#include "SimulatedCluster.h"
+#include "Trace.h"
+
+#include <faabric/scheduler/ExecutorFactory.h>
+#include <faabric/scheduler/FunctionCallClient.h>
+#include <faabric/scheduler/Scheduler.h>
+#include <faabric/snapshot/SnapshotClient.h>
+#include <faabric/snapshot/SnapshotRegistry.h>
+#include <faabric/transport/context.h>
+#include <faabric/util/clock.h>
+#include <faabric/util/config.h>
+#include <faabric/util/func.h>
+#include <faabric/util/logging.h>
+#include <faabric/util/memory.h>
+#include <faabric/util/snapshot.h>
+#include <faabric/util/testing.h>
+#include <faabric/util/timing.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <tuple>
+
+using namespace faabric::scheduler;
+using namespace tests;
+
+#define BENCH_USER "bench"
+#define BENCH_RESULT_TIMEOUT_MS 60000
+
+struct BenchOptions
+{
+    int nHosts = 16;
+    int hostSlots = 8;
+    int localSlots = 8;
+    int latencyMillis = 1;
+    int execMillis = 10;
+    int nClients = 4;
+    int snapshotKb = 64;
+    int inputKb = 0;
+    std::string tracePath;
+
+    TraceOptions trace;
+};
+
+// Everything we find out about a single batch
+struct BatchRecord
+{
+    TraceCallType type = TraceCallType::FUNCTIONS;
+    int nMessages = 0;
+    long decisionMicros = 0;
+    int nHosts = 0;
+    int nLocal = 0;
+    int nRejected = 0;
+    std::vector<long> latencyMillis;
+};
+
+static void printUsage()
+{
+    fmt::print(
+      "Usage: faabric_scheduler_bench [options]\n"
+      "  --hosts <n>             simulated remote hosts (16)\n"
+      "  --slots <n>             slots per remote host (8)\n"
+      "  --local-slots <n>       slots on this host (8)\n"
+      "  --latency-ms <n>        round-trip to remote hosts (1)\n"
+      "  --exec-ms <n>           execution time of each call (10)\n"
+      "  --clients <n>           threads submitting batches (4)\n"
+      "  --snapshot-kb <n>       size of thread snapshots (64)\n"
+      "  --input-kb <n>          input data per call (0)\n"
+      "  --batches <n>           batches in generated trace (1000)\n"
+      "  --interval-ms <x>       mean interval between arrivals (1)\n"
+      "  --batch-size <n>        largest batch in generated trace (4)\n"
+      "  --threads-fraction <x>  fraction of thread batches (0.1)\n"
+      "  --mpi-fraction <x>      fraction of MPI batches (0.05)\n"
+      "  --functions <n>         distinct functions (10)\n"
+      "  --seed <n>              seed for the generated trace (1)\n"
+      "  --trace <path>          replay a trace file instead\n"
+      "Scheduler settings, e.g. PLACEMENT_POLICY, are read from the "
+      "environment as usual.\n");
+}
+
+static BenchOptions parseArgs(int argc, char* argv[])
+{
+    BenchOptions opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            exit(0);
+        }
+
+        if (i + 1 >= argc) {
+            printUsage();
+            throw std::runtime_error("Missing value for " + arg);
+        }
+
+        std::string value = argv[++i];
+        if (arg == "--hosts") {
+            opts.nHosts = std::stoi(value);
+        } else if (arg == "--slots") {
+            opts.hostSlots = std::stoi(value);
+        } else if (arg == "--local-slots") {
+            opts.localSlots = std::stoi(value);
+        } else if (arg == "--latency-ms") {
+            opts.latencyMillis = std::stoi(value);
+        } else if (arg == "--exec-ms") {
+            opts.execMillis = std::stoi(value);
+        } else if (arg == "--clients") {
+            opts.nClients = std::max(1, std::stoi(value));
+        } else if (arg == "--snapshot-kb") {
+            opts.snapshotKb = std::stoi(value);
+        } else if (arg == "--input-kb") {
+            opts.inputKb = std::max(0, std::stoi(value));
+        } else if (arg == "--batches") {
+            opts.trace.nBatches = std::stoi(value);
+        } else if (arg == "--interval-ms") {
+            opts.trace.meanIntervalMillis = std::stod(value);
+        } else if (arg == "--batch-size") {
+            opts.trace.maxBatchSize = std::stoi(value);
+        } else if (arg == "--threads-fraction") {
+            opts.trace.threadsFraction = std::stod(value);
+        } else if (arg == "--mpi-fraction") {
+            opts.trace.mpiFraction = std::stod(value);
+        } else if (arg == "--functions") {
+            opts.trace.nFunctions = std::stoi(value);
+        } else if (arg == "--seed") {
+            opts.trace.seed = std::stoul(value);
+        } else if (arg == "--trace") {
+            opts.tracePath = value;
+        } else {
+            printUsage();
+            throw std::runtime_error("Unrecognised option " + arg);
+        }
+    }
+
+    return opts;
+}
+
+// Thread snapshots, and the executor memory they're restored into
+static size_t getSnapshotSize(const BenchOptions& opts)
+{
+    size_t nBytes = (size_t)std::max(1, opts.snapshotKb) * 1024;
+    return faabric::util::getRequiredHostPages(nBytes) *
+           faabric::util::HOST_PAGE_SIZE;
+}
+
+static std::shared_ptr<faabric::BatchExecuteRequest> buildRequest(
+  const TraceEntry& entry,
+  size_t batchIdx,
+  const std::string& inputData)
+{
+    // Threads need their own function, as threaded functions only ever have
+    // the one executor
+    std::string function = entry.function;
+    if (entry.type == TraceCallType::THREADS) {
+        function += "_threads_" + std::to_string(batchIdx);
+    }
+
+    auto req =
+      faabric::util::batchExecFactory(BENCH_USER, function, entry.nMessages);
+
+    if (entry.type == TraceCallType::THREADS) {
+        req->set_type(faabric::BatchExecuteRequest::THREADS);
+    } else if (entry.type == TraceCallType::MPI) {
+        // MPI worlds are gang-scheduled, so no rank should be left alone
+        for (int i = 0; i < req->messages_size(); i++) {
+            faabric::Message& m = req->mutable_messages()->at(i);
+            m.set_ismpi(true);
+            m.set_mpiworldsize(entry.nMessages);
+            m.set_mpirank(i);
+        }
+        req->mutable_messages()->at(0).set_topologyhint("NEVER_ALONE");
+    }
+
+    if (!inputData.empty()) {
+        for (auto& m : *req->mutable_messages()) {
+            m.set_inputdata(inputData);
+        }
+    }
+
+    return req;
+}
+
+static void awaitResults(std::shared_ptr<faabric::BatchExecuteRequest> req,
+                         long submittedAt,
+                         BatchRecord& record)
+{
+    Scheduler& sch = getScheduler();
+
+    if (req->type() == faabric::BatchExecuteRequest::THREADS) {
+        // Thread results don't carry a timestamp, so have to be waited on as
+        // soon as they're sent
+        sch.awaitThreadResults(req);
+        long finishedAt = faabric::util::getGlobalClock().epochMillis();
+        record.latencyMillis.assign(req->messages_size(),
+                                    finishedAt - submittedAt);
+        sch.deregisterThreads(req);
+
+        faabric::snapshot::getSnapshotRegistry().deleteSnapshot(
+          faabric::util::getMainThreadSnapshotKey(req->messages().at(0)));
+        return;
+    }
+
+    for (const auto& m : req->messages()) {
+        faabric::Message result =
+          sch.getFunctionResult(m.id(), BENCH_RESULT_TIMEOUT_MS);
+        if (result.returnvalue() == REJECTED_FUNCTION_RETURN_VALUE) {
+            record.nRejected++;
+            continue;
+        }
+
+        record.latencyMillis.push_back(result.finishtimestamp() - submittedAt);
+    }
+}
+
+static void runClient(const BenchOptions& opts,
+                      const std::vector<TraceEntry>& trace,
+                      int clientIdx,
+                      faabric::util::TimePoint startedAt,
+                      std::deque<BatchRecord>& records)
+{
+    Scheduler& sch = getScheduler();
+    auto& reg = faabric::snapshot::getSnapshotRegistry();
+    std::string thisHost = sch.getThisHost();
+
+    // All calls share the same input, built once up front
+    std::string inputData((size_t)opts.inputKb * 1024, 'x');
+
+    size_t snapshotSize = getSnapshotSize(opts);
+
+    std::vector<std::tuple<std::shared_ptr<faabric::BatchExecuteRequest>,
+                           long,
+                           BatchRecord*>>
+      submitted;
+    std::vector<std::jthread> threadWaiters;
+
+    for (size_t i = clientIdx; i < trace.size(); i += opts.nClients) {
+        const TraceEntry& entry = trace.at(i);
+
+        // Replay at the arrival time in the trace, or as soon as we can if
+        // we've fallen behind
+        std::this_thread::sleep_until(
+          startedAt + std::chrono::milliseconds(entry.arrivalMillis));
+
+        auto req = buildRequest(entry, i, inputData);
+        if (entry.type == TraceCallType::THREADS) {
+            reg.registerSnapshot(
+              faabric::util::getMainThreadSnapshotKey(req->messages().at(0)),
+              std::make_shared<faabric::util::SnapshotData>(snapshotSize));
+        }
+
+        BatchRecord& record = records.emplace_back();
+        record.type = entry.type;
+        record.nMessages = entry.nMessages;
+
+        long submittedAt = faabric::util::getGlobalClock().epochMillis();
+        faabric::util::TimePoint t = faabric::util::startTimer();
+        faabric::util::SchedulingDecision decision = sch.callFunctions(req);
+        record.decisionMicros = faabric::util::getTimeDiffMicros(t);
+
+        std::set<std::string> uniqueHosts(decision.hosts.begin(),
+                                          decision.hosts.end());
+        record.nHosts = uniqueHosts.size();
+        record.nLocal =
+          std::count(decision.hosts.begin(), decision.hosts.end(), thisHost);
+
+        if (entry.type == TraceCallType::THREADS) {
+            threadWaiters.emplace_back([req, submittedAt, &record] {
+                awaitResults(req, submittedAt, record);
+            });
+        } else {
+            submitted.emplace_back(req, submittedAt, &record);
+        }
+    }
+
+    // Function results carry their finish time, so can be read afterwards
+    for (auto& [req, submittedAt, record] : submitted) {
+        awaitResults(req, submittedAt, *record);
+    }
+
+    for (auto& t : threadWaiters) {
+        t.join();
+    }
+}
+
+static void printReport(
+  const BenchOptions& opts,
+  const std::vector<std::deque<BatchRecord>>& records,
+  const std::vector<std::shared_ptr<SimulatedHost>>& hosts,
+  double submitSeconds,
+  double totalSeconds)
+{
+    std::vector<long> decisionMicros;
+    std::map<TraceCallType, std::vector<long>> latencies;
+    std::map<TraceCallType, int> nBatches;
+    std::map<TraceCallType, long> nHostsPerType;
+    long nMessages = 0;
+    long nLocal = 0;
+    long nRejected = 0;
+
+    for (const auto& clientRecords : records) {
+        for (const auto& r : clientRecords) {
+            decisionMicros.push_back(r.decisionMicros);
+            nBatches[r.type]++;
+            nHostsPerType[r.type] += r.nHosts;
+            nMessages += r.nMessages;
+            nLocal += r.nLocal;
+            nRejected += r.nRejected;
+
+            auto& typeLatencies = latencies[r.type];
+            typeLatencies.insert(typeLatencies.end(),
+                                 r.latencyMillis.begin(),
+                                 r.latencyMillis.end());
+        }
+    }
+
+    long nDecisions = decisionMicros.size();
+    double meanDecisionMicros =
+      nDecisions == 0 ? 0
+                      : (double)std::accumulate(decisionMicros.begin(),
+                                                decisionMicros.end(),
+                                                0L) /
+                          (double)nDecisions;
+
+    fmt::print("\n---- Scheduler benchmark ----\n");
+    fmt::print("Cluster: this host ({} slots) + {} hosts x {} slots, "
+               "{}ms round-trip, {}ms per call\n",
+               opts.localSlots,
+               opts.nHosts,
+               opts.hostSlots,
+               opts.latencyMillis,
+               opts.execMillis);
+    fmt::print("Batches: {} ({} messages) from {} clients in {:.2f}s\n",
+               nDecisions,
+               nMessages,
+               opts.nClients,
+               totalSeconds);
+
+    // Time spent in callFunctions includes waiting on the scheduler's locks,
+    // so its tail grows with contention between clients
+    fmt::print("\nDecisions\n");
+    fmt::print("  decisions/s:       {:.1f}\n",
+               submitSeconds > 0 ? nDecisions / submitSeconds : 0);
+    fmt::print("  per client/s:      {:.1f}\n",
+               meanDecisionMicros > 0 ? 1e6 / meanDecisionMicros : 0);
+    fmt::print("  latency us:        p50={} p99={} max={}\n",
+               percentile(decisionMicros, 50),
+               percentile(decisionMicros, 99),
+               percentile(decisionMicros, 100));
+
+    fmt::print("\nPlacement\n");
+    fmt::print("  on this host:      {:.1f}%\n",
+               nMessages > 0 ? 100.0 * nLocal / nMessages : 0);
+    for (const auto& [type, n] : nBatches) {
+        fmt::print("  hosts per {:<9}  {:.2f}\n",
+                   traceCallTypeToString(type) + ":",
+                   (double)nHostsPerType[type] / n);
+    }
+
+    long nRemoteExecuted = 0;
+    long nOverloaded = 0;
+    double maxLoad = 0;
+    for (const auto& h : hosts) {
+        nRemoteExecuted += h->getExecutedCount();
+        nOverloaded += h->getOverloadedCount();
+        maxLoad = std::max(maxLoad,
+                           (double)h->getExecutedCount() / h->getSlots());
+    }
+
+    long totalRemoteSlots = (long)opts.nHosts * opts.hostSlots;
+    double meanLoad =
+      totalRemoteSlots > 0 ? (double)nRemoteExecuted / totalRemoteSlots : 0;
+    fmt::print("  remote overloaded: {} of {}\n", nOverloaded, nRemoteExecuted);
+    fmt::print("  remote imbalance:  {:.2f} (busiest / mean calls per slot)\n",
+               meanLoad > 0 ? maxLoad / meanLoad : 0);
+
+    AdmissionMetrics admission = getScheduler().getAdmissionMetrics();
+    fmt::print("  local queued:      {} (max wait {}ms)\n",
+               admission.nQueued,
+               admission.maxWaitMillis);
+    fmt::print("  rejected:          {}\n", nRejected);
+
+    fmt::print("\nEnd-to-end latency ms\n");
+    for (auto& [type, values] : latencies) {
+        fmt::print("  {:<10} p50={} p90={} p99={} max={}\n",
+                   traceCallTypeToString(type) + ":",
+                   percentile(values, 50),
+                   percentile(values, 90),
+                   percentile(values, 99),
+                   percentile(values, 100));
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    faabric::util::initLogging();
+
+    BenchOptions opts = parseArgs(argc, argv);
+
+    std::vector<TraceEntry> trace = opts.tracePath.empty()
+                                      ? generateTrace(opts.trace)
+                                      : loadTrace(opts.tracePath);
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.print();
+
+    faabric::transport::initGlobalMessageContext();
+
+    // Everything remote is simulated, but results still go through Redis
+    // unless pushed directly
+    faabric::util::setMockMode(true);
+
+    setExecutorFactory(std::make_shared<BenchExecutorFactory>(
+      opts.execMillis, getSnapshotSize(opts)));
+
+    Scheduler& sch = getScheduler();
+    sch.shutdown();
+
+    for (const auto& h : sch.getAvailableHosts()) {
+        sch.removeHostFromGlobalSet(h);
+    }
+    sch.addHostToGlobalSet();
+
+    faabric::HostResources res;
+    res.set_slots(opts.localSlots);
+    sch.setThisHostResources(res);
+
+    std::vector<std::shared_ptr<SimulatedHost>> hosts;
+    for (int i = 0; i < opts.nHosts; i++) {
+        std::string host = "sim-host-" + std::to_string(i);
+        auto simHost = std::make_shared<SimulatedHost>(
+          host, opts.hostSlots, opts.latencyMillis, opts.execMillis);
+
+        hosts.push_back(simHost);
+        setMockHost(host, simHost);
+        sch.addHostToGlobalSet(host);
+    }
+
+    SPDLOG_INFO("Replaying {} batches against {} simulated hosts",
+                trace.size(),
+                hosts.size());
+
+    // Records are only ever appended to, so references to them stay valid
+    std::vector<std::deque<BatchRecord>> records(opts.nClients);
+    faabric::util::TimePoint startedAt = faabric::util::startTimer();
+    {
+        std::vector<std::jthread> clients;
+        for (int c = 0; c < opts.nClients; c++) {
+            clients.emplace_back([&, c] {
+                runClient(opts, trace, c, startedAt, records.at(c));
+            });
+        }
+    }
+    double totalSeconds = faabric::util::getTimeDiffMillis(startedAt) / 1000;
+
+    // Decisions per second are over the time clients actually spent in the
+    // scheduler, so don't depend on how spread out the arrivals are
+    double submitSeconds = 0;
+    for (const auto& clientRecords : records) {
+        long clientMicros = 0;
+        for (const auto& r : clientRecords) {
+            clientMicros += r.decisionMicros;
+        }
+        submitSeconds = std::max(submitSeconds, clientMicros / 1e6);
+    }
+
+    printReport(opts, records, hosts, submitSeconds, totalSeconds);
+
+    for (auto& h : hosts) {
+        h->stop();
+    }
+
+    sch.shutdown();
+    faabric::scheduler::clearMockRequests();
+    faabric::snapshot::clearMockSnapshotRequests();
+    faabric::util::setMockMode(false);
+
+    faabric::transport::closeGlobalMessageContext();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+#include <catch2/catch.hpp>
+
+#include "faabric_utils.h"
+
+#include <faabric/redis/AsyncRedis.h>
+#include <faabric/redis/Redis.h>
+#include <faabric/util/bytes.h>
+
+#include <thread>
+
+using namespace faabric::redis;
+
+namespace tests {
+
+TEST_CASE_METHOD(RedisTestFixture, "Test async redis commands", "[redis]")
+{
+    AsyncRedis asyncRedis(getRedisInstance(QUEUE), 2);
+    REQUIRE(asyncRedis.getConnectionCount() == 2);
+
+    std::string key = "async_key";
+    std::vector<uint8_t> value = { 0, 1, 2, 0, 3 };
+
+    // Binary values make it through untouched
+    asyncRedis
+      .command({ "SET", key, std::string(value.begin(), value.end()) })
+      .get();
+    REQUIRE(redis.get(key) == value);
+
+    // Commands in the same pipeline are executed in order
+    std::string setKey = "async_set";
+    asyncRedis
+      .pipeline({ { "SADD", setKey, "a" },
+                  { "SADD", setKey, "b" },
+                  { "EXPIRE", setKey, "100" } })
+      .get();
+    REQUIRE(redis.smembers(setKey) == std::set<std::string>({ "a", "b" }));
+    REQUIRE(redis.getTtl(setKey) > 10);
+
+    // Errors are returned through the future, and don't affect other
+    // commands in the pipeline
+    std::string otherKey = "async_other";
+    auto failed =
+      asyncRedis.pipeline({ { "SADD", key, "a" }, { "SET", otherKey, "b" } });
+    REQUIRE_THROWS(failed.get());
+    REQUIRE(redis.get(otherKey) == faabric::util::stringToBytes("b"));
+}
+
+TEST_CASE_METHOD(RedisTestFixture,
+                 "Test flushing async redis from many threads",
+                 "[redis]")
+{
+    AsyncRedis asyncRedis(getRedisInstance(QUEUE), 3);
+
+    int nThreads = 5;
+    int nPerThread = 200;
+    std::string key = "async_list";
+
+    // Don't wait on any of the individual pushes, just flush at the end
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&asyncRedis, &key, t, nPerThread] {
+            for (int i = 0; i < nPerThread; i++) {
+                asyncRedis.command({ "RPUSH", key, std::to_string(t) });
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    asyncRedis.flush();
+    REQUIRE(redis.listLength(key) == nThreads * nPerThread);
+
+    // Flushing with nothing outstanding is a no-op
+    asyncRedis.flush();
+}
+
+TEST_CASE_METHOD(RedisTestFixture,
+                 "Test publishing scheduler results asynchronously",
+                 "[redis]")
+{
+    AsyncRedis asyncRedis(getRedisInstance(QUEUE), 2);
+
+    std::string resultKey = "async_result";
+    std::string statusKey = "async_status";
+    std::vector<uint8_t> result = { 9, 8, 0, 7 };
+
+    asyncRedis.publishSchedulerResult(resultKey, statusKey, result).get();
+
+    REQUIRE(redis.listLength(resultKey) == 1);
+    REQUIRE(redis.getTtl(resultKey) > 10);
+    REQUIRE(redis.get(statusKey) == result);
+    REQUIRE(redis.dequeueBytes(resultKey) == result);
+}
+
+TEST_CASE_METHOD(RedisTestFixture,
+                 "Test async redis submissions with an ordering key",
+                 "[redis]")
+{
+    AsyncRedis asyncRedis(getRedisInstance(QUEUE), 4);
+
+    // Separate submissions sharing a key go over one connection, in order
+    int nPushes = 100;
+    std::string key = "async_ordered";
+    for (int i = 0; i < nPushes; i++) {
+        asyncRedis.pipeline({ { "RPUSH", key, std::to_string(i) } }, 123);
+    }
+
+    asyncRedis.flush();
+
+    REQUIRE(redis.listLength(key) == nPushes);
+    for (int i = 0; i < nPushes; i++) {
+        REQUIRE(redis.dequeue(key) == std::to_string(i));
+    }
+}
+
+TEST_CASE_METHOD(RedisTestFixture,
+                 "Test stopping async redis sends queued commands",
+                 "[redis]")
+{
+    AsyncRedis asyncRedis(getRedisInstance(QUEUE), 2);
+
+    int nPushes = 500;
+    std::string key = "async_stopping";
+    std::vector<std::future<void>> pushes;
+    for (int i = 0; i < nPushes; i++) {
+        pushes.emplace_back(asyncRedis.command({ "RPUSH", key, "x" }));
+    }
+
+    asyncRedis.stop();
+
+    for (auto& p : pushes) {
+        p.get();
+    }
+    REQUIRE(redis.listLength(key) == nPushes);
+}
+
+TEST_CASE("Test stopped async redis rejects commands", "[redis]")
+{
+    AsyncRedis asyncRedis(getRedisInstance(QUEUE), 1);
+    asyncRedis.stop();
+
+    REQUIRE_THROWS(asyncRedis.command({ "PING" }));
+}
+}
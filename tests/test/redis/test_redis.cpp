@@ -609,6 +609,15 @@ TEST_CASE("Test enqueue and dequeue multiple")
                                    bytesC.size() + bytesD.size());
     redisQueue.dequeueMultiple(key, actualAll.data(), actualAll.size(), 4);
     REQUIRE(actualAll == expectedAll);
+
+    // Try dequeueing from an offset
+    std::vector<uint8_t> expectedOffset = bytesC;
+    expectedOffset.insert(expectedOffset.end(), bytesD.begin(), bytesD.end());
+
+    std::vector<uint8_t> actualOffset(bytesC.size() + bytesD.size());
+    redisQueue.dequeueMultiple(
+      key, actualOffset.data(), actualOffset.size(), 2, 2);
+    REQUIRE(actualOffset == expectedOffset);
 }
 
 TEST_CASE("Test dequeue multiple empty")
@@ -659,6 +668,33 @@ TEST_CASE("Test range set pipeline")
     REQUIRE(actual == expected);
 }
 
+TEST_CASE("Test range get pipeline", "[redis]")
+{
+    Redis& redisState = Redis::getState();
+    redisState.flushAll();
+
+    std::vector<uint8_t> valueA = { 0, 1, 2, 3, 4, 5 };
+    std::vector<uint8_t> valueB = { 9, 8, 7 };
+    redisState.set("pipelineA", valueA);
+    redisState.set("pipelineB", valueB);
+
+    std::vector<uint8_t> actualA(3, 0);
+    std::vector<uint8_t> actualB(3, 0);
+    std::vector<uint8_t> actualC(2, 0);
+    redisState.getRangesPipeline({
+      { "pipelineA", 2, actualA.size(), actualA.data() },
+      { "pipelineB", 0, actualB.size(), actualB.data() },
+      { "pipelineA", 0, actualC.size(), actualC.data() },
+    });
+
+    REQUIRE(actualA == std::vector<uint8_t>({ 2, 3, 4 }));
+    REQUIRE(actualB == valueB);
+    REQUIRE(actualC == std::vector<uint8_t>({ 0, 1 }));
+
+    // Check the connection is still usable after reading everything
+    REQUIRE(redisState.get("pipelineB") == valueB);
+}
+
 void checkDequeueBytes(Redis& redis,
                        const std::string& queueName,
                        const std::vector<uint8_t>& expected)
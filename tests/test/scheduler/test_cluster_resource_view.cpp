@@ -0,0 +1,55 @@
+#include <catch2/catch.hpp>
+
+#include <faabric/scheduler/ClusterResourceView.h>
+
+using namespace faabric::scheduler;
+
+namespace tests {
+
+TEST_CASE("Test reserving slots in cluster resource view", "[scheduler]")
+{
+    ClusterResourceView view;
+
+    std::string hostA = "hostA";
+    std::string hostB = "hostB";
+
+    faabric::HostResources resA;
+    resA.set_slots(4);
+    resA.set_usedslots(1);
+    view.update(hostA, resA);
+
+    // Overloaded hosts have nothing to give
+    faabric::HostResources resB;
+    resB.set_slots(2);
+    resB.set_usedslots(5);
+    view.update(hostB, resB);
+
+    REQUIRE(view.getHosts() == std::set<std::string>({ hostA, hostB }));
+    REQUIRE(view.hasHost(hostA));
+    REQUIRE(!view.hasHost("blah"));
+    REQUIRE_THROWS(view.getResources("blah"));
+
+    // Reservations can't take more than what's free
+    REQUIRE(view.reserve(hostA, 2) == 2);
+    REQUIRE(view.getResources(hostA).usedslots() == 3);
+    REQUIRE(view.reserve(hostA, 5) == 1);
+    REQUIRE(view.reserve(hostA, 1) == 0);
+    REQUIRE(view.reserve(hostB, 1) == 0);
+    REQUIRE(view.reserve("blah", 1) == 0);
+
+    // Released slots can be reserved again
+    view.release(hostA, 2);
+    REQUIRE(view.getResources(hostA).usedslots() == 2);
+    REQUIRE(view.reserve(hostA, 3) == 2);
+
+    // Updates overwrite any reservations
+    view.update(hostA, resA);
+    REQUIRE(view.getResources(hostA).usedslots() == 1);
+
+    view.removeHost(hostB);
+    REQUIRE(view.getHosts() == std::set<std::string>({ hostA }));
+
+    view.clear();
+    REQUIRE(view.getHosts().empty());
+}
+}
@@ -31,6 +31,7 @@ TEST_CASE_METHOD(SchedulerReapingTestFixture,
 {
     int boundTimeoutMs = 0;
     int sleepTimeMs = 0;
+    int poolMin = 0;
     bool expectReaped = false;
 
     // Check nothing happens by default
@@ -44,6 +45,14 @@ TEST_CASE_METHOD(SchedulerReapingTestFixture,
         expectReaped = true;
     }
 
+    SECTION("When executors are stale with a pool minimum")
+    {
+        boundTimeoutMs = 10;
+        sleepTimeMs = 1000;
+        poolMin = 3;
+        expectReaped = true;
+    }
+
     SECTION("When executors aren't stale")
     {
         boundTimeoutMs = 2000;
@@ -53,6 +62,7 @@ TEST_CASE_METHOD(SchedulerReapingTestFixture,
 
     // Set a short bound timeout so executors become stale quickly
     conf.boundTimeout = boundTimeoutMs;
+    conf.executorPoolMin = poolMin;
 
     // Cause the scheduler to scale up
     int nMsgs = 10;
@@ -70,8 +80,8 @@ TEST_CASE_METHOD(SchedulerReapingTestFixture,
     int actual = sch.reapStaleExecutors();
 
     if (expectReaped) {
-        REQUIRE(actual == nMsgs);
-        REQUIRE(sch.getFunctionExecutorCount(firstMsg) == 0);
+        REQUIRE(actual == nMsgs - poolMin);
+        REQUIRE(sch.getFunctionExecutorCount(firstMsg) == poolMin);
     } else {
         REQUIRE(actual == 0);
         REQUIRE(sch.getFunctionExecutorCount(firstMsg) == nMsgs);
@@ -81,9 +91,83 @@ TEST_CASE_METHOD(SchedulerReapingTestFixture,
     int actualTwo = sch.reapStaleExecutors();
     REQUIRE(actualTwo == 0);
     if (expectReaped) {
-        REQUIRE(sch.getFunctionExecutorCount(firstMsg) == 0);
+        REQUIRE(sch.getFunctionExecutorCount(firstMsg) == poolMin);
     } else {
         REQUIRE(sch.getFunctionExecutorCount(firstMsg) == nMsgs);
     }
 }
+
+TEST_CASE_METHOD(SchedulerReapingTestFixture,
+                 "Test pre-warming executors",
+                 "[scheduler]")
+{
+    conf.boundTimeout = 10;
+    conf.executorPoolMax = 5;
+
+    // Nothing to do for functions that haven't been called
+    REQUIRE(sch.prewarmExecutors() == 0);
+
+    int nMsgs = 4;
+    auto req = faabric::util::batchExecFactory("foo", "bar", nMsgs);
+    faabric::Message firstMsg = req->messages().at(0);
+    sch.callFunctions(req);
+
+    for (const auto& m : req->messages()) {
+        sch.getFunctionResult(m.id(), 2000);
+    }
+
+    REQUIRE(sch.getFunctionExecutorCount(firstMsg) == nMsgs);
+
+    // Clear out the executors
+    SLEEP_MS(100);
+    REQUIRE(sch.reapStaleExecutors() == nMsgs);
+    REQUIRE(sch.getFunctionExecutorCount(firstMsg) == 0);
+
+    // Average rate is half the calls seen in the last interval
+    REQUIRE(sch.prewarmExecutors() == nMsgs / 2);
+    REQUIRE(sch.getFunctionExecutorCount(firstMsg) == nMsgs / 2);
+
+    // Rate decays, but we don't remove executors that are already warm
+    REQUIRE(sch.prewarmExecutors() == 0);
+    REQUIRE(sch.getFunctionExecutorCount(firstMsg) == nMsgs / 2);
+
+    // Pool is topped up to its minimum, and not reaped below it
+    conf.executorPoolMin = 3;
+    REQUIRE(sch.prewarmExecutors() == 1);
+    REQUIRE(sch.getFunctionExecutorCount(firstMsg) == 3);
+
+    SLEEP_MS(100);
+    REQUIRE(sch.reapStaleExecutors() == 0);
+    REQUIRE(sch.getFunctionExecutorCount(firstMsg) == 3);
+}
+
+TEST_CASE_METHOD(SchedulerReapingTestFixture,
+                 "Test pre-warming with claimed executors",
+                 "[scheduler]")
+{
+    conf.boundTimeout = 10;
+
+    int nMsgs = 4;
+    conf.executorPoolMin = nMsgs;
+    conf.executorPoolMax = nMsgs;
+
+    auto req = faabric::util::batchExecFactory("foo", "bar", nMsgs);
+    faabric::Message firstMsg = req->messages().at(0);
+    sch.callFunctions(req);
+
+    // The pool is already at its maximum, whether or not the executors are
+    // still busy with the calls
+    REQUIRE(sch.prewarmExecutors() == 0);
+    REQUIRE(sch.getFunctionExecutorCount(firstMsg) == nMsgs);
+
+    for (const auto& m : req->messages()) {
+        sch.getFunctionResult(m.id(), 2000);
+    }
+
+    // Raising the maximum leaves room for one more
+    conf.executorPoolMin = nMsgs + 1;
+    conf.executorPoolMax = nMsgs + 1;
+    REQUIRE(sch.prewarmExecutors() == 1);
+    REQUIRE(sch.getFunctionExecutorCount(firstMsg) == nMsgs + 1);
+}
 }
@@ -268,4 +268,63 @@ TEST_CASE_METHOD(ClientServerFixture, "Test unregister request", "[scheduler]")
     sch.setThisHostResources(originalResources);
     faabric::scheduler::clearMockRequests();
 }
+
+class CountingMockHost : public MockHost
+{
+  public:
+    int nExecuted = 0;
+
+    faabric::HostResources getResources() override
+    {
+        faabric::HostResources res;
+        res.set_slots(4);
+        res.set_usedslots(nExecuted);
+        return res;
+    }
+
+    int tryReserve(int slots, bool force) override
+    {
+        return force ? slots : std::min(slots, 2);
+    }
+
+    void executeFunctions(
+      std::shared_ptr<faabric::BatchExecuteRequest> req) override
+    {
+        nExecuted += req->messages_size();
+    }
+};
+
+TEST_CASE("Test mock hosts handle client requests", "[scheduler]")
+{
+    faabric::util::setMockMode(true);
+
+    std::string mockedHost = "mocked";
+    auto mockHost = std::make_shared<CountingMockHost>();
+    setMockHost(mockedHost, mockHost);
+
+    FunctionCallClient mockedCli(mockedHost);
+    auto req = faabric::util::batchExecFactory("foo", "bar", 3);
+    mockedCli.executeFunctions(req);
+    REQUIRE(mockHost->nExecuted == 3);
+
+    faabric::HostResources res = mockedCli.getResources();
+    REQUIRE(res.slots() == 4);
+    REQUIRE(res.usedslots() == 3);
+
+    faabric::ReservationResponse reservation = mockedCli.tryReserve(3);
+    REQUIRE(reservation.allocatedslots() == 2);
+    REQUIRE(reservation.resources().usedslots() == 3);
+
+    // Requests to mock hosts aren't recorded, others still are
+    REQUIRE(getBatchRequests().empty());
+    REQUIRE(getResourceRequests().empty());
+    REQUIRE(getReservationRequests().empty());
+
+    FunctionCallClient otherCli("other");
+    otherCli.tryReserve(3);
+    REQUIRE(getReservationRequests().size() == 1);
+
+    faabric::util::setMockMode(false);
+    faabric::scheduler::clearMockRequests();
+}
 }
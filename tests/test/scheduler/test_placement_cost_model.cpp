@@ -0,0 +1,66 @@
+#include <catch2/catch.hpp>
+
+#include <faabric/scheduler/PlacementCostModel.h>
+
+using namespace faabric::scheduler;
+
+namespace tests {
+
+TEST_CASE("Test placement cost estimates", "[scheduler]")
+{
+    REQUIRE_THROWS(PlacementCostModel(0));
+
+    // 1000Mbps is 125 bytes per microsecond
+    PlacementCostModel model(1000);
+    size_t snapshotBytes = 125 * 1000;
+    REQUIRE(model.getTransferMillis(snapshotBytes) == 1.0);
+    REQUIRE(model.getTransferMillis(0) == 0);
+
+    PlacementCandidate withSnapshot = { "a", 1, true };
+    PlacementCandidate oneSlot = { "b", 1, false };
+    PlacementCandidate fourSlots = { "c", 4, false };
+    PlacementCandidate unknownSlots = { "d", 0, false };
+
+    REQUIRE(model.getStartMillis(withSnapshot, snapshotBytes, 4) == 0);
+    REQUIRE(model.getStartMillis(oneSlot, snapshotBytes, 4) == 1.0);
+    REQUIRE(model.getStartMillis(unknownSlots, snapshotBytes, 4) == 1.0);
+
+    // Transfer is shared between the calls the host will actually take
+    REQUIRE(model.getStartMillis(fourSlots, snapshotBytes, 4) == 0.25);
+    REQUIRE(model.getStartMillis(fourSlots, snapshotBytes, 2) == 0.5);
+
+    // Nothing to transfer without a snapshot
+    REQUIRE(model.getStartMillis(oneSlot, 0, 4) == 0);
+}
+
+TEST_CASE("Test ranking hosts for placement", "[scheduler]")
+{
+    PlacementCostModel model(1000);
+
+    std::vector<PlacementCandidate> candidates = {
+        { "small", 1, false },
+        { "warmA", 1, true },
+        { "large", 8, false },
+        { "warmB", 2, true },
+        { "unknown", 0, false },
+    };
+
+    size_t snapshotBytes = 0;
+    std::vector<std::string> expected;
+
+    SECTION("No snapshot")
+    {
+        // All the same, so original order is kept
+        snapshotBytes = 0;
+        expected = { "small", "warmA", "large", "warmB", "unknown" };
+    }
+
+    SECTION("With snapshot")
+    {
+        snapshotBytes = 10 * 1024 * 1024;
+        expected = { "warmA", "warmB", "large", "small", "unknown" };
+    }
+
+    REQUIRE(model.rankHosts(candidates, snapshotBytes, 8) == expected);
+}
+}
@@ -624,6 +624,7 @@ TEST_CASE_METHOD(SlowExecutorFixture,
     call.set_inputdata(inputData);
 
     sch.setFunctionResult(call);
+    sch.flushFunctionResults();
 
     // Check result has been written to the right key
     REQUIRE(redis.listLength(call.resultkey()) == 1);
@@ -638,6 +639,202 @@ TEST_CASE_METHOD(SlowExecutorFixture,
     checkMessageEquality(call, actualCall2);
 }
 
+TEST_CASE_METHOD(SlowExecutorFixture,
+                 "Test pushing function results to master",
+                 "[scheduler]")
+{
+    faabric::util::setMockMode(true);
+
+    std::string thisHost = conf.endpointHost;
+    std::string otherHost = "other";
+    conf.functionResultMode = "direct";
+
+    // Send calls from this host to another
+    auto req = faabric::util::batchExecFactory("foo", "bar", 2);
+    faabric::util::SchedulingDecision hint(req->messages().at(0).appid(), 0);
+    for (auto& m : *req->mutable_messages()) {
+        m.set_masterhost(thisHost);
+        hint.addMessage(otherHost, m);
+    }
+
+    sch.callFunctions(req, hint);
+
+    auto batchRequests = faabric::scheduler::getBatchRequests();
+    REQUIRE(batchRequests.size() == 1);
+    for (const auto& m : batchRequests.at(0).second->messages()) {
+        REQUIRE(m.directresult());
+    }
+
+    // Result of the first arrives back on this host
+    faabric::Message resultA = batchRequests.at(0).second->messages().at(0);
+    resultA.set_outputdata("done");
+    sch.setFunctionResultLocally(resultA);
+
+    faabric::Message actualA = sch.getFunctionResult(resultA.id(), 1000);
+    REQUIRE(actualA.outputdata() == "done");
+
+    // Nothing yet for the second
+    int idB = batchRequests.at(0).second->messages().at(1).id();
+    faabric::Message actualB = sch.getFunctionResult(idB, 0);
+    REQUIRE(actualB.type() == faabric::Message_MessageType_EMPTY);
+
+    // Executing a call for another host pushes the result back to it
+    faabric::Message remoteCall = faabric::util::messageFactory("foo", "bar");
+    remoteCall.set_masterhost(otherHost);
+    remoteCall.set_directresult(true);
+    sch.setFunctionResult(remoteCall);
+    sch.flushFunctionResults();
+
+    auto pushedResults = faabric::scheduler::getFunctionCalls();
+    REQUIRE(pushedResults.size() == 1);
+    REQUIRE(pushedResults.at(0).first == otherHost);
+    REQUIRE(pushedResults.at(0).second.id() == remoteCall.id());
+
+    // Pushed results are always published to Redis as well
+    REQUIRE(redis.listLength(remoteCall.resultkey()) == 1);
+}
+
+TEST_CASE_METHOD(SlowExecutorFixture,
+                 "Test queueing calls beyond host capacity",
+                 "[scheduler]")
+{
+    int nSlots = 2;
+    conf.hostQueueCapacity = 2;
+
+    faabric::HostResources res;
+    res.set_slots(nSlots);
+    sch.setThisHostResources(res);
+
+    // With no other hosts, everything is overloaded on this one
+    int nMsgs = 5;
+    auto req = faabric::util::batchExecFactory("slow", "func", nMsgs);
+    faabric::Message firstMsg = req->messages().at(0);
+    sch.callFunctions(req);
+
+    // Two execute, two wait, and the last is turned away
+    AdmissionMetrics metrics = sch.getAdmissionMetrics();
+    REQUIRE(metrics.queueDepth == 2);
+    REQUIRE(metrics.nQueued == 2);
+    REQUIRE(metrics.nRejected == 1);
+
+    faabric::Message rejected =
+      sch.getFunctionResult(req->messages().at(nMsgs - 1).id(), 1000);
+    REQUIRE(rejected.returnvalue() == REJECTED_FUNCTION_RETURN_VALUE);
+
+    for (int i = 0; i < nMsgs - 1; i++) {
+        faabric::Message result =
+          sch.getFunctionResult(req->messages().at(i).id(), 10000);
+        REQUIRE(result.returnvalue() == 0);
+    }
+
+    // Queued calls reuse the executors freed up by the others
+    REQUIRE(sch.getFunctionExecutorCount(firstMsg) == nSlots);
+
+    metrics = sch.getAdmissionMetrics();
+    REQUIRE(metrics.queueDepth == 0);
+    REQUIRE(metrics.maxWaitMillis > 0);
+    REQUIRE(metrics.totalWaitMillis >= metrics.maxWaitMillis);
+}
+
+TEST_CASE_METHOD(SlowExecutorFixture,
+                 "Test priority calls use reserved slots",
+                 "[scheduler]")
+{
+    conf.hostQueueCapacity = 10;
+    conf.reservedPrioritySlots = 1;
+
+    faabric::HostResources res;
+    res.set_slots(2);
+    sch.setThisHostResources(res);
+
+    // Normal calls can't use the reserved slot
+    auto batchReq = faabric::util::batchExecFactory("slow", "func", 3);
+    sch.callFunctions(batchReq);
+
+    AdmissionMetrics metrics = sch.getAdmissionMetrics();
+    REQUIRE(metrics.queueDepth == 2);
+
+    // A priority call skips the queue and takes the reserved slot
+    auto priorityReq = faabric::util::batchExecFactory("slow", "func", 1);
+    faabric::Message& priorityMsg = priorityReq->mutable_messages()->at(0);
+    priorityMsg.set_priority(1);
+    sch.callFunctions(priorityReq);
+
+    metrics = sch.getAdmissionMetrics();
+    REQUIRE(metrics.queueDepth == 2);
+    REQUIRE(metrics.nQueued == 2);
+
+    faabric::Message priorityResult =
+      sch.getFunctionResult(priorityMsg.id(), 10000);
+    REQUIRE(priorityResult.returnvalue() == 0);
+
+    for (const auto& m : batchReq->messages()) {
+        faabric::Message result = sch.getFunctionResult(m.id(), 10000);
+        REQUIRE(result.returnvalue() == 0);
+    }
+
+    metrics = sch.getAdmissionMetrics();
+    REQUIRE(metrics.queueDepth == 0);
+    REQUIRE(metrics.nRejected == 0);
+}
+
+TEST_CASE_METHOD(SlowExecutorFixture,
+                 "Test queueing calls on a host with no slots",
+                 "[scheduler]")
+{
+    conf.hostQueueCapacity = 10;
+
+    faabric::HostResources res;
+    res.set_slots(0);
+    sch.setThisHostResources(res);
+
+    // Calls still run one at a time rather than waiting forever
+    int nMsgs = 3;
+    auto req = faabric::util::batchExecFactory("slow", "func", nMsgs);
+    sch.callFunctions(req);
+
+    AdmissionMetrics metrics = sch.getAdmissionMetrics();
+    REQUIRE(metrics.nQueued == nMsgs - 1);
+    REQUIRE(sch.getThisHostResources().usedslots() == 1);
+
+    for (const auto& m : req->messages()) {
+        faabric::Message result = sch.getFunctionResult(m.id(), 10000);
+        REQUIRE(result.returnvalue() == 0);
+    }
+
+    metrics = sch.getAdmissionMetrics();
+    REQUIRE(metrics.queueDepth == 0);
+    REQUIRE(metrics.nRejected == 0);
+    REQUIRE(sch.getThisHostResources().usedslots() == 0);
+}
+
+TEST_CASE_METHOD(SlowExecutorFixture,
+                 "Test queued calls start when slots are added",
+                 "[scheduler]")
+{
+    conf.hostQueueCapacity = 10;
+
+    faabric::HostResources res;
+    res.set_slots(1);
+    sch.setThisHostResources(res);
+
+    int nMsgs = 3;
+    auto req = faabric::util::batchExecFactory("slow", "func", nMsgs);
+    sch.callFunctions(req);
+    REQUIRE(sch.getAdmissionMetrics().queueDepth == nMsgs - 1);
+
+    // Growing the host lets the queued calls in straight away
+    res = sch.getThisHostResources();
+    res.set_slots(nMsgs);
+    sch.setThisHostResources(res);
+    REQUIRE(sch.getAdmissionMetrics().queueDepth == 0);
+
+    for (const auto& m : req->messages()) {
+        faabric::Message result = sch.getFunctionResult(m.id(), 10000);
+        REQUIRE(result.returnvalue() == 0);
+    }
+}
+
 TEST_CASE_METHOD(SlowExecutorFixture,
                  "Check multithreaded function results",
                  "[scheduler]")
@@ -737,6 +934,7 @@ TEST_CASE_METHOD(SlowExecutorFixture,
     expected.set_executedhost(util::getSystemConfig().endpointHost);
 
     sch.setFunctionResult(msg);
+    sch.flushFunctionResults();
 
     std::vector<uint8_t> actual = redis.get(msg.statuskey());
     REQUIRE(!actual.empty());
@@ -929,6 +1127,48 @@ TEST_CASE_METHOD(DummyExecutorFixture, "Test executor reuse", "[scheduler]")
     REQUIRE(sch.getFunctionExecutorCount(msgB) == 2);
 }
 
+TEST_CASE_METHOD(DummyExecutorFixture,
+                 "Test concurrent calls to different functions",
+                 "[scheduler]")
+{
+    int nFuncs = 6;
+    int nRepeats = 5;
+    int nMsgs = 2;
+
+    // Each thread calls its own function several times, so each function
+    // should have its own executors
+    std::vector<std::vector<faabric::Message>> calledMessages(nFuncs);
+    std::vector<std::jthread> threads;
+    for (int f = 0; f < nFuncs; f++) {
+        threads.emplace_back([this, f, nRepeats, nMsgs, &calledMessages] {
+            std::string funcName = "func_" + std::to_string(f);
+            for (int r = 0; r < nRepeats; r++) {
+                auto req =
+                  faabric::util::batchExecFactory("foo", funcName, nMsgs);
+                sch.callFunctions(req);
+
+                for (const auto& m : req->messages()) {
+                    calledMessages.at(f).push_back(m);
+                    sch.getFunctionResult(m.id(), SHORT_TEST_TIMEOUT_MS);
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    for (int f = 0; f < nFuncs; f++) {
+        REQUIRE(calledMessages.at(f).size() == nRepeats * nMsgs);
+
+        faabric::Message& msg = calledMessages.at(f).front();
+        REQUIRE(sch.getFunctionExecutorCount(msg) >= nMsgs);
+    }
+
+    REQUIRE(sch.getRecordedMessagesLocal().size() == nFuncs * nRepeats * nMsgs);
+}
+
 TEST_CASE_METHOD(DummyExecutorFixture,
                  "Test point-to-point mappings sent from scheduler",
                  "[scheduler]")
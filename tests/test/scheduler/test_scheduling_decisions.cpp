@@ -490,4 +490,172 @@ TEST_CASE_METHOD(SchedulingDecisionTestFixture,
       faabric::util::batchExecFactory("foo", "bar", config.numReqs);
     testActualSchedulingDecision(missReq, missConfig);
 }
+
+TEST_CASE_METHOD(SchedulingDecisionTestFixture,
+                 "Test scheduling decisions from cluster resource view",
+                 "[scheduler]")
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.resourceGossipIntervalSeconds = 10;
+
+    auto countResourceRequests = [](const std::string& host) {
+        int count = 0;
+        for (const auto& r : getResourceRequests()) {
+            count += r.first == host ? 1 : 0;
+        }
+        return count;
+    };
+
+    setHostResources(
+      { masterHost, "hostA", "hostB" }, { 1, 2, 4 }, { 0, 0, 0 });
+
+    // Hosts not in the view are fetched on first use
+    auto req = faabric::util::batchExecFactory("foo", "bar", 6);
+    faabric::util::SchedulingDecision decision =
+      sch.makeSchedulingDecision(req);
+
+    std::vector<std::string> expectedHosts = { masterHost, "hostA", "hostA",
+                                               "hostB",    "hostB", "hostB" };
+    REQUIRE(decision.hosts == expectedHosts);
+    REQUIRE(countResourceRequests("hostA") == 1);
+    REQUIRE(countResourceRequests("hostB") == 1);
+
+    // Reservations are confirmed once the decision is made
+    auto reservations = getReservationRequests();
+    REQUIRE(reservations.size() == 2);
+    REQUIRE(reservations.at(0).first == "hostA");
+    REQUIRE(reservations.at(0).second.slots() == 2);
+    REQUIRE(reservations.at(1).first == "hostB");
+    REQUIRE(reservations.at(1).second.slots() == 3);
+
+    // The next decision only uses the view, which has what's left over
+    auto nextReq = faabric::util::batchExecFactory("foo", "bar", 3);
+    for (int i = 0; i < nextReq->messages_size(); i++) {
+        nextReq->mutable_messages()->at(i).set_appid(decision.appId);
+    }
+
+    decision = sch.makeSchedulingDecision(nextReq);
+    expectedHosts = { masterHost, "hostB", masterHost };
+    REQUIRE(decision.hosts == expectedHosts);
+    REQUIRE(countResourceRequests("hostA") == 1);
+    REQUIRE(countResourceRequests("hostB") == 1);
+    REQUIRE(getReservationRequests().size() == 3);
+
+    // Refreshing the view picks up the hosts' latest resources
+    faabric::HostResources freeRes;
+    freeRes.set_slots(2);
+    queueResourceResponse("hostA", freeRes);
+    queueResourceResponse("hostB", freeRes);
+    sch.refreshClusterResources();
+    REQUIRE(countResourceRequests("hostA") == 2);
+    REQUIRE(countResourceRequests("hostB") == 2);
+
+    decision = sch.makeSchedulingDecision(nextReq);
+    expectedHosts = { masterHost, "hostA", "hostA" };
+    REQUIRE(decision.hosts == expectedHosts);
+
+    conf.reset();
+}
+
+// Looks free to the view, but only has one slot left to reserve
+class OutdatedMockHost : public MockHost
+{
+  public:
+    int usedSlots = 0;
+    std::vector<std::pair<int, bool>> reservations;
+
+    faabric::HostResources getResources() override
+    {
+        faabric::HostResources res;
+        res.set_slots(4);
+        res.set_usedslots(usedSlots);
+        return res;
+    }
+
+    int tryReserve(int slots, bool force) override
+    {
+        reservations.emplace_back(slots, force);
+        int reserved = force ? slots : std::min(slots, 1);
+        usedSlots += reserved;
+        return reserved;
+    }
+
+    void executeFunctions(
+      std::shared_ptr<faabric::BatchExecuteRequest> req) override
+    {}
+};
+
+TEST_CASE_METHOD(SchedulingDecisionTestFixture,
+                 "Test reservation shortfalls are forced on the host",
+                 "[scheduler]")
+{
+    setHostResources({ masterHost }, { 1 }, { 0 });
+
+    auto mockHost = std::make_shared<OutdatedMockHost>();
+    setMockHost("hostA", mockHost);
+    sch.addHostToGlobalSet("hostA");
+
+    auto req = faabric::util::batchExecFactory("foo", "bar", 4);
+    faabric::util::SchedulingDecision decision =
+      sch.makeSchedulingDecision(req);
+
+    std::vector<std::string> expectedHosts = { masterHost,
+                                               "hostA",
+                                               "hostA",
+                                               "hostA" };
+    REQUIRE(decision.hosts == expectedHosts);
+
+    // The host confirmed one slot, then was made to take the other two
+    std::vector<std::pair<int, bool>> expectedReservations = { { 3, false },
+                                                               { 2, true } };
+    REQUIRE(mockHost->reservations == expectedReservations);
+    REQUIRE(mockHost->usedSlots == 3);
+}
+
+TEST_CASE_METHOD(SchedulingDecisionTestFixture,
+                 "Test locality-aware scheduling decisions",
+                 "[scheduler]")
+{
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    faabric::snapshot::SnapshotRegistry& reg =
+      faabric::snapshot::getSnapshotRegistry();
+
+    // Slot counts come from the cluster view
+    conf.resourceGossipIntervalSeconds = 10;
+    setHostResources(
+      { masterHost, "hostA", "hostB" }, { 1, 1, 3 }, { 0, 0, 0 });
+    sch.refreshClusterResources();
+
+    std::string snapKey = "locality-snap";
+    size_t snapSize = 20 * faabric::util::HOST_PAGE_SIZE;
+    auto snap = std::make_shared<faabric::util::SnapshotData>(snapSize);
+    reg.registerSnapshot(snapKey, snap);
+
+    auto req = faabric::util::batchExecFactory("foo", "bar", 4);
+    for (auto& m : *req->mutable_messages()) {
+        m.set_snapshotkey(snapKey);
+    }
+
+    std::vector<std::string> expectedHosts;
+    SECTION("Bin-packing")
+    {
+        conf.placementPolicy = "binpack";
+        expectedHosts = { masterHost, "hostA", "hostB", "hostB" };
+    }
+
+    SECTION("Locality")
+    {
+        // Sending everything to the larger host means pushing the snapshot
+        // to one host rather than two
+        conf.placementPolicy = "locality";
+        expectedHosts = { masterHost, "hostB", "hostB", "hostB" };
+    }
+
+    faabric::util::SchedulingDecision decision =
+      sch.makeSchedulingDecision(req);
+    REQUIRE(decision.hosts == expectedHosts);
+
+    reg.deleteSnapshot(snapKey);
+    conf.reset();
+}
 }
@@ -0,0 +1,185 @@
+#include <catch2/catch.hpp>
+
+#include <faabric/scheduler/WeightedFairQueue.h>
+
+#include <algorithm>
+#include <map>
+
+using namespace faabric::scheduler;
+
+namespace tests {
+
+TEST_CASE("Test fair queue ordering", "[scheduler]")
+{
+    WeightedFairQueue<int> queue;
+    REQUIRE(queue.empty());
+    REQUIRE_THROWS(queue.dequeue());
+    REQUIRE_THROWS(queue.peekPriority());
+
+    // A single user is served in order
+    queue.enqueue(1, "alice", "echo");
+    queue.enqueue(2, "alice", "echo");
+    queue.enqueue(3, "alice", "echo");
+    REQUIRE(queue.size() == 3);
+    REQUIRE(queue.dequeue() == 1);
+
+    // Higher priorities jump the queue regardless of user
+    queue.enqueue(10, "bob", "echo", 2);
+    queue.enqueue(11, "alice", "echo", 1);
+    REQUIRE(queue.peekPriority() == 2);
+    REQUIRE(queue.dequeue() == 10);
+    REQUIRE(queue.peekPriority() == 1);
+    REQUIRE(queue.dequeue() == 11);
+
+    REQUIRE(queue.peekPriority() == 0);
+    REQUIRE(queue.dequeue() == 2);
+    REQUIRE(queue.dequeue() == 3);
+    REQUIRE(queue.empty());
+
+    queue.enqueue(4, "alice", "echo");
+    queue.clear();
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("Test fair queue weights", "[scheduler]")
+{
+    WeightedFairQueue<std::string> queue;
+
+    int nEach = 100;
+    for (int i = 0; i < nEach; i++) {
+        queue.enqueue("heavy", "alice", "echo", 0, 3);
+        queue.enqueue("light", "bob", "echo", 0, 1);
+    }
+
+    // Shares are in proportion to the weights
+    int nHeavy = 0;
+    for (int i = 0; i < 40; i++) {
+        if (queue.dequeue() == "heavy") {
+            nHeavy++;
+        }
+    }
+
+    REQUIRE(nHeavy == 30);
+
+    // Weights below one are treated as one
+    queue.clear();
+    queue.enqueue("a", "alice", "echo", 0, 0);
+    queue.enqueue("b", "alice", "echo", 0, -1);
+    queue.enqueue("c", "bob", "echo", 0, 1);
+    REQUIRE(queue.dequeue() == "c");
+    REQUIRE(queue.dequeue() == "a");
+    REQUIRE(queue.dequeue() == "b");
+}
+
+TEST_CASE("Test fair queue shares users' slots between their functions",
+          "[scheduler]")
+{
+    WeightedFairQueue<std::string> queue;
+
+    // Alice queues a big batch of one function before a few of another
+    for (int i = 0; i < 100; i++) {
+        queue.enqueue("alice/train", "alice", "train");
+        queue.enqueue("bob/echo", "bob", "echo");
+    }
+    for (int i = 0; i < 10; i++) {
+        queue.enqueue("alice/serve", "alice", "serve");
+    }
+
+    // Users still get equal shares, and Alice's is split between functions
+    std::map<std::string, int> counts;
+    for (int i = 0; i < 40; i++) {
+        counts[queue.dequeue()]++;
+    }
+
+    REQUIRE(counts["bob/echo"] == 20);
+    REQUIRE(counts["alice/train"] == 10);
+    REQUIRE(counts["alice/serve"] == 10);
+}
+
+TEST_CASE("Test fair queue drops empty flows", "[scheduler]")
+{
+    WeightedFairQueue<int> queue;
+
+    queue.enqueue(1, "alice", "echo");
+    for (int i = 0; i < 3; i++) {
+        queue.enqueue(2, "bob", "echo");
+    }
+    REQUIRE(queue.getFlowCount() == 2);
+
+    REQUIRE(queue.dequeue() == 2);
+    REQUIRE(queue.dequeue() == 1);
+
+    // Alice's flow is empty, but still finishes ahead of Bob's next call
+    REQUIRE(queue.getFlowCount() == 2);
+
+    REQUIRE(queue.dequeue() == 2);
+    REQUIRE(queue.getFlowCount() == 1);
+
+    REQUIRE(queue.dequeue() == 2);
+    REQUIRE(queue.empty());
+    REQUIRE(queue.getFlowCount() == 0);
+
+    // Lots of users coming and going don't leave anything behind
+    for (int i = 0; i < 1000; i++) {
+        queue.enqueue(i, "user_" + std::to_string(i), "echo");
+        queue.dequeue();
+    }
+    REQUIRE(queue.getFlowCount() == 0);
+}
+
+TEST_CASE("Test fair queue isolates interactive users", "[scheduler]")
+{
+    // Simulates a host with a few slots, where every call takes one tick. A
+    // batch user submits a big batch up front, while an interactive user
+    // sends a call every few ticks. Putting everyone under the same user
+    // gives the old first-come-first-served behaviour.
+    bool fair = false;
+    int expectedMaxLatency = 0;
+
+    SECTION("First-come-first-served")
+    {
+        fair = false;
+        expectedMaxLatency = 250;
+    }
+
+    SECTION("Fair share")
+    {
+        fair = true;
+        expectedMaxLatency = 0;
+    }
+
+    int nSlots = 4;
+    int nBatch = 1000;
+    int nInteractive = 20;
+    int interactiveInterval = 5;
+
+    // Items are the tick the call arrived, or -1 for batch calls
+    WeightedFairQueue<int> queue;
+    std::string batchUser = "batch";
+    std::string interactiveUser = fair ? "interactive" : batchUser;
+
+    for (int i = 0; i < nBatch; i++) {
+        queue.enqueue(-1, batchUser, "echo");
+    }
+
+    int nArrived = 0;
+    int nServed = 0;
+    int maxLatency = 0;
+    for (int tick = 0; nServed < nInteractive; tick++) {
+        if (nArrived < nInteractive && tick % interactiveInterval == 0) {
+            queue.enqueue(tick, interactiveUser, "echo");
+            nArrived++;
+        }
+
+        for (int s = 0; s < nSlots && !queue.empty(); s++) {
+            int arrivedAt = queue.dequeue();
+            if (arrivedAt >= 0) {
+                maxLatency = std::max(maxLatency, tick - arrivedAt);
+                nServed++;
+            }
+        }
+    }
+
+    REQUIRE(maxLatency == expectedMaxLatency);
+}
+}
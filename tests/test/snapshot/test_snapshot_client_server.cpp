@@ -247,6 +247,76 @@ TEST_CASE_METHOD(SnapshotClientServerFixture,
     checkDiffsApplied(snap->getDataPtr(), diffsB);
 }
 
+TEST_CASE("Test snapshot broadcast groups", "[snapshot]")
+{
+    std::vector<std::string> hosts = { "a", "b", "c", "d", "e" };
+    std::vector<std::vector<std::string>> expected;
+    int fanOut = 0;
+
+    SECTION("No fan-out")
+    {
+        fanOut = 0;
+        expected = { { "a" }, { "b" }, { "c" }, { "d" }, { "e" } };
+    }
+
+    SECTION("Fan-out of one")
+    {
+        fanOut = 1;
+        expected = { { "a", "b", "c", "d", "e" } };
+    }
+
+    SECTION("Uneven fan-out")
+    {
+        fanOut = 2;
+        expected = { { "a", "b", "c" }, { "d", "e" } };
+    }
+
+    SECTION("Fan-out larger than hosts")
+    {
+        fanOut = 10;
+        expected = { { "a" }, { "b" }, { "c" }, { "d" }, { "e" } };
+    }
+
+    REQUIRE(faabric::snapshot::getBroadcastGroups(hosts, fanOut) == expected);
+    REQUIRE(faabric::snapshot::getBroadcastGroups({}, fanOut).empty());
+}
+
+TEST_CASE_METHOD(SnapshotClientServerFixture,
+                 "Test broadcasting snapshots through relays",
+                 "[snapshot]")
+{
+    // Both hosts resolve to the same server, so the first has to relay to the
+    // second while still handling the original request
+    std::vector<std::string> hosts = { LOCALHOST, "localhost" };
+    int fanOut = 0;
+
+    SECTION("Direct") { fanOut = 0; }
+
+    SECTION("Relayed") { fanOut = 1; }
+
+    std::string snapKey = std::to_string(generateGid());
+    std::vector<uint8_t> data(2 * HOST_PAGE_SIZE, 3);
+    auto snap = std::make_shared<SnapshotData>(data);
+    snap->addMergeRegion(
+      0, sizeof(int), SnapshotDataType::Int, SnapshotMergeOperation::Sum);
+
+    faabric::snapshot::pushSnapshotToHosts(hosts, snapKey, snap, fanOut);
+
+    auto actual = reg.getSnapshot(snapKey);
+    REQUIRE(actual->getDataCopy() == data);
+    REQUIRE(actual->getMergeRegions().size() == 1);
+
+    // Bytewise diffs are the same however many times they're applied
+    std::vector<uint8_t> diffData = { 7, 8, 9 };
+    std::vector<SnapshotDiff> diffs = { SnapshotDiff(
+      SnapshotDataType::Raw, SnapshotMergeOperation::Bytewise, 10, diffData) };
+
+    faabric::snapshot::pushSnapshotUpdateToHosts(
+      hosts, snapKey, snap, diffs, fanOut);
+
+    checkDiffsApplied(reg.getSnapshot(snapKey)->getDataPtr(), diffs);
+}
+
 TEST_CASE_METHOD(SnapshotClientServerFixture,
                  "Test detailed snapshot diffs with merge ops",
                  "[snapshot]")
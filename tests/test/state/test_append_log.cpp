@@ -0,0 +1,125 @@
+#include <catch2/catch.hpp>
+
+#include <faabric/state/AppendLog.h>
+
+#include <numeric>
+
+using namespace faabric::state;
+
+namespace tests {
+
+TEST_CASE("Test appending to and reading from append log", "[state]")
+{
+    AppendLog log(10);
+
+    std::vector<uint8_t> valuesA = { 0, 1, 2, 3 };
+    std::vector<uint8_t> valuesB = { 4, 5, 6, 7, 8 };
+    std::vector<uint8_t> valuesC = { 9, 10, 11 };
+
+    // First two fit in one segment, the third needs another
+    log.append(valuesA.data(), valuesA.size());
+    log.append(valuesB.data(), valuesB.size());
+    REQUIRE(log.size() == 2);
+    REQUIRE(log.getSegmentCount() == 1);
+
+    log.append(valuesC.data(), valuesC.size());
+    REQUIRE(log.size() == 3);
+    REQUIRE(log.getSegmentCount() == 2);
+
+    // Values larger than a segment get their own
+    std::vector<uint8_t> valuesD(25);
+    std::iota(valuesD.begin(), valuesD.end(), 12);
+    log.append(valuesD.data(), valuesD.size());
+    REQUIRE(log.size() == 4);
+    REQUIRE(log.getSegmentCount() == 3);
+
+    std::vector<uint8_t> all(37);
+    std::iota(all.begin(), all.end(), 0);
+
+    size_t startIdx = 0;
+    size_t nValues = 0;
+    std::vector<uint8_t> expected;
+    size_t expectedSlices = 0;
+
+    SECTION("All values")
+    {
+        startIdx = 0;
+        nValues = 4;
+        expected = all;
+        expectedSlices = 3;
+    }
+
+    SECTION("Within one segment")
+    {
+        startIdx = 1;
+        nValues = 1;
+        expected = valuesB;
+        expectedSlices = 1;
+    }
+
+    SECTION("Across segments")
+    {
+        startIdx = 1;
+        nValues = 2;
+        expected = std::vector<uint8_t>(all.begin() + 4, all.begin() + 12);
+        expectedSlices = 2;
+    }
+
+    SECTION("None")
+    {
+        startIdx = 4;
+        nValues = 0;
+        expectedSlices = 0;
+    }
+
+    REQUIRE(log.getRangeBytes(startIdx, nValues) == expected.size());
+
+    std::vector<uint8_t> actual(expected.size(), 0);
+    size_t nBytes =
+      log.readRange(startIdx, nValues, actual.data(), actual.size());
+    REQUIRE(nBytes == expected.size());
+    REQUIRE(actual == expected);
+
+    // Values in the same segment are visited together
+    std::vector<uint8_t> visited;
+    size_t nSlices = 0;
+    log.visitRange(startIdx, nValues, [&](std::span<const uint8_t> slice) {
+        visited.insert(visited.end(), slice.begin(), slice.end());
+        nSlices++;
+    });
+    REQUIRE(visited == expected);
+    REQUIRE(nSlices == expectedSlices);
+}
+
+TEST_CASE("Test append log errors and clearing", "[state]")
+{
+    REQUIRE_THROWS(AppendLog(0));
+
+    AppendLog log(10);
+
+    std::vector<uint8_t> valuesA = { 1, 2, 3, 4, 5, 6 };
+    std::vector<uint8_t> valuesB = { 7, 8, 9, 10, 11, 12 };
+    log.append(valuesA.data(), valuesA.size());
+    log.append(valuesB.data(), valuesB.size());
+
+    // Reading past the end
+    std::vector<uint8_t> buffer(20, 0);
+    REQUIRE_THROWS(log.readRange(1, 2, buffer.data(), buffer.size()));
+
+    // Buffer too small
+    REQUIRE_THROWS(log.readRange(0, 2, buffer.data(), 8));
+
+    // Clearing keeps the first segment for reuse
+    log.clear();
+    REQUIRE(log.size() == 0);
+    REQUIRE(log.getSegmentCount() == 1);
+
+    log.append(valuesB.data(), valuesB.size());
+    REQUIRE(log.size() == 1);
+    REQUIRE(log.getSegmentCount() == 1);
+
+    std::vector<uint8_t> actual(valuesB.size(), 0);
+    log.readRange(0, 1, actual.data(), actual.size());
+    REQUIRE(actual == valuesB);
+}
+}
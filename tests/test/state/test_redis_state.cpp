@@ -574,4 +574,48 @@ TEST_CASE("Test redis state deletion", "[state]")
 
     resetStateMode();
 }
+
+TEST_CASE("Test redis pulling and pushing multiple values", "[state]")
+{
+    setUpStateMode("redis");
+
+    State& s = getGlobalState();
+    redis::Redis& redisState = redis::Redis::getState();
+
+    int nValues = 5;
+    std::vector<std::shared_ptr<StateKeyValue>> kvs;
+    std::vector<std::vector<uint8_t>> values;
+    for (int i = 0; i < nValues; i++) {
+        values.emplace_back(10 + i, i + 1);
+        kvs.push_back(setupKV(values.back().size()));
+
+        redisState.set(faabric::util::keyForUser(kvs.back()->user,
+                                                 kvs.back()->key),
+                       values.back());
+    }
+
+    // Pull them all at once
+    s.pullMultiple(kvs);
+    for (int i = 0; i < nValues; i++) {
+        std::vector<uint8_t> actual(values.at(i).size(), 0);
+        kvs.at(i)->get(actual.data());
+        REQUIRE(actual == values.at(i));
+    }
+
+    // Change some of them and push them all at once
+    std::vector<uint8_t> update = { 9, 9 };
+    for (int i = 0; i < nValues; i += 2) {
+        kvs.at(i)->setChunk(3, update.data(), update.size());
+        std::copy(update.begin(), update.end(), values.at(i).begin() + 3);
+    }
+
+    s.pushMultiple(kvs);
+    for (int i = 0; i < nValues; i++) {
+        std::string redisKey =
+          faabric::util::keyForUser(kvs.at(i)->user, kvs.at(i)->key);
+        REQUIRE(redisState.get(redisKey) == values.at(i));
+    }
+
+    resetStateMode();
+}
 }
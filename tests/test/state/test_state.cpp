@@ -5,14 +5,21 @@
 #include <faabric/redis/Redis.h>
 #include <faabric/state/InMemoryStateKeyValue.h>
 #include <faabric/state/State.h>
+#include <faabric/state/StateFlusher.h>
+#include <faabric/state/StateMemoryTracker.h>
 #include <faabric/state/StateServer.h>
 #include <faabric/util/config.h>
 #include <faabric/util/macros.h>
 #include <faabric/util/memory.h>
 #include <faabric/util/network.h>
+#include <faabric/util/snapshot.h>
 #include <faabric/util/state.h>
 
+#include <cstring>
+#include <numeric>
+#include <set>
 #include <sys/mman.h>
+#include <thread>
 
 using namespace faabric::state;
 
@@ -728,6 +735,149 @@ TEST_CASE_METHOD(StateServerTestFixture, "Test deletion", "[state]")
     REQUIRE(remoteState.getKVCount() == 0);
 }
 
+TEST_CASE_METHOD(StateServerTestFixture,
+                 "Test pulling and pushing large values",
+                 "[state]")
+{
+    faabric::util::SystemConfig& sysConf = faabric::util::getSystemConfig();
+
+    SECTION("Serial") { sysConf.stateTransferWindow = 1; }
+
+    SECTION("Small window") { sysConf.stateTransferWindow = 2; }
+
+    SECTION("Large window") { sysConf.stateTransferWindow = 64; }
+
+    // Spans several transfer requests and doesn't end on a chunk boundary
+    size_t valueSize = 3 * STATE_TRANSFER_MAX_BYTES + 123;
+    std::vector<uint8_t> values(valueSize, 0);
+    for (size_t i = 0; i < valueSize; i++) {
+        values.at(i) = i % 255;
+    }
+    setDummyData(values);
+
+    REQUIRE(getLocalKvValue() == values);
+
+    // Change a mix of small and large chunks, including one crossing a
+    // transfer boundary, and push them
+    std::shared_ptr<StateKeyValue> localKv = getLocalKv();
+    std::vector<uint8_t> update(2 * STATE_STREAMING_CHUNK_SIZE, 7);
+    std::vector<std::pair<size_t, size_t>> updates = {
+        { 10, 100 },
+        { STATE_TRANSFER_MAX_BYTES - 50, update.size() },
+        { valueSize - 20, 20 },
+    };
+
+    std::vector<uint8_t> expected = values;
+    for (const auto& [offset, length] : updates) {
+        localKv->setChunk(offset, update.data(), length);
+        std::copy_n(update.begin(), length, expected.begin() + offset);
+    }
+
+    localKv->pushPartial();
+    REQUIRE(getRemoteKvValue() == expected);
+
+    // Push the whole value
+    std::vector<uint8_t> newValues(valueSize, 3);
+    localKv->set(newValues.data());
+    localKv->pushFull();
+    REQUIRE(getRemoteKvValue() == newValues);
+}
+
+TEST_CASE_METHOD(StateServerTestFixture,
+                 "Test sharded state spread over hosts",
+                 "[state]")
+{
+    faabric::util::SystemConfig& sysConf = faabric::util::getSystemConfig();
+    sysConf.stateMode = "sharded";
+    sysConf.stateShardSize = 4;
+
+    // Spread the value over this host and the dummy remote server
+    std::string thisHost = state.getThisIP();
+    faabric::redis::Redis& queueRedis = faabric::redis::Redis::getQueue();
+    queueRedis.flushAll();
+    queueRedis.sadd(AVAILABLE_HOST_SET, LOCALHOST);
+    queueRedis.sadd(AVAILABLE_HOST_SET, thisHost);
+
+    int nSegments = 16;
+    std::vector<uint8_t> values(nSegments * sysConf.stateShardSize, 0);
+    std::iota(values.begin(), values.end(), 0);
+
+    auto localKv = std::static_pointer_cast<InMemoryStateKeyValue>(
+      state.getKV(dummyUser, dummyKey, values.size()));
+
+    std::set<std::string> owners;
+    for (int i = 0; i < nSegments; i++) {
+        owners.insert(localKv->getSegmentOwner(i));
+    }
+    REQUIRE(owners == std::set<std::string>({ LOCALHOST, thisHost }));
+
+    // Set and push, the remote host should only get the segments it owns
+    localKv->set(values.data());
+    localKv->pushFull();
+
+    // The remote host can look up the size without being told it
+    REQUIRE(remoteState.getStateSize(dummyUser, dummyKey) == values.size());
+    std::shared_ptr<StateKeyValue> remoteKv =
+      remoteState.getKV(dummyUser, dummyKey);
+    REQUIRE(remoteKv->size() == values.size());
+
+    // Only check the segments the remote host owns, as there's no server
+    // for this host to pull the others from
+    for (int i = 0; i < nSegments; i++) {
+        if (localKv->getSegmentOwner(i) != LOCALHOST) {
+            continue;
+        }
+
+        size_t offset = i * sysConf.stateShardSize;
+        std::vector<uint8_t> actualSegment(sysConf.stateShardSize, 0);
+        remoteKv->getChunk(offset, actualSegment.data(), actualSegment.size());
+
+        std::vector<uint8_t> expectedSegment(
+          values.begin() + offset,
+          values.begin() + offset + sysConf.stateShardSize);
+        REQUIRE(actualSegment == expectedSegment);
+    }
+
+    // Update remotely, pulling should only change the remote segments
+    std::vector<uint8_t> newValues(values.size(), 99);
+    remoteKv->set(newValues.data());
+    localKv->pull();
+
+    std::vector<uint8_t> expectedLocal = values;
+    for (int i = 0; i < nSegments; i++) {
+        if (localKv->getSegmentOwner(i) == LOCALHOST) {
+            size_t offset = i * sysConf.stateShardSize;
+            std::fill_n(
+              expectedLocal.begin() + offset, sysConf.stateShardSize, 99);
+        }
+    }
+
+    std::vector<uint8_t> actualLocal(values.size(), 0);
+    localKv->get(actualLocal.data());
+    REQUIRE(actualLocal == expectedLocal);
+
+    // Chunks spanning several segments are split between the owners
+    std::vector<uint8_t> chunk(10, 0);
+    localKv->getChunk(3, chunk.data(), chunk.size());
+    REQUIRE(chunk == std::vector<uint8_t>(expectedLocal.begin() + 3,
+                                          expectedLocal.begin() + 13));
+
+    // Deleting removes the value from every host
+    state.deleteKV(dummyUser, dummyKey);
+    REQUIRE(remoteState.getKVCount() == 0);
+
+    // The value can then be created again with a different size
+    size_t newSize = 2 * values.size();
+    std::shared_ptr<StateKeyValue> recreatedKv =
+      state.getKV(dummyUser, dummyKey, newSize);
+    REQUIRE(recreatedKv->size() == newSize);
+    REQUIRE(remoteState.getStateSize(dummyUser, dummyKey) == newSize);
+
+    state.deleteKV(dummyUser, dummyKey);
+
+    queueRedis.flushAll();
+}
+
 TEST_CASE_METHOD(StateServerTestFixture,
                  "Test appended state with KV",
                  "[state]")
@@ -818,6 +968,16 @@ TEST_CASE_METHOD(StateServerTestFixture,
     localKv->getAppended(actualLocal.data(), actualLocal.size(), 3);
     REQUIRE(actualLocal == expectedLocal);
 
+    // Read a range from the middle
+    std::vector<uint8_t> expectedRange = { 3, 3, 5, 5, 0, 1, 2, 3, 4 };
+    std::vector<uint8_t> actualRange(expectedRange.size(), 0);
+    localKv->getAppendedRange(actualRange.data(), actualRange.size(), 1, 2);
+    REQUIRE(actualRange == expectedRange);
+
+    // Reading past the end fails
+    REQUIRE_THROWS(
+      localKv->getAppendedRange(actualRange.data(), actualRange.size(), 2, 2));
+
     // Clear and check again
     localKv->clearAppended();
     remoteKv->append(valuesB.data(), valuesB.size());
@@ -988,4 +1148,445 @@ TEST_CASE_METHOD(StateServerTestFixture,
     actualRemote = getRemoteKvValue();
     REQUIRE(actualRemote == dataB);
 }
+
+TEST_CASE_METHOD(StateServerTestFixture,
+                 "Test concurrent merge pushes to remote master",
+                 "[state]")
+{
+    int nValues = 1000;
+    int nThreads = 8;
+    int nPushes = 10;
+
+    std::vector<int> initial(nValues, 5);
+    setDummyData(std::vector<uint8_t>(BYTES(initial.data()),
+                                      BYTES(initial.data()) +
+                                        nValues * sizeof(int)));
+
+    faabric::util::SnapshotMergeOperation op =
+      faabric::util::SnapshotMergeOperation::Sum;
+    std::vector<int> expected(nValues, 0);
+    SECTION("Sum")
+    {
+        op = faabric::util::SnapshotMergeOperation::Sum;
+        for (int i = 0; i < nValues; i++) {
+            expected.at(i) = 5 + nThreads * nPushes * i;
+        }
+    }
+
+    SECTION("Max")
+    {
+        op = faabric::util::SnapshotMergeOperation::Max;
+        for (int i = 0; i < nValues; i++) {
+            expected.at(i) = std::max(5, (nThreads - 1) * i);
+        }
+    }
+
+    // Each thread pushes its own values into the master at the same time
+    std::shared_ptr<state::StateKeyValue> localKv = getLocalKv();
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < nThreads; t++) {
+        threads.emplace_back([&localKv, t, nValues, nPushes, op] {
+            std::vector<int> delta(nValues, 0);
+            for (int i = 0; i < nValues; i++) {
+                delta.at(i) =
+                  op == faabric::util::SnapshotMergeOperation::Sum ? i : t * i;
+            }
+
+            for (int p = 0; p < nPushes; p++) {
+                localKv->pushMergeChunk(0,
+                                        BYTES(delta.data()),
+                                        nValues * sizeof(int),
+                                        faabric::util::SnapshotDataType::Int,
+                                        op);
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::vector<uint8_t> actualBytes = getRemoteKvValue();
+    std::vector<int> actual(nValues, 0);
+    std::memcpy(actual.data(), actualBytes.data(), actualBytes.size());
+    REQUIRE(actual == expected);
+
+    // Misaligned merges should be rejected
+    REQUIRE_THROWS(localKv->pushMergeChunk(
+      0,
+      BYTES(initial.data()),
+      sizeof(int) + 1,
+      faabric::util::SnapshotDataType::Int,
+      faabric::util::SnapshotMergeOperation::Sum));
+}
+
+TEST_CASE_METHOD(StateServerTestFixture,
+                 "Test replica only pulls changed chunks",
+                 "[state]")
+{
+    size_t chunkSize = STATE_STREAMING_CHUNK_SIZE;
+    size_t valueSize = 4 * chunkSize;
+    std::vector<uint8_t> values(valueSize, 1);
+    setDummyData(values);
+
+    auto remoteKv =
+      std::static_pointer_cast<InMemoryStateKeyValue>(getRemoteKv());
+    auto localKv =
+      std::static_pointer_cast<InMemoryStateKeyValue>(getLocalKv());
+
+    // Initial pull gets everything along with the versions
+    localKv->pull();
+    REQUIRE(getLocalKvValue() == values);
+
+    uint64_t versionA = remoteKv->getChunkVersion(1);
+    uint64_t versionB = remoteKv->getChunkVersion(2);
+    REQUIRE(localKv->getChunkVersion(1) == versionA);
+    REQUIRE(localKv->getChunkVersion(2) == versionB);
+
+    // Change one chunk on the master
+    long offsetA = chunkSize + 3;
+    std::vector<uint8_t> update(10, 5);
+    remoteKv->setChunk(offsetA, update.data(), update.size());
+    REQUIRE(remoteKv->getChunkVersion(1) == versionA + 1);
+    REQUIRE(remoteKv->getChunkVersion(2) == versionB);
+
+    // Scribble on another chunk locally without telling the value, so that
+    // we can see whether it gets pulled again
+    long offsetB = 2 * chunkSize;
+    uint8_t* localPtr = localKv->get();
+    localPtr[offsetB] = 9;
+
+    // Pull and check only the changed chunk has been pulled
+    localKv->pull();
+    std::vector<uint8_t> actualA(localPtr + offsetA,
+                                 localPtr + offsetA + update.size());
+    REQUIRE(actualA == update);
+    REQUIRE(localPtr[offsetB] == 9);
+    REQUIRE(localKv->getChunkVersion(1) == versionA + 1);
+
+    // Flagging the chunk as modified locally means it gets pulled again
+    localKv->flagChunkDirty(offsetB, 1);
+    REQUIRE(localKv->getChunkVersion(2) == UNKNOWN_CHUNK_VERSION);
+
+    localKv->pull();
+    REQUIRE(localPtr[offsetB] == 1);
+    REQUIRE(localKv->getChunkVersion(2) == versionB);
+}
+
+TEST_CASE_METHOD(StateServerTestFixture,
+                 "Test asynchronous pushes",
+                 "[state]")
+{
+    size_t valueSize = 2 * STATE_STREAMING_CHUNK_SIZE;
+    std::vector<uint8_t> values(valueSize, 1);
+    setDummyData(values);
+
+    std::shared_ptr<state::StateKeyValue> localKv = getLocalKv();
+    localKv->pull();
+
+    std::vector<uint8_t> expected = values;
+    std::vector<uint8_t> update(10, 5);
+    localKv->setChunk(0, update.data(), update.size());
+    std::copy(update.begin(), update.end(), expected.begin());
+
+    SECTION("Wait on future")
+    {
+        std::shared_future<void> f = state.pushAsync(localKv);
+        f.get();
+    }
+
+    SECTION("Flush")
+    {
+        state.pushAsync(localKv);
+
+        // A second change before the flush is picked up too
+        long offset = STATE_STREAMING_CHUNK_SIZE + 5;
+        localKv->setChunk(offset, update.data(), update.size());
+        std::copy(update.begin(), update.end(), expected.begin() + offset);
+        state.pushAsync(localKv);
+
+        state.flushPushes();
+    }
+
+    REQUIRE(getRemoteKvValue() == expected);
+}
+
+TEST_CASE_METHOD(StateServerTestFixture,
+                 "Test coalescing state pushes",
+                 "[state]")
+{
+    size_t valueSize = 1000;
+    std::vector<uint8_t> values(valueSize, 1);
+    setDummyData(values);
+
+    std::shared_ptr<state::StateKeyValue> localKv = getLocalKv();
+    localKv->pull();
+
+    state::StateFlusher flusher;
+
+    // Hold the value's lock so that no push can complete
+    std::vector<uint8_t> update(10, 5);
+    localKv->setChunk(0, update.data(), update.size());
+    localKv->lockWrite();
+
+    std::vector<std::shared_future<void>> futures;
+    for (int i = 0; i < 5; i++) {
+        futures.push_back(flusher.push(localKv, false));
+    }
+
+    // At most one push can have been started, and the rest are coalesced
+    REQUIRE(flusher.getPendingCount() <= 2);
+
+    localKv->unlockWrite();
+    flusher.flush();
+    REQUIRE(flusher.getPendingCount() == 0);
+
+    for (auto& f : futures) {
+        REQUIRE(f.wait_for(std::chrono::seconds(0)) ==
+                std::future_status::ready);
+    }
+
+    std::vector<uint8_t> expected = values;
+    std::copy(update.begin(), update.end(), expected.begin());
+    REQUIRE(getRemoteKvValue() == expected);
+
+    // Can't push once stopped
+    flusher.stop();
+    REQUIRE_THROWS(flusher.push(localKv, false));
+}
+
+TEST_CASE_METHOD(StateServerTestFixture,
+                 "Test pulling and pushing multiple values",
+                 "[state]")
+{
+    int nValues = 5;
+    std::vector<std::shared_ptr<state::StateKeyValue>> localKvs;
+    std::vector<std::vector<uint8_t>> values;
+    std::vector<std::string> keys;
+    for (int i = 0; i < nValues; i++) {
+        dummyKey = "multi_key_" + std::to_string(i);
+        keys.push_back(dummyKey);
+        values.emplace_back(10 + i, i + 1);
+
+        setDummyData(values.back());
+        localKvs.push_back(getLocalKv());
+    }
+
+    // Include one value twice to check it's only pulled once
+    localKvs.push_back(localKvs.front());
+
+    state.pullMultiple(localKvs);
+    for (int i = 0; i < nValues; i++) {
+        std::vector<uint8_t> actual(values.at(i).size(), 0);
+        localKvs.at(i)->get(actual.data());
+        REQUIRE(actual == values.at(i));
+    }
+
+    // Change some of the values and push them all together
+    std::vector<uint8_t> update = { 9, 9 };
+    for (int i = 1; i < nValues; i += 2) {
+        localKvs.at(i)->setChunk(3, update.data(), update.size());
+        std::copy(update.begin(), update.end(), values.at(i).begin() + 3);
+    }
+
+    state.pushMultiple(localKvs);
+    for (int i = 0; i < nValues; i++) {
+        std::vector<uint8_t> actual(values.at(i).size(), 0);
+        remoteState.getKV(dummyUser, keys.at(i))->get(actual.data());
+        REQUIRE(actual == values.at(i));
+    }
+}
+
+TEST_CASE_METHOD(StateServerTestFixture,
+                 "Test evicting least recently used replicas",
+                 "[state]")
+{
+    faabric::util::getSystemConfig().stateMemoryLimitMb = 1;
+    size_t valueSize = 600 * 1024;
+
+    std::vector<std::shared_ptr<state::StateKeyValue>> localKvs;
+    std::vector<std::vector<uint8_t>> values;
+    for (int i = 0; i < 3; i++) {
+        dummyKey = "evict_key_" + std::to_string(i);
+        values.emplace_back(valueSize, i + 1);
+
+        setDummyData(values.back());
+        localKvs.push_back(getLocalKv());
+    }
+
+    auto kvA = localKvs.at(0);
+    auto kvB = localKvs.at(1);
+    auto kvC = localKvs.at(2);
+
+    StateMemoryTracker& tracker = getStateMemoryTracker();
+    tracker.clear();
+
+    // First access is a miss, the next a hit
+    std::vector<uint8_t> actual(valueSize, 0);
+    kvA->get(actual.data());
+    kvA->get(actual.data());
+
+    StateCacheStats stats = tracker.getStats();
+    REQUIRE(stats.misses == 1);
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.evictions == 0);
+    REQUIRE(stats.residentBytes == valueSize);
+
+    // Pulling another value goes over the limit and evicts the first
+    kvB->get(actual.data());
+    REQUIRE(actual == values.at(1));
+
+    stats = tracker.getStats();
+    REQUIRE(stats.misses == 2);
+    REQUIRE(stats.evictions == 1);
+    REQUIRE(stats.evictedBytes == valueSize);
+    REQUIRE(stats.residentBytes == valueSize);
+
+    // The evicted value is pulled again when next accessed
+    kvA->get(actual.data());
+    REQUIRE(actual == values.at(0));
+
+    stats = tracker.getStats();
+    REQUIRE(stats.misses == 3);
+    REQUIRE(stats.evictions == 2);
+
+    // Dirty values aren't evicted
+    std::vector<uint8_t> update(10, 9);
+    kvA->setChunk(0, update.data(), update.size());
+    kvC->get(actual.data());
+    REQUIRE(actual == values.at(2));
+
+    stats = tracker.getStats();
+    REQUIRE(stats.evictions == 2);
+    REQUIRE(stats.residentBytes == 2 * valueSize);
+
+    kvA->getChunk(0, actual.data(), update.size());
+    REQUIRE(std::vector<uint8_t>(actual.begin(),
+                                 actual.begin() + update.size()) == update);
+}
+
+TEST_CASE_METHOD(StateServerTestFixture,
+                 "Test pointers into state values block eviction",
+                 "[state]")
+{
+    faabric::util::getSystemConfig().stateMemoryLimitMb = 1;
+    size_t valueSize = 600 * 1024;
+
+    std::vector<std::shared_ptr<state::StateKeyValue>> localKvs;
+    std::vector<std::vector<uint8_t>> values;
+    for (int i = 0; i < 3; i++) {
+        dummyKey = "pinned_key_" + std::to_string(i);
+        values.emplace_back(valueSize, i + 1);
+
+        setDummyData(values.back());
+        localKvs.push_back(getLocalKv());
+    }
+
+    auto kvA = localKvs.at(0);
+    auto kvB = localKvs.at(1);
+    auto kvC = localKvs.at(2);
+
+    StateMemoryTracker& tracker = getStateMemoryTracker();
+    tracker.clear();
+
+    bool useChunk = false;
+    SECTION("Full value") { useChunk = false; }
+
+    SECTION("Chunk") { useChunk = true; }
+
+    // Reader holds a pointer into the first value while other values are
+    // pulled on this thread
+    auto pointerHeld = faabric::util::Latch::create(2);
+    auto pullsDone = faabric::util::Latch::create(2);
+    bool readerOk = true;
+    std::thread reader([&] {
+        StatePinScope pins;
+        uint8_t* ptr =
+          useChunk ? kvA->getChunk(0, (long)valueSize) : kvA->get();
+        pointerHeld->wait();
+        pullsDone->wait();
+
+        readerOk = std::vector<uint8_t>(ptr, ptr + valueSize) == values.at(0);
+    });
+
+    pointerHeld->wait();
+
+    std::vector<uint8_t> actual(valueSize, 0);
+    kvB->get(actual.data());
+    kvC->get(actual.data());
+    REQUIRE(actual == values.at(2));
+
+    // The pinned value is skipped in favour of the unpinned one
+    StateCacheStats stats = tracker.getStats();
+    REQUIRE(stats.evictions == 1);
+
+    pullsDone->wait();
+    reader.join();
+    REQUIRE(readerOk);
+
+    // Once released, the value can be evicted again
+    kvB->get(actual.data());
+    stats = tracker.getStats();
+    REQUIRE(stats.evictions == 2);
+    REQUIRE(stats.residentBytes == 2 * valueSize);
+}
+
+TEST_CASE_METHOD(StateServerTestFixture,
+                 "Test state pins only last as long as their scope",
+                 "[state]")
+{
+    faabric::util::getSystemConfig().stateMemoryLimitMb = 1;
+    size_t valueSize = 600 * 1024;
+
+    std::vector<std::shared_ptr<state::StateKeyValue>> localKvs;
+    for (int i = 0; i < 2; i++) {
+        dummyKey = "scoped_pin_key_" + std::to_string(i);
+        std::vector<uint8_t> values(valueSize, i + 1);
+
+        setDummyData(values);
+        localKvs.push_back(getLocalKv());
+    }
+
+    auto kvA = localKvs.at(0);
+    auto kvB = localKvs.at(1);
+
+    StateMemoryTracker& tracker = getStateMemoryTracker();
+    tracker.clear();
+
+    // Pulls the other value, which needs the first one evicted
+    auto pullOther = [&] {
+        std::vector<uint8_t> actual(valueSize, 0);
+        kvB->get(actual.data());
+        return tracker.getStats().evictions;
+    };
+
+    SECTION("No scope")
+    {
+        // Nothing is pinned, so the value can be evicted under the pointer
+        kvA->get();
+        REQUIRE(pullOther() == 1);
+    }
+
+    SECTION("Released scope")
+    {
+        StatePinScope pins;
+        kvA->get();
+        pins.release();
+        REQUIRE(pullOther() == 1);
+    }
+
+    SECTION("Nested scopes")
+    {
+        StatePinScope outer;
+        kvA->get();
+
+        {
+            StatePinScope inner;
+            kvA->getChunk(0, 10);
+        }
+
+        // The outer scope still holds its pin
+        REQUIRE(pullOther() == 0);
+    }
+}
 }
@@ -35,4 +35,30 @@ TEST_CASE("Test message moving", "[transport]")
     REQUIRE(dataPtr[1] == 2);
     REQUIRE(dataPtr[2] == 3);
 }
+
+TEST_CASE("Test message parts survive moving", "[transport]")
+{
+    faabric::transport::Message m(10);
+
+    // Small messages are stored inline in the part, so the spans must still
+    // be valid once the message has been moved
+    std::vector<uint8_t> partA = { 1, 2, 3 };
+    std::vector<uint8_t> partB(2000, 4);
+    m.addPart(zmq::message_t(partA.data(), partA.size()));
+    m.addPart(zmq::message_t(partB.data(), partB.size()));
+
+    std::vector<std::span<const uint8_t>> before = m.getParts();
+
+    faabric::transport::Message mB(std::move(m));
+    std::vector<std::span<const uint8_t>> after = mB.getParts();
+
+    REQUIRE(after.size() == 2);
+    REQUIRE(after.at(0).data() == before.at(0).data());
+    REQUIRE(after.at(1).data() == before.at(1).data());
+
+    REQUIRE(std::vector<uint8_t>(after.at(0).begin(), after.at(0).end()) ==
+            partA);
+    REQUIRE(std::vector<uint8_t>(after.at(1).begin(), after.at(1).end()) ==
+            partB);
+}
 }
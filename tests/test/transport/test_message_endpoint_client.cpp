@@ -260,6 +260,46 @@ TEST_CASE_METHOD(SchedulerTestFixture, "Test direct messaging", "[transport]")
     REQUIRE(actual == expected);
 }
 
+TEST_CASE_METHOD(SchedulerTestFixture,
+                 "Test internal messaging with busy-polling",
+                 "[transport]")
+{
+    std::string inprocLabel =
+      "busy-poll-test-" + std::to_string(faabric::util::generateGid());
+
+    int busyPollUs = 0;
+    SECTION("No busy-poll") { busyPollUs = 0; }
+
+    SECTION("Busy-poll") { busyPollUs = 500; }
+
+    AsyncInternalRecvMessageEndpoint receiver(
+      inprocLabel, DEFAULT_SOCKET_TIMEOUT_MS, busyPollUs);
+
+    int nMessages = 100;
+    std::jthread senderThread([inprocLabel, nMessages] {
+        AsyncInternalSendMessageEndpoint sender(inprocLabel);
+        for (int i = 0; i < nMessages; i++) {
+            std::string msg = "Hello " + std::to_string(i);
+            sender.send(0, BYTES_CONST(msg.c_str()), msg.size());
+
+            // Leave gaps so that some receives find nothing while spinning
+            if (i % 10 == 0) {
+                SLEEP_MS(2);
+            }
+        }
+    });
+
+    for (int i = 0; i < nMessages; i++) {
+        faabric::transport::Message recvMsg = receiver.recv();
+        std::string actual(recvMsg.data(), recvMsg.size());
+        REQUIRE(actual == "Hello " + std::to_string(i));
+    }
+
+    if (senderThread.joinable()) {
+        senderThread.join();
+    }
+}
+
 TEST_CASE_METHOD(SchedulerTestFixture,
                  "Stress test direct messaging",
                  "[transport]")
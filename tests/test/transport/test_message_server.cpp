@@ -5,11 +5,13 @@
 #include <thread>
 
 #include <faabric/proto/faabric.pb.h>
+#include <faabric/transport/ConnectionPool.h>
 #include <faabric/transport/MessageEndpointClient.h>
 #include <faabric/transport/MessageEndpointServer.h>
 #include <faabric/transport/common.h>
 #include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
+#include <faabric/util/timing.h>
 
 using namespace faabric::transport;
 
@@ -55,8 +57,14 @@ class EchoServer final : public MessageEndpointServer
     {
         SPDLOG_TRACE("Echo server received {} bytes", message.size());
 
+        // Echo the body followed by any parts
+        std::string data(message.data(), message.size());
+        for (const auto& part : message.getParts()) {
+            data.append(part.begin(), part.end());
+        }
+
         auto response = std::make_unique<faabric::StatePart>();
-        response->set_data(message.udata(), message.size());
+        response->set_data(data);
 
         return response;
     }
@@ -121,6 +129,44 @@ class BlockServer final : public MessageEndpointServer
     std::shared_ptr<faabric::util::Latch> latch = nullptr;
 };
 
+class PriorityServer final : public MessageEndpointServer
+{
+  public:
+    PriorityServer()
+      : MessageEndpointServer(TEST_PORT_ASYNC,
+                              TEST_PORT_SYNC,
+                              "test-priority",
+                              1)
+      , latch(faabric::util::Latch::create(2))
+    {}
+
+    std::vector<uint8_t> receivedHeaders;
+
+    std::shared_ptr<faabric::util::Latch> latch = nullptr;
+
+  protected:
+    void doAsyncRecv(transport::Message& message) override
+    {
+        // Block the only worker on the first message, so that the rest queue
+        if (receivedHeaders.empty()) {
+            latch->wait();
+        }
+
+        receivedHeaders.push_back(message.getHeader());
+    }
+
+    std::unique_ptr<google::protobuf::Message> doSyncRecv(
+      transport::Message& message) override
+    {
+        throw std::runtime_error("Priority server not expecting sync recv");
+    }
+
+    bool isHighPriority(uint8_t header, bool async) override
+    {
+        return header == 2;
+    }
+};
+
 namespace tests {
 
 TEST_CASE("Test sending one message to server", "[transport]")
@@ -166,6 +212,75 @@ TEST_CASE("Test sending response to client", "[transport]")
     server.stop();
 }
 
+TEST_CASE("Test sending message parts to server", "[transport]")
+{
+    EchoServer server;
+    server.start();
+
+    std::string body = "body";
+
+    // Check both copied and zero-copy parts
+    std::vector<uint8_t> smallPart(10, 1);
+    std::vector<uint8_t> largePart(2 * MIN_ZERO_COPY_BYTES, 2);
+    std::vector<uint8_t> emptyPart;
+
+    MessageParts parts = { smallPart, largePart, emptyPart, smallPart };
+
+    std::string expected = body;
+    for (const auto& p : parts) {
+        expected.append(p.begin(), p.end());
+    }
+
+    faabric::StatePart response;
+    SECTION("Direct client")
+    {
+        MessageEndpointClient cli(LOCALHOST, TEST_PORT_ASYNC, TEST_PORT_SYNC);
+        cli.syncSend(0, BYTES(body.data()), body.size(), parts, &response);
+    }
+
+    SECTION("Connection pool")
+    {
+        ConnectionPool pool(LOCALHOST, TEST_PORT_ASYNC, TEST_PORT_SYNC, 1);
+        faabric::transport::Message msg =
+          pool.syncSend(0, BYTES(body.data()), body.size(), parts);
+        response.ParseFromArray(msg.data(), msg.size());
+    }
+
+    SECTION("Shared parts through a connection pool")
+    {
+        // The owner keeps the parts alive until they've been sent
+        auto owner = std::make_shared<std::vector<std::vector<uint8_t>>>();
+        SharedMessageParts sharedParts;
+        for (const auto& p : parts) {
+            owner->emplace_back(p.begin(), p.end());
+        }
+        for (const auto& p : *owner) {
+            sharedParts.push_back({ p, owner });
+        }
+
+        ConnectionPool pool(LOCALHOST, TEST_PORT_ASYNC, TEST_PORT_SYNC, 1);
+        auto future =
+          pool.submitSync(0, BYTES(body.data()), body.size(), sharedParts);
+        sharedParts.clear();
+
+        faabric::transport::Message msg = pool.awaitResponse(future);
+        response.ParseFromArray(msg.data(), msg.size());
+
+        // Nothing holds on to the parts once they're sent
+        REQUIRE(owner.use_count() == 1);
+    }
+
+    REQUIRE(response.data() == expected);
+
+    // Make sure sending without parts still works on the same server
+    MessageEndpointClient cli(LOCALHOST, TEST_PORT_ASYNC, TEST_PORT_SYNC);
+    faabric::StatePart plainResponse;
+    cli.syncSend(0, BYTES(body.data()), body.size(), &plainResponse);
+    REQUIRE(plainResponse.data() == body);
+
+    server.stop();
+}
+
 // This test hangs ThreadSanitizer
 #if !(defined(__has_feature) && __has_feature(thread_sanitizer))
 TEST_CASE("Test multiple clients talking to one server", "[transport]")
@@ -359,4 +474,130 @@ TEST_CASE("Test server keeps listening after socket timeout", "[transport]")
 
     server.stop();
 }
+
+TEST_CASE("Test slow request does not block other requests", "[transport]")
+{
+    SleepServer server;
+    server.start();
+
+    // Occupy one of the two workers with a slow request
+    std::jthread slowThread([] {
+        MessageEndpointClient cli(LOCALHOST, TEST_PORT_ASYNC, TEST_PORT_SYNC);
+
+        int sleepMs = 2000;
+        faabric::StatePart response;
+        cli.syncSend(0, BYTES(&sleepMs), sizeof(int), &response);
+    });
+
+    SLEEP_MS(200);
+
+    // These should all be picked up by the free worker, rather than some of
+    // them waiting behind the slow request
+    MessageEndpointClient cli(LOCALHOST, TEST_PORT_ASYNC, TEST_PORT_SYNC);
+    faabric::util::TimePoint start = faabric::util::startTimer();
+    for (int i = 0; i < 5; i++) {
+        int sleepMs = 10;
+        faabric::StatePart response;
+        cli.syncSend(0, BYTES(&sleepMs), sizeof(int), &response);
+        REQUIRE(response.data() == "Response after sleep");
+    }
+    REQUIRE(faabric::util::getTimeDiffMillis(start) < 1000);
+
+    if (slowThread.joinable()) {
+        slowThread.join();
+    }
+
+    server.stop();
+}
+
+TEST_CASE("Test high priority requests overtake queued requests",
+          "[transport]")
+{
+    PriorityServer server;
+    server.start();
+
+    MessageEndpointClient cli(LOCALHOST, TEST_PORT_ASYNC, TEST_PORT_SYNC);
+
+    std::string body = "body";
+    const uint8_t* bodyMsg = BYTES_CONST(body.c_str());
+
+    // First message blocks the worker, then the rest queue up behind it
+    cli.asyncSend(0, bodyMsg, body.size());
+    cli.asyncSend(1, bodyMsg, body.size());
+    cli.asyncSend(1, bodyMsg, body.size());
+    cli.asyncSend(2, bodyMsg, body.size());
+
+    SLEEP_MS(500);
+    server.latch->wait();
+
+    // Shutdown messages are queued behind everything else
+    server.stop();
+
+    std::vector<uint8_t> expected = { 0, 2, 1, 1 };
+    REQUIRE(server.receivedHeaders == expected);
+}
+
+TEST_CASE("Test pooled clients shared between threads", "[transport]")
+{
+    EchoServer server;
+    server.start();
+
+    int nConnections = 2;
+    auto pool = std::make_shared<ConnectionPool>(
+      LOCALHOST, TEST_PORT_ASYNC, TEST_PORT_SYNC, nConnections);
+    REQUIRE(pool->getConnectionCount() == nConnections + 1);
+
+    // Many more threads than connections all make requests at once
+    int nThreads = 50;
+    int nMessages = 20;
+    std::atomic<int> nFailed = 0;
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        threads.emplace_back([i, nMessages, &pool, &nFailed] {
+            for (int j = 0; j < nMessages; j++) {
+                std::string msg =
+                  fmt::format("Message {} from thread {}", j, i);
+
+                faabric::transport::Message response =
+                  pool->syncSend(0, BYTES_CONST(msg.c_str()), msg.size());
+
+                faabric::StatePart part;
+                part.ParseFromArray(response.data(), response.size());
+                if (part.data() != msg) {
+                    nFailed++;
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+
+    REQUIRE(nFailed == 0);
+
+    pool->stop();
+    server.stop();
+}
+
+TEST_CASE("Test async sends through a connection pool", "[transport]")
+{
+    DummyServer server;
+    server.start();
+
+    {
+        ConnectionPool pool(LOCALHOST, TEST_PORT_ASYNC, TEST_PORT_SYNC, 1);
+
+        std::string body = "body";
+        server.setRequestLatch();
+        pool.asyncSend(0, BYTES_CONST(body.c_str()), body.size());
+        server.awaitRequestLatch();
+    }
+
+    REQUIRE(server.messageCount == 1);
+
+    server.stop();
+}
 }
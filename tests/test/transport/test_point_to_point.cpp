@@ -12,6 +12,7 @@
 #include <faabric/util/logging.h>
 #include <faabric/util/macros.h>
 #include <faabric/util/scheduling.h>
+#include <faabric/util/timing.h>
 
 using namespace faabric::transport;
 using namespace faabric::util;
@@ -263,6 +264,182 @@ TEST_CASE_METHOD(PointToPointClientServerFixture,
     conf.reset();
 }
 
+TEST_CASE_METHOD(PointToPointClientServerFixture,
+                 "Test coalescing small point-to-point messages",
+                 "[transport][ptp]")
+{
+    faabric::util::setMockMode(true);
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.pointToPointCoalesceBytes = 100;
+    conf.pointToPointCoalesceWindowUs = 60 * 1000 * 1000;
+
+    std::string otherHost = "other-host";
+    PointToPointClient coalescingCli(otherHost);
+
+    int nSmall = 3;
+    for (int i = 0; i < nSmall; i++) {
+        faabric::PointToPointMessage msg;
+        msg.set_groupid(123);
+        msg.set_sendidx(0);
+        msg.set_recvidx(1);
+        msg.set_data(std::string(10, (char)i));
+        coalescingCli.sendMessage(msg, i);
+    }
+
+    // Nothing sent yet
+    REQUIRE(coalescingCli.getPendingMessageCount() == nSmall);
+    REQUIRE(getSentPointToPointMessageBatches().empty());
+    REQUIRE(getSentPointToPointMessages().empty());
+
+    // Large message flushes the batch then goes straight out
+    faabric::PointToPointMessage largeMsg;
+    largeMsg.set_groupid(123);
+    largeMsg.set_data(std::string(200, 'a'));
+    coalescingCli.sendMessage(largeMsg, nSmall);
+
+    REQUIRE(coalescingCli.getPendingMessageCount() == 0);
+    REQUIRE(getSentPointToPointMessages().size() == 1);
+
+    auto batches = getSentPointToPointMessageBatches();
+    REQUIRE(batches.size() == 1);
+    REQUIRE(batches.at(0).first == otherHost);
+    REQUIRE(batches.at(0).second.messages_size() == nSmall);
+    for (int i = 0; i < nSmall; i++) {
+        REQUIRE(batches.at(0).second.messages(i).data() ==
+                std::string(10, (char)i));
+        REQUIRE(batches.at(0).second.sequencenums(i) == i);
+    }
+
+    // Explicit flush sends anything outstanding
+    faabric::PointToPointMessage lastMsg;
+    lastMsg.set_data(std::string(10, 'b'));
+    coalescingCli.sendMessage(lastMsg);
+    REQUIRE(getSentPointToPointMessageBatches().size() == 1);
+
+    coalescingCli.flushMessages();
+    REQUIRE(getSentPointToPointMessageBatches().size() == 2);
+    REQUIRE(coalescingCli.getPendingMessageCount() == 0);
+
+    // Flushing when empty does nothing
+    coalescingCli.flushMessages();
+    REQUIRE(getSentPointToPointMessageBatches().size() == 2);
+
+    conf.reset();
+}
+
+TEST_CASE_METHOD(PointToPointClientServerFixture,
+                 "Test coalesced point-to-point messages flushed after window",
+                 "[transport][ptp]")
+{
+    faabric::util::setMockMode(true);
+
+    int appId = 123;
+    int groupId = 345;
+    int idxA = 0;
+    int idxB = 1;
+    std::string otherHost = "other-host";
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.endpointHost = LOCALHOST;
+    conf.pointToPointCoalesceBytes = 1024;
+    int windowMs = 20;
+    conf.pointToPointCoalesceWindowUs = windowMs * 1000;
+
+    faabric::util::SchedulingDecision decision(appId, groupId);
+
+    faabric::Message msgA = faabric::util::messageFactory("foo", "bar");
+    msgA.set_appid(appId);
+    msgA.set_groupid(groupId);
+    msgA.set_groupidx(idxA);
+
+    faabric::Message msgB = faabric::util::messageFactory("foo", "bar");
+    msgB.set_appid(appId);
+    msgB.set_groupid(groupId);
+    msgB.set_groupidx(idxB);
+
+    decision.addMessage(LOCALHOST, msgA);
+    decision.addMessage(otherHost, msgB);
+    broker.setUpLocalMappingsFromSchedulingDecision(decision);
+
+    // Send a single small message, then don't touch the broker again
+    std::vector<uint8_t> data(10, 1);
+    auto sentAt = faabric::util::startTimer();
+    broker.sendMessage(groupId, idxA, idxB, data.data(), data.size());
+    REQUIRE(getSentPointToPointMessageBatches().empty());
+
+    // The flusher thread must send it once the window expires
+    int maxWaitMs = 2000;
+    while (getSentPointToPointMessageBatches().empty() &&
+           faabric::util::getTimeDiffMillis(sentAt) < maxWaitMs) {
+        SLEEP_MS(1);
+    }
+    double elapsedMs = faabric::util::getTimeDiffMillis(sentAt);
+
+    auto batches = getSentPointToPointMessageBatches();
+    REQUIRE(batches.size() == 1);
+    REQUIRE(batches.at(0).first == otherHost);
+    REQUIRE(batches.at(0).second.messages_size() == 1);
+    REQUIRE(elapsedMs >= windowMs);
+    REQUIRE(elapsedMs < maxWaitMs);
+
+    conf.reset();
+}
+
+TEST_CASE_METHOD(PointToPointClientServerFixture,
+                 "Test sending coalesced point-to-point messages in order",
+                 "[transport][ptp]")
+{
+    int appId = 123;
+    int groupId = 345;
+    int idxA = 0;
+    int idxB = 1;
+
+    faabric::util::SystemConfig& conf = faabric::util::getSystemConfig();
+    conf.endpointHost = LOCALHOST;
+    conf.pointToPointCoalesceBytes = 1024;
+    conf.pointToPointCoalesceWindowUs = 60 * 1000 * 1000;
+
+    faabric::util::SchedulingDecision decision(appId, groupId);
+
+    faabric::Message msgA = faabric::util::messageFactory("foo", "bar");
+    msgA.set_appid(appId);
+    msgA.set_groupid(groupId);
+    msgA.set_groupidx(idxA);
+
+    faabric::Message msgB = faabric::util::messageFactory("foo", "bar");
+    msgB.set_appid(appId);
+    msgB.set_groupid(groupId);
+    msgB.set_groupidx(idxB);
+
+    decision.addMessage(LOCALHOST, msgA);
+    decision.addMessage(LOCALHOST, msgB);
+    broker.setUpLocalMappingsFromSchedulingDecision(decision);
+
+    // Client created after setting the config
+    PointToPointClient coalescingCli(LOCALHOST);
+
+    int numMsg = 100;
+    for (int i = 0; i < numMsg; i++) {
+        faabric::PointToPointMessage msg;
+        msg.set_groupid(groupId);
+        msg.set_sendidx(idxA);
+        msg.set_recvidx(idxB);
+        msg.set_data(std::string(3, (char)i));
+        coalescingCli.sendMessage(msg, i);
+    }
+    coalescingCli.flushMessages();
+
+    for (int i = 0; i < numMsg; i++) {
+        std::vector<uint8_t> expected(3, (uint8_t)i);
+        std::vector<uint8_t> actual =
+          broker.recvMessage(groupId, idxA, idxB, true);
+        REQUIRE(actual == expected);
+    }
+
+    conf.reset();
+}
+
 TEST_CASE_METHOD(
   PointToPointClientServerFixture,
   "Test setting up point-to-point mappings with scheduling decision",
@@ -19,11 +19,22 @@ TEST_CASE("Test default system config initialisation", "[util]")
     REQUIRE(conf.stateMode == "inmemory");
 
     REQUIRE(conf.redisPort == "6379");
+    REQUIRE(conf.redisPoolSize == 2);
 
     REQUIRE(conf.noScheduler == 0);
     REQUIRE(conf.overrideCpuCount == 0);
     REQUIRE(conf.noTopologyHints == "off");
     REQUIRE(conf.noSingleHostOptimisations == 0);
+    REQUIRE(conf.resourceGossipIntervalSeconds == 0);
+    REQUIRE(conf.snapshotBroadcastFanOut == 0);
+    REQUIRE(conf.executorPoolMin == 0);
+    REQUIRE(conf.executorPoolMax == 0);
+    REQUIRE(conf.executorPoolIntervalSeconds == 1);
+    REQUIRE(conf.functionResultMode == "redis");
+    REQUIRE(conf.placementPolicy == "binpack");
+    REQUIRE(conf.snapshotTransferMbps == 1000);
+    REQUIRE(conf.hostQueueCapacity == 0);
+    REQUIRE(conf.reservedPrioritySlots == 0);
 
     REQUIRE(conf.globalMessageTimeout == 60000);
     REQUIRE(conf.boundTimeout == 30000);
@@ -31,6 +42,19 @@ TEST_CASE("Test default system config initialisation", "[util]")
     REQUIRE(conf.defaultMpiWorldSize == 5);
     REQUIRE(conf.mpiBasePort == 10800);
 
+    REQUIRE(conf.pointToPointCoalesceBytes == 0);
+    REQUIRE(conf.pointToPointCoalesceWindowUs == 100);
+    REQUIRE(conf.pointToPointBusyPollUs == 0);
+    REQUIRE(conf.transportIoThreads == 1);
+    REQUIRE(conf.transportIoCpus.empty());
+    REQUIRE(conf.transportServerCpus.empty());
+    REQUIRE(conf.transportClientPoolSize == 0);
+    REQUIRE(conf.transportBindHost == "0.0.0.0");
+    REQUIRE(conf.stateShardSize == 1048576);
+    REQUIRE(conf.stateTransferWindow == 16);
+    REQUIRE(conf.stateTransferConnections == 2);
+    REQUIRE(conf.stateMemoryLimitMb == 0);
+
     REQUIRE(conf.dirtyTrackingMode == "segfault");
 }
 
@@ -45,11 +69,23 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     std::string redisState = setEnvVar("REDIS_STATE_HOST", "not-localhost");
     std::string redisQueue = setEnvVar("REDIS_QUEUE_HOST", "other-host");
     std::string redisPort = setEnvVar("REDIS_PORT", "1234");
+    std::string redisPoolSize = setEnvVar("REDIS_POOL_SIZE", "5");
 
     std::string noScheduler = setEnvVar("NO_SCHEDULER", "1");
     std::string overrideCpuCount = setEnvVar("OVERRIDE_CPU_COUNT", "4");
     std::string noTopologyHints = setEnvVar("NO_TOPOLOGY_HINTS", "on");
     std::string noSingleHost = setEnvVar("NO_SINGLE_HOST", "1");
+    std::string gossipInterval =
+      setEnvVar("RESOURCE_GOSSIP_INTERVAL_SECS", "7");
+    std::string broadcastFanOut = setEnvVar("SNAPSHOT_BROADCAST_FANOUT", "3");
+    std::string poolMin = setEnvVar("EXECUTOR_POOL_MIN", "2");
+    std::string poolMax = setEnvVar("EXECUTOR_POOL_MAX", "8");
+    std::string poolInterval = setEnvVar("EXECUTOR_POOL_INTERVAL_SECS", "4");
+    std::string resultMode = setEnvVar("FUNCTION_RESULT_MODE", "direct");
+    std::string placement = setEnvVar("PLACEMENT_POLICY", "locality");
+    std::string transferMbps = setEnvVar("SNAPSHOT_TRANSFER_MBPS", "250");
+    std::string queueCapacity = setEnvVar("HOST_QUEUE_CAPACITY", "64");
+    std::string prioritySlots = setEnvVar("RESERVED_PRIORITY_SLOTS", "2");
 
     std::string globalTimeout = setEnvVar("GLOBAL_MESSAGE_TIMEOUT", "9876");
     std::string boundTimeout = setEnvVar("BOUND_TIMEOUT", "6666");
@@ -59,6 +95,20 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     std::string snapshotThreads = setEnvVar("SNAPSHOT_SERVER_THREADS", "333");
     std::string pointToPointThreads =
       setEnvVar("POINT_TO_POINT_SERVER_THREADS", "444");
+    std::string coalesceBytes =
+      setEnvVar("POINT_TO_POINT_COALESCE_BYTES", "4096");
+    std::string coalesceWindow =
+      setEnvVar("POINT_TO_POINT_COALESCE_WINDOW_US", "250");
+    std::string busyPoll = setEnvVar("POINT_TO_POINT_BUSY_POLL_US", "50");
+    std::string ioThreads = setEnvVar("TRANSPORT_IO_THREADS", "3");
+    std::string ioCpus = setEnvVar("TRANSPORT_IO_CPUS", "0-1");
+    std::string serverCpus = setEnvVar("TRANSPORT_SERVER_CPUS", "2,3");
+    std::string clientPoolSize = setEnvVar("TRANSPORT_CLIENT_POOL_SIZE", "4");
+    std::string bindHost = setEnvVar("TRANSPORT_BIND_HOST", "127.0.0.2");
+    std::string shardSize = setEnvVar("STATE_SHARD_SIZE", "4096");
+    std::string transferWindow = setEnvVar("STATE_TRANSFER_WINDOW", "8");
+    std::string transferConns = setEnvVar("STATE_TRANSFER_CONNECTIONS", "3");
+    std::string memoryLimit = setEnvVar("STATE_MEMORY_LIMIT_MB", "512");
 
     std::string mpiSize = setEnvVar("DEFAULT_MPI_WORLD_SIZE", "2468");
     std::string mpiPort = setEnvVar("MPI_BASE_PORT", "9999");
@@ -75,11 +125,22 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     REQUIRE(conf.redisStateHost == "not-localhost");
     REQUIRE(conf.redisQueueHost == "other-host");
     REQUIRE(conf.redisPort == "1234");
+    REQUIRE(conf.redisPoolSize == 5);
 
     REQUIRE(conf.noScheduler == 1);
     REQUIRE(conf.overrideCpuCount == 4);
     REQUIRE(conf.noTopologyHints == "on");
     REQUIRE(conf.noSingleHostOptimisations == 1);
+    REQUIRE(conf.resourceGossipIntervalSeconds == 7);
+    REQUIRE(conf.snapshotBroadcastFanOut == 3);
+    REQUIRE(conf.executorPoolMin == 2);
+    REQUIRE(conf.executorPoolMax == 8);
+    REQUIRE(conf.executorPoolIntervalSeconds == 4);
+    REQUIRE(conf.functionResultMode == "direct");
+    REQUIRE(conf.placementPolicy == "locality");
+    REQUIRE(conf.snapshotTransferMbps == 250);
+    REQUIRE(conf.hostQueueCapacity == 64);
+    REQUIRE(conf.reservedPrioritySlots == 2);
 
     REQUIRE(conf.globalMessageTimeout == 9876);
     REQUIRE(conf.boundTimeout == 6666);
@@ -88,6 +149,18 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     REQUIRE(conf.stateServerThreads == 222);
     REQUIRE(conf.snapshotServerThreads == 333);
     REQUIRE(conf.pointToPointServerThreads == 444);
+    REQUIRE(conf.pointToPointCoalesceBytes == 4096);
+    REQUIRE(conf.pointToPointCoalesceWindowUs == 250);
+    REQUIRE(conf.pointToPointBusyPollUs == 50);
+    REQUIRE(conf.transportIoThreads == 3);
+    REQUIRE(conf.transportIoCpus == "0-1");
+    REQUIRE(conf.transportServerCpus == "2,3");
+    REQUIRE(conf.transportClientPoolSize == 4);
+    REQUIRE(conf.transportBindHost == "127.0.0.2");
+    REQUIRE(conf.stateShardSize == 4096);
+    REQUIRE(conf.stateTransferWindow == 8);
+    REQUIRE(conf.stateTransferConnections == 3);
+    REQUIRE(conf.stateMemoryLimitMb == 512);
 
     REQUIRE(conf.defaultMpiWorldSize == 2468);
     REQUIRE(conf.mpiBasePort == 9999);
@@ -104,11 +177,22 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     setEnvVar("REDIS_STATE_HOST", redisState);
     setEnvVar("REDIS_QUEUE_HOST", redisQueue);
     setEnvVar("REDIS_PORT", redisPort);
+    setEnvVar("REDIS_POOL_SIZE", redisPoolSize);
 
     setEnvVar("NO_SCHEDULER", noScheduler);
     setEnvVar("OVERRIDE_CPU_COUNT", overrideCpuCount);
     setEnvVar("USE_TOPOLOGY_HINTS", noTopologyHints);
     setEnvVar("NO_SINGLE_HOST", noSingleHost);
+    setEnvVar("RESOURCE_GOSSIP_INTERVAL_SECS", gossipInterval);
+    setEnvVar("SNAPSHOT_BROADCAST_FANOUT", broadcastFanOut);
+    setEnvVar("EXECUTOR_POOL_MIN", poolMin);
+    setEnvVar("EXECUTOR_POOL_MAX", poolMax);
+    setEnvVar("EXECUTOR_POOL_INTERVAL_SECS", poolInterval);
+    setEnvVar("FUNCTION_RESULT_MODE", resultMode);
+    setEnvVar("PLACEMENT_POLICY", placement);
+    setEnvVar("SNAPSHOT_TRANSFER_MBPS", transferMbps);
+    setEnvVar("HOST_QUEUE_CAPACITY", queueCapacity);
+    setEnvVar("RESERVED_PRIORITY_SLOTS", prioritySlots);
 
     setEnvVar("GLOBAL_MESSAGE_TIMEOUT", globalTimeout);
     setEnvVar("BOUND_TIMEOUT", boundTimeout);
@@ -117,6 +201,18 @@ TEST_CASE("Test overriding system config initialisation", "[util]")
     setEnvVar("STATE_SERVER_THREADS", stateThreads);
     setEnvVar("SNAPSHOT_SERVER_THREADS", snapshotThreads);
     setEnvVar("POINT_TO_POINT_SERVER_THREADS", pointToPointThreads);
+    setEnvVar("POINT_TO_POINT_COALESCE_BYTES", coalesceBytes);
+    setEnvVar("POINT_TO_POINT_COALESCE_WINDOW_US", coalesceWindow);
+    setEnvVar("POINT_TO_POINT_BUSY_POLL_US", busyPoll);
+    setEnvVar("TRANSPORT_IO_THREADS", ioThreads);
+    setEnvVar("TRANSPORT_IO_CPUS", ioCpus);
+    setEnvVar("TRANSPORT_SERVER_CPUS", serverCpus);
+    setEnvVar("TRANSPORT_CLIENT_POOL_SIZE", clientPoolSize);
+    setEnvVar("TRANSPORT_BIND_HOST", bindHost);
+    setEnvVar("STATE_SHARD_SIZE", shardSize);
+    setEnvVar("STATE_TRANSFER_WINDOW", transferWindow);
+    setEnvVar("STATE_TRANSFER_CONNECTIONS", transferConns);
+    setEnvVar("STATE_MEMORY_LIMIT_MB", memoryLimit);
 
     setEnvVar("DEFAULT_MPI_WORLD_SIZE", mpiSize);
     setEnvVar("MPI_BASE_PORT", mpiPort);
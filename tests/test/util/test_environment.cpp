@@ -4,6 +4,8 @@
 #include <faabric/util/config.h>
 #include <faabric/util/environment.h>
 
+#include <pthread.h>
+#include <sched.h>
 #include <thread>
 
 using namespace faabric::util;
@@ -58,4 +60,123 @@ TEST_CASE("Test overriding CPU count", "[util]")
     // Check we're back to the default
     REQUIRE(getUsableCores() == defaultCores);
 }
+
+TEST_CASE("Test parsing CPU lists", "[util]")
+{
+    std::string cpuList;
+    std::vector<int> expected;
+
+    SECTION("Empty")
+    {
+        cpuList = "";
+        expected = {};
+    }
+
+    SECTION("Single")
+    {
+        cpuList = "3";
+        expected = { 3 };
+    }
+
+    SECTION("List")
+    {
+        cpuList = "0,2,5";
+        expected = { 0, 2, 5 };
+    }
+
+    SECTION("Ranges")
+    {
+        cpuList = "0-2,6,8-9";
+        expected = { 0, 1, 2, 6, 8, 9 };
+    }
+
+    REQUIRE(parseCpuList(cpuList) == expected);
+}
+
+TEST_CASE("Test parsing invalid CPU lists", "[util]")
+{
+    REQUIRE_THROWS(parseCpuList("a"));
+    REQUIRE_THROWS(parseCpuList("3-1"));
+    REQUIRE_THROWS(parseCpuList("1-"));
+
+    // CPUs must fit in a cpu_set_t
+    REQUIRE_THROWS(parseCpuList(std::to_string(CPU_SETSIZE)));
+    REQUIRE_THROWS(parseCpuList("0-" + std::to_string(CPU_SETSIZE + 10)));
+}
+
+// The test runner may be restricted to any CPUs, not necessarily CPU 0
+static int getFirstUsableCpu()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    REQUIRE(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            return cpu;
+        }
+    }
+
+    FAIL("No usable CPUs");
+    return -1;
+}
+
+TEST_CASE("Test pinning thread to CPUs", "[util]")
+{
+    int cpu = getFirstUsableCpu();
+    int cpuCount = 0;
+    bool isOnCpu = false;
+
+    // Pin a separate thread to avoid changing the affinity of the test runner
+    std::jthread t([cpu, &cpuCount, &isOnCpu] {
+        pinThisThreadToCpus({ cpu });
+
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+
+        cpuCount = CPU_COUNT(&cpuSet);
+        isOnCpu = CPU_ISSET(cpu, &cpuSet);
+    });
+
+    if (t.joinable()) {
+        t.join();
+    }
+
+    REQUIRE(cpuCount == 1);
+    REQUIRE(isOnCpu);
+}
+
+TEST_CASE("Test pinning thread to unavailable CPUs", "[util]")
+{
+    bool pinned = true;
+    int cpuCountBefore = 0;
+    int cpuCountAfter = 0;
+
+    // CPUs the process can't use are ignored rather than failing the thread
+    std::jthread t([&pinned, &cpuCountBefore, &cpuCountAfter] {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        cpuCountBefore = CPU_COUNT(&cpuSet);
+
+        pinned = pinThisThreadToCpus({ -1, CPU_SETSIZE, CPU_SETSIZE + 10 });
+
+        CPU_ZERO(&cpuSet);
+        pthread_getaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        cpuCountAfter = CPU_COUNT(&cpuSet);
+    });
+
+    if (t.joinable()) {
+        t.join();
+    }
+
+    REQUIRE(!pinned);
+    REQUIRE(cpuCountAfter == cpuCountBefore);
+
+    // Only usable CPUs are kept
+    int firstCpu = getFirstUsableCpu();
+    std::vector<int> expected = { firstCpu };
+    REQUIRE(filterUsableCpus({ firstCpu, CPU_SETSIZE }) == expected);
+}
 }
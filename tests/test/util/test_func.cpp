@@ -6,6 +6,8 @@
 #include <faabric/util/config.h>
 #include <faabric/util/func.h>
 
+#include <google/protobuf/util/message_differencer.h>
+
 using namespace boost::filesystem;
 
 namespace tests {
@@ -51,6 +53,75 @@ TEST_CASE("Test batch exec factory", "[util]")
     }
 }
 
+TEST_CASE("Test serialising batch subsets", "[util]")
+{
+    std::shared_ptr<faabric::BatchExecuteRequest> req =
+      faabric::util::batchExecFactory("demo", "echo", 5);
+    req->set_snapshotkey("foobar");
+    req->set_type(faabric::BatchExecuteRequest::THREADS);
+    for (int i = 0; i < req->messages_size(); i++) {
+        auto* m = req->mutable_messages(i);
+        m->set_inputdata(std::string(100 * (i + 1), 'a' + i));
+        m->set_executeslocally(true);
+    }
+
+    std::shared_ptr<faabric::BatchExecuteRequest> header =
+      faabric::util::batchExecFactory();
+    header->set_snapshotkey(req->snapshotkey());
+    header->set_type(req->type());
+
+    std::vector<int> msgIdxs = { 1, 3, 4 };
+    std::vector<bool> directResults = { false, true, false };
+
+    std::vector<uint8_t> bytes = faabric::util::serialiseBatchSubset(
+      *header, *req, msgIdxs, directResults);
+
+    // Should be the same as copying the messages into the header
+    faabric::BatchExecuteRequest expected = *header;
+    for (int i = 0; i < msgIdxs.size(); i++) {
+        auto* m = expected.add_messages();
+        *m = req->messages().at(msgIdxs.at(i));
+        m->set_executeslocally(false);
+        if (directResults.at(i)) {
+            m->set_directresult(true);
+        }
+    }
+
+    // The bytes themselves differ, as each message has its flags appended
+    // rather than set in place, but they must parse to the same request
+    faabric::BatchExecuteRequest actual;
+    REQUIRE(actual.ParseFromArray(bytes.data(), bytes.size()));
+    REQUIRE(
+      google::protobuf::util::MessageDifferencer::Equals(actual, expected));
+    REQUIRE(actual.SerializeAsString() == expected.SerializeAsString());
+
+    REQUIRE(actual.id() == header->id());
+    REQUIRE(actual.snapshotkey() == "foobar");
+    REQUIRE(actual.messages_size() == msgIdxs.size());
+    for (int i = 0; i < msgIdxs.size(); i++) {
+        const faabric::Message& m = actual.messages().at(i);
+        const faabric::Message& orig = req->messages().at(msgIdxs.at(i));
+
+        REQUIRE(m.id() == orig.id());
+        REQUIRE(m.inputdata() == orig.inputdata());
+        REQUIRE(!m.executeslocally());
+        REQUIRE(m.directresult() == directResults.at(i));
+    }
+
+    // Original request must be untouched
+    for (const auto& m : req->messages()) {
+        REQUIRE(m.executeslocally());
+        REQUIRE(!m.directresult());
+    }
+
+    // Mismatched flags and headers with messages aren't allowed
+    std::vector<bool> shortFlags = { true };
+    REQUIRE_THROWS(faabric::util::serialiseBatchSubset(
+      *header, *req, msgIdxs, shortFlags));
+    REQUIRE_THROWS(faabric::util::serialiseBatchSubset(
+      *req, *req, msgIdxs, directResults));
+}
+
 TEST_CASE("Test adding ids to message", "[util]")
 {
     faabric::Message msgA;
@@ -0,0 +1,74 @@
+#include <catch2/catch.hpp>
+
+#include <faabric/util/hash_ring.h>
+
+#include <map>
+
+using namespace faabric::util;
+
+namespace tests {
+
+TEST_CASE("Test stable hash", "[util]")
+{
+    REQUIRE(stableHash("foo") == stableHash("foo"));
+    REQUIRE(stableHash("foo") != stableHash("bar"));
+    REQUIRE(stableHash("key_1") != stableHash("key_2"));
+}
+
+TEST_CASE("Test hash ring with no nodes", "[util]")
+{
+    REQUIRE_THROWS(HashRing({}));
+}
+
+TEST_CASE("Test hash ring spreads keys over nodes", "[util]")
+{
+    std::vector<std::string> nodes = { "hostA", "hostB", "hostC" };
+    HashRing ring(nodes);
+
+    int nKeys = 3000;
+    std::map<std::string, int> counts;
+    for (int i = 0; i < nKeys; i++) {
+        std::string key = "key_" + std::to_string(i);
+        const std::string& node = ring.getNode(key);
+
+        // Same key always goes to the same node
+        REQUIRE(ring.getNode(key) == node);
+        counts[node]++;
+    }
+
+    // Every node should get a reasonable share
+    REQUIRE(counts.size() == nodes.size());
+    for (const auto& [node, count] : counts) {
+        REQUIRE(count > nKeys / 6);
+    }
+
+    // The same nodes in the same order give the same placement
+    HashRing ringB(nodes);
+    for (int i = 0; i < 100; i++) {
+        std::string key = "key_" + std::to_string(i);
+        REQUIRE(ringB.getNode(key) == ring.getNode(key));
+    }
+}
+
+TEST_CASE("Test adding a node to a hash ring only moves keys to it", "[util]")
+{
+    HashRing ringBefore({ "hostA", "hostB", "hostC" });
+    HashRing ringAfter({ "hostA", "hostB", "hostC", "hostD" });
+
+    int nMoved = 0;
+    int nKeys = 1000;
+    for (int i = 0; i < nKeys; i++) {
+        std::string key = "key_" + std::to_string(i);
+        const std::string& before = ringBefore.getNode(key);
+        const std::string& after = ringAfter.getNode(key);
+
+        if (before != after) {
+            REQUIRE(after == "hostD");
+            nMoved++;
+        }
+    }
+
+    REQUIRE(nMoved > 0);
+    REQUIRE(nMoved < nKeys / 2);
+}
+}
@@ -279,4 +279,122 @@ TEST_CASE("Test fixed capacity queue with asymetric consume/produce rates",
     REQUIRE(producerSuccess);
     REQUIRE(consumerSuccess);
 }
+
+TEST_CASE("Test work-stealing queue operations", "[util]")
+{
+    WorkStealingQueue<int> q(3);
+
+    // Items are spread round-robin, so worker 0 gets 1 and 4
+    for (int i = 1; i < 7; i++) {
+        q.enqueue(i);
+    }
+    REQUIRE(q.size() == 6);
+
+    // Worker 0 takes its own items first, then steals from the others
+    std::vector<int> actual;
+    for (int i = 0; i < 6; i++) {
+        actual.push_back(q.dequeue(0));
+    }
+
+    std::vector<int> expected = { 1, 4, 2, 5, 3, 6 };
+    REQUIRE(actual == expected);
+    REQUIRE(q.size() == 0);
+
+    REQUIRE(!q.tryDequeue(1).has_value());
+    REQUIRE_THROWS_AS(q.dequeue(1, 1), QueueTimeoutException);
+}
+
+TEST_CASE("Test work-stealing queue high priority items", "[util]")
+{
+    WorkStealingQueue<int> q(2);
+
+    q.enqueue(1);
+    q.enqueue(2);
+    q.enqueue(3, true);
+    q.enqueue(4, true);
+
+    REQUIRE(q.dequeue(1) == 3);
+    REQUIRE(q.dequeue(0) == 4);
+    REQUIRE(q.dequeue(0) == 1);
+    REQUIRE(q.dequeue(0) == 2);
+}
+
+TEST_CASE("Test work-stealing queue with multiple consumers", "[util]")
+{
+    int nWorkers = 4;
+    int nItems = 2000;
+    WorkStealingQueue<std::promise<int32_t>> q(nWorkers);
+
+    std::vector<std::future<int32_t>> futures;
+    for (int i = 0; i < nItems; i++) {
+        std::promise<int32_t> p;
+        futures.emplace_back(p.get_future());
+        q.enqueue(std::move(p), i % 10 == 0);
+    }
+
+    // Only some of the workers consume, so the rest must be stolen
+    std::vector<std::jthread> threads;
+    for (int w = 0; w < nWorkers / 2; w++) {
+        threads.emplace_back([&q, w] {
+            while (q.size() > 0) {
+                std::optional<std::promise<int32_t>> p = q.tryDequeue(w);
+                if (p.has_value()) {
+                    p->set_value(w);
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+
+    for (auto& f : futures) {
+        REQUIRE(f.get() < nWorkers / 2);
+    }
+}
+
+TEST_CASE("Test work-stealing queue workers must be positive", "[util]")
+{
+    REQUIRE_THROWS(WorkStealingQueue<int>(0));
+}
+
+TEST_CASE("Test multi-producer queue", "[util]")
+{
+    MultiProducerQueue<int> q;
+    REQUIRE(q.empty());
+
+    int nProducers = 4;
+    int nItems = 1000;
+    std::vector<std::jthread> producers;
+    for (int p = 0; p < nProducers; p++) {
+        producers.emplace_back([&q, p, nItems] {
+            for (int i = 0; i < nItems; i++) {
+                q.enqueue(p * nItems + i);
+            }
+        });
+    }
+
+    // Consume while producing, and check each producer's items are in order
+    std::vector<int> lastSeen(nProducers, -1);
+    int nConsumed = 0;
+    bool inOrder = true;
+    while (nConsumed < nProducers * nItems) {
+        std::vector<int> items;
+        nConsumed += q.dequeueAll(items);
+
+        for (int item : items) {
+            int p = item / nItems;
+            if (item <= lastSeen.at(p)) {
+                inOrder = false;
+            }
+            lastSeen.at(p) = item;
+        }
+    }
+
+    REQUIRE(inOrder);
+    REQUIRE(q.empty());
+}
 }
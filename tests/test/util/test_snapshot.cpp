@@ -1846,6 +1846,83 @@ TEST_CASE("Test diffing byte array regions", "[util][snapshot]")
     }
 }
 
+TEST_CASE("Test applying merge values element-wise", "[snapshot][util]")
+{
+    SECTION("Int sum")
+    {
+        std::vector<int> target = { 1, 2, 3, -4 };
+        std::vector<int> diff = { 10, 0, -3, 4 };
+        std::vector<int> expected = { 11, 2, 0, 0 };
+
+        applyDiffValues(BYTES(target.data()),
+                        { BYTES(diff.data()), diff.size() * sizeof(int) },
+                        SnapshotDataType::Int,
+                        SnapshotMergeOperation::Sum);
+        REQUIRE(target == expected);
+    }
+
+    SECTION("Double max")
+    {
+        std::vector<double> target = { 1.5, -2.5, 3.5 };
+        std::vector<double> diff = { 0.5, -1.5, 4.5 };
+        std::vector<double> expected = { 1.5, -1.5, 4.5 };
+
+        applyDiffValues(BYTES(target.data()),
+                        { BYTES(diff.data()), diff.size() * sizeof(double) },
+                        SnapshotDataType::Double,
+                        SnapshotMergeOperation::Max);
+        REQUIRE(target == expected);
+    }
+
+    SECTION("Long min")
+    {
+        std::vector<long> target = { 100, 200, -300 };
+        std::vector<long> diff = { 150, 50, -100 };
+        std::vector<long> expected = { 100, 50, -300 };
+
+        applyDiffValues(BYTES(target.data()),
+                        { BYTES(diff.data()), diff.size() * sizeof(long) },
+                        SnapshotDataType::Long,
+                        SnapshotMergeOperation::Min);
+        REQUIRE(target == expected);
+    }
+
+    SECTION("Bytewise")
+    {
+        std::vector<uint8_t> target = { 1, 2, 3 };
+        std::vector<uint8_t> diff = { 4, 5 };
+        std::vector<uint8_t> expected = { 4, 5, 3 };
+
+        applyDiffValues(target.data(),
+                        diff,
+                        SnapshotDataType::Raw,
+                        SnapshotMergeOperation::Bytewise);
+        REQUIRE(target == expected);
+    }
+
+    SECTION("Misaligned")
+    {
+        std::vector<uint8_t> target(10, 0);
+        std::vector<uint8_t> diff(5, 1);
+
+        REQUIRE_THROWS(applyDiffValues(target.data(),
+                                       diff,
+                                       SnapshotDataType::Int,
+                                       SnapshotMergeOperation::Sum));
+    }
+
+    SECTION("Unsupported type")
+    {
+        std::vector<uint8_t> target(4, 0);
+        std::vector<uint8_t> diff(4, 1);
+
+        REQUIRE_THROWS(applyDiffValues(target.data(),
+                                       diff,
+                                       SnapshotDataType::Raw,
+                                       SnapshotMergeOperation::Sum));
+    }
+}
+
 TEST_CASE("Test snapshot merge region equality", "[snapshot][util]")
 {
     SECTION("Equal")
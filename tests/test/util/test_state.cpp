@@ -9,4 +9,90 @@ TEST_CASE("Test creating key for user", "[util]")
 {
     REQUIRE(faabric::util::keyForUser("foo", "bar") == "foo_bar");
 }
+
+TEST_CASE("Test adding byte ranges", "[util]")
+{
+    ByteRangeSet set;
+    REQUIRE(set.empty());
+
+    std::vector<std::pair<size_t, size_t>> toAdd;
+    std::vector<std::pair<size_t, size_t>> expected;
+
+    SECTION("Single range")
+    {
+        toAdd = { { 10, 5 } };
+        expected = { { 10, 5 } };
+    }
+
+    SECTION("Zero length")
+    {
+        toAdd = { { 10, 0 } };
+        expected = {};
+    }
+
+    SECTION("Disjoint ranges out of order")
+    {
+        toAdd = { { 20, 5 }, { 0, 2 }, { 10, 3 } };
+        expected = { { 0, 2 }, { 10, 3 }, { 20, 5 } };
+    }
+
+    SECTION("Adjacent ranges")
+    {
+        toAdd = { { 0, 5 }, { 10, 5 }, { 5, 5 } };
+        expected = { { 0, 15 } };
+    }
+
+    SECTION("Overlapping ranges")
+    {
+        toAdd = { { 5, 10 }, { 0, 7 }, { 12, 10 } };
+        expected = { { 0, 22 } };
+    }
+
+    SECTION("Range covering several others")
+    {
+        toAdd = { { 2, 1 }, { 5, 1 }, { 8, 1 }, { 30, 1 }, { 1, 10 } };
+        expected = { { 1, 10 }, { 30, 1 } };
+    }
+
+    SECTION("Range inside another")
+    {
+        toAdd = { { 0, 100 }, { 20, 10 } };
+        expected = { { 0, 100 } };
+    }
+
+    for (const auto& [offset, length] : toAdd) {
+        set.add(offset, length);
+    }
+
+    REQUIRE(set.getRanges() == expected);
+    REQUIRE(set.getRangeCount() == expected.size());
+
+    set.clear();
+    REQUIRE(set.empty());
+}
+
+TEST_CASE("Test checking byte ranges are contained", "[util]")
+{
+    ByteRangeSet set;
+    set.add(10, 10);
+    set.add(30, 5);
+
+    REQUIRE(set.contains(10, 10));
+    REQUIRE(set.contains(12, 3));
+    REQUIRE(set.contains(19, 1));
+    REQUIRE(set.contains(30, 5));
+    REQUIRE(set.contains(50, 0));
+
+    REQUIRE(!set.contains(0, 1));
+    REQUIRE(!set.contains(9, 2));
+    REQUIRE(!set.contains(19, 2));
+    REQUIRE(!set.contains(15, 20));
+    REQUIRE(!set.contains(20, 1));
+    REQUIRE(!set.contains(34, 2));
+
+    // Filling in the gap should make the whole range contained
+    set.add(20, 10);
+    REQUIRE(set.contains(10, 25));
+    REQUIRE(set.getRangeCount() == 1);
+}
 }
@@ -3,6 +3,7 @@
 #include <sys/mman.h>
 
 #include <faabric/proto/faabric.pb.h>
+#include <faabric/redis/AsyncRedis.h>
 #include <faabric/redis/Redis.h>
 #include <faabric/scheduler/ExecutorContext.h>
 #include <faabric/scheduler/ExecutorFactory.h>
@@ -32,9 +33,16 @@ class RedisTestFixture
     RedisTestFixture()
       : redis(faabric::redis::Redis::getQueue())
     {
+        // Make sure nothing from previous tests lands after the flush
+        faabric::redis::AsyncRedis::getQueue().flush();
+        redis.flushAll();
+    }
+
+    ~RedisTestFixture()
+    {
+        faabric::redis::AsyncRedis::getQueue().flush();
         redis.flushAll();
     }
-    ~RedisTestFixture() { redis.flushAll(); }
 
   protected:
     faabric::redis::Redis& redis;